@@ -6,14 +6,223 @@
 #include <limits>   
 #include <string>   
 #include <sstream>   
+#include <vector>     // 分区清单等动态列表
+#include <filesystem> // 分区目录的创建与文件删除
+#include <cstdint>    // 定宽整数 (列式文件的 int32/int64 列)
+#include <cstring>    // memcpy
+#include <cmath>      // llround (金额与"分"之间的换算)
+#include <unordered_map> // 预算与月度累计的哈希表 (O(1) 查找)
+#include <unordered_set> // 导入时尚未插入的记录的重复检测键
+#include <algorithm>  // sort
+#include <map>        // 结算档案 (按年月有序)
+#include <tuple>      // TeeSink 组合多个输出端
+#include <chrono>     // 查询耗时统计
+#include <cctype>     // 过滤表达式的词法分析
+#include <set>        // 分区的删除标记 (墓碑) 集合
+#include <queue>      // 多账本归并的最小堆
+#include <random>     // 记录编号生成
+#include <thread>     // CSV 导入流水线的读取线程和解析线程
+#include <atomic>     // 无锁队列的读写下标
+#include <memory>     // unique_ptr (队列含原子成员，不能放进 vector 直接移动)
+#include <functional> // 文件读写完成回调、线程池任务
+#include <mutex>      // 线程池的任务队列
+#include <shared_mutex> // 核心接口的读写锁 (读操作并发执行)
+#include <condition_variable>
+#include <deque>
+#include <string_view> // 在文件缓冲区上直接解析 (不必先转成 std::string)
+#include <optional>    // Expense::create 在数据无效时不返回对象
+#include <fcntl.h>    // open
+#include <unistd.h>   // pread/pwrite/close
+#include <sys/stat.h> // fstat (读取前确定文件大小)
+#include <sys/mman.h> // 映射 io_uring 的提交/完成队列
+#include <sys/syscall.h>
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h> // 只用内核头文件中的结构定义，直接调用系统调用，不依赖 liburing
+#endif
 
 using namespace std; 
 
+/*
+【内存统计】按子系统统计内存: 当前字节数、峰值、分配次数和释放次数。
+- 记录: ExpenseStore 的分块数组、外部排序的记录缓冲
+- 字符串: 记录的描述和类别占用的堆内存 (短字符串存放在 Expense 对象内部，不计)
+- 索引: 列式快照、月度累计、汇总立方体、位图索引、重复检测索引
+- I/O 缓冲: 读写文件的内容、CSV 导入的数据块
+容器通过 `SubsystemAllocator<T, 子系统>` 分配 (见下面的 TrackedVector 等别名)；记录的两个字符串仍是 std::string，
+由 Expense 在构造、赋值和析构时把堆内存的增减记到"字符串"上。计数器是原子变量 (解析线程、后台结算线程也会分配)，
+只做宽松顺序的加减。编译时定义 EXPENSE_UNTRACKED_ALLOCATOR 则改用 std::allocator，用来比较统计本身的开销。
+*/
+enum MemorySubsystem {
+	MEMORY_RECORDS,
+	MEMORY_STRINGS,
+	MEMORY_INDEXES,
+	MEMORY_IO_BUFFERS,
+	MEMORY_SUBSYSTEM_COUNT
+};
+
+const char* const MEMORY_SUBSYSTEM_NAMES[MEMORY_SUBSYSTEM_COUNT] = { "记录", "字符串", "索引", "I/O 缓冲" };
+
+class MemoryCounter {
+public:
+	atomic<int64_t> bytes;          // 当前占用
+	atomic<int64_t> peak;           // 占用的最大值
+	atomic<uint64_t> allocations;
+	atomic<uint64_t> deallocations;
+
+	MemoryCounter() : bytes(0), peak(0), allocations(0), deallocations(0) {}
+
+	void allocate(size_t n) {
+		int64_t now = bytes.fetch_add((int64_t)n, memory_order_relaxed) + (int64_t)n;
+		allocations.fetch_add(1, memory_order_relaxed);
+		int64_t seen = peak.load(memory_order_relaxed);
+		while (now > seen && !peak.compare_exchange_weak(seen, now, memory_order_relaxed)) {}
+	}
+	void release(size_t n) {
+		bytes.fetch_sub((int64_t)n, memory_order_relaxed);
+		deallocations.fetch_add(1, memory_order_relaxed);
+	}
+	void adjust(int64_t delta) { // 字符串缓冲区的增减
+		if (delta > 0) allocate((size_t)delta);
+		else if (delta < 0) release((size_t)-delta);
+	}
+};
+
+MemoryCounter memoryCounters[MEMORY_SUBSYSTEM_COUNT];
+
+// 【统计分配器】满足标准库分配器的要求，内存由 `::operator new` 分配，同时记在子系统 S 的计数器上。
+template <typename T, MemorySubsystem S>
+class TrackedAllocator {
+public:
+	typedef T value_type;
+	template <typename U> struct rebind { typedef TrackedAllocator<U, S> other; };
+
+	TrackedAllocator() noexcept {}
+	template <typename U> TrackedAllocator(const TrackedAllocator<U, S>&) noexcept {}
+
+	T* allocate(size_t n) {
+		T* p = static_cast<T*>(::operator new(n * sizeof(T)));
+		memoryCounters[S].allocate(n * sizeof(T));
+		return p;
+	}
+	void deallocate(T* p, size_t n) noexcept {
+		memoryCounters[S].release(n * sizeof(T));
+		::operator delete(p);
+	}
+};
+
+template <typename T, typename U, MemorySubsystem S>
+bool operator==(const TrackedAllocator<T, S>&, const TrackedAllocator<U, S>&) { return true; }
+template <typename T, typename U, MemorySubsystem S>
+bool operator!=(const TrackedAllocator<T, S>&, const TrackedAllocator<U, S>&) { return false; }
+
+#ifdef EXPENSE_UNTRACKED_ALLOCATOR
+template <typename T, MemorySubsystem S> using SubsystemAllocator = allocator<T>;
+#else
+template <typename T, MemorySubsystem S> using SubsystemAllocator = TrackedAllocator<T, S>;
+#endif
+
+template <typename T, MemorySubsystem S>
+using TrackedVector = vector<T, SubsystemAllocator<T, S> >;
+template <typename K, typename V, MemorySubsystem S>
+using TrackedHashMap = unordered_map<K, V, hash<K>, equal_to<K>, SubsystemAllocator<pair<const K, V>, S> >;
+typedef basic_string<char, char_traits<char>, SubsystemAllocator<char, MEMORY_IO_BUFFERS> > IoBuffer; // 文件内容等 I/O 缓冲区
+
+// 记一笔字符串堆内存的增减 (Expense 使用)。
+inline void trackStringBytes(int64_t delta) {
+#ifndef EXPENSE_UNTRACKED_ALLOCATOR
+	if (delta != 0) memoryCounters[MEMORY_STRINGS].adjust(delta);
+#else
+	(void)delta;
+#endif
+}
+
+// 字符串在堆上占用的字节数 (容量不超过对象内部的短字符串缓冲区时为 0)。
+inline size_t stringHeapBytes(const string& s) {
+	static const size_t inlineCapacity = string().capacity();
+	return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+}
+
+// 字节数的可读形式 (B / KB / MB)。
+string formatMemoryBytes(int64_t bytes) {
+	ostringstream out;
+	out << fixed << setprecision(1);
+	if (bytes >= (1 << 20)) out << bytes / 1048576.0 << " MB";
+	else if (bytes >= (1 << 10)) out << bytes / 1024.0 << " KB";
+	else out << bytes << " B";
+	return out.str();
+}
+
+// 【内存摘要】一行: 各子系统的当前占用 (I/O 缓冲为峰值，读写完成后缓冲区即释放)。附在各项性能数据之后。
+string memoryUsageLine() {
+	ostringstream out;
+	out << "内存: ";
+	for (int s = 0; s < MEMORY_SUBSYSTEM_COUNT; ++s) {
+		bool peakOnly = s == MEMORY_IO_BUFFERS;
+		int64_t value = peakOnly ? memoryCounters[s].peak.load() : memoryCounters[s].bytes.load();
+		out << (s > 0 ? "，" : "") << MEMORY_SUBSYSTEM_NAMES[s] << (peakOnly ? "峰值 " : " ") << formatMemoryBytes(value);
+	}
+	return out.str();
+}
+
+// 【内存输入流】直接在已读入的缓冲区上按行解析，不像 istringstream 那样先复制一份。
+class MemoryStreamBuffer : public streambuf {
+public:
+	MemoryStreamBuffer(const char* data, size_t length) {
+		char* begin = const_cast<char*>(data); // 只读: streambuf 的接口要求 char*，但不会写入
+		setg(begin, begin, begin + length);
+	}
+};
+
+// 【日历规则 (编译期常量)】平年各月的天数，闰年 2 月另加一天。
+constexpr int DAYS_IN_MONTH[13] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+constexpr bool isLeapYear(int y) {
+	return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+constexpr int daysInMonth(int y, int m) {
+	return (m == 2 && isLeapYear(y)) ? 29 : DAYS_IN_MONTH[m];
+}
+
+// 年份限定在 1-9999，保证 yyyymmdd 能放进 32 位整数。
+constexpr bool isValidDate(int y, int m, int d) {
+	return y >= 1 && y <= 9999 && m >= 1 && m <= 12 && d >= 1 && d <= daysInMonth(y, m);
+}
+
+static_assert(daysInMonth(2024, 2) == 29 && daysInMonth(2025, 2) == 28, "闰年 2 月有 29 天");
+static_assert(daysInMonth(1900, 2) == 28 && daysInMonth(2000, 2) == 29, "整百年只有能被 400 整除时才是闰年");
+
+// 【日期】把年月日压缩成一个 32 位整数 yyyymmdd。
+// 整数大小与日期先后一致，比较两个日期只需一次整数比较；按月、按年的期间也就是一段连续的整数区间。
+class Date {
+public:
+	constexpr Date() : packed(0) {}
+	constexpr Date(int y, int m, int d) : packed((uint32_t)(y * 10000 + m * 100 + d)) {}
+
+	constexpr int year() const { return (int)(packed / 10000); }
+	constexpr int month() const { return (int)(packed / 100 % 100); }
+	constexpr int day() const { return (int)(packed % 100); }
+	constexpr uint32_t value() const { return packed; } // yyyymmdd，也是数据文件中的日期字段
+	constexpr bool valid() const { return isValidDate(year(), month(), day()); }
+
+	constexpr bool operator==(const Date& o) const { return packed == o.packed; }
+	constexpr bool operator!=(const Date& o) const { return packed != o.packed; }
+	constexpr bool operator<(const Date& o) const { return packed < o.packed; }
+	constexpr bool operator<=(const Date& o) const { return packed <= o.packed; }
+	constexpr bool operator>(const Date& o) const { return packed > o.packed; }
+	constexpr bool operator>=(const Date& o) const { return packed >= o.packed; }
+
+private:
+	uint32_t packed;
+};
+
+static_assert(Date(2025, 2, 28) < Date(2025, 3, 1) && Date(2024, 12, 31) < Date(2025, 1, 1), "日期按整数排序");
+static_assert(!Date(2025, 2, 31).valid() && Date(2024, 2, 29).valid(), "日期校验");
+
 class Expense {
 private:
-	int year;
-	int month;
-	int day;
+	uint64_t id; // 稳定的记录编号 (同步时用来对应两份账本中的同一条记录)，0 表示尚未分配
+	Date date;
 	string description;
 	double amount;
 	string category;
@@ -65,25 +274,76 @@ public:
 	// 【构造函数 - `Expense()`】
 	// 构造函数是一种特殊的成员函数，当创建类的一个新对象 (实例) 时，它会自动被调用。
 	// 默认构造函数
-	Expense() : year(0), month(0), day(0), amount(0.0) {
+	// 得到的是"未初始化"的对象 (日期为 0)，只用作解析文件时 `setData` 的目标或容器的占位；
+	// 需要一条有效记录时用下面的 `create`。
+	Expense() : id(0), amount(0.0) {
 	
 	}
 
-	
-	void setData(int y, int m, int d, const string& desc, double amt, const string& cat) {
-		year = y;
-		month = m;
-		day = d;
+	// 【创建一条有效记录】日期按月份实际天数和闰年规则校验，金额不能为负。
+	// 数据无效时不返回对象，因此拿到的 Expense 一定处于有效状态。
+	static optional<Expense> create(int y, int m, int d, const string& desc, double amt, const string& cat) {
+		Expense e;
+		if (amt < 0 || !e.setData(y, m, d, desc, amt, cat)) return nullopt;
+		return e;
+	}
+
+	// 拷贝、移动、赋值和析构时把两个字符串堆内存的增减记到内存统计的"字符串"上。
+	Expense(const Expense& other)
+		: id(other.id), date(other.date), description(other.description), amount(other.amount), category(other.category) {
+		trackStringBytes((int64_t)heapBytes());
+	}
+	Expense(Expense&& other) noexcept
+		: id(other.id), date(other.date), description(move(other.description)), amount(other.amount), category(move(other.category)) {
+		trackStringBytes((int64_t)other.heapBytes()); // 缓冲区随移动转给本对象；对方若还留有缓冲区则另计
+	}
+	Expense& operator=(const Expense& other) {
+		int64_t before = (int64_t)heapBytes();
+		id = other.id;
+		date = other.date;
+		description = other.description;
+		amount = other.amount;
+		category = other.category;
+		trackStringBytes((int64_t)heapBytes() - before);
+		return *this;
+	}
+	Expense& operator=(Expense&& other) noexcept {
+		int64_t before = (int64_t)(heapBytes() + other.heapBytes());
+		id = other.id;
+		date = other.date;
+		description = move(other.description);
+		amount = other.amount;
+		category = move(other.category);
+		trackStringBytes((int64_t)(heapBytes() + other.heapBytes()) - before);
+		return *this;
+	}
+	~Expense() { trackStringBytes(-(int64_t)heapBytes()); }
+
+	// 描述和类别在堆上占用的字节数。
+	size_t heapBytes() const { return stringHeapBytes(description) + stringHeapBytes(category); }
+
+	// 【设置数据】日期在这里统一校验 (按月份实际天数和闰年规则)。
+	// 日期无效时不修改对象并返回 false，由调用方决定提示用户还是跳过该记录。
+	bool setData(int y, int m, int d, const string& desc, double amt, const string& cat) {
+		if (!isValidDate(y, m, d)) return false;
+		int64_t before = (int64_t)heapBytes();
+		date = Date(y, m, d);
 		description = desc;
 		amount = amt;
 		category = cat;
-        
+		trackStringBytes((int64_t)heapBytes() - before);
+		return true;
 	}
 
+	// 记录编号不属于记录内容: `setData` 不修改它，内容哈希与重复检测也不包含它。
+	void setId(uint64_t newId) { id = newId; }
+
 	// Getter 方法
-	int getYear() const { return year; }
-	int getMonth() const { return month; }
-	int getDay() const { return day; }
+	uint64_t getId() const { return id; }
+	const Date& getDate() const { return date; }
+	int getYear() const { return date.year(); }
+	int getMonth() const { return date.month(); }
+	int getDay() const { return date.day(); }
 	const string& getDescription() const { return description; }
 	double getAmount() const { return amount; }
 	const string& getCategory() const { return category; }
@@ -100,211 +360,3272 @@ public:
 };
 
 
-const int MAX_EXPENSES = 1000; 
+// 【日历换算辅助函数】公历日期与"自 1970-01-01 起的天数"之间的互相换算 (列式文件的 date32 列使用)。
+// 算法按 400 年一个周期 (146097 天) 计算，对任意年份都成立。
+int daysFromCivil(int y, int m, int d) {
+	y -= m <= 2;                                         // 把 1、2 月算作上一年的末尾，闰日就落在"年"的最后一天
+	int era = (y >= 0 ? y : y - 399) / 400;              // 第几个 400 年周期
+	int yoe = y - era * 400;                             // 周期内的年 [0, 399]
+	int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1; // 从 3 月 1 日起算的年内天数 [0, 365]
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;     // 周期内的天数 [0, 146096]
+	return era * 146097 + doe - 719468;                  // 719468 = 0000-03-01 到 1970-01-01 的天数
+}
+
+void civilFromDays(int z, int& y, int& m, int& d) {
+	z += 719468;
+	int era = (z >= 0 ? z : z - 146096) / 146097;
+	int doe = z - era * 146097;
+	int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	int mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = mp + (mp < 10 ? 3 : -9);
+	y = yoe + era * 400 + (m <= 2);
+}
+
+const int MAX_EXPENSES = 1000000; // 内存中记录数上限 (按日期分块存放，数量多时插入也不需要整体移动)
 const int MAX_UNIQUE_CATEGORIES_PER_MONTH = 20;
-const char* DATA_FILE = "expenses.dat";
+const char* DATA_FILE = "expenses.dat"; // 旧版单文件数据 (仅在分区清单不存在时读取并迁移)
 const char* SETTLEMENT_FILE = "settlement_status.txt";
+const char* PARTITION_DIR = "expenses_data";              // 按月分区的数据目录
+const char* MANIFEST_FILE = "expenses_data/manifest.txt"; // 分区清单: 记录每个分区的年月与记录数
+const char* COLUMNAR_FILE = "expenses.arrow";             // 列式导出/导入的默认文件名
+const char* BUDGET_FILE = "budgets.txt";                  // 类别预算 (与 SETTLEMENT_FILE 放在同一目录)
+const double BUDGET_WARNING_RATIO = 0.8;                  // 已用预算达到该比例时提醒
+const char* SETTLEMENT_ARCHIVE_FILE = "settlement_archive.txt"; // 已结算月份的报告缓存
+const char* CATEGORY_FILE = "categories.txt";             // 已知类别与别名表
+const char* BITMAP_INDEX_FILE = "expenses_data/bitmaps.idx"; // 各分区按类别的压缩位图索引
+const char BITMAP_INDEX_MAGIC[8] = { 'E', 'X', 'P', 'B', 'M', 'P', '1', 0 }; // 位图索引文件头
+const char* ANOMALY_FILE = "expenses_data/anomalies.txt"; // 各类别的滚动统计与被标记的异常开销
+const double ANOMALY_EWMA_ALPHA = 0.05;                   // 滚动均值/方差的平滑系数 (约等于最近 20 条记录的窗口)
+const long ANOMALY_MIN_SAMPLES = 10;                      // 类别的记录数达到该值后才开始判断异常
+const double ANOMALY_SIGMAS = 4.0;                        // 超出均值的标准差倍数
+const double ANOMALY_MIN_RATIO = 3.0;                     // 同时至少是均值的倍数 (避免金额固定的类别因方差很小而误报)
+const size_t MAX_CATEGORY_SUGGESTIONS = 10;               // 类别补全最多列出的候选数
 
-class ExpenseTracker {
-private:
-	Expense allExpenses[MAX_EXPENSES]; // Expense 对象数组
-	int expenseCount;                  // 当前开销数量
+// 【类别预算】
+// year 和 month 都为 0 表示"每个月"的默认预算；指定年月的预算优先于默认预算。
+class BudgetEntry {
+public:
+	int year;
+	int month;
+	string category;
+	double amount;
 
-	// 私有辅助方法
-	void clearInputBuffer();
-	void readLastSettlement(int& lastYear, int& lastMonth);
-	void writeLastSettlement(int year, int month);
-	void generateMonthlyReportForSettlement(int year, int month);
+	BudgetEntry() : year(0), month(0), amount(0.0) {}
+};
 
+// 【结算档案条目】
+// 保存一个已结算月份的计算结果，重新打印该月结算报告时直接读取，无需重新汇总记录。
+class SettlementReport {
 public:
-	ExpenseTracker();  // 构造函数
-	~ExpenseTracker(); // 析构函数 (可选, 此处为空)
+	int year;
+	int month;
+	int recordCount;
+	double total;
+	uint64_t contentHash;            // 该月所有记录内容的校验值 (与记录顺序无关)
+	vector<CategorySum> categories;  // 按类别汇总
 
-	void run(); // 运行主程序循环
+	SettlementReport() : year(0), month(0), recordCount(0), total(0.0), contentHash(0) {}
+};
 
-	// 公共接口方法
-	void addExpense();
-	void displayAllExpenses();
-	void displayMonthlySummary();
-	// void generateSimpleChart(); // Removed
-	void listExpensesByPeriod(); // Added
-	void saveExpenses();
-	bool loadExpenses();
-	void deleteExpense();
-	void performAutomaticSettlement();
+// 【FNV-1a 64 位哈希】用于计算记录内容的校验值。
+uint64_t fnv1a64(const string& data, uint64_t hash = 14695981039346656037ULL) {
+	for (size_t i = 0; i < data.size(); ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// 【单条记录的内容哈希】把所有字段 (金额按"分") 拼接后求哈希。
+uint64_t recordContentHash(const Expense& e) {
+	return fnv1a64(to_string(e.getYear()) + "," + to_string(e.getMonth()) + "," + to_string(e.getDay()) + "," +
+				   e.getDescription() + "," + to_string(llround(e.getAmount() * 100)) + "," + e.getCategory());
+}
+
+// 【重复检测键】同一天、同一金额 (按分)、描述相同 (忽略首尾空白、连续空白和英文大小写) 的记录视为重复。
+// 只保存 64 位哈希，索引每条记录只占一个整数键，百万条记录也能常驻内存。
+uint64_t duplicateKey(const Expense& e) {
+	string normalized = to_string(e.getDate().value()) + "," + to_string(llround(e.getAmount() * 100)) + ",";
+	bool started = false, pendingSpace = false;
+	for (size_t i = 0; i < e.getDescription().size(); ++i) {
+		unsigned char c = e.getDescription()[i];
+		if (isspace(c)) { pendingSpace = true; continue; }
+		if (pendingSpace && started) normalized += ' '; // 连续空白合并为一个空格，首部空白丢弃
+		started = true;
+		pendingSpace = false;
+		normalized += (char)tolower(c);
+	}
+	return fnv1a64(normalized);
+}
+
+// 【重复记录处理策略】
+enum DuplicatePolicy {
+	DUPLICATE_SKIP,  // 跳过重复的新记录
+	DUPLICATE_FLAG,  // 照常加入，但提示并列入重复记录报告
+	DUPLICATE_MERGE  // 不新增记录，把新记录的类别合并到已有记录上
 };
 
-// --- ExpenseTracker 类成员函数实现 ---
-/*
-!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-!!! CRITICAL REFACTORING POINT / 核心重构点: MVC 架构分离 !!!
-!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-TODO: UI逻辑、业务逻辑、控制逻辑必须分离！采用MVC (Model-View-Controller) 设计模式。
+// 对一条新记录执行策略的结果。
+enum DuplicateAction {
+	DUPLICATE_NONE,     // 没有重复，照常加入
+	DUPLICATE_SKIPPED,
+	DUPLICATE_FLAGGED,  // 重复，但仍照常加入
+	DUPLICATE_MERGED
+};
 
-      目标是将当前混合的逻辑拆分成三个明确职责的组件:
+// 【月份-类别键】把 (年, 月, 类别) 拼成一个字符串，作为预算表和月度累计表的哈希键。
+string monthCategoryKey(int year, int month, const string& category) {
+	return to_string(year) + "-" + to_string(month) + "|" + category;
+}
 
-      1. M - Model (模型层 - 例如: 新建类 `ExpenseService` 或 `ExpenseModel`):
-         职责:
-         -   管理应用程序的核心数据 (例如: `allExpenses` 数组, `expenseCount`) 和状态。
-         -   包含所有的业务规则和数据处理逻辑 (例如: 添加、删除、查询开销的实际操作，数据验证，计算统计，文件保存与加载，自动结算逻辑)。
-         -   完全独立于用户界面。Model 不知道数据将如何显示，也不知道用户如何输入数据。
-         -   提供清晰的接口供 Controller 调用 (例如: `bool createExpense(data)`, `vector<Expense> getAllExpenses()`, `bool saveExpensesToFile()`, `MonthlySummaryData generateMonthlySummary(year, month)`)。
-         -   示例: `DATA_FILE`, `SETTLEMENT_FILE`, `MAX_EXPENSES` 这些常量和相关文件操作逻辑应属于 Model。
+// 【预算查找】先找该月的专门预算，没有时找每月都适用的默认预算。
+const BudgetEntry* findBudgetIn(const unordered_map<string, BudgetEntry>& table, int year, int month, const string& category) {
+	auto it = table.find(monthCategoryKey(year, month, category));
+	if (it == table.end()) it = table.find(monthCategoryKey(0, 0, category));
+	return it == table.end() ? nullptr : &it->second;
+}
 
-      2. V - View (视图层 - 例如: 新建类 `ExpenseTrackerConsoleUI`):
-         职责:
-         -   负责所有与用户的直接交互，即输入和输出。
-         -   显示数据给用户 (例如: 打印菜单、列表、报告、提示信息、错误信息)。
-         -   从用户获取输入 (例如: 读取菜单选项、开销详情)。
-         -   不包含任何业务逻辑。它只是一个"哑"的界面，根据 Controller 的指令显示信息或收集输入。
-         -   提供接口供 Controller 调用 (例如: `int displayMainMenu()`, `ExpenseData promptForNewExpenseData()`, `void displayExpenses(const vector<Expense>& expenses)`, `void showMessage(const string& message)`)。
+// 【分区元数据】
+// 每个分区对应一个自然月的数据文件 (expenses_data/YYYY-MM.dat)。
+// 清单只记录年月与记录数，程序启动时只读取清单，分区文件在被查询用到时才加载。
+class PartitionInfo {
+public:
+	int year;
+	int month;
+	int recordCount; // 该分区的记录数 (已加载时随增删实时维护，未加载时取自清单)
+	bool loaded;     // 分区文件是否已读入内存
+	bool dirty;      // 分区是否有未保存的修改，保存时只重写 dirty 的分区
+	uint64_t blockHash;       // 分区内容 (记录与删除标记) 的校验值，记在清单中供同步比较；0 表示未知
+	set<uint64_t> tombstones; // 已删除记录的编号 (删除标记)，随分区文件保存，同步时把删除传给另一份账本
 
-      3. C - Controller (控制器层 - 当前的 `ExpenseTracker` 类将演变为此角色):
-         职责:
-         -   作为 Model 和 View 之间的协调者和中介。
-         -   接收来自 View 的用户请求/输入 (例如，用户选择了"添加开销"菜单项)。
-         -   根据用户请求调用 Model 的相应方法来处理数据或执行业务逻辑。
-         -   获取 Model 处理后的结果。
-         -   选择合适的 View 来更新显示，将结果呈现给用户。
-         -   管理应用程序的流程和状态转换。
-         -   示例: `ExpenseTracker::run()` 方法将是主要的控制循环。当用户选择"添加开销"时：
-             a. `Controller::run()` 调用 `View::promptForNewExpenseData()` 获取用户输入的开销信息。
-             b. 如果数据有效, `Controller` 调用 `Model::createExpense(expenseData)`。
-             c. `Model` 执行添加逻辑，返回成功/失败状态。
-             d. `Controller` 根据 `Model` 的返回，调用 `View::showMessage()` 显示相应信息。
+	PartitionInfo() : year(0), month(0), recordCount(0), loaded(false), dirty(false), blockHash(0) {}
+};
 
-      重构步骤建议:
-      A. 先定义 `ExpenseService` (Model) 和 `ExpenseTrackerConsoleUI` (View) 的接口和基本骨架。
-      B. 逐步将 `ExpenseTracker` 方法中的业务逻辑和数据存储迁移到 `ExpenseService`。
-      C. 逐步将 `ExpenseTracker` 方法中的 `cout` 和 `cin` 迁移到 `ExpenseTrackerConsoleUI`。
-      D. 修改 `ExpenseTracker` (Controller) 的方法，使其调用新的 Model 和 View 完成任务。
+// 【记录编号的文本形式】16 位十六进制，写在数据文件每行的开头 ("@编号,")。
+string formatRecordId(uint64_t id) {
+	char buffer[17];
+	snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)id);
+	return buffer;
+}
 
-      这样做的好处:
-      -   高内聚，低耦合：每个组件职责单一，修改一个组件不轻易影响其他组件。
-      -   可维护性：逻辑清晰，更容易理解和修改。
-      -   可测试性：Model 可以独立于 UI 进行单元测试。
-      -   灵活性：未来如果想更换 UI (例如图形界面)，理论上只需替换 View 层。
-!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-*/
+// 【分区校验值】每条记录 (编号 + 内容) 和每个删除标记各自求哈希后相加，与顺序无关。
+// 两份账本同一个月的校验值相同，就可以认为这个月的内容一致而不必读取分区文件。
+const uint64_t EMPTY_BLOCK_HASH = 0x9E3779B97F4A7C15ULL; // 空分区的校验值 (非 0，0 留作"未知")
 
-// 【开发者提示解读：关于代码的"整理房间"——MVC模式】
-// 上面这段非常长的、被 `/* ... */` 和很多感叹号包围的注释，是程序员写给其他程序员看的，关于如何把代码写得更整洁、更有条理的专业建议。
-// 它在说："我们这个开销追踪程序，现在把所有事情都放在一个大抽屉 (`ExpenseTracker` 类) 里了，以后东西多了可能会乱。我们应该学习一种叫做 MVC 的整理方法。"
-//
-// MVC 是什么？
-// 想象一下餐馆的运作：
-// -   Model (模型 M - 管理数据和规则)：就像是餐馆的【后厨】。负责管理食材 (数据)，处理订单 (业务逻辑)，比如计算总价、保存记录等。后厨不直接跟顾客打交道。
-// -   View (视图 V - 展示给用户看/用户操作的界面)：就像是餐馆的【菜单和餐桌上的食物】。负责把菜品 (数据) 好看地展示给顾客，以及记录顾客点的菜 (用户输入)。菜单本身不做菜。
-// -   Controller (控制器 C - 指挥官)：就像是餐馆的【服务员】。服务员在顾客和后厨之间跑腿。他把顾客的点单 (来自View的请求)告诉后厨 (调用Model)，然后把做好的菜 (来自Model的结果)端给顾客 (更新View)。
-//
-// 这段注释建议我们把 `ExpenseTracker` 程序也这样分开：
-// 1.  **Model (模型层)**：专门负责所有的数据处理。比如 `allExpenses` 数组、`expenseCount` 变量，还有保存文件、从文件加载、计算月度总结这些具体的数据操作，都应该放到 Model 里。它不关心这些数据怎么显示给用户。
-// 2.  **View (视图层)**：专门负责和用户打交道。所有 `cout` (在屏幕上显示东西) 和 `cin` (从键盘读取东西) 的代码，比如显示菜单、打印开销列表、提示用户输入等，都应该放到 View 里。它不处理具体的数据逻辑。
-// 3.  **Controller (控制器层)**：现在的 `ExpenseTracker` 类慢慢变成这个角色。它会接收用户的操作 (比如用户选了"添加开销")，然后告诉 Model 去做相应的数据处理，拿到结果后，再告诉 View 把结果显示出来。
-//
-// 为什么要这么做（好处）？
-// -   **代码更清晰**：每个部分只做自己的事，就像餐馆里厨师专心做菜，服务员专心服务一样。找问题、改东西都更容易。
-// -   **更容易维护和修改**：如果想改菜单样式 (View)，不用动后厨 (Model) 的代码。如果想改菜品价格计算方法 (Model)，顾客看到的菜单 (View) 可能不用变。
-// -   **更容易测试**：可以单独测试后厨 (Model) 的功能好不好用，不用真的找个顾客来点单。
-// -   **更灵活**：以后如果想把现在的命令行界面换成漂亮的图形窗口界面，理论上只需要换掉 View 部分，Model 和 Controller 可能不用大改。
-//
-// 对于初学者：
-// 这是一种让代码结构更棒的设计思想。目前程序的功能是正常的。等你对C++更熟悉了，学习这种设计模式会对编写大型程序非常有帮助。
-// 现在，我们可以继续看 `ExpenseTracker` 类里的函数是怎么具体工作的。
+uint64_t recordBlockHash(const Expense& e) {
+	return fnv1a64(formatRecordId(e.getId()), recordContentHash(e));
+}
 
-// 【ExpenseTracker 构造函数实现】
-// `ExpenseTracker::` // 这个双冒号叫做作用域解析运算符，它表明我们现在定义的是属于 `ExpenseTracker` 类的那个名为 `ExpenseTracker` 的函数（也就是构造函数）。
-// `: expenseCount(0)` // 这是成员初始化列表。在构造函数体执行之前，它会把成员变量 `expenseCount` 初始化为0。
-//                   // 对于类来说，这是一种推荐的初始化成员变量的方式，比在函数体内部赋值更高效。
-ExpenseTracker::ExpenseTracker() : expenseCount(0) {
-	// `if (loadExpenses())` // 调用本类 (ExpenseTracker对象自己) 的 `loadExpenses()` 方法，尝试从文件中加载已保存的开销数据。
-	                       // `loadExpenses()` 会返回一个布尔值 (`true` 或 `false`)。
-	if (loadExpenses()) { // 如果 `loadExpenses()` 返回 `true` (表示数据成功加载)
-		// `cout` // 是 `iostream` 库中提供的标准输出流对象，通常用于向控制台（屏幕）输出信息。
-		// `<<`  // 是流插入运算符，它把右边的内容发送到左边的流中。
-		// `expenseCount` // 此处是成员变量 `expenseCount`，它在 `loadExpenses()` 成功后会被更新为加载的记录条数。
-		// `" 条历史记录。\n"` // 这是一个字符串字面量。`\n` 是一个转义字符，代表换行，使后续输出从新的一行开始。
-		cout << "成功加载 " << expenseCount << " 条历史记录。\n"; // 在屏幕上打印加载成功的消息和记录数量。
-	} else { // `else` 分支：如果 `loadExpenses()` 返回 `false` (表示加载失败，比如文件不存在或文件内容损坏)
-		cout << "未找到历史数据文件或加载失败，开始新的记录。\n"; // 在屏幕上打印相应的提示信息。
-	}
-	// `performAutomaticSettlement()` // 调用本类的 `performAutomaticSettlement()` 方法。
-	                               // 这个方法用于检查并自动处理（例如生成报告）过去月份中尚未结算的开销数据。
-	                               // 这样程序每次启动时，都会确保历史数据的完整性。
-	performAutomaticSettlement(); // 执行自动结算检查。
-} // 构造函数结束
+uint64_t tombstoneBlockHash(uint64_t id) {
+	return fnv1a64("~" + formatRecordId(id));
+}
 
-// 【ExpenseTracker 析构函数实现】
-// `~ExpenseTracker()` // 这是 `ExpenseTracker` 类的析构函数。析构函数在对象生命周期结束时（例如，`main`函数中的`tracker`对象在`main`函数结束时）自动被调用。
-                    // 它的主要用途是释放对象在生命周期内可能获取的资源（如动态分配的内存、打开的文件等）。
-                    // 析构函数的名称是类名前面加一个波浪号 `~`，并且没有参数，也没有返回类型。
-ExpenseTracker::~ExpenseTracker() {
-	// 这个析构函数的函数体是空的。
-	// 在这个特定的程序中，数据保存是在用户选择退出时通过 `saveExpenses()` 方法显式完成的，
-	// 并且没有在 `ExpenseTracker` 对象内部直接使用 `new` 动态分配需要 `delete` 清理的内存。
-	// 因此，目前这个析构函数不需要执行特定的清理操作。
-	// 如果将来类变得更复杂，比如动态管理了某些资源，就需要在这里添加相应的释放代码。
-} // 析构函数结束
+// 【日期键】把记录的日期编码成可直接比较大小的整数 yyyymmdd。
+inline int dateKey(const Expense& e) {
+	return (int)e.getDate().value();
+}
 
-// 【私有辅助方法 `clearInputBuffer` 实现】
-// `void` // 表示这个函数不返回任何值。
-// `ExpenseTracker::clearInputBuffer()` // 定义 `ExpenseTracker` 类的 `clearInputBuffer` 方法。
-                                     // 这是一个私有方法，意味着它主要被类内部的其他成员函数调用，用于辅助完成任务。
-void ExpenseTracker::clearInputBuffer() {
-	// `cin` // 标准输入流对象，通常代表键盘输入。
-	// `.ignore(...)` // 是输入流的一个成员函数，用于忽略（跳过并丢弃）输入流中的字符。
-	// `numeric_limits<streamsize>::max()` // `numeric_limits` 是定义在 `<limits>` 头文件中的模板类，用于获取各种数据类型的属性（如此处的最大值）。
-	                                     // `streamsize` 是一种用于表示流大小的整数类型。
-	                                     // `numeric_limits<streamsize>::max()` 返回 `streamsize` 类型能表示的最大值。
-	                                     // 这意味着 `.ignore()` 会尝试忽略非常非常多的字符，直到遇到下一个参数指定的停止条件。
-	// `'\n'` // 这是第二个参数，指定了忽略操作的终止字符。`'\n'` 代表换行符。
-	//         // 当用户在控制台输入并按下回车键时，这个换行符也会被放入输入缓冲区。
-	// 这整行代码的作用是：丢弃输入缓冲区中当前位置直到下一个换行符（包括该换行符）之间的所有字符，或者丢弃掉缓冲区内所有剩余字符（如果先达到了流的最大限制）。
-	// 这样做的目的是为了清除在一次输入操作（尤其是使用 `>>` 操作符读取数字后）后可能残留在缓冲区中的换行符或其他多余字符，
-	// 以防止它们影响到后续的输入操作（特别是 `getline` 函数，它会读取整行直到换行符）。
-	cin.ignore(numeric_limits<streamsize>::max(), '\n'); // 清除输入缓冲区中直到下一个换行符的所有内容。
-} // `clearInputBuffer` 函数结束
+/*
+【按日期有序的记录存储 (有序分块链表)】
+记录始终按日期升序排列 (同一天的记录保持添加顺序)，因此所有列表天然按时间顺序输出，不需要排序；
+某个期间的记录是一段连续的下标区间，可以用二分查找直接定位。
+存储分成若干块，每块最多 STORE_CHUNK_CAPACITY 条:
+- 插入补记的旧日期记录时，只需在所在块内移动最多一块的记录，块满时一分为二；
+- 各块的记录数保存在树状数组 (Fenwick 树) 中: 插入或删除一条记录只更新 O(log 块数) 个节点，
+  按下标访问时沿树下降找到所在块，再在块内直接定位；只有块的分裂、合并才整体重建一次。
+- 加载分区和导入时用 `insertMany` 批量插入: 新记录排序后与日期区间重叠的几块一次归并。
+对外的用法与数组相同 (`store[i]`，下标从 0 开始)。
+*/
+const int STORE_CHUNK_CAPACITY = 64;
+const int STORE_BULK_FILL = STORE_CHUNK_CAPACITY * 3 / 4; // 批量插入时每块的记录数 (留出空位给之后补记的记录)
+const int DEFAULT_PAGE_SIZE = 20; // 分页浏览时每页显示的记录数
 
-// 【核心功能方法 `run` 实现】
-// `void ExpenseTracker::run()` // 定义 `ExpenseTracker` 类的 `run` 方法。这是程序的用户交互核心。
-void ExpenseTracker::run() {
-	int choice; // 声明一个整型变量 `choice`，用于存储用户从菜单中选择的选项的数字。
-	// `do...while` // 这是一个 `do-while` 循环结构。它的特点是循环体内的代码至少会执行一次，然后在每次循环结束时检查 `while` 后面的条件。
-	             // 只要条件为真，循环就会继续。
-	do { // `do-while` 循环开始
-		// 下面是一系列的 `cout` 语句，用于在控制台（屏幕）上打印出程序的主菜单。
-		cout << "\n大学生开销追踪器\n"; // `\n` 是换行符，使标题在新的一行显示，并且前面有一个空行，让界面更清晰。
-		cout << "--------------------\n"; // 打印一行分隔线。
-		cout << "1. 添加开销记录\n";   // 菜单选项1。
-		cout << "2. 查看所有开销\n";   // 菜单选项2。
-		cout << "3. 查看月度统计\n";   // 菜单选项3。
-		cout << "4. 按期间列出开销\n"; // 菜单选项4。
-		cout << "5. 删除开销记录\n";   // 菜单选项5。
-		cout << "6. 保存并退出\n";     // 菜单选项6。
-		cout << "--------------------\n"; // 打印一行分隔线。
-		cout << "请输入选项: ";        // 提示用户输入他们的选择。
+typedef TrackedVector<Expense, MEMORY_RECORDS> RecordChunk; // 一块记录
 
-		// `cin >> choice;` // 使用标准输入流 `cin` 和提取运算符 `>>` 来读取用户输入的整数，并将其存储到 `choice` 变量中。
-		                    // 注意：`>>` 操作符在读取数字时，会跳过前面的空白字符（空格、制表符、换行符），然后读取数字字符，
-		                    // 直到遇到第一个非数字字符。它会将这个非数字字符（通常是按下回车时产生的换行符 `\n`）留在输入缓冲区中。
-		cin >> choice; // 从用户那里获取菜单选项。
+class ExpenseStore {
+public:
+	ExpenseStore() : count(0) {}
 
-		// 【输入验证和错误处理】
-		// `cin.fail()` // 这个成员函数检查输入流 `cin` 是否处于"失败"状态。
-		              // 如果上一次输入操作（如 `cin >> choice`）因为用户输入了无效的内容（例如输入了字母而不是数字）而失败，`cin.fail()` 会返回 `true`。
-		if (cin.fail()) { // 如果输入操作失败了 (例如，用户输入了文本而不是数字)
-			cin.clear();          // `cin.clear()`: 这个成员函数用于清除输入流的错误状态标志（例如 `failbit` 或 `badbit`）。
-			                      // 清除错误标志后，输入流对象才能恢复正常工作，进行下一次输入/输出操作。
-			clearInputBuffer();   // 调用我们自己定义的 `clearInputBuffer()` 辅助函数，
-			                      // 来清除输入缓冲区中导致先前输入失败的无效字符 (以及随后的换行符)。
-			choice = 0;           // 将 `choice` 变量的值设置为0。这是一个任意选择的无效菜单选项值，
-			                      // 目的是确保在接下来的 `switch` 语句中，程序会进入 `default` 分支，从而提示用户输入无效。
-		} else { // `else` 分支：如果 `cin >> choice` 操作没有失败 (即用户确实输入了看起来像数字的内容)
-			clearInputBuffer();   // 即使输入成功，输入缓冲区中通常还残留着用户按下回车键时产生的换行符 `\n`。
-			                      // 调用 `clearInputBuffer()` 来清除这个换行符，对于后续可能使用 `getline`（它对换行符敏感）的函数调用来说，这是个好习惯。
-		} // 输入验证结束。
+	int size() const { return count; }
 
-		// `switch (choice)` // `switch` 语句是一种多分支选择结构。它会根据 `choice` 变量的值，跳转到匹配的 `case`标签处执行代码。
+	Expense& operator[](int index) {
+		int offset;
+		int c = locate(index, offset);
+		return chunks[c][offset];
+	}
+	const Expense& operator[](int index) const {
+		int offset;
+		int c = locate(index, offset);
+		return chunks[c][offset];
+	}
+
+	// 按日期插入一条记录 (排在同一天已有记录之后)，返回它的下标。
+	int insert(const Expense& e) {
+		int key = dateKey(e);
+		size_t c = 0; // 第一个末尾日期晚于 key 的块；都不晚于时放进最后一块
+		size_t lo = 0, hi = chunks.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (dateKey(chunks[mid].back()) > key) hi = mid; else lo = mid + 1;
+		}
+		c = lo;
+		if (c == chunks.size()) {
+			if (chunks.empty()) chunks.push_back(RecordChunk());
+			c = chunks.size() - 1;
+		}
+		RecordChunk& chunk = chunks[c];
+		size_t pos = upper_bound(chunk.begin(), chunk.end(), key,
+								 [](int k, const Expense& x) { return k < dateKey(x); }) - chunk.begin();
+		chunk.insert(chunk.begin() + pos, e);
+		++count;
+		if (chunk.size() > (size_t)STORE_CHUNK_CAPACITY) { // 块满，后一半移到新块
+			RecordChunk tail(chunk.begin() + chunk.size() / 2, chunk.end());
+			chunk.resize(chunk.size() / 2);
+			chunks.insert(chunks.begin() + c + 1, tail);
+			if (pos >= chunks[c].size()) { pos -= chunks[c].size(); ++c; }
+			rebuildStarts();
+		} else {
+			adjustChunkSize(c, 1);
+		}
+		return chunkStart(c) + (int)pos;
+	}
+
+	// 批量插入 (加载分区、导入)。结果与逐条 `insert` 相同: 同一天的新记录排在已有记录之后，新记录之间保持原来的顺序。
+	// 新记录排好序后按 `insert` 的规则分配到各块 (第一个末尾日期晚于它的块，都不晚于时放进最后一块)，
+	// 只有收到新记录的块与之归并，超过容量时按 STORE_BULK_FILL 重新分块；块的起始下标最后重建一次。
+	void insertMany(const vector<Expense>& records) {
+		if (records.empty()) return;
+		vector<const Expense*> incoming(records.size());
+		for (size_t k = 0; k < records.size(); ++k) incoming[k] = &records[k];
+		auto byDate = [](const Expense* a, const Expense* b) { return dateKey(*a) < dateKey(*b); };
+		if (!is_sorted(incoming.begin(), incoming.end(), byDate)) stable_sort(incoming.begin(), incoming.end(), byDate);
+
+		vector<RecordChunk> result;
+		result.reserve(chunks.size() + records.size() / STORE_BULK_FILL + 1);
+		size_t next = 0;
+		for (size_t c = 0; c <= chunks.size(); ++c) {
+			bool last = c + 1 >= chunks.size();
+			size_t end = next;
+			while (end < incoming.size() && (last || dateKey(*incoming[end]) < dateKey(chunks[c].back()))) ++end;
+			if (end == next) { // 这一块没有新记录，原样保留
+				if (c < chunks.size()) result.push_back(move(chunks[c]));
+				continue;
+			}
+			RecordChunk merged;
+			merged.reserve((c < chunks.size() ? chunks[c].size() : 0) + (end - next));
+			if (c < chunks.size()) {
+				for (size_t k = 0; k < chunks[c].size(); ++k) {
+					int key = dateKey(chunks[c][k]);
+					while (next < end && dateKey(*incoming[next]) < key) merged.push_back(*incoming[next++]);
+					merged.push_back(move(chunks[c][k]));
+				}
+			}
+			while (next < end) merged.push_back(*incoming[next++]);
+			if (merged.size() <= (size_t)STORE_CHUNK_CAPACITY) {
+				result.push_back(move(merged));
+				continue;
+			}
+			for (size_t begin = 0; begin < merged.size(); begin += STORE_BULK_FILL) {
+				size_t stop = min(merged.size(), begin + STORE_BULK_FILL);
+				result.push_back(RecordChunk(make_move_iterator(merged.begin() + begin), make_move_iterator(merged.begin() + stop)));
+			}
+		}
+		chunks.swap(result);
+		count += (int)records.size();
+		rebuildStarts();
+	}
+
+	// 删除一条记录。
+	void erase(int index) {
+		int offset;
+		int c = locate(index, offset);
+		chunks[c].erase(chunks[c].begin() + offset);
+		--count;
+		if (chunks[c].empty()) {
+			chunks.erase(chunks.begin() + c);
+			rebuildStarts();
+		} else {
+			adjustChunkSize(c, -1);
+		}
+	}
+
+	// 删除多条记录 (`rows` 为升序下标)。每块只做一遍压缩，空块随之移除。
+	void eraseRows(const vector<uint32_t>& rows) {
+		size_t next = 0;
+		size_t keptChunks = 0;
+		uint32_t first = 0; // 当前块第一条记录删除前的下标
+		for (size_t c = 0; c < chunks.size(); ++c) {
+			RecordChunk& chunk = chunks[c];
+			size_t original = chunk.size();
+			size_t write = 0;
+			for (size_t read = 0; read < chunk.size(); ++read) {
+				if (next < rows.size() && rows[next] == first + read) { ++next; continue; }
+				if (write != read) chunk[write] = move(chunk[read]); // 移动: 保留的记录不必重新分配字符串
+				++write;
+			}
+			count -= (int)(original - write);
+			chunk.resize(write);
+			if (!chunk.empty()) {
+				if (keptChunks != c) chunks[keptChunks].swap(chunk);
+				++keptChunks;
+			}
+			first += (uint32_t)original;
+		}
+		chunks.resize(keptChunks);
+		rebuildStarts();
+	}
+
+	// 第一条日期不早于 key (yyyymmdd) 的记录的下标；都早于 key 时返回 size()。
+	int lowerBound(int key) const {
+		size_t lo = 0, hi = chunks.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (dateKey(chunks[mid].back()) >= key) hi = mid; else lo = mid + 1;
+		}
+		if (lo == chunks.size()) return count;
+		const RecordChunk& chunk = chunks[lo];
+		size_t pos = lower_bound(chunk.begin(), chunk.end(), key,
+								 [](const Expense& x, int k) { return dateKey(x) < k; }) - chunk.begin();
+		return chunkStart(lo) + (int)pos;
+	}
+
+	// 按顺序访问下标 [from, to) 的记录，逐块遍历，不必每条都定位。
+	template <typename Visit>
+	void forEachInRange(int from, int to, Visit visit) const {
+		if (from >= to) return;
+		int offset;
+		size_t c = locate(from, offset);
+		for (int i = from; i < to; ++c, offset = 0) {
+			const RecordChunk& chunk = chunks[c];
+			for (size_t k = offset; k < chunk.size() && i < to; ++k, ++i) visit(chunk[k]);
+		}
+	}
+
+private:
+	vector<RecordChunk> chunks;       // 各块，块内与块之间都按日期升序
+	vector<int> sizeTree;            // 各块记录数的树状数组 (下标从 1 开始，sizeTree[i] 是以第 i 块结尾、长度为 i & -i 的一段块的记录数之和)
+	int count;                       // 记录总数
+
+	// 块的数目变化后 O(块数) 重建树状数组。
+	void rebuildStarts() {
+		sizeTree.assign(chunks.size() + 1, 0);
+		for (size_t i = 1; i <= chunks.size(); ++i) {
+			sizeTree[i] += (int)chunks[i - 1].size();
+			size_t parent = i + (i & (0 - i));
+			if (parent <= chunks.size()) sizeTree[parent] += sizeTree[i];
+		}
+	}
+
+	// 第 c 块的记录数变化了 `delta`。
+	void adjustChunkSize(size_t c, int delta) {
+		for (size_t i = c + 1; i < sizeTree.size(); i += i & (0 - i)) sizeTree[i] += delta;
+	}
+
+	// 第 c 块第一条记录的全局下标 (之前各块的记录数之和)。
+	int chunkStart(size_t c) const {
+		int start = 0;
+		for (size_t i = c; i > 0; i -= i & (0 - i)) start += sizeTree[i];
+		return start;
+	}
+
+	// 找到下标 `index` 所在的块，并给出块内偏移: 沿树状数组下降，跳过整体位于 `index` 之前的块。
+	int locate(int index, int& offset) const {
+		size_t c = 0;
+		size_t step = 1;
+		while (step * 2 < sizeTree.size()) step *= 2;
+		for (; step > 0; step /= 2) {
+			if (c + step < sizeTree.size() && sizeTree[c + step] <= index) {
+				c += step;
+				index -= sizeTree[c];
+			}
+		}
+		offset = index;
+		return (int)c;
+	}
+};
+
+/*
+【查询管道 (编译期组合)】
+各种报告都是同一个循环: 按条件筛选记录 -> 交给输出端处理 (打印 / 汇总 / 导出)。
+`ExpenseTracker::runQuery(条件, 输出端)` 是一个模板，条件和输出端都是普通的类 (不是虚函数接口)，
+编译器会为每一种组合生成一个专门的紧凑循环，条件判断和输出处理都可以被内联。
+- 条件 (Predicate): `bool operator()(const Expense&)`，并通过 `range()` 告诉管道需要加载哪些月份的分区。
+- 分组键 (GroupKey): `const string& operator()(const Expense&)`，作为 `AggregateSink` 的模板参数。
+- 输出端 (Sink): `void consume(const Expense&)`。多个输出端可以用 `TeeSink` 组合，一次遍历同时完成。
+新增一种报告通常只需要组合已有的条件和输出端，或者再写一个几行的小类。
+*/
+
+// 【筛选条件】
+// `range()` 返回 false 表示条件不限定期间 (需要全部分区)，否则给出 [起始年月, 结束年月]。
+class MatchAll {
+public:
+	bool operator()(const Expense&) const { return true; }
+	bool range(int&, int&, int&, int&) const { return false; }
+};
+
+// 年、月、日都是一段连续的日期区间 [from, to]，判断只需比较压缩后的日期整数。
+class MatchDateRange {
+public:
+	Date from, to;
+	MatchDateRange(const Date& f, const Date& t) : from(f), to(t) {}
+	bool operator()(const Expense& e) const { return e.getDate() >= from && e.getDate() <= to; }
+	bool range(int& fy, int& fm, int& ty, int& tm) const {
+		fy = from.year(); fm = from.month(); ty = to.year(); tm = to.month();
+		return true;
+	}
+};
+
+class MatchYear : public MatchDateRange {
+public:
+	explicit MatchYear(int y) : MatchDateRange(Date(y, 1, 1), Date(y, 12, 31)) {}
+};
+
+class MatchMonth : public MatchDateRange {
+public:
+	MatchMonth(int y, int m) : MatchDateRange(Date(y, m, 1), Date(y, m, 31)) {}
+};
+
+class MatchDay : public MatchDateRange {
+public:
+	MatchDay(int y, int m, int d) : MatchDateRange(Date(y, m, d), Date(y, m, d)) {}
+};
+
+/*
+【过滤表达式】
+语法 (关键字不区分大小写，and 的优先级高于 or):
+    表达式 := 合取式 { or 合取式 }
+    合取式 := 条件 { and 条件 }
+    条件   := 字段 比较符 值 | 字段 in ( 值 {, 值} ) | description contains 值
+    字段   := date | year | month | day | amount | category | description
+    比较符 := = | == | != | < | <= | > | >=
+例如: category in (餐饮, 交通) and amount > 50 and date >= 2025-03-01
+日期写作 YYYY-MM-DD，金额可带两位小数；含空格或逗号的值可以用引号括起来。
+
+表达式被编译成一组 `FilterTerm`，执行时按列计算 (见 `ExpenseTracker::evaluateFilter`):
+先把记录拆成日期/金额/类别编号等列，每个合取式从全部行号开始，依次用各个条件收窄"选择向量" (满足条件的行号)，
+条件按估算的选择率从小到大排序，最挑剔的条件先执行，后面的条件只需检查剩下的少量行。
+*/
+class FilterTerm {
+public:
+	enum Field { DATE, YEAR, MONTH, DAY, AMOUNT, CATEGORY, DESCRIPTION };
+	enum Op { EQ, NE, LT, LE, GT, GE, IN, CONTAINS };
+	Field field;
+	Op op;
+	int64_t number;          // 数值型字段的比较值 (日期为 yyyymmdd，金额为分)
+	vector<string> values;   // category 的候选值 (= 和 in)，description 的比较文本
+	double estimatedCost;    // 估算的选择率 x 单行代价，执行前用于排序
+
+	FilterTerm() : field(DATE), op(EQ), number(0), estimatedCost(1.0) {}
+};
+
+class FilterExpression {
+public:
+	vector<vector<FilterTerm> > disjuncts; // 各合取式之间为 or 关系
+};
+
+// 【过滤表达式词法分析】把表达式切分为单词、比较符、括号和逗号。
+// 非 ASCII 字节 (例如中文类别名) 视为单词的一部分；引号内的内容整体作为一个单词。
+bool tokenizeFilter(const string& text, vector<string>& tokens, string& error) {
+	size_t i = 0;
+	while (i < text.size()) {
+		unsigned char c = text[i];
+		if (isspace(c)) { ++i; continue; }
+		if (c == '(' || c == ')' || c == ',') { tokens.push_back(string(1, (char)c)); ++i; continue; }
+		if (c == '<' || c == '>' || c == '=' || c == '!') { // 比较符 (可能是两个字符)
+			string op(1, (char)c);
+			if (i + 1 < text.size() && text[i + 1] == '=') op += '=';
+			if (op == "!") { error = "无法识别的符号 '!'"; return false; }
+			tokens.push_back(op);
+			i += op.size();
+			continue;
+		}
+		if (c == '\'' || c == '"') { // 引号括起的值
+			size_t end = text.find((char)c, i + 1);
+			if (end == string::npos) { error = "引号没有闭合"; return false; }
+			tokens.push_back("\x01" + text.substr(i + 1, end - i - 1)); // \x01 前缀标记"已加引号"，不会被当作关键字
+			i = end + 1;
+			continue;
+		}
+		size_t start = i; // 普通单词: 直到空白或符号为止
+		while (i < text.size()) {
+			unsigned char d = text[i];
+			if (isspace(d) || d == '(' || d == ')' || d == ',' || d == '<' || d == '>' || d == '=' || d == '!' || d == '\'' || d == '"') break;
+			++i;
+		}
+		tokens.push_back(text.substr(start, i - start));
+	}
+	return true;
+}
+
+string lowerAscii(string word) {
+	for (size_t i = 0; i < word.size(); ++i) word[i] = (char)tolower((unsigned char)word[i]);
+	return word;
+}
+
+// 去掉引号标记，得到值的原文。
+string filterTokenValue(const string& token) {
+	return (!token.empty() && token[0] == '\x01') ? token.substr(1) : token;
+}
+
+// 【解析比较值】日期写作 YYYY-MM-DD (编码为 yyyymmdd)，金额换算为分，其余为整数。
+bool parseFilterNumber(FilterTerm::Field field, const string& token, int64_t& number) {
+	string text = filterTokenValue(token);
+	if (field == FilterTerm::DATE) {
+		int y, m, d;
+		char dash1, dash2;
+		stringstream ss(text);
+		if (!(ss >> y >> dash1 >> m >> dash2 >> d) || dash1 != '-' || dash2 != '-' || !ss.eof()) return false;
+		if (!isValidDate(y, m, d)) return false;
+		number = Date(y, m, d).value();
+		return true;
+	}
+	stringstream ss(text);
+	if (field == FilterTerm::AMOUNT) {
+		double amount;
+		if (!(ss >> amount) || !ss.eof()) return false;
+		number = llround(amount * 100);
+		return true;
+	}
+	long long value;
+	if (!(ss >> value) || !ss.eof()) return false;
+	number = value;
+	return true;
+}
+
+// 【过滤表达式语法分析】成功时填充 `out`，失败时在 `error` 中给出原因。
+bool parseFilterExpression(const string& text, FilterExpression& out, string& error) {
+	vector<string> tokens;
+	if (!tokenizeFilter(text, tokens, error)) return false;
+	if (tokens.empty()) { error = "表达式为空"; return false; }
+	out.disjuncts.assign(1, vector<FilterTerm>());
+	size_t pos = 0;
+	while (true) {
+		// 【字段】
+		if (pos >= tokens.size()) { error = "表达式不完整，缺少条件"; return false; }
+		string fieldName = lowerAscii(tokens[pos++]);
+		FilterTerm term;
+		if (fieldName == "date") term.field = FilterTerm::DATE;
+		else if (fieldName == "year") term.field = FilterTerm::YEAR;
+		else if (fieldName == "month") term.field = FilterTerm::MONTH;
+		else if (fieldName == "day") term.field = FilterTerm::DAY;
+		else if (fieldName == "amount") term.field = FilterTerm::AMOUNT;
+		else if (fieldName == "category") term.field = FilterTerm::CATEGORY;
+		else if (fieldName == "description") term.field = FilterTerm::DESCRIPTION;
+		else { error = "未知字段 '" + filterTokenValue(tokens[pos - 1]) + "'"; return false; }
+
+		// 【比较符】
+		if (pos >= tokens.size()) { error = "字段 " + fieldName + " 后缺少比较符"; return false; }
+		string op = lowerAscii(tokens[pos++]);
+		if (op == "=" || op == "==") term.op = FilterTerm::EQ;
+		else if (op == "!=") term.op = FilterTerm::NE;
+		else if (op == "<") term.op = FilterTerm::LT;
+		else if (op == "<=") term.op = FilterTerm::LE;
+		else if (op == ">") term.op = FilterTerm::GT;
+		else if (op == ">=") term.op = FilterTerm::GE;
+		else if (op == "in") term.op = FilterTerm::IN;
+		else if (op == "contains") term.op = FilterTerm::CONTAINS;
+		else { error = "无法识别的比较符 '" + op + "'"; return false; }
+
+		bool textField = term.field == FilterTerm::CATEGORY || term.field == FilterTerm::DESCRIPTION;
+		if (term.op == FilterTerm::CONTAINS && term.field != FilterTerm::DESCRIPTION) { error = "contains 只能用于 description"; return false; }
+		if (term.op == FilterTerm::IN && term.field != FilterTerm::CATEGORY) { error = "in 只能用于 category"; return false; }
+		if (textField && term.op != FilterTerm::EQ && term.op != FilterTerm::NE && term.op != FilterTerm::IN && term.op != FilterTerm::CONTAINS) {
+			error = fieldName + " 只支持 =、!=、in 或 contains";
+			return false;
+		}
+
+		// 【值】
+		if (term.op == FilterTerm::IN) { // ( 值, 值, ... )
+			if (pos >= tokens.size() || tokens[pos] != "(") { error = "in 后应为 '('"; return false; }
+			++pos;
+			while (true) {
+				if (pos >= tokens.size()) { error = "in 列表没有闭合"; return false; }
+				term.values.push_back(filterTokenValue(tokens[pos++]));
+				if (pos < tokens.size() && tokens[pos] == ",") { ++pos; continue; }
+				if (pos < tokens.size() && tokens[pos] == ")") { ++pos; break; }
+				error = "in 列表中应为 ',' 或 ')'";
+				return false;
+			}
+		} else {
+			if (pos >= tokens.size()) { error = "比较符后缺少值"; return false; }
+			if (textField) {
+				term.values.push_back(filterTokenValue(tokens[pos++]));
+			} else if (!parseFilterNumber(term.field, tokens[pos++], term.number)) {
+				error = "无效的值 '" + filterTokenValue(tokens[pos - 1]) + "'";
+				return false;
+			}
+		}
+		out.disjuncts.back().push_back(term);
+
+		// 【连接词】
+		if (pos >= tokens.size()) break;
+		string conj = lowerAscii(tokens[pos++]);
+		if (conj == "or") out.disjuncts.push_back(vector<FilterTerm>());
+		else if (conj != "and") { error = "应为 and 或 or，而不是 '" + filterTokenValue(tokens[pos - 1]) + "'"; return false; }
+	}
+	return true;
+}
+
+// 【列式快照】按列存放已加载记录的常用字段，供过滤表达式逐列计算。
+// 快照带有生成时的"数据版本号"，记录增删后版本号变化，下次查询时重建。
+class ColumnSnapshot {
+public:
+	TrackedVector<int32_t, MEMORY_INDEXES> dates;       // yyyymmdd
+	TrackedVector<int64_t, MEMORY_INDEXES> cents;       // 金额 (分)
+	TrackedVector<int32_t, MEMORY_INDEXES> categoryIds; // 类别编号
+	vector<string> categoryNames;                       // 编号 -> 类别名称
+	TrackedVector<int, MEMORY_INDEXES> categoryCounts;  // 每个类别的记录数 (用于估算选择率)
+	unsigned long version;        // 构建时的数据版本号
+	bool valid;
+
+	ColumnSnapshot() : version(0), valid(false) {}
+};
+
+// 【二进制读写】按本机字节序追加/读出定宽整数，位图索引文件使用。读出越界时返回 false。
+template <typename T>
+void appendBinary(string& out, T value) {
+	out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool readBinary(const string& data, size_t& pos, T& value) {
+	if (pos > data.size() || data.size() - pos < sizeof(value)) return false;
+	memcpy(&value, &data[pos], sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
+
+// 【压缩位图】(Roaring 位图) 存放 32 位无符号整数的集合。
+// 高 16 位相同的值放在同一个容器里: 不超过 4096 个值时用有序的 16 位数组，更多时用 65536 位的位图 (1024 个 64 位字)，
+// 因此每个容器都不超过 8KB。交、并、差逐容器进行: 两边都是数组时归并有序数组，否则按 64 位字做位运算。
+class RoaringBitmap {
+public:
+	static const size_t ARRAY_LIMIT = 4096;  // 数组容器的最大元素数，超过后转为位图容器
+	static const size_t BITMAP_WORDS = 1024; // 位图容器的 64 位字数
+
+	class Container {
+	public:
+		uint16_t key;           // 容器内各值共同的高 16 位
+		int cardinality;        // 元素个数
+		TrackedVector<uint16_t, MEMORY_INDEXES> values; // 数组形式: 有序的低 16 位
+		TrackedVector<uint64_t, MEMORY_INDEXES> words;  // 位图形式 (非空时使用)
+
+		Container(uint16_t k = 0) : key(k), cardinality(0) {}
+
+		bool isBitmap() const { return !words.empty(); }
+
+		void add(uint16_t low) {
+			if (isBitmap()) {
+				uint64_t bit = 1ULL << (low & 63);
+				if (!(words[low >> 6] & bit)) { words[low >> 6] |= bit; ++cardinality; }
+				return;
+			}
+			if (values.empty() || values.back() < low) { // 按升序添加时直接追加
+				values.push_back(low);
+			} else {
+				auto it = lower_bound(values.begin(), values.end(), low);
+				if (*it == low) return;
+				values.insert(it, low);
+			}
+			++cardinality;
+			if ((size_t)cardinality > ARRAY_LIMIT) toBitmap();
+		}
+
+		bool contains(uint16_t low) const {
+			if (isBitmap()) return (words[low >> 6] >> (low & 63)) & 1;
+			return binary_search(values.begin(), values.end(), low);
+		}
+
+		void toBitmap() {
+			words.assign(BITMAP_WORDS, 0);
+			for (size_t k = 0; k < values.size(); ++k) words[values[k] >> 6] |= 1ULL << (values[k] & 63);
+			decltype(values)().swap(values);
+		}
+
+		// 位运算结果的元素不多时转回数组形式。
+		void normalize() {
+			if (!isBitmap() || (size_t)cardinality > ARRAY_LIMIT) return;
+			values.clear();
+			forEach([&](uint16_t low) { values.push_back(low); });
+			decltype(words)().swap(words);
+		}
+
+		// 取得位图形式的内容 (数组容器临时展开)。
+		void fillWords(TrackedVector<uint64_t, MEMORY_INDEXES>& out) const {
+			if (isBitmap()) { out = words; return; }
+			out.assign(BITMAP_WORDS, 0);
+			for (size_t k = 0; k < values.size(); ++k) out[values[k] >> 6] |= 1ULL << (values[k] & 63);
+		}
+
+		template <typename Visit>
+		void forEach(Visit visit) const {
+			if (!isBitmap()) {
+				for (size_t k = 0; k < values.size(); ++k) visit(values[k]);
+				return;
+			}
+			for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+				for (uint64_t bits = words[w]; bits; bits &= bits - 1) visit((uint16_t)(w * 64 + __builtin_ctzll(bits)));
+			}
+		}
+	};
+
+	enum Operation { AND, OR, ANDNOT };
+
+	TrackedVector<Container, MEMORY_INDEXES> containers; // 按 key 升序，不含空容器
+
+	bool empty() const { return containers.empty(); }
+
+	uint64_t cardinality() const {
+		uint64_t total = 0;
+		for (size_t c = 0; c < containers.size(); ++c) total += containers[c].cardinality;
+		return total;
+	}
+
+	void add(uint32_t value) {
+		uint16_t high = (uint16_t)(value >> 16);
+		if (containers.empty() || containers.back().key < high) {
+			containers.push_back(Container(high));
+			containers.back().add((uint16_t)value);
+			return;
+		}
+		auto it = lower_bound(containers.begin(), containers.end(), high, [](const Container& c, uint16_t k) { return c.key < k; });
+		if (it->key != high) it = containers.insert(it, Container(high));
+		it->add((uint16_t)value);
+	}
+
+	bool contains(uint32_t value) const {
+		uint16_t high = (uint16_t)(value >> 16);
+		auto it = lower_bound(containers.begin(), containers.end(), high, [](const Container& c, uint16_t k) { return c.key < k; });
+		return it != containers.end() && it->key == high && it->contains((uint16_t)value);
+	}
+
+	// [0, count) 的全部整数。
+	static RoaringBitmap range(uint32_t count) {
+		RoaringBitmap result;
+		for (uint32_t v = 0; v < count; ++v) result.add(v);
+		return result;
+	}
+
+	// 按容器逐个计算交 (AND)、并 (OR) 或差 (ANDNOT)。
+	RoaringBitmap combine(const RoaringBitmap& other, Operation op) const {
+		RoaringBitmap result;
+		size_t i = 0, j = 0;
+		TrackedVector<uint64_t, MEMORY_INDEXES> left, right;
+		while (i < containers.size() || j < other.containers.size()) {
+			const Container* a = i < containers.size() ? &containers[i] : nullptr;
+			const Container* b = j < other.containers.size() ? &other.containers[j] : nullptr;
+			if (a && (!b || a->key < b->key)) { // 只有左边有该容器
+				if (op != AND) result.containers.push_back(*a);
+				++i;
+				continue;
+			}
+			if (b && (!a || b->key < a->key)) { // 只有右边有该容器
+				if (op == OR) result.containers.push_back(*b);
+				++j;
+				continue;
+			}
+			Container merged(a->key);
+			if (!a->isBitmap() && !b->isBitmap()) { // 两个有序数组直接归并
+				const auto& x = a->values;
+				const auto& y = b->values;
+				if (op == AND) set_intersection(x.begin(), x.end(), y.begin(), y.end(), back_inserter(merged.values));
+				else if (op == OR) set_union(x.begin(), x.end(), y.begin(), y.end(), back_inserter(merged.values));
+				else set_difference(x.begin(), x.end(), y.begin(), y.end(), back_inserter(merged.values));
+				merged.cardinality = (int)merged.values.size();
+				if ((size_t)merged.cardinality > ARRAY_LIMIT) merged.toBitmap();
+			} else { // 至少一边是位图: 按 64 位字运算
+				a->fillWords(left);
+				b->fillWords(right);
+				merged.words.resize(BITMAP_WORDS);
+				for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+					uint64_t bits = op == AND ? left[w] & right[w] : op == OR ? left[w] | right[w] : left[w] & ~right[w];
+					merged.words[w] = bits;
+					merged.cardinality += __builtin_popcountll(bits);
+				}
+				merged.normalize();
+			}
+			if (merged.cardinality > 0) result.containers.push_back(merged);
+			++i;
+			++j;
+		}
+		return result;
+	}
+
+	// 按升序访问每个值。
+	template <typename Visit>
+	void forEach(Visit visit) const {
+		for (size_t c = 0; c < containers.size(); ++c) {
+			uint32_t high = (uint32_t)containers[c].key << 16;
+			containers[c].forEach([&](uint16_t low) { visit(high | low); });
+		}
+	}
+
+	// 序列化: 容器数，之后每个容器为 key、元素数和内容 (元素数不超过 ARRAY_LIMIT 时为数组，否则为 1024 个字)。
+	void appendTo(string& out) const {
+		appendBinary(out, (uint32_t)containers.size());
+		for (size_t c = 0; c < containers.size(); ++c) {
+			const Container& container = containers[c];
+			appendBinary(out, container.key);
+			appendBinary(out, (uint32_t)container.cardinality);
+			if (container.isBitmap()) out.append(reinterpret_cast<const char*>(container.words.data()), BITMAP_WORDS * 8);
+			else out.append(reinterpret_cast<const char*>(container.values.data()), container.values.size() * 2);
+		}
+	}
+
+	bool readFrom(const string& data, size_t& pos) {
+		containers.clear();
+		uint32_t count;
+		if (!readBinary(data, pos, count) || count > 65536) return false;
+		for (uint32_t c = 0; c < count; ++c) {
+			Container container;
+			uint32_t cardinality;
+			if (!readBinary(data, pos, container.key) || !readBinary(data, pos, cardinality)) return false;
+			if (cardinality == 0 || cardinality > 65536) return false;
+			if (!containers.empty() && containers.back().key >= container.key) return false;
+			container.cardinality = (int)cardinality;
+			size_t bytes = cardinality > ARRAY_LIMIT ? BITMAP_WORDS * 8 : cardinality * 2;
+			if (data.size() - pos < bytes) return false;
+			if (cardinality > ARRAY_LIMIT) {
+				container.words.resize(BITMAP_WORDS);
+				memcpy(container.words.data(), &data[pos], bytes);
+			} else {
+				container.values.resize(cardinality);
+				memcpy(container.values.data(), &data[pos], bytes);
+			}
+			pos += bytes;
+			containers.push_back(container);
+		}
+		return true;
+	}
+};
+
+// 【分区位图索引】一个月份分区内每个类别的记录集合。
+// 位图中的值是记录在分区内的序号 (该月记录按存储顺序从 0 编号)，分区的第 k 条记录在内存中的行号为
+// "该月第一条记录的行号 + k"。分区文件按同样的顺序写出和读入，所以序号在保存、重新加载之后保持不变，
+// 索引可以随账本保存，未加载的分区也能直接用索引判断是否可能有满足条件的记录。
+class PartitionBitmaps {
+public:
+	int recordCount;        // 建立索引时分区的记录数
+	uint64_t blockHash;     // 对应分区文件的校验值 (与清单不一致时索引作废)
+	bool stale;             // 分区在内存中被修改过，下次使用前从记录重建
+	map<string, RoaringBitmap> byCategory; // 类别 -> 分区内序号集合
+
+	PartitionBitmaps() : recordCount(0), blockHash(0), stale(false) {}
+};
+
+// 【类别前缀树】按 UTF-8 字节存放所有已知类别名 (含别名)，用于输入时按前缀列出补全候选。
+// 查找一个前缀只需沿树走前缀长度步，与类别总数无关；候选按字节序 (即字典序) 给出。
+class TrieNode {
+public:
+	map<unsigned char, int> children; // 下一个字节 -> 子节点下标
+	bool terminal;                    // 是否有类别名在此结束
+
+	TrieNode() : terminal(false) {}
+};
+
+class CategoryTrie {
+public:
+	CategoryTrie() : nodes(1) {} // 节点 0 为根
+
+	void insert(const string& name) {
+		int node = 0;
+		for (size_t i = 0; i < name.size(); ++i) {
+			unsigned char c = name[i];
+			auto it = nodes[node].children.find(c);
+			if (it == nodes[node].children.end()) {
+				nodes.push_back(TrieNode());
+				int child = (int)nodes.size() - 1;
+				nodes[node].children[c] = child;
+				node = child;
+			} else {
+				node = it->second;
+			}
+		}
+		nodes[node].terminal = true;
+	}
+
+	// 只取消结束标记，节点留给共享前缀的其他类别。
+	void erase(const string& name) {
+		int node = find(name);
+		if (node >= 0) nodes[node].terminal = false;
+	}
+
+	bool contains(const string& name) const {
+		int node = find(name);
+		return node >= 0 && nodes[node].terminal;
+	}
+
+	// 以 `prefix` 开头的类别名，最多 `limit` 个。
+	vector<string> complete(const string& prefix, size_t limit) const {
+		vector<string> result;
+		int node = find(prefix);
+		if (node >= 0) {
+			string path = prefix;
+			collect(node, path, limit, result);
+		}
+		return result;
+	}
+
+private:
+	vector<TrieNode> nodes;
+
+	int find(const string& key) const {
+		int node = 0;
+		for (size_t i = 0; i < key.size() && node >= 0; ++i) {
+			auto it = nodes[node].children.find((unsigned char)key[i]);
+			node = it == nodes[node].children.end() ? -1 : it->second;
+		}
+		return node;
+	}
+
+	void collect(int node, string& path, size_t limit, vector<string>& result) const {
+		if (result.size() >= limit) return;
+		if (nodes[node].terminal) result.push_back(path);
+		for (auto it = nodes[node].children.begin(); it != nodes[node].children.end() && result.size() < limit; ++it) {
+			path.push_back((char)it->first);
+			collect(it->second, path, limit, result);
+			path.pop_back();
+		}
+	}
+};
+
+// 【类别名去空白】去掉首尾的半角空白和全角空格 (U+3000)，"餐饮 " 与 "餐饮" 视为同一类别。
+string trimCategory(const string& raw) {
+	const string fullWidthSpace = "\xE3\x80\x80";
+	size_t begin = 0, end = raw.size();
+	while (true) {
+		if (begin < end && isspace((unsigned char)raw[begin])) { ++begin; continue; }
+		if (end - begin >= 3 && raw.compare(begin, 3, fullWidthSpace) == 0) { begin += 3; continue; }
+		break;
+	}
+	while (true) {
+		if (end > begin && isspace((unsigned char)raw[end - 1])) { --end; continue; }
+		if (end - begin >= 3 && raw.compare(end - 3, 3, fullWidthSpace) == 0) { end -= 3; continue; }
+		break;
+	}
+	return raw.substr(begin, end - begin);
+}
+
+// 【外部文本入库前的清理】数据文件以逗号分隔字段、每行一条记录，类别文件以制表符分隔别名:
+// 逗号换成全角逗号，换行、回车和制表符换成空格，否则保存时会破坏所在分区或类别文件。
+string sanitizeRecordField(string text) {
+	for (size_t pos = 0; (pos = text.find(',', pos)) != string::npos; pos += 3) text.replace(pos, 1, "，");
+	replace_if(text.begin(), text.end(), [](char c) { return c == '\n' || c == '\r' || c == '\t'; }, ' ');
+	return text;
+}
+
+/*
+【类别层级】类别名中的 '/' 表示层级，例如 "餐饮/午餐" 是 "餐饮" 的子类别。记录中保存完整路径 (仍受 MAX_CATEGORY_LENGTH 限制)，
+类别树和按月聚合只在内存中维护: 每条记录增删时沿路径向上更新各级合计，O(层数)，月度统计直接读取各节点的合计。
+*/
+const char CATEGORY_PATH_SEPARATOR = '/';
+
+// 【类别路径规范化】每一级去掉首尾空白，并去掉空的层级: " 餐饮 / 午餐/" -> "餐饮/午餐"。
+string normalizeCategoryPath(const string& raw) {
+	string path;
+	size_t begin = 0;
+	while (begin <= raw.size()) {
+		size_t end = raw.find(CATEGORY_PATH_SEPARATOR, begin);
+		if (end == string::npos) end = raw.size();
+		string segment = trimCategory(raw.substr(begin, end - begin));
+		if (!segment.empty()) {
+			if (!path.empty()) path += CATEGORY_PATH_SEPARATOR;
+			path += segment;
+		}
+		begin = end + 1;
+	}
+	return path;
+}
+
+// 【类别树节点】
+class CategoryNode {
+public:
+	string name;          // 本级名称，例如 "午餐"
+	string path;          // 完整路径，例如 "餐饮/午餐"；根节点为空
+	int parent;           // 父节点编号，根节点为 -1
+	int depth;            // 根节点为 0
+	vector<int> children;
+	CategoryNode() : parent(-1), depth(0) {}
+};
+
+// 【类别树】编号 0 是根 (全部类别)。节点只增不减，删除记录后合计归零但节点保留。
+class CategoryTree {
+public:
+	vector<CategoryNode> nodes;
+	unordered_map<string, int> ids; // 完整路径 -> 节点编号
+
+	CategoryTree() {
+		nodes.push_back(CategoryNode());
+		ids[""] = 0;
+	}
+	// 查找路径对应的节点，不存在时连同缺少的上级一起创建。
+	int nodeFor(const string& path) {
+		auto it = ids.find(path);
+		if (it != ids.end()) return it->second;
+		size_t slash = path.rfind(CATEGORY_PATH_SEPARATOR);
+		int parent = slash == string::npos ? 0 : nodeFor(path.substr(0, slash));
+		CategoryNode node;
+		node.name = slash == string::npos ? path : path.substr(slash + 1);
+		node.path = path;
+		node.parent = parent;
+		node.depth = nodes[parent].depth + 1;
+		int id = (int)nodes.size();
+		nodes.push_back(node);
+		nodes[parent].children.push_back(id);
+		ids[path] = id;
+		return id;
+	}
+	int find(const string& path) const {
+		auto it = ids.find(path);
+		return it == ids.end() ? -1 : it->second;
+	}
+};
+
+// 【月度类别聚合】某月每个类别节点的子树合计 (该类别及其全部子类别)，按节点编号存放。
+class MonthRollup {
+public:
+	TrackedVector<long long, MEMORY_INDEXES> cents; // 金额合计 (单位: 分)
+	TrackedVector<int, MEMORY_INDEXES> counts;      // 记录数
+	// 从 `node` 沿父节点一直加到根，O(层数)。
+	void add(const CategoryTree& tree, int node, long long amountCents, int count) {
+		if (cents.size() < tree.nodes.size()) {
+			cents.resize(tree.nodes.size(), 0);
+			counts.resize(tree.nodes.size(), 0);
+		}
+		for (int n = node; n >= 0; n = tree.nodes[n].parent) {
+			cents[n] += amountCents;
+			counts[n] += count;
+		}
+	}
+	long long totalCents(int node) const { return node >= 0 && node < (int)cents.size() ? cents[node] : 0; }
+	int recordCount(int node) const { return node >= 0 && node < (int)counts.size() ? counts[node] : 0; }
+};
+
+/*
+【多维汇总立方体】
+年 × 月 × 日 × 类别 四个维度上的汇总，每个单元格保存金额 (分) 与记录数，随 `recordAdded` / `recordRemoved` 增量更新。
+按任意维度切片 (固定某些维度的取值) 并沿任一维度汇总，例如 "2025 年交通的每个月"、"本月的每一天"，
+只需遍历切片内的几百到几千个单元格，不必重新扫描记录。
+布局: 每个有记录的年份一块稠密数组 (按年份放在 map 中)，块内下标 = (类别 * 12 + 月 - 1) * 31 + 日 - 1，同一个月的 31 天连续存放；
+某年第一次出现某个类别时才把该年的块扩到这个类别。内存只与有记录的年份数成正比，
+个别日期异常的记录 (例如 0001 年或 9999 年) 只多占一块，不会按整个年份区间分配。
+立方体只包含已加载的记录；钻取报告在第一次使用前加载全部分区。
+*/
+enum CubeDimension {
+	CUBE_BY_YEAR,
+	CUBE_BY_MONTH,
+	CUBE_BY_DAY,
+	CUBE_BY_CATEGORY
+};
+
+class CubeCell {
+public:
+	long long cents;
+	int count;
+	CubeCell() : cents(0), count(0) {}
+};
+
+// 切片条件: 年/月/日为 0 表示该维度不限；`categories` 为空表示全部类别。
+class CubeSlice {
+public:
+	int year, month, day;
+	vector<int> categories;
+	CubeSlice() : year(0), month(0), day(0) {}
+};
+
+class ExpenseCube {
+public:
+	int firstYear;                         // 有记录的最早一年 (按年汇总时结果的下标 0)
+	int yearCount;                         // 最早一年到最晚一年的年数
+	vector<string> categoryNames;          // 类别编号 -> 类别路径
+	unordered_map<string, int> categoryIds;
+	map<int, TrackedVector<CubeCell, MEMORY_INDEXES> > years; // 年份 -> 该年的单元格块 (按需分配)
+
+	ExpenseCube() : firstYear(0), yearCount(0) {}
+
+	static size_t cellsPerCategoryYear() { return 12 * 31; }
+	static size_t index(int category, int month, int day) {
+		return ((size_t)category * 12 + month - 1) * 31 + day - 1;
+	}
+
+	void add(const Expense& e, int sign) {
+		int year = e.getYear();
+		if (yearCount == 0) {
+			firstYear = year;
+			yearCount = 1;
+		} else if (year < firstYear) {
+			yearCount += firstYear - year;
+			firstYear = year;
+		} else if (year >= firstYear + yearCount) {
+			yearCount = year - firstYear + 1;
+		}
+		auto found = categoryIds.find(e.getCategory());
+		int category;
+		if (found == categoryIds.end()) { // 新类别: 编号追加在末尾
+			category = (int)categoryNames.size();
+			categoryIds[e.getCategory()] = category;
+			categoryNames.push_back(e.getCategory());
+		} else {
+			category = found->second;
+		}
+		TrackedVector<CubeCell, MEMORY_INDEXES>& block = years[year];
+		if (block.size() < (category + 1) * cellsPerCategoryYear()) block.resize((category + 1) * cellsPerCategoryYear()); // 该年第一次出现这个类别
+		CubeCell& cell = block[index(category, e.getMonth(), e.getDay())];
+		cell.cents += sign * llround(e.getAmount() * 100);
+		cell.count += sign;
+	}
+
+	// 类别及其全部子类别的编号 (路径为空时返回空数组，即全部类别)。
+	vector<int> categoriesUnder(const string& path) const {
+		vector<int> ids;
+		if (path.empty()) return ids;
+		for (size_t c = 0; c < categoryNames.size(); ++c) {
+			const string& name = categoryNames[c];
+			if (name == path || (name.size() > path.size() && name.compare(0, path.size(), path) == 0 && name[path.size()] == CATEGORY_PATH_SEPARATOR)) {
+				ids.push_back((int)c);
+			}
+		}
+		return ids;
+	}
+
+	// 沿 `by` 维度汇总切片内的单元格。结果的下标: 年为相对 `firstYear` 的偏移，月和日从 0 开始，类别为类别编号。
+	vector<CubeCell> rollup(const CubeSlice& slice, CubeDimension by) const {
+		size_t width = by == CUBE_BY_YEAR ? yearCount : by == CUBE_BY_MONTH ? 12 : by == CUBE_BY_DAY ? 31 : categoryNames.size();
+		vector<CubeCell> result(width);
+		auto from = slice.year != 0 ? years.lower_bound(slice.year) : years.begin();
+		auto to = slice.year != 0 ? years.upper_bound(slice.year) : years.end();
+		int m0 = slice.month ? slice.month : 1, m1 = slice.month ? slice.month : 12;
+		int d0 = slice.day ? slice.day : 1, d1 = slice.day ? slice.day : 31;
+		size_t categoryCount = slice.categories.empty() ? categoryNames.size() : slice.categories.size();
+		for (auto year = from; year != to; ++year) {
+			const TrackedVector<CubeCell, MEMORY_INDEXES>& block = year->second;
+			for (size_t k = 0; k < categoryCount; ++k) {
+				int c = slice.categories.empty() ? (int)k : slice.categories[k];
+				if (block.size() < (c + 1) * cellsPerCategoryYear()) continue; // 该年没有这个类别的记录
+				for (int m = m0; m <= m1; ++m) {
+					const CubeCell* row = &block[index(c, m, 1)]; // 该月 31 天连续存放
+					for (int d = d0; d <= d1; ++d) {
+						const CubeCell& cell = row[d - 1];
+						if (cell.count == 0) continue;
+						size_t slot = by == CUBE_BY_YEAR ? year->first - firstYear : by == CUBE_BY_MONTH ? m - 1 : by == CUBE_BY_DAY ? d - 1 : c;
+						result[slot].cents += cell.cents;
+						result[slot].count += cell.count;
+					}
+				}
+			}
+		}
+		return result;
+	}
+};
+
+// 【月度汇总】核心接口 `coreSummarize` 的结果: 该月的合计与各类别的合计 (只列出有记录的类别)。
+class MonthSummary {
+public:
+	int year;
+	int month;
+	long long totalCents;
+	int recordCount;
+	vector<pair<string, CubeCell> > categories;
+
+	MonthSummary() : year(0), month(0), totalCents(0), recordCount(0) {}
+};
+
+// 【压力测试】`runStressTest` 中一个线程的统计 (各操作的延迟，单位微秒)。
+class StressWorkerStats {
+public:
+	vector<double> readMicros;
+	vector<double> writeMicros;
+	long queryRows; // 查询返回的记录总数 (防止编译器把查询当作无用计算)
+
+	StressWorkerStats() : queryRows(0) {}
+};
+
+const int STRESS_MIN_RECORDS = 1000;    // 账本记录少于此数时先生成测试数据
+const int STRESS_SEED_RECORDS = 50000;  // 生成的测试记录数
+
+// 第 q 分位数 (0 <= q <= 1)，会打乱 `values` 的顺序。
+double percentile(vector<double>& values, double q) {
+	if (values.empty()) return 0;
+	size_t k = min(values.size() - 1, (size_t)(q * values.size()));
+	nth_element(values.begin(), values.begin() + k, values.end());
+	return values[k];
+}
+
+// 【类别滚动统计】一个类别近期金额 (分) 的指数加权移动平均与方差，每条新记录 O(1) 更新，不需要回看历史。
+// 前 1/ALPHA 条记录使用 1/count 作为系数，此时就是普通的均值与方差，之后逐渐忘记较早的记录。
+class CategoryTrend {
+public:
+	long count;
+	double mean;
+	double variance;
+
+	CategoryTrend() : count(0), mean(0), variance(0) {}
+
+	// 金额是否远高于近期水平: 样本足够，且同时超出 mean + SIGMAS 个标准差和 MIN_RATIO 倍均值。
+	bool isOutlier(double cents) const {
+		if (count < ANOMALY_MIN_SAMPLES) return false;
+		return cents > max(mean + ANOMALY_SIGMAS * sqrt(variance), mean * ANOMALY_MIN_RATIO);
+	}
+
+	void update(double cents) {
+		++count;
+		double alpha = max(ANOMALY_EWMA_ALPHA, 1.0 / count);
+		double diff = cents - mean;
+		double step = alpha * diff;
+		mean += step;
+		variance = (1 - alpha) * (variance + diff * step);
+	}
+};
+
+// 【异常开销】添加或导入时被标记的一条记录，`expectedCents` 是当时该类别的滚动均值。
+class AnomalyFlag {
+public:
+	uint64_t id;
+	int date; // YYYYMMDD
+	long long cents;
+	long long expectedCents;
+	string category;
+
+	AnomalyFlag() : id(0), date(0), cents(0), expectedCents(0) {}
+};
+
+// 【分组键】
+class ByCategory {
+public:
+	const string& operator()(const Expense& e) const { return e.getCategory(); }
+};
+
+// 【明细表格的表头与单行打印】所有列表类报告共用同一种格式。
+// `out` 默认为屏幕，后台结算把报告写进日志时传入字符串流。
+void printExpenseHeader(bool withIndex = false, ostream& out = cout) {
+	out << left;
+	if (withIndex) out << setw(5) << "序号";
+	out << setw(12) << "日期" << setw(30) << "描述" << setw(20) << "类别" << right << setw(10) << "金额\n";
+	out << string((withIndex ? 5 : 0) + 12 + 30 + 20 + 10, '-') << "\n";
+}
+
+void printExpenseSeparator(bool withIndex = false, ostream& out = cout) {
+	out << string((withIndex ? 5 : 0) + 12 + 30 + 20 + 10, '-') << "\n";
+}
+
+void printExpenseRow(const Expense& e, ostream& out = cout) {
+	out << right << setfill('0') << setw(4) << e.getYear() << "-" << setw(2) << e.getMonth() << "-" // 日期 YYYY-MM-DD (右对齐补0)
+		 << setw(2) << e.getDay() << setfill(' ') << "  "
+		 << left << setw(30) << e.getDescription()                                     // 描述
+		 << setw(20) << e.getCategory()                                                // 类别
+		 << right << fixed << setprecision(2) << setw(10) << e.getAmount() << "\n";    // 金额
+}
+
+// 【输出端: 打印明细】`withIndex` 为 true 时在最前面打印从 1 开始的序号 (删除记录时使用)。
+class PrintSink {
+public:
+	int count;
+	bool withIndex;
+	ostream& out;
+	explicit PrintSink(bool indexed = false, ostream& o = cout) : count(0), withIndex(indexed), out(o) {}
+	void consume(const Expense& e) {
+		++count;
+		if (withIndex) out << left << setw(5) << count;
+		printExpenseRow(e, out);
+	}
+};
+
+// 【输出端: 汇总】累加总金额和记录数，并按 GroupKey 分组汇总 (最多 MAX_UNIQUE_CATEGORIES_PER_MONTH 组)。
+template <typename GroupKey>
+class AggregateSink {
+public:
+	double total;
+	int count;
+	CategorySum groups[MAX_UNIQUE_CATEGORIES_PER_MONTH];
+	int groupCount;
+	AggregateSink() : total(0.0), count(0), groupCount(0) {}
+	void consume(const Expense& e) {
+		total += e.getAmount();
+		++count;
+		const string& key = GroupKey()(e);
+		for (int j = 0; j < groupCount; ++j) {
+			if (groups[j].name == key) { groups[j].total += e.getAmount(); return; }
+		}
+		if (groupCount < MAX_UNIQUE_CATEGORIES_PER_MONTH) { // 新分组
+			groups[groupCount].name = key;
+			groups[groupCount].total = e.getAmount();
+			++groupCount;
+		}
+	}
+};
+
+// 【输出端: 收集】把记录复制到数组中 (交给后台线程的快照)。
+class CollectSink {
+public:
+	vector<Expense>& records;
+	explicit CollectSink(vector<Expense>& out) : records(out) {}
+	void consume(const Expense& e) { records.push_back(e); }
+};
+
+// 【输出端: 内容校验值】各记录哈希之和，与记录顺序无关 (结算档案使用)。
+class HashSink {
+public:
+	uint64_t contentHash;
+	HashSink() : contentHash(0) {}
+	void consume(const Expense& e) { contentHash += recordContentHash(e); }
+};
+
+// 【输出端: 分区校验值】从 EMPTY_BLOCK_HASH 开始累加各记录的 `recordBlockHash`，删除标记由调用方另外加上。
+class BlockHashSink {
+public:
+	uint64_t blockHash;
+	BlockHashSink() : blockHash(EMPTY_BLOCK_HASH) {}
+	void consume(const Expense& e) { blockHash += recordBlockHash(e); }
+};
+
+// 【输出端: 导出】按数据文件格式 (逗号分隔) 写出记录。
+class RecordWriterSink {
+public:
+	ostream& out;
+	int written;
+	explicit RecordWriterSink(ostream& o) : out(o), written(0) {}
+	void consume(const Expense& e) {
+		out << "@" << formatRecordId(e.getId()) << "," // 记录编号
+			<< e.getDate().value() << "," // 日期写成一个 yyyymmdd 字段
+			<< e.getDescription() << "," << e.getAmount() << "," << e.getCategory() << "\n";
+		++written;
+	}
+};
+
+// 【输出端组合】把同一条记录依次交给多个输出端 (例如同时打印和汇总)。
+template <typename... Sinks>
+class TeeSink {
+public:
+	tuple<Sinks&...> sinks;
+	explicit TeeSink(Sinks&... s) : sinks(s...) {}
+	void consume(const Expense& e) {
+		apply([&e](Sinks&... s) { (s.consume(e), ...); }, sinks);
+	}
+};
+
+/*
+【JSON / NDJSON 输出】
+供仪表盘等程序读取的机器可读格式: 字段名为英文，金额是两位小数的数字，日期是 "YYYY-MM-DD"，记录编号是 16 位十六进制字符串。
+- NDJSON: 每个对象一行；
+- JSON: 整个输出是一个数组，每个对象是其中一个元素。
+两种格式的对象相同，都带 "type" 字段 ("record" / "summary" / "settlement")，一次输出中可以混合多种对象。
+JsonWriter 把文本直接拼进固定大小的缓冲区，满了才整块写到输出流；整数、金额、日期和编号都手工转成字符，
+字符串逐字节转义 (只有引号、反斜杠和控制字符需要处理，中文按 UTF-8 原样输出)，写一条记录不分配内存。
+*/
+const size_t JSON_BUFFER_SIZE = 1 << 16; // 输出缓冲区 (字节)
+const int JSON_MAX_DEPTH = 16;           // 对象/数组的最大嵌套层数
+
+class JsonWriter {
+public:
+	ostream& out;
+	bool lines;                       // true: NDJSON
+	char buffer[JSON_BUFFER_SIZE];
+	size_t used;
+	int depth;
+	bool inArray[JSON_MAX_DEPTH];     // 各层是数组还是对象
+	bool needComma[JSON_MAX_DEPTH];   // 各层是否已有元素 (下一个元素前要加逗号)
+	long rows;                        // 已写出的顶层对象数
+
+	JsonWriter(ostream& o, bool ndjson) : out(o), lines(ndjson), used(0), depth(0), rows(0) {
+		inArray[0] = false;
+		needComma[0] = false;
+		if (!lines) beginArray(); // JSON: 顶层数组
+	}
+	~JsonWriter() { flush(); }
+
+	void flush() {
+		if (used > 0) out.write(buffer, used);
+		used = 0;
+	}
+	void reserve(size_t n) {
+		if (used + n > JSON_BUFFER_SIZE) flush();
+	}
+	void put(char c) {
+		reserve(1);
+		buffer[used++] = c;
+	}
+	void put(const char* text, size_t n) {
+		if (n > JSON_BUFFER_SIZE) { // 超长字符串直接写出
+			flush();
+			out.write(text, n);
+			return;
+		}
+		reserve(n);
+		memcpy(buffer + used, text, n);
+		used += n;
+	}
+
+	// 数组中的元素之间加逗号；对象成员的逗号由 `key` 负责。
+	void beginValue() {
+		if (!inArray[depth]) return;
+		if (needComma[depth]) put(',');
+		needComma[depth] = true;
+	}
+	void open(char c, bool array) {
+		beginValue();
+		put(c);
+		++depth;
+		inArray[depth] = array;
+		needComma[depth] = false;
+	}
+	void beginObject() { open('{', false); }
+	void endObject() { --depth; put('}'); }
+	void beginArray() { open('[', true); }
+	void endArray() { --depth; put(']'); }
+	void beginRow() { beginObject(); }
+	void endRow() {
+		endObject();
+		++rows;
+		if (lines) put('\n');
+	}
+	// 结束输出: JSON 格式补上顶层数组的右括号。
+	void finish() {
+		if (!lines) {
+			endArray();
+			put('\n');
+		}
+		flush();
+	}
+
+	void key(const char* name) { // 字段名都是程序中的 ASCII 常量，无需转义
+		if (needComma[depth]) put(',');
+		needComma[depth] = true;
+		put('"');
+		put(name, strlen(name));
+		put('"');
+		put(':');
+	}
+	void writeString(const char* text, size_t n) {
+		static const char hexDigits[] = "0123456789abcdef";
+		beginValue();
+		put('"');
+		size_t start = 0; // 尚未写出的一段不需要转义的字符
+		for (size_t i = 0; i < n; ++i) {
+			unsigned char c = (unsigned char)text[i];
+			if (c >= 0x20 && c != '"' && c != '\\') continue;
+			put(text + start, i - start);
+			start = i + 1;
+			put('\\');
+			switch (c) {
+				case '"': put('"'); break;
+				case '\\': put('\\'); break;
+				case '\n': put('n'); break;
+				case '\r': put('r'); break;
+				case '\t': put('t'); break;
+				default: // 其他控制字符写成 \u00XX
+					put("u00", 3);
+					put(hexDigits[c >> 4]);
+					put(hexDigits[c & 15]);
+			}
+		}
+		put(text + start, n - start);
+		put('"');
+	}
+	void writeString(const string& text) { writeString(text.data(), text.size()); }
+	void appendUnsigned(unsigned long long value) {
+		char digits[24];
+		int n = 0;
+		do { digits[n++] = (char)('0' + value % 10); value /= 10; } while (value != 0);
+		reserve(n);
+		while (n > 0) buffer[used++] = digits[--n];
+	}
+	void writeInteger(long long value) {
+		beginValue();
+		if (value < 0) put('-');
+		appendUnsigned(value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value);
+	}
+	void writeCents(long long cents) { // 金额: 整数部分 + 两位小数
+		beginValue();
+		if (cents < 0) {
+			put('-');
+			cents = -cents;
+		}
+		appendUnsigned((unsigned long long)(cents / 100));
+		reserve(3);
+		buffer[used++] = '.';
+		buffer[used++] = (char)('0' + cents % 100 / 10);
+		buffer[used++] = (char)('0' + cents % 10);
+	}
+	void writeDigits(unsigned value, int width) {
+		reserve(width);
+		for (int i = width - 1; i >= 0; --i, value /= 10) buffer[used + i] = (char)('0' + value % 10);
+		used += width;
+	}
+	void writeDate(const Date& date) { // "YYYY-MM-DD"
+		beginValue();
+		reserve(12);
+		put('"');
+		writeDigits(date.year(), 4);
+		put('-');
+		writeDigits(date.month(), 2);
+		put('-');
+		writeDigits(date.day(), 2);
+		put('"');
+	}
+	void writeHex(uint64_t value) { // 16 位十六进制字符串 (与数据文件中的记录编号相同)
+		static const char hexDigits[] = "0123456789abcdef";
+		beginValue();
+		reserve(18);
+		buffer[used++] = '"';
+		for (int shift = 60; shift >= 0; shift -= 4) buffer[used++] = hexDigits[(value >> shift) & 15];
+		buffer[used++] = '"';
+	}
+
+	void field(const char* name, const char* text) { key(name); writeString(text, strlen(text)); }
+	void field(const char* name, const string& text) { key(name); writeString(text); }
+	void field(const char* name, long long value) { key(name); writeInteger(value); }
+	void fieldBool(const char* name, bool value) { key(name); put(value ? "true" : "false", value ? 4 : 5); }
+	void fieldCents(const char* name, long long cents) { key(name); writeCents(cents); }
+	void fieldDate(const char* name, const Date& date) { key(name); writeDate(date); }
+	void fieldHex(const char* name, uint64_t value) { key(name); writeHex(value); }
+};
+
+// 【输出端: JSON 记录】每条记录写成一个 "record" 对象，直接从记录存储序列化。
+class JsonRecordSink {
+public:
+	JsonWriter& json;
+	long count;
+	explicit JsonRecordSink(JsonWriter& writer) : json(writer), count(0) {}
+	void consume(const Expense& e) {
+		json.beginRow();
+		json.field("type", "record");
+		json.fieldHex("id", e.getId());
+		json.fieldDate("date", e.getDate());
+		json.field("description", e.getDescription());
+		json.fieldCents("amount", llround(e.getAmount() * 100));
+		json.field("category", e.getCategory());
+		json.endRow();
+		++count;
+	}
+};
+
+/*
+【银行流水 CSV 导入流水线】
+读取线程 -> 解析线程 x N -> 写入 (主线程)，相邻两级之间用有界无锁队列 SpscQueue 连接:
+1. 读取线程每次读入 CSV_READ_BLOCK 字节，截到最后一个换行符为止作为一个数据块，块按序号轮流分给各解析线程；
+2. 解析线程按表头确定的列号取出日期、描述、金额、类别，做与 loadExpenses 相同的字段检查
+   (日期有效、金额可解析、描述和类别超长截断)，类别按别名表换成规范名；
+3. 主线程按块序号依次从各解析线程的结果队列取出 (第 k 块一定在第 k % N 个队列里)，保持文件中的行顺序，
+   逐批加载分区、处理重复记录并插入。只有主线程修改 ExpenseTracker，解析线程只读导入前复制的别名表。
+*/
+const size_t CSV_READ_BLOCK = 1 << 20;   // 读取线程每次读入的字节数
+const size_t CSV_QUEUE_CAPACITY = 8;     // 每个队列最多缓存的块数 (2 的幂)
+const unsigned CSV_MAX_WORKERS = 8;      // 解析线程数上限
+const size_t CSV_MAX_ERROR_LINES = 10;   // 报告中列出的被拒绝行数上限
+const char* CSV_DEFAULT_CATEGORY = "未分类"; // 文件没有类别列时使用
+
+// 【单生产者单消费者有界队列】每个队列只有一个线程写入、一个线程取出，两个下标各由一方修改，不需要加锁。
+// 队列满 (或空) 时 push (pop) 让出 CPU 后重试。
+template <typename T>
+class SpscQueue {
+public:
+	explicit SpscQueue(size_t capacity) : slots(capacity), head(0), tail(0) {}
+	bool tryPush(T& item) {
+		size_t t = tail.load(memory_order_relaxed);
+		if (t - head.load(memory_order_acquire) == slots.size()) return false; // 满
+		slots[t % slots.size()] = move(item);
+		tail.store(t + 1, memory_order_release); // 发布: 消费者看到新下标时一定能看到写好的元素
+		return true;
+	}
+	bool tryPop(T& item) {
+		size_t h = head.load(memory_order_relaxed);
+		if (h == tail.load(memory_order_acquire)) return false; // 空
+		item = move(slots[h % slots.size()]);
+		head.store(h + 1, memory_order_release); // 归还槽位
+		return true;
+	}
+	void push(T& item) { while (!tryPush(item)) this_thread::yield(); }
+	void pop(T& item) { while (!tryPop(item)) this_thread::yield(); }
+private:
+	vector<T> slots;
+	alignas(64) atomic<size_t> head; // 下一个要取出的位置 (只由消费者修改)
+	alignas(64) atomic<size_t> tail; // 下一个要写入的位置 (只由生产者修改)
+};
+
+// 【CSV 数据块】若干完整的行。`last` 为 true 的块不含数据，表示文件已读完。
+class CsvChunk {
+public:
+	size_t sequence;  // 块序号 (从 0 开始)
+	long firstLine;   // 块内第一行在文件中的行号 (从 1 开始，表头是第 1 行)
+	IoBuffer text;
+	bool last;
+	CsvChunk() : sequence(0), firstLine(0), last(false) {}
+};
+
+// 【一个数据块的解析结果】
+class CsvBatch {
+public:
+	size_t sequence;
+	vector<Expense> rows;   // 通过检查的记录 (尚未分配编号)
+	long lineCount;         // 块内的数据行数 (不含空行)
+	int rejected;           // 字段检查不通过的行数
+	int credits;            // 收入/退款行 (不是支出，不导入)
+	vector<string> errors;  // 被拒绝行的原因 (最多 CSV_MAX_ERROR_LINES 条)
+	bool last;
+	CsvBatch() : sequence(0), lineCount(0), rejected(0), credits(0), last(false) {}
+};
+
+// 【CSV 列布局】由表头确定；解析线程共享只读。
+class CsvLayout {
+public:
+	char delimiter;
+	int dateColumn, descriptionColumn, amountColumn, categoryColumn; // 列号，-1 表示没有该列
+	bool negativeIsExpense; // true: 支出记为负数、正数为收入 (多数银行导出)；false: 支出记为正数
+	unordered_map<string, string> categoryAliases; // 类别名或别名 -> 规范名 (导入前从类别字典复制)
+	CsvLayout() : delimiter(','), dateColumn(-1), descriptionColumn(-1), amountColumn(-1), categoryColumn(-1), negativeIsExpense(true) {}
+};
+
+// 【拆分 CSV 行】支持双引号包围的字段和 "" 转义；去掉行尾的 '\r'。
+void splitCsvLine(const string& line, char delimiter, vector<string>& fields) {
+	fields.clear();
+	string field;
+	bool quoted = false;
+	size_t end = line.size();
+	if (end > 0 && line[end - 1] == '\r') --end;
+	for (size_t i = 0; i < end; ++i) {
+		char c = line[i];
+		if (quoted) {
+			if (c == '"' && i + 1 < end && line[i + 1] == '"') { field += '"'; ++i; }
+			else if (c == '"') quoted = false;
+			else field += c;
+		} else if (c == '"') {
+			quoted = true;
+		} else if (c == delimiter) {
+			fields.push_back(field);
+			field.clear();
+		} else {
+			field += c;
+		}
+	}
+	fields.push_back(field);
+} // `splitCsvLine` 函数结束。
+
+// 【判断分隔符】表头中逗号、分号、制表符哪个最多就用哪个。
+char detectCsvDelimiter(const string& header) {
+	const char candidates[] = { ',', ';', '\t' };
+	char best = ',';
+	long bestCount = 0;
+	for (char c : candidates) {
+		long n = count(header.begin(), header.end(), c);
+		if (n > bestCount) { best = c; bestCount = n; }
+	}
+	return best;
+}
+
+// 【表头列名规范化】去掉 UTF-8 BOM 和首尾空白，英文转小写。
+string normalizeCsvHeader(string name) {
+	if (name.compare(0, 3, "\xEF\xBB\xBF") == 0) name.erase(0, 3);
+	name = trimCategory(name);
+	for (char& c : name) c = (char)tolower((unsigned char)c);
+	return name;
+}
+
+// 【按表头确定列号】日期和金额列必须有，描述和类别列可以没有。
+bool mapCsvColumns(const vector<string>& header, CsvLayout& layout, string& error) {
+	const char* dateNames[] = { "date", "transaction date", "posting date", "booking date", "日期", "交易日期", "记账日期", "交易时间" };
+	const char* descriptionNames[] = { "description", "memo", "payee", "details", "narrative", "描述", "摘要", "交易摘要", "备注", "对方户名", "商户名称" };
+	const char* amountNames[] = { "amount", "transaction amount", "金额", "交易金额", "发生额" };
+	const char* categoryNames[] = { "category", "类别", "分类", "交易类型" };
+	for (size_t c = 0; c < header.size(); ++c) {
+		string name = normalizeCsvHeader(header[c]);
+		for (const char* n : dateNames) if (layout.dateColumn < 0 && name == n) layout.dateColumn = (int)c;
+		for (const char* n : descriptionNames) if (layout.descriptionColumn < 0 && name == n) layout.descriptionColumn = (int)c;
+		for (const char* n : amountNames) if (layout.amountColumn < 0 && name == n) layout.amountColumn = (int)c;
+		for (const char* n : categoryNames) if (layout.categoryColumn < 0 && name == n) layout.categoryColumn = (int)c;
+	}
+	if (layout.dateColumn < 0) { error = "表头中没有日期列 (date / 日期 / 交易日期 ...)"; return false; }
+	if (layout.amountColumn < 0) { error = "表头中没有金额列 (amount / 金额 / 交易金额 ...)"; return false; }
+	return true;
+}
+
+// 【解析 CSV 日期】接受 YYYY-MM-DD、YYYY/MM/DD、YYYY.MM.DD 和 YYYYMMDD，后面可以带时间 ("2025-03-01 12:30:00")。
+// 只检查格式，日期是否真实存在由 Expense::setData 检查。
+bool parseCsvDate(const string& text, int& year, int& month, int& day) {
+	string s = trimCategory(text);
+	size_t space = s.find_first_of(" T");
+	if (space != string::npos) s = s.substr(0, space);
+	int parts[3] = { 0, 0, 0 };
+	int part = 0, digits = 0;
+	for (char c : s) {
+		if (isdigit((unsigned char)c)) {
+			parts[part] = parts[part] * 10 + (c - '0');
+			if (++digits > 8) return false;
+		} else if ((c == '-' || c == '/' || c == '.') && digits > 0 && part < 2) {
+			++part;
+			digits = 0;
+		} else {
+			return false;
+		}
+	}
+	if (part == 0 && digits == 8) { // YYYYMMDD
+		year = parts[0] / 10000;
+		month = parts[0] / 100 % 100;
+		day = parts[0] % 100;
+		return true;
+	}
+	if (part != 2 || digits == 0) return false;
+	year = parts[0];
+	month = parts[1];
+	day = parts[2];
+	return true;
+}
+
+// 【解析 CSV 金额】去掉货币符号、千位分隔符和空白；"(12.50)" 视为负数。整个字段都必须是数字才算有效。
+bool parseCsvAmount(const string& text, double& amount) {
+	string s;
+	bool negative = false;
+	for (char c : text) {
+		if (isdigit((unsigned char)c) || c == '.' || c == '-' || c == '+') s += c;
+		else if (c == '(' || c == ')') negative = true;
+		else if (c == ',' || c == '$' || c == '\'' || isspace((unsigned char)c) || (unsigned char)c >= 0x80) continue; // 分隔符、货币符号 (¥ 等多字节字符)
+		else return false;
+	}
+	if (s.empty()) return false;
+	char* end = nullptr;
+	amount = strtod(s.c_str(), &end);
+	if (*end != '\0' || !isfinite(amount)) return false;
+	if (negative) amount = -fabs(amount);
+	return true;
+}
+
+// 【解析一个数据块】逐行拆分字段并检查，结果写入 `batch`。只读取 `layout`，可在多个线程中同时调用。
+void parseCsvChunk(const CsvChunk& chunk, const CsvLayout& layout, CsvBatch& batch) {
+	MemoryStreamBuffer source(chunk.text.data(), chunk.text.size());
+	istream in(&source);
+	string line;
+	vector<string> fields;
+	long lineNumber = chunk.firstLine - 1;
+	int needed = max(max(layout.dateColumn, layout.amountColumn), max(layout.descriptionColumn, layout.categoryColumn)) + 1;
+	while (getline(in, line)) {
+		++lineNumber;
+		if (line.empty() || line == "\r") continue;
+		batch.lineCount++;
+		splitCsvLine(line, layout.delimiter, fields);
+		string reason;
+		int year = 0, month = 0, day = 0;
+		double amount = 0.0;
+		if ((int)fields.size() < needed) reason = "列数不足";
+		else if (!parseCsvDate(fields[layout.dateColumn], year, month, day)) reason = "日期格式无效 \"" + fields[layout.dateColumn] + "\"";
+		else if (!parseCsvAmount(fields[layout.amountColumn], amount)) reason = "金额格式无效 \"" + fields[layout.amountColumn] + "\"";
+		if (reason.empty()) {
+			if (layout.negativeIsExpense) { // 负数是支出；正数 (含 0) 是收入或退款
+				if (amount >= 0) { batch.credits++; continue; }
+				amount = -amount;
+			} else if (amount < 0) {
+				reason = "金额为负";
+			}
+		}
+		if (reason.empty()) {
+			string description = layout.descriptionColumn >= 0 ? sanitizeRecordField(trimCategory(fields[layout.descriptionColumn])) : "";
+			if (description.length() > Expense::MAX_DESCRIPTION_LENGTH) description = description.substr(0, Expense::MAX_DESCRIPTION_LENGTH);
+			string category = layout.categoryColumn >= 0 ? sanitizeRecordField(normalizeCategoryPath(fields[layout.categoryColumn])) : "";
+			if (category.empty()) category = CSV_DEFAULT_CATEGORY;
+			if (category.length() > Expense::MAX_CATEGORY_LENGTH) category = category.substr(0, Expense::MAX_CATEGORY_LENGTH);
+			auto alias = layout.categoryAliases.find(category);
+			if (alias != layout.categoryAliases.end()) category = alias->second;
+			if (optional<Expense> record = Expense::create(year, month, day, description, llround(amount * 100) / 100.0, category)) {
+				batch.rows.push_back(move(*record));
+				continue;
+			}
+			reason = "日期 " + to_string(year) + "-" + to_string(month) + "-" + to_string(day) + " 不存在";
+		}
+		batch.rejected++;
+		if (batch.errors.size() < CSV_MAX_ERROR_LINES) batch.errors.push_back("第 " + to_string(lineNumber) + " 行: " + reason);
+	}
+} // `parseCsvChunk` 函数结束。
+
+/*
+【异步文件读写】
+分区文件、清单、类别表等都通过 AsyncFileIO 读写。一批文件按 IO_BLOCK_SIZE 切块后同时提交，
+每读完一个文件就在调用线程中回调一次，调用方解析这个文件时其余文件仍在读取 (I/O 与解析重叠)。
+后端优先使用 Linux io_uring (直接调用系统调用)；内核不支持或被禁止 (容器的 seccomp 规则常见) 时改用线程池执行 pread/pwrite。
+两种后端对调用方完全相同，回调只在调用线程中执行，因此回调里可以直接修改 ExpenseTracker。
+写入时每个文件先写到 "路径.tmp"，fsync 后再改名覆盖原文件 (见 `writeFiles`)：写入失败或程序崩溃时原文件保持完整。
+*/
+const size_t IO_BLOCK_SIZE = 256 * 1024; // 每个读写请求的最大字节数
+const unsigned IO_QUEUE_DEPTH = 64;      // io_uring 提交队列长度 (同时在途的请求数上限)
+const unsigned IO_POOL_THREADS = 4;      // 线程池后端的线程数
+
+// 【文件读写请求】
+class FileRequest {
+public:
+	string path;
+	IoBuffer data; // 读: 完成后为文件内容；写: 要写出的内容
+	bool ok;      // 完成后表示是否成功
+	int fd;       // 以下两项由 AsyncFileIO 内部使用
+	int pending;  // 尚未完成的块数
+	FileRequest() : ok(false), fd(-1), pending(0) {}
+	explicit FileRequest(const string& p, const string& d = "") : path(p), data(d.data(), d.size()), ok(false), fd(-1), pending(0) {}
+};
+
+// 【文件块】请求 `file` 中的一段 [offset, offset + length)。
+class IoBlock {
+public:
+	size_t file;
+	size_t offset;
+	size_t length;
+	IoBlock(size_t f, size_t o, size_t l) : file(f), offset(o), length(l) {}
+};
+
+// 【线程池】线程池后端执行读写块的固定线程，第一次使用时才创建。
+class FileThreadPool {
+public:
+	explicit FileThreadPool(unsigned threadCount) : stopping(false) {
+		for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back([this]() { work(); });
+	}
+	~FileThreadPool() {
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		signal.notify_all();
+		for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+	}
+	void submit(function<void()> task) {
+		{
+			lock_guard<mutex> guard(lock);
+			tasks.push_back(move(task));
+		}
+		signal.notify_one();
+	}
+private:
+	void work() {
+		for (;;) {
+			function<void()> task;
+			{
+				unique_lock<mutex> guard(lock);
+				signal.wait(guard, [this]() { return stopping || !tasks.empty(); });
+				if (tasks.empty()) return; // 正在关闭且没有剩余任务
+				task = move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+	vector<thread> workers;
+	mutex lock;
+	condition_variable signal;
+	deque<function<void()> > tasks;
+	bool stopping;
+};
+
+class AsyncFileIO {
+public:
+	AsyncFileIO();
+	~AsyncFileIO();
+	// 读取一批文件，每个文件完成 (或失败) 时以其下标调用一次 `onComplete`。
+	void readFiles(vector<FileRequest>& requests, const function<void(size_t)>& onComplete);
+	// 同时写出一批文件，全部成功时返回 true；各文件是否成功见 `ok`。
+	bool writeFiles(vector<FileRequest>& requests);
+	bool readFile(const string& path, string& data);
+	bool writeFile(const string& path, const string& data);
+private:
+	size_t splitIntoBlocks(size_t file, FileRequest& request, vector<IoBlock>& blocks);
+	void finishBlock(FileRequest& request, size_t file, bool success, bool writing, const function<void(size_t)>& onComplete);
+	static void closeRequest(FileRequest& request, bool writing);
+	void runBlocks(vector<FileRequest>& requests, vector<IoBlock>& blocks, bool writing, const function<void(size_t)>& onComplete);
+	void runBlocksOnRing(vector<FileRequest>& requests, vector<IoBlock>& blocks, bool writing, const function<void(size_t)>& onComplete);
+	void runBlocksOnPool(vector<FileRequest>& requests, vector<IoBlock>& blocks, bool writing, const function<void(size_t)>& onComplete);
+	static bool transferBlock(FileRequest& request, const IoBlock& block, bool writing);
+	void closeRing();
+
+	int ringFd;                   // io_uring 实例，-1 表示使用线程池
+	char* sqRing;                 // 提交队列 (与完成队列可能共用一段映射)
+	char* cqRing;                 // 完成队列
+	void* sqes;                   // 提交队列条目数组
+	size_t sqRingSize, cqRingSize, sqesSize;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray, sqEntries;
+	unsigned *cqHead, *cqTail, *cqMask;
+	void* cqes;
+	unique_ptr<FileThreadPool> pool;
+};
+
+// 【`AsyncFileIO` 构造函数】尝试建立 io_uring；任何一步失败都改用线程池。
+AsyncFileIO::AsyncFileIO() : ringFd(-1), sqRing(nullptr), cqRing(nullptr), sqes(nullptr), sqRingSize(0), cqRingSize(0), sqesSize(0),
+	sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr), sqEntries(0), cqHead(nullptr), cqTail(nullptr), cqMask(nullptr), cqes(nullptr) {
+#ifdef __NR_io_uring_setup
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = (int)syscall(__NR_io_uring_setup, IO_QUEUE_DEPTH, &params);
+	if (fd < 0) return;
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0; // 两个队列共用一次映射 (5.4 起)
+	if (single) sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+	sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	void* sq = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	void* cq = single ? sq : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	void* entries = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (sq == MAP_FAILED || cq == MAP_FAILED || entries == MAP_FAILED) {
+		if (sq != MAP_FAILED) munmap(sq, sqRingSize);
+		if (!single && cq != MAP_FAILED) munmap(cq, cqRingSize);
+		if (entries != MAP_FAILED) munmap(entries, sqesSize);
+		close(fd);
+		return;
+	}
+	sqRing = (char*)sq;
+	cqRing = (char*)cq;
+	sqes = entries;
+	sqHead = (unsigned*)(sqRing + params.sq_off.head);
+	sqTail = (unsigned*)(sqRing + params.sq_off.tail);
+	sqMask = (unsigned*)(sqRing + params.sq_off.ring_mask);
+	sqArray = (unsigned*)(sqRing + params.sq_off.array);
+	sqEntries = params.sq_entries;
+	cqHead = (unsigned*)(cqRing + params.cq_off.head);
+	cqTail = (unsigned*)(cqRing + params.cq_off.tail);
+	cqMask = (unsigned*)(cqRing + params.cq_off.ring_mask);
+	cqes = cqRing + params.cq_off.cqes;
+	ringFd = fd;
+#endif
+} // `AsyncFileIO` 构造函数结束。
+
+AsyncFileIO::~AsyncFileIO() {
+	closeRing();
+}
+
+// 【`AsyncFileIO::closeRing` - 释放 io_uring，之后的读写改用线程池】
+void AsyncFileIO::closeRing() {
+	if (ringFd < 0) return;
+	munmap(sqes, sqesSize);
+	if (cqRing != sqRing) munmap(cqRing, cqRingSize);
+	munmap(sqRing, sqRingSize);
+	close(ringFd);
+	ringFd = -1;
+} // `AsyncFileIO::closeRing` 函数结束。
+
+// 【`AsyncFileIO::splitIntoBlocks` - 把一个文件切成若干块追加到 `blocks`】返回块数 (空文件为 0)。
+size_t AsyncFileIO::splitIntoBlocks(size_t file, FileRequest& request, vector<IoBlock>& blocks) {
+	size_t count = 0;
+	for (size_t offset = 0; offset < request.data.size(); offset += IO_BLOCK_SIZE, ++count) {
+		blocks.push_back(IoBlock(file, offset, min(IO_BLOCK_SIZE, request.data.size() - offset)));
+	}
+	request.pending = (int)count;
+	return count;
+} // `AsyncFileIO::splitIntoBlocks` 函数结束。
+
+// 【`AsyncFileIO::finishBlock` - 一个块完成】文件的最后一块完成时关闭文件并回调。
+void AsyncFileIO::finishBlock(FileRequest& request, size_t file, bool success, bool writing, const function<void(size_t)>& onComplete) {
+	if (!success) request.ok = false;
+	if (--request.pending > 0) return;
+	closeRequest(request, writing);
+	onComplete(file);
+} // `AsyncFileIO::finishBlock` 函数结束。
+
+// 【`AsyncFileIO::closeRequest` - 关闭一个文件】写出的文件先 fsync: 内容落盘后才改名，崩溃后不会出现只写了一半的新文件。
+void AsyncFileIO::closeRequest(FileRequest& request, bool writing) {
+	if (writing && request.ok && fsync(request.fd) != 0) request.ok = false;
+	close(request.fd);
+	request.fd = -1;
+} // `AsyncFileIO::closeRequest` 函数结束。
+
+// 【`AsyncFileIO::transferBlock` - 同步读写一个块】处理短读写和被信号中断的情况。
+bool AsyncFileIO::transferBlock(FileRequest& request, const IoBlock& block, bool writing) {
+	size_t done = 0;
+	while (done < block.length) {
+		size_t offset = block.offset + done;
+		ssize_t n = writing ? pwrite(request.fd, request.data.data() + offset, block.length - done, (off_t)offset)
+							: pread(request.fd, &request.data[0] + offset, block.length - done, (off_t)offset);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false; // 出错，或读取时文件变短
+		done += (size_t)n;
+	}
+	return true;
+} // `AsyncFileIO::transferBlock` 函数结束。
+
+// 【`AsyncFileIO::readFiles` - 读取一批文件】先同步打开并取得大小 (很快)，再把所有块一起提交。
+void AsyncFileIO::readFiles(vector<FileRequest>& requests, const function<void(size_t)>& onComplete) {
+	vector<IoBlock> blocks;
+	for (size_t f = 0; f < requests.size(); ++f) {
+		FileRequest& request = requests[f];
+		request.data.clear();
+		request.ok = false;
+		request.fd = open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat info;
+		if (request.fd < 0 || fstat(request.fd, &info) != 0) { // 文件不存在或无法访问
+			if (request.fd >= 0) close(request.fd);
+			request.fd = -1;
+			onComplete(f);
+			continue;
+		}
+		request.data.resize((size_t)info.st_size);
+		request.ok = true;
+		if (splitIntoBlocks(f, request, blocks) == 0) { // 空文件
+			request.pending = 1;
+			finishBlock(request, f, true, false, onComplete);
+		}
+	}
+	runBlocks(requests, blocks, false, onComplete);
+} // `AsyncFileIO::readFiles` 函数结束。
+
+// 【`AsyncFileIO::writeFiles` - 同时写出一批文件】
+// 每个文件先写到 "路径.tmp"，全部块写完并 fsync 后再改名覆盖原文件: 写入失败、中途退出或崩溃时原文件保持完整，
+// 不会留下截断了一半的文件。
+bool AsyncFileIO::writeFiles(vector<FileRequest>& requests) {
+	vector<IoBlock> blocks;
+	function<void(size_t)> onComplete = [](size_t) {};
+	for (size_t f = 0; f < requests.size(); ++f) {
+		FileRequest& request = requests[f];
+		request.fd = open((request.path + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		request.ok = request.fd >= 0;
+		if (!request.ok) {
+			onComplete(f);
+			continue;
+		}
+		if (splitIntoBlocks(f, request, blocks) == 0) { // 空内容: 截断即完成
+			request.pending = 1;
+			finishBlock(request, f, true, true, onComplete);
+		}
+	}
+	runBlocks(requests, blocks, true, onComplete);
+	bool allOk = true;
+	for (size_t f = 0; f < requests.size(); ++f) {
+		FileRequest& request = requests[f];
+		string temporary = request.path + ".tmp";
+		if (request.ok && rename(temporary.c_str(), request.path.c_str()) != 0) request.ok = false;
+		if (!request.ok) {
+			unlink(temporary.c_str());
+			allOk = false;
+		}
+	}
+	return allOk;
+} // `AsyncFileIO::writeFiles` 函数结束。
+
+// 【`AsyncFileIO::readFile` / `writeFile` - 只有一个文件的批次】
+bool AsyncFileIO::readFile(const string& path, string& data) {
+	vector<FileRequest> requests(1, FileRequest(path));
+	readFiles(requests, [](size_t) {});
+	data.assign(requests[0].data.data(), requests[0].data.size());
+	return requests[0].ok;
+}
+
+bool AsyncFileIO::writeFile(const string& path, const string& data) {
+	vector<FileRequest> requests(1, FileRequest(path, data));
+	return writeFiles(requests);
+}
+
+void AsyncFileIO::runBlocks(vector<FileRequest>& requests, vector<IoBlock>& blocks, bool writing, const function<void(size_t)>& onComplete) {
+	if (blocks.empty()) return;
+	if (ringFd >= 0) runBlocksOnRing(requests, blocks, writing, onComplete);
+	else runBlocksOnPool(requests, blocks, writing, onComplete);
+}
+
+// 【`AsyncFileIO::runBlocksOnRing` - io_uring 后端】
+// 在途的块不超过队列长度；每次 io_uring_enter 提交新填入的条目并至少等到一个完成，再收取所有已完成的条目。
+// 短读写把剩余部分作为新块重新提交。io_uring_enter 本身出错时关闭 io_uring，尚未完成的块同步补做 (重复读写同一段是安全的)。
+void AsyncFileIO::runBlocksOnRing(vector<FileRequest>& requests, vector<IoBlock>& blocks, bool writing, const function<void(size_t)>& onComplete) {
+#ifdef __NR_io_uring_setup
+	io_uring_sqe* sqeArray = (io_uring_sqe*)sqes;
+	io_uring_cqe* cqeArray = (io_uring_cqe*)cqes;
+	vector<char> finished(blocks.size(), 0);
+	size_t next = 0, queued = 0, completed = 0;
+	while (completed < blocks.size()) {
+		unsigned tail = *sqTail; // 只有本线程修改提交队列尾
+		while (next < blocks.size() && queued - completed < sqEntries) {
+			const IoBlock& block = blocks[next];
+			FileRequest& request = requests[block.file];
+			unsigned slot = tail & *sqMask;
+			io_uring_sqe& sqe = sqeArray[slot];
+			memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = writing ? IORING_OP_WRITE : IORING_OP_READ;
+			sqe.fd = request.fd;
+			sqe.off = block.offset;
+			sqe.addr = (uint64_t)(uintptr_t)(&request.data[0] + block.offset);
+			sqe.len = (uint32_t)block.length;
+			sqe.user_data = next;
+			sqArray[slot] = slot;
+			++tail;
+			++next;
+			++queued;
+		}
+		__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE); // 发布新条目
+		unsigned toSubmit = tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		if (syscall(__NR_io_uring_enter, ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+			errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			cerr << "警告：io_uring 提交失败，改用线程池读写文件。\n";
+			closeRing();
+			for (size_t b = 0; b < blocks.size(); ++b) {
+				if (!finished[b]) finishBlock(requests[blocks[b].file], blocks[b].file, transferBlock(requests[blocks[b].file], blocks[b], writing), writing, onComplete);
+			}
+			return;
+		}
+		unsigned head = *cqHead;
+		while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+			const io_uring_cqe& cqe = cqeArray[head & *cqMask];
+			size_t b = (size_t)cqe.user_data;
+			int result = cqe.res;
+			++head;
+			++completed;
+			finished[b] = 1;
+			IoBlock block = blocks[b]; // 复制: 下面可能向 blocks 追加元素
+			FileRequest& request = requests[block.file];
+			if (result == -EINTR || result == -EAGAIN) { // 稍后重试
+				blocks.push_back(block);
+				finished.push_back(0);
+			} else if (result == -EINVAL || result == -EOPNOTSUPP) { // 内核不支持 IORING_OP_READ/WRITE (5.6 之前)
+				finishBlock(request, block.file, transferBlock(request, block, writing), writing, onComplete);
+			} else if (result > 0 && (size_t)result < block.length) { // 短读写: 剩余部分重新提交
+				blocks.push_back(IoBlock(block.file, block.offset + result, block.length - result));
+				finished.push_back(0);
+			} else {
+				finishBlock(request, block.file, result > 0, writing, onComplete);
+			}
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE); // 归还完成队列条目
+	}
+#else
+	runBlocksOnPool(requests, blocks, writing, onComplete);
+#endif
+} // `AsyncFileIO::runBlocksOnRing` 函数结束。
+
+// 【`AsyncFileIO::runBlocksOnPool` - 线程池后端】
+// 各块由线程池并行读写；文件的最后一块完成时把文件下标放进完成队列，调用线程从中取出后关闭文件并回调。
+void AsyncFileIO::runBlocksOnPool(vector<FileRequest>& requests, vector<IoBlock>& blocks, bool writing, const function<void(size_t)>& onComplete) {
+	if (!pool) pool.reset(new FileThreadPool(IO_POOL_THREADS));
+	mutex doneLock;
+	condition_variable doneSignal;
+	deque<size_t> doneFiles;
+	size_t remaining = 0; // 还有块未完成的文件数
+	for (size_t f = 0; f < requests.size(); ++f) {
+		if (requests[f].pending > 0) ++remaining;
+	}
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		IoBlock block = blocks[b];
+		pool->submit([&, block]() {
+			bool success = transferBlock(requests[block.file], block, writing);
+			lock_guard<mutex> guard(doneLock);
+			FileRequest& request = requests[block.file];
+			if (!success) request.ok = false;
+			if (--request.pending == 0) doneFiles.push_back(block.file);
+			doneSignal.notify_one(); // 持锁通知: 调用线程取到最后一个文件并返回之前，这里已不再访问局部变量
+		});
+	}
+	while (remaining > 0) {
+		size_t f;
+		{
+			unique_lock<mutex> guard(doneLock);
+			doneSignal.wait(guard, [&]() { return !doneFiles.empty(); });
+			f = doneFiles.front();
+			doneFiles.pop_front();
+		}
+		closeRequest(requests[f], writing);
+		onComplete(f);
+		--remaining;
+	}
+} // `AsyncFileIO::runBlocksOnPool` 函数结束。
+
+// 【分区清单的文本】第一行为分区数，之后每个分区一行: 年 月 记录数 校验值。
+string formatManifest(const vector<PartitionInfo>& list) {
+	ostringstream out;
+	out << list.size() << "\n";
+	for (size_t p = 0; p < list.size(); ++p) {
+		out << list[p].year << " " << list[p].month << " " << list[p].recordCount << " " << formatRecordId(list[p].blockHash) << "\n";
+	}
+	return out.str();
+}
+
+// 【解析一条记录行】数据文件中的一行 ("@编号," 前缀可选，旧文件没有)。`lineNumber` 是记录序号，用于警告信息。
+// 字段不完整或无效时在 cerr 中说明原因并返回 false。没有编号的旧记录解析后编号为 0，由调用方推导。
+bool parseRecordLine(string line, int lineNumber, Expense& record) {
+	// 【记录编号】"@" 开头的 16 位十六进制编号，解析后从行中去掉，其余部分与旧格式相同。
+	uint64_t recordId = 0;
+	if (!line.empty() && line[0] == '@') {
+		size_t comma = line.find(',');
+		if (comma == string::npos) { cerr << "警告：记录 " << lineNumber << " 数据不完整 (编号)。\n"; return false; }
+		recordId = strtoull(line.substr(1, comma - 1).c_str(), nullptr, 16);
+		line = line.substr(comma + 1);
+	}
+
+	// 【解析从文件中读取到的每一行数据】
+	// `stringstream ss(line);` // 用当前从文件中读取到的行 `line` 创建一个字符串流 `ss`。
+	                           // 字符串流使得我们可以方便地从这个行字符串中按分隔符提取各个字段的值。
+	stringstream ss(line); // 将行数据放入字符串流以方便解析。
+	string segment; // 声明一个 `string` 变量 `segment`，用于临时存储从行字符串流中按逗号分隔出来的每个数据片段。
+	// 声明并初始化用于存储解析出的开销数据的局部变量。
+	int year = 0, month = 0, day = 0; // 年、月、日，默认为0。
+	string description_str;           // 描述，默认为空字符串。
+	double amount = 0.0;              // 金额，默认为0.0。
+	string category_str;              // 类别，默认为空字符串。
+
+	// 【逐个字段解析】
+	// 使用 `getline(ss, segment, ',')` 从字符串流 `ss` 中读取内容到 `segment`，直到遇到逗号 `,` (逗号本身会被消耗掉但不会放入 `segment`)。
+	// 如果成功读取到一个片段，则进行后续的类型转换和错误处理。
+	// 如果 `getline` 失败（例如行中没有足够的逗号分隔的字段），则该记录解析失败。
+
+	// 【解析日期字段】当前格式是一个 yyyymmdd 字段；旧格式是年、月、日三个字段。
+	// 第一个字段大于 9999 时按当前格式拆出年月日，否则再依次读取月、日两个字段。两种格式可以混在同一个文件里。
+	if (getline(ss, segment, ',')) { // 尝试读取年份 (或压缩日期) 片段。
+		// `try...catch` // 错误处理块。`stoi(segment)` 尝试将字符串 `segment` 转换为整数。
+		try { year = stoi(segment); } // 转换字符串到整数。
+		// `catch (const invalid_argument& ia)` // 如果 `segment` 不是有效的数字字符串 (例如 "abc")，`stoi` 会抛出 `std::invalid_argument` 异常。
+		catch (const invalid_argument& ia) { cerr << "警告：无效日期格式 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; /* 跳过此记录 */ }
+		// `catch (const out_of_range& oor)` // 如果 `segment` 是数字但超出了 `int` 类型能表示的范围，`stoi` 会抛出 `std::out_of_range` 异常。
+		catch (const out_of_range& oor) { cerr << "警告：日期超出范围 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; }
+	} else { cerr << "警告：记录 " << lineNumber << " 数据不完整 (日期)。\n"; return false; } // 如果连第一个片段都读不到，说明行数据不完整，跳过此记录。
+
+	if (year > 9999) { // 当前格式: yyyymmdd
+		int packed = year;
+		year = packed / 10000;
+		month = packed / 100 % 100;
+		day = packed % 100;
+	} else { // 旧格式: 继续解析月份和日期 (逻辑与年份解析类似)
+		if (getline(ss, segment, ',')) {
+			try { month = stoi(segment); } catch (const invalid_argument& ia) { cerr << "警告：无效月份格式 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; } catch (const out_of_range& oor) { cerr << "警告：月份超出范围 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; }
+		} else { cerr << "警告：记录 " << lineNumber << " 数据不完整 (月份)。\n"; return false; }
+
+		if (getline(ss, segment, ',')) {
+			try { day = stoi(segment); } catch (const invalid_argument& ia) { cerr << "警告：无效日期格式 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; } catch (const out_of_range& oor) { cerr << "警告：日期超出范围 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; }
+		} else { cerr << "警告：记录 " << lineNumber << " 数据不完整 (日期)。\n"; return false; }
+	} // 日期字段解析结束。
+
+	// 解析描述 (描述是字符串，不需要类型转换，但需要检查长度)
+	if (getline(ss, description_str, ',')) { // 尝试读取描述片段。
+		// `if (description_str.length() > Expense::MAX_DESCRIPTION_LENGTH)` // 如果读取到的描述长度超过了预设的最大长度
+		if (description_str.length() > Expense::MAX_DESCRIPTION_LENGTH) {
+			description_str = description_str.substr(0, Expense::MAX_DESCRIPTION_LENGTH); // 将描述截断到最大允许长度。
+		}
+	} else { cerr << "警告：记录 " << lineNumber << " 数据不完整 (描述)。\n"; return false; } // 如果描述片段读不到，跳过此记录。
+	
+	// 解析金额 (使用 `stod` 将字符串转换为 `double` 类型)
+	if (getline(ss, segment, ',')) { // 尝试读取金额片段。
+		// `stod(segment)` // 尝试将字符串 `segment` 转换为 `double`。
+		try { amount = stod(segment); } // 转换。
+		// 类似 `stoi`，`stod` 也会在转换失败时抛出 `std::invalid_argument` 或 `std::out_of_range` 异常。
+		catch (const invalid_argument& ia) { cerr << "警告：无效金额格式 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; }
+		catch (const out_of_range& oor) { cerr << "警告：金额超出范围 '" << segment << "' 在记录 " << lineNumber << "。跳过此记录。\n"; return false; }
+	} else { cerr << "警告：记录 " << lineNumber << " 数据不完整 (金额)。\n"; return false; } // 如果金额片段读不到，跳过。
+
+	// 解析类别 (类别是行中的最后一个字段)
+	// `if (getline(ss, category_str))` // 注意这里调用 `getline` 时没有第三个参数（分隔符）。
+	                               // 这意味着它会从字符串流 `ss` 的当前位置读取所有剩余的字符，直到流结束（即行尾），并存入 `category_str`。
+	if (getline(ss, category_str)) { // 尝试读取类别片段（即行中剩余的部分）。
+		// `if (category_str.length() > Expense::MAX_CATEGORY_LENGTH)` // 如果类别长度超限
+		if (category_str.length() > Expense::MAX_CATEGORY_LENGTH) {
+			category_str = category_str.substr(0, Expense::MAX_CATEGORY_LENGTH); // 截断类别字符串。
+		}
+	} else { 
+		// 如果这里 `getline` 失败，可能意味着金额后面紧跟着就是行结束符，没有类别字段，或者类别字段为空。
+		// 在这种情况下，`category_str` 会保持其默认的空字符串状态。
+		// 程序允许这种情况，后续 `setData` 时空类别可能会被处理或使用默认值（例如 "未分类"，取决于 `Expense` 类的具体实现，不过当前 `Expense` 类并没有为 `category` 设置默认值）。
+	} // 类别解析结束。
+	
+	// 【将成功解析的数据存入记录对象】
+	if (!record.setData(year, month, day, description_str, amount, category_str)) { // 将解析的数据设置到对象 (同时校验日期)。
+		cerr << "警告：记录 " << lineNumber << " 的日期 " << year << "-" << month << "-" << day << " 无效。跳过此记录。\n";
+		return false;
+	}
+	record.setId(recordId);
+	return true;
+} // `parseRecordLine` 函数结束。
+
+/*
+【多账本归并】
+每人一份账本 (账本根目录、其中的分区目录，或单个数据文件)，各自按日期有序。LedgerStream 逐行读取一份账本，
+同一时刻只保留当前一条记录；k 份账本的当前记录放进按日期排序的最小堆，每次取出最早的一条，再从同一账本补充下一条。
+内存占用只与输入账本的个数成正比，与记录总数无关。
+合并模式保留全部记录；并集模式下编号相同的记录 (例如两份同步过的账本中的同一条) 只保留一条。
+*/
+
+// 【账本记录流】按日期顺序逐条读出一份账本的记录。
+class LedgerStream {
+public:
+	string label;          // 报告中显示的名称 (目录名或文件名)
+	vector<string> files;  // 按年月顺序的数据文件
+	size_t fileIndex;      // 下一个要打开的文件
+	ifstream in;
+	int remaining;         // 当前文件中还未读取的记录行数 (由文件头给出)
+	int recordNumber;      // 当前文件中的记录序号 (警告信息使用)
+	Expense current;       // 当前记录
+	bool hasCurrent;
+	bool unsorted;         // 读到了比上一条更早的记录
+	unordered_map<uint64_t, int> derivedIdOccurrences; // 旧记录的编号推导: 内容哈希 -> 本文件中已出现次数 (与 parseRecordData 相同，按文件计数)
+
+	LedgerStream() : fileIndex(0), remaining(0), recordNumber(0), hasCurrent(false), unsorted(false) {}
+
+	// 账本根目录取其中的分区目录 (没有分区目录时取旧版单文件)；目录中的 *.dat 按文件名 (YYYY-MM) 排序。
+	bool open(const string& path, string& error) {
+		error_code ec;
+		filesystem::path p(path);
+		label = p.filename().empty() ? p.parent_path().filename().string() : p.filename().string();
+		if (filesystem::is_directory(p, ec)) {
+			if (filesystem::is_directory(p / PARTITION_DIR, ec)) {
+				p /= PARTITION_DIR;
+			} else if (!filesystem::exists(p / "manifest.txt", ec) && filesystem::exists(p / DATA_FILE, ec)) {
+				files.push_back((p / DATA_FILE).string());
+				return true;
+			}
+			for (const auto& entry : filesystem::directory_iterator(p, ec)) {
+				if (entry.path().extension() == ".dat") files.push_back(entry.path().string());
+			}
+			sort(files.begin(), files.end());
+			return true;
+		}
+		if (!filesystem::exists(p, ec)) {
+			error = "找不到账本 " + path;
+			return false;
+		}
+		files.push_back(path);
+		return true;
+	}
+
+	// 读取下一条记录到 `current`，没有更多记录时返回 false。删除标记行不读取 (它们对应的记录已不在文件中)。
+	bool next() {
+		while (true) {
+			if (remaining == 0) {
+				if (!openNextFile()) return false;
+				continue;
+			}
+			string line;
+			if (!getline(in, line)) { // 文件比声明的记录数短
+				remaining = 0;
+				continue;
+			}
+			--remaining;
+			Expense record;
+			if (!parseRecordLine(line, ++recordNumber, record)) continue;
+			if (record.getId() == 0) { // 旧记录: 与 parseRecordData 相同的推导规则
+				uint64_t content = recordContentHash(record);
+				uint64_t id = fnv1a64("#" + to_string(derivedIdOccurrences[content]++), content);
+				record.setId(id == 0 ? 1 : id);
+			}
+			if (hasCurrent && record.getDate() < current.getDate()) unsorted = true;
+			current = record;
+			hasCurrent = true;
+			return true;
+		}
+	}
+
+	// 打开下一个数据文件并读取文件头；无法读取的文件给出警告后跳过。
+	bool openNextFile() {
+		while (fileIndex < files.size()) {
+			in.close();
+			in.clear();
+			in.open(files[fileIndex++]);
+			int count = 0;
+			if (!in || !(in >> count) || count < 0) {
+				cerr << "警告：无法读取 " << files[fileIndex - 1] << "，已跳过。\n";
+				continue;
+			}
+			in.ignore(numeric_limits<streamsize>::max(), '\n');
+			remaining = count;
+			recordNumber = 0;
+			derivedIdOccurrences.clear();
+			return true;
+		}
+		return false;
+	}
+
+	const string& currentFile() const { return files[fileIndex - 1]; }
+
+	// 预读各文件记录之后的删除标记 ("~编号" 行)，按文件名中的年月 (yyyymm) 归入 `byMonth`，文件名不是 YYYY-MM 时归入 0。
+	// 删除标记可能来自另一份账本中更晚才读到的文件，必须在输出任何记录之前读全，因此单独把文件读一遍。
+	void readTombstones(map<int, set<uint64_t> >& byMonth) const {
+		for (size_t f = 0; f < files.size(); ++f) {
+			ifstream file(files[f]);
+			int count = 0;
+			if (!file || !(file >> count) || count < 0) continue; // 警告在读取记录时给出
+			file.ignore(numeric_limits<streamsize>::max(), '\n');
+			for (int i = 0; i < count && file.ignore(numeric_limits<streamsize>::max(), '\n'); ++i) {} // 跳过记录行
+			int year = 0, month = 0;
+			string stem = filesystem::path(files[f]).stem().string();
+			int key = (sscanf(stem.c_str(), "%4d-%2d", &year, &month) == 2 && month >= 1 && month <= 12) ? year * 100 + month : 0;
+			string line;
+			while (getline(file, line)) {
+				if (line.size() > 1 && line[0] == '~') byMonth[key].insert(strtoull(line.c_str() + 1, nullptr, 16));
+			}
+		}
+	}
+};
+
+// 【k 路归并】反复从最小堆取出日期最早的记录交给 `emit(记录, 来源下标)`，再从同一来源补充下一条。
+// 堆按 (日期, 来源下标) 排序，同一天先输出下标小的来源，因此归并是稳定的。某个来源没有按日期排序时返回 false。
+template <typename Emit>
+bool mergeStreams(vector<unique_ptr<LedgerStream> >& streams, Emit emit) {
+	typedef pair<uint32_t, size_t> HeapEntry; // (日期 yyyymmdd, 来源下标)
+	priority_queue<HeapEntry, vector<HeapEntry>, greater<HeapEntry> > heap;
+	for (size_t s = 0; s < streams.size(); ++s) {
+		if (streams[s]->next()) heap.push(HeapEntry(streams[s]->current.getDate().value(), s));
+	}
+	while (!heap.empty()) {
+		size_t s = heap.top().second;
+		heap.pop();
+		Expense e = streams[s]->current;
+		if (streams[s]->next()) {
+			if (streams[s]->unsorted) {
+				cerr << "错误：" << streams[s]->currentFile() << " 第 " << streams[s]->recordNumber << " 条记录早于上一条，没有按日期排序，无法归并。\n";
+				return false;
+			}
+			heap.push(HeapEntry(streams[s]->current.getDate().value(), s));
+		}
+		emit(e, s);
+	}
+	return true;
+}
+
+/*
+【外部排序】
+账本大到放不进内存时 (例如多年的旧版单文件存档，记录也不一定按日期排列)，分两步按日期排序:
+1. 生成有序段: 逐条读入记录，攒到内存预算时按日期稳定排序，写成一个临时段文件。预算包括记录数组和记录中的字符串
+   (按实际占用估算)；记录数组按需倍增，扩容时新数组只用预算的剩余部分，小账本不会一开始就占满预算;
+2. 归并: 用 `mergeStreams` 把各段归并成一个有序的记录流交给输出端。段数超过 EXTERNAL_SORT_FAN_IN 时先分组归并成更长的段，
+   保证同时打开的文件数有上限。
+临时段文件与数据文件格式相同 (第一行为记录数)，放在系统临时目录中，排序结束后删除。
+*/
+const size_t EXTERNAL_SORT_DEFAULT_MEMORY = 64u << 20; // 默认内存预算 (字节)
+const size_t EXTERNAL_SORT_MIN_MEMORY = 1u << 20;
+const size_t EXTERNAL_SORT_FAN_IN = 64;                 // 一次归并同时打开的段文件数上限
+
+class ExternalSorter {
+public:
+	size_t memoryBudget;
+	filesystem::path tempDir;
+	vector<string> runs;       // 待归并的有序段
+	vector<long> runCounts;    // 各段的记录数
+	int runSerial;             // 段文件编号
+	long records;              // 读入的记录总数
+	bool failed;
+
+	explicit ExternalSorter(size_t budget) : memoryBudget(max(budget, EXTERNAL_SORT_MIN_MEMORY)), runSerial(0), records(0), failed(false) {
+		static atomic<int> sorterSerial(0);
+		tempDir = filesystem::temp_directory_path() / ("expense_sort_" + to_string(getpid()) + "_" + to_string(sorterSerial++));
+		error_code ec;
+		filesystem::create_directories(tempDir, ec);
+		if (ec) {
+			cerr << "错误：无法创建临时目录 " << tempDir.string() << "！\n";
+			failed = true;
+		}
+	}
+	~ExternalSorter() {
+		error_code ec;
+		filesystem::remove_all(tempDir, ec);
+	}
+
+	static size_t recordBytes(const Expense& e) {
+		return sizeof(Expense) + e.getDescription().capacity() + e.getCategory().capacity();
+	}
+
+	// 第 1 步: 读完 `input`，生成若干有序段。
+	bool makeRuns(LedgerStream& input) {
+		RecordChunk buffer;
+		size_t stringBytes = 0; // 缓冲中记录的字符串占用
+		while (!failed && input.next()) {
+			size_t extra = recordBytes(input.current) - sizeof(Expense);
+			if (buffer.size() == buffer.capacity()) { // 倍增: 扩容时新旧数组同时存在，新数组只能占用预算的剩余部分
+				size_t used = buffer.capacity() * sizeof(Expense) + stringBytes;
+				size_t room = used < memoryBudget ? (memoryBudget - used) / sizeof(Expense) : 0;
+				if (room > buffer.size()) {
+					buffer.reserve(min(max(buffer.capacity() * 2, (size_t)256), room));
+				} else { // 放不下更大的数组: 先写出一段，数组留给下一段复用
+					writeRun(buffer);
+					stringBytes = 0;
+				}
+			} else if (!buffer.empty() && buffer.capacity() * sizeof(Expense) + stringBytes + extra > memoryBudget) {
+				writeRun(buffer);
+				stringBytes = 0;
+			}
+			stringBytes += extra;
+			buffer.push_back(input.current);
+			++records;
+		}
+		if (!buffer.empty()) writeRun(buffer);
+		return !failed;
+	}
+
+	void writeRun(RecordChunk& buffer) {
+		stable_sort(buffer.begin(), buffer.end(), [](const Expense& a, const Expense& b) { return a.getDate() < b.getDate(); });
+		string path = nextRunPath();
+		ofstream out(path);
+		out << buffer.size() << "\n";
+		RecordWriterSink writer(out);
+		for (size_t i = 0; i < buffer.size(); ++i) writer.consume(buffer[i]);
+		out.close();
+		if (out.fail()) {
+			cerr << "错误：无法写入临时文件 " << path << "（磁盘空间不足？）\n";
+			failed = true;
+		}
+		runs.push_back(path);
+		runCounts.push_back((long)buffer.size());
+		buffer.clear(); // 保留容量，下一段复用同一块内存 (makeRuns 结束时释放)
+	}
+
+	string nextRunPath() {
+		return (tempDir / ("run_" + to_string(runSerial++) + ".dat")).string();
+	}
+
+	// 打开 [from, to) 范围内的段。
+	bool openRuns(size_t from, size_t to, vector<unique_ptr<LedgerStream> >& streams) {
+		for (size_t r = from; r < to; ++r) {
+			streams.emplace_back(new LedgerStream());
+			string error;
+			if (!streams.back()->open(runs[r], error)) {
+				cerr << "错误：" << error << "。\n";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// 第 2 步: 段数超过 EXTERNAL_SORT_FAN_IN 时，每 EXTERNAL_SORT_FAN_IN 段归并成一段，直到可以一次归并为止。
+	bool reduceRuns() {
+		while (!failed && runs.size() > EXTERNAL_SORT_FAN_IN) {
+			vector<string> merged;
+			vector<long> mergedCounts;
+			for (size_t from = 0; from < runs.size(); from += EXTERNAL_SORT_FAN_IN) {
+				size_t to = min(runs.size(), from + EXTERNAL_SORT_FAN_IN);
+				vector<unique_ptr<LedgerStream> > streams;
+				if (!openRuns(from, to, streams)) return false;
+				long count = 0;
+				for (size_t r = from; r < to; ++r) count += runCounts[r];
+				string path = nextRunPath();
+				ofstream out(path);
+				out << count << "\n";
+				RecordWriterSink writer(out);
+				if (!mergeStreams(streams, [&writer](const Expense& e, size_t) { writer.consume(e); })) return false;
+				out.close();
+				if (out.fail()) {
+					cerr << "错误：无法写入临时文件 " << path << "（磁盘空间不足？）\n";
+					failed = true;
+					return false;
+				}
+				streams.clear();
+				error_code ec;
+				for (size_t r = from; r < to; ++r) filesystem::remove(runs[r], ec); // 已并入新段
+				merged.push_back(path);
+				mergedCounts.push_back(count);
+			}
+			runs.swap(merged);
+			runCounts.swap(mergedCounts);
+		}
+		return !failed;
+	}
+
+	// 把 `input` 的全部记录按日期顺序交给 `sink.consume` (同一天保持输入中的先后顺序)。
+	template <typename Sink>
+	bool sort(LedgerStream& input, Sink& sink) {
+		if (!makeRuns(input) || !reduceRuns()) return false;
+		vector<unique_ptr<LedgerStream> > streams;
+		if (!openRuns(0, runs.size(), streams)) return false;
+		return mergeStreams(streams, [&sink](const Expense& e, size_t) { sink.consume(e); });
+	}
+};
+
+// 【输出端: 流式年度汇总】记录按日期顺序到来，只保存当年 12 个月的小计、当年各类别的小计、各年的总计与全部类别的总计；
+// 一年结束时立即打印该年的汇总。内存占用与记录数无关。`onlyYear` 非 0 时只打印该年 (全部记录仍会被读完)。
+class YearlySummarySink {
+public:
+	int onlyYear;
+	int year;                                  // 正在汇总的年份 (0 表示还没有记录)
+	long long monthCents[13];                  // 当年各月金额 (分)，下标 1..12
+	long monthCount[13];
+	map<string, long long> yearCategoryCents;  // 当年各类别
+	map<int, pair<long long, long> > yearTotals; // 各年的 (金额, 记录数)
+	map<string, long long> allCategoryCents;   // 全部年份各类别
+	explicit YearlySummarySink(int only = 0) : onlyYear(only), year(0) { clearYear(); }
+	void clearYear() {
+		fill(monthCents, monthCents + 13, 0);
+		fill(monthCount, monthCount + 13, 0);
+		yearCategoryCents.clear();
+	}
+	void consume(const Expense& e) {
+		if (year != 0 && e.getYear() != year) {
+			printYear();
+			clearYear();
+		}
+		year = e.getYear();
+		long long cents = llround(e.getAmount() * 100);
+		monthCents[e.getMonth()] += cents;
+		monthCount[e.getMonth()]++;
+		yearCategoryCents[e.getCategory()] += cents;
+		allCategoryCents[e.getCategory()] += cents;
+		yearTotals[year].first += cents;
+		yearTotals[year].second++;
+	}
+	static void printCategories(const map<string, long long>& cents) {
+		vector<pair<long long, string> > byAmount;
+		for (const auto& item : cents) byAmount.push_back(make_pair(-item.second, item.first));
+		sort(byAmount.begin(), byAmount.end());
+		for (size_t c = 0; c < byAmount.size(); ++c) {
+			cout << "  " << left << setw(28) << byAmount[c].second << right << setw(14) << -byAmount[c].first / 100.0 << "\n";
+		}
+	}
+	void printYear() {
+		if (onlyYear != 0 && year != onlyYear) return;
+		cout << "\n--- " << year << "年 开销汇总 ---\n" << fixed << setprecision(2);
+		for (int m = 1; m <= 12; ++m) {
+			if (monthCount[m] == 0) continue;
+			cout << "  " << setfill('0') << setw(2) << m << setfill(' ') << "月" << right << setw(16) << monthCents[m] / 100.0 << setw(10) << monthCount[m] << " 条\n";
+		}
+		cout << "按类别:\n";
+		printCategories(yearCategoryCents);
+		cout << "全年总计: " << yearTotals[year].first / 100.0 << " (" << yearTotals[year].second << " 条)\n";
+	}
+	void finish() {
+		if (year != 0) printYear();
+		if (onlyYear != 0) {
+			if (yearTotals.find(onlyYear) == yearTotals.end()) cout << onlyYear << "年没有开销记录。\n";
+			return;
+		}
+		cout << "\n--- 历年汇总 ---\n" << fixed << setprecision(2);
+		long long total = 0;
+		long count = 0;
+		for (const auto& item : yearTotals) {
+			cout << "  " << item.first << "年" << right << setw(16) << item.second.first / 100.0 << setw(10) << item.second.second << " 条\n";
+			total += item.second.first;
+			count += item.second.second;
+		}
+		cout << "按类别:\n";
+		printCategories(allCategoryCents);
+		cout << "总计: " << total / 100.0 << " (" << count << " 条)\n";
+	}
+};
+
+// 【输出端: 按月分区流式写出】记录按日期顺序到来，月份变化时结束当前分区文件并开始下一个，只缓存当前一行。
+// 文件头的记录数事先未知，先写一行空格占位，文件结束时回到开头写入 (读取时 `>>` 会跳过数字后面的空格)。
+class PartitionStreamWriter {
+public:
+	string dir;                    // 分区目录
+	ofstream out;
+	RecordWriterSink writer;
+	PartitionInfo part;            // 正在写的分区 (记录数与校验值随写随算)
+	bool fileOpen;
+	bool failed;
+	vector<PartitionInfo> written; // 已写完的分区，最后写入清单
+	const map<int, set<uint64_t> >* tombstones; // 要写入各分区的删除标记 (yyyymm -> 编号)，可以为空
+	explicit PartitionStreamWriter(const string& directory) : dir(directory), writer(out), fileOpen(false), failed(false), tombstones(nullptr) {}
+	void consume(const Expense& e) {
+		if (!fileOpen || e.getYear() != part.year || e.getMonth() != part.month) {
+			finishFile();
+			startFile(e.getYear(), e.getMonth());
+		}
+		if (!fileOpen) return;
+		writer.consume(e);
+		part.recordCount++;
+		part.blockHash += recordBlockHash(e);
+	}
+	void startFile(int year, int month) {
+		char name[16];
+		snprintf(name, sizeof(name), "%04d-%02d.dat", year, month);
+		out.clear();
+		out.open(dir + "/" + name);
+		if (!out) {
+			cerr << "错误：无法写入 " << dir << "/" << name << "！\n";
+			failed = true;
+			return;
+		}
+		out << string(12, ' ') << "\n"; // 记录数占位
+		part = PartitionInfo();
+		part.year = year;
+		part.month = month;
+		part.blockHash = EMPTY_BLOCK_HASH;
+		fileOpen = true;
+	}
+	void finishFile() {
+		if (!fileOpen) return;
+		if (tombstones) { // 记录之后写删除标记
+			auto month = tombstones->find(part.year * 100 + part.month);
+			if (month != tombstones->end()) {
+				for (uint64_t id : month->second) {
+					out << "~" << formatRecordId(id) << "\n";
+					part.blockHash += tombstoneBlockHash(id);
+				}
+				part.tombstones = month->second;
+			}
+		}
+		out.seekp(0);
+		out << part.recordCount;
+		out.close();
+		if (out.fail()) failed = true;
+		written.push_back(part);
+		fileOpen = false;
+	}
+	// 写完最后一个分区，再为只有删除标记、没有记录的月份补写分区文件 (月份未知的删除标记无处安放，不写出)。
+	void finishAll() {
+		finishFile();
+		if (!tombstones) return;
+		set<int> months;
+		for (size_t p = 0; p < written.size(); ++p) months.insert(written[p].year * 100 + written[p].month);
+		for (const auto& month : *tombstones) {
+			if (month.first == 0 || months.count(month.first)) continue;
+			startFile(month.first / 100, month.first % 100);
+			finishFile();
+		}
+		sort(written.begin(), written.end(), [](const PartitionInfo& a, const PartitionInfo& b) {
+			return a.year != b.year ? a.year < b.year : a.month < b.month;
+		});
+	}
+};
+
+// 【家庭合并报告】按月列出每份账本的支出和合计，最后给出各账本与各类别的总计。
+// 记录按日期有序到来，一个月结束时立即打印该月一行；只保存当月各账本的小计和各类别的总计。
+class HouseholdReport {
+public:
+	vector<string> labels;
+	int year, month;
+	vector<long long> monthCents;      // 当月各账本的小计 (分)
+	vector<long long> totalCents;      // 各账本的总计
+	map<string, long long> categoryCents;
+	long records;
+	explicit HouseholdReport(const vector<string>& names) : labels(names), year(0), month(0), monthCents(names.size(), 0), totalCents(names.size(), 0), records(0) {
+		cout << left << setw(10) << "年月";
+		for (size_t s = 0; s < labels.size(); ++s) cout << right << setw(14) << labels[s].substr(0, 12);
+		cout << right << setw(14) << "合计" << "\n";
+		cout << string(10 + 14 * (labels.size() + 1), '-') << "\n";
+	}
+	void consume(const Expense& e, size_t source) {
+		if (records > 0 && (e.getYear() != year || e.getMonth() != month)) printMonth();
+		year = e.getYear();
+		month = e.getMonth();
+		long long cents = llround(e.getAmount() * 100);
+		monthCents[source] += cents;
+		totalCents[source] += cents;
+		categoryCents[e.getCategory()] += cents;
+		++records;
+	}
+	void printRow(const string& title, vector<long long>& cents) {
+		long long sum = 0;
+		cout << left << setw(10) << title << right << fixed << setprecision(2);
+		for (size_t s = 0; s < cents.size(); ++s) {
+			cout << setw(14) << cents[s] / 100.0;
+			sum += cents[s];
+		}
+		cout << setw(14) << sum / 100.0 << "\n";
+	}
+	void printMonth() {
+		char title[16];
+		snprintf(title, sizeof(title), "%04d-%02d", year, month);
+		printRow(title, monthCents);
+		fill(monthCents.begin(), monthCents.end(), 0);
+	}
+	void finish() {
+		if (records > 0) printMonth();
+		cout << string(10 + 14 * (labels.size() + 1), '-') << "\n";
+		printRow("总计", totalCents);
+		vector<pair<long long, string> > byAmount;
+		for (const auto& item : categoryCents) byAmount.push_back(make_pair(-item.second, item.first));
+		sort(byAmount.begin(), byAmount.end());
+		cout << "\n按类别合计:\n";
+		for (size_t c = 0; c < byAmount.size(); ++c) {
+			cout << left << setw(30) << byAmount[c].second << right << setw(14) << -byAmount[c].first / 100.0 << "\n";
+		}
+		cout << "共 " << records << " 条记录。\n";
+	}
+};
+
+// 【类别汇总与预算对比表】`budgetTable` 由调用方给出 (后台结算使用预算表的快照)。
+void writeCategoryBudgetTable(ostream& out, const unordered_map<string, BudgetEntry>& budgetTable, int year, int month,
+							  const CategorySum categorySums[], int uniqueCategoriesCount) {
+	out << "按类别汇总:\n";
+	out << left << setw(20) << "类别" << right << setw(10) << "实际" << setw(10) << "预算" << setw(10) << "差额" << "\n";
+	out << string(50, '-') << "\n";
+	for (int i = 0; i < uniqueCategoriesCount; ++i) {
+		out << left << setw(20) << categorySums[i].name
+			<< right << fixed << setprecision(2) << setw(10) << categorySums[i].total;
+		const BudgetEntry* budget = findBudgetIn(budgetTable, year, month, categorySums[i].name);
+		if (budget != nullptr) { // 差额为正表示结余，为负表示超支
+			out << setw(10) << budget->amount << setw(10) << budget->amount - categorySums[i].total;
+			if (categorySums[i].total > budget->amount) out << "  超支";
+		} else {
+			out << setw(10) << "-" << setw(10) << "-";
+		}
+		out << "\n";
+	}
+	out << string(50, '-') << "\n";
+}
+
+// 【结算报告正文】明细、本月总计与类别预算表，同时算出要写入结算档案的结果。
+// `feed(sink)` 把该月的记录逐条交给 sink (主线程从记录存储查询，后台线程遍历快照)。
+template <typename Feed>
+SettlementReport writeSettlementReport(ostream& out, const unordered_map<string, BudgetEntry>& budgetTable, int year, int month, Feed feed) {
+	out << "\n--- " << year << "年" << setfill('0') << setw(2) << month << setfill(' ') << "月 开销报告 (自动结算) ---\n";
+	out << "明细:\n";
+	printExpenseHeader(false, out);
+
+	// 【一次遍历: 打印明细、按类别汇总、计算内容校验值】
+	PrintSink printer(false, out);
+	AggregateSink<ByCategory> summary;
+	HashSink hasher;
+	TeeSink<PrintSink, AggregateSink<ByCategory>, HashSink> all(printer, summary, hasher);
+	feed(all);
+
+	SettlementReport report;
+	report.year = year;
+	report.month = month;
+	report.recordCount = summary.count;
+	report.total = summary.total;
+	report.contentHash = hasher.contentHash;
+	report.categories.assign(summary.groups, summary.groups + summary.groupCount);
+
+	if (summary.count == 0) {
+		out << "该月份没有开销记录。\n";
+		return report;
+	}
+	printExpenseSeparator(false, out);
+	out << left << setw(12 + 30 + 20) << "本月总计:" << right << fixed << setprecision(2) << setw(10) << summary.total << "\n\n";
+	if (summary.groupCount > 0) writeCategoryBudgetTable(out, budgetTable, year, month, summary.groups, summary.groupCount);
+	out << "--- 报告生成完毕 ---\n";
+	return report;
+}
+
+// 【原子替换文件】先写同目录下的临时文件，再用 rename 替换: 中途退出时文件要么是旧内容，要么是完整的新内容。
+bool writeFileAtomically(AsyncFileIO& io, const string& path, const string& data) {
+	string temp = path + string(".tmp");
+	if (!io.writeFile(temp, data)) return false;
+	error_code ec;
+	filesystem::rename(temp, path, ec);
+	return !ec;
+}
+
+/*
+【后台结算】
+启动时要补结算的月份可能很多，逐月打印完整报告会让菜单迟迟不出现。构造函数在主线程中只列出待结算的月份、复制预算表，
+各月记录的快照由后台线程直接读取分区文件得到 (不经过主线程的内存数据)，逐月结算，菜单立即显示:
+- 每结算一个月，先把报告追加到 SETTLEMENT_LOG_FILE，再原子地更新 SETTLEMENT_FILE，最后把结果放进 `completed`。
+  因此 SETTLEMENT_FILE 指向的月份在日志中一定有完整的报告;
+- 结算档案只由主线程修改: 主菜单每次显示前调用 `collectBackgroundSettlement` 取走结果，全部完成时提示用户;
+- 用户提前退出时设置 `stopRequested`，后台线程做完当前月份就停下，其余月份下次启动时继续;
+- 结算期间用户改动了某个待结算月份的记录时，该月的快照已过时，取回的结果不写入档案 (重新打印时会重新计算)。
+*/
+const char* SETTLEMENT_LOG_FILE = "settlement_log.txt"; // 后台结算报告的日志 (追加写入)
+
+class SettlementMonth {
+public:
+	int year;
+	int month;
+	vector<Expense> records; // 该月记录的快照
+	string partitionFile;    // 非空时由后台线程读取该分区文件得到快照 (分区尚未加载到内存)
+	SettlementMonth(int y, int m) : year(y), month(m) {}
+};
+
+class BackgroundSettlement {
+public:
+	vector<SettlementMonth> months;             // 待结算的月份 (按时间顺序)
+	unordered_map<string, BudgetEntry> budgets; // 预算表快照 (报告中的预算对比列)
+	atomic<bool> stopRequested;
+	atomic<bool> finished;
+	mutex resultLock;                           // 保护下面三项
+	vector<SettlementReport> completed;         // 已结算、主线程尚未取走的结果
+	int settledCount;
+	bool failed;                                // 读分区文件、写日志或状态文件失败
+	thread worker;
+	function<int(string_view, vector<Expense>&)> parseRecords; // 解析分区文件内容 (与加载分区相同的规则)
+
+	BackgroundSettlement() : stopRequested(false), finished(false), settledCount(0), failed(false) {}
+	void start() { worker = thread([this]() { run(); }); }
+
+	void run() {
+		AsyncFileIO io; // 主线程的 fileIO 不能跨线程共用
+		for (size_t k = 0; k < months.size() && !stopRequested; ++k) {
+			SettlementMonth& target = months[k];
+			if (!target.partitionFile.empty()) { // 快照在这里读取，不占用启动时间，也不改动主线程的内存数据
+				string data;
+				if (!io.readFile(target.partitionFile, data) || parseRecords(data, target.records) < 0) { // 不能按无记录结算: 停在这个月，下次启动时重试
+					cerr << "错误：无法读取分区文件 " << target.partitionFile << "。\n";
+					lock_guard<mutex> guard(resultLock);
+					failed = true;
+					break;
+				}
+			}
+			ostringstream text;
+			text << "\n>>> 开始自动结算: " << target.year << "年" << setfill('0') << setw(2) << target.month << setfill(' ') << "月 <<\n";
+			SettlementReport report = writeSettlementReport(text, budgets, target.year, target.month, [&target](auto& sink) {
+				for (size_t r = 0; r < target.records.size(); ++r) sink.consume(target.records[r]);
+			});
+			text << ">>> 自动结算完成: " << target.year << "年" << setfill('0') << setw(2) << target.month << setfill(' ') << "月 <<\n";
+
+			ofstream log(SETTLEMENT_LOG_FILE, ios::app); // 追加写入 (AsyncFileIO 只做整个文件的读写)
+			log << text.str();
+			log.close();
+			bool ok = !log.fail() && writeFileAtomically(io, SETTLEMENT_FILE, to_string(target.year) + " " + to_string(target.month) + "\n");
+			vector<Expense>().swap(target.records); // 快照用完即释放
+
+			lock_guard<mutex> guard(resultLock);
+			if (!ok) {
+				failed = true;
+				break;
+			}
+			completed.push_back(report);
+			++settledCount;
+		}
+		finished = true;
+	}
+};
+
+class ExpenseTracker {
+private:
+	ExpenseStore allExpenses;          // 按日期有序的开销记录
+	int expenseCount;                  // 当前开销数量 (已加载到内存的记录)
+	vector<PartitionInfo> partitions;  // 按年月升序排列的分区列表
+	unordered_map<string, BudgetEntry> budgets;         // 预算表，键为 monthCategoryKey (默认预算的年月为 0)
+	CategoryTree categoryHierarchy;                     // 类别层级 (由已加载记录的类别路径建立)
+	TrackedHashMap<int, MonthRollup, MEMORY_INDEXES> monthRollups; // 已加载记录按月、按类别节点的子树合计，键为 年*100+月
+	ExpenseCube cube;                                   // 已加载记录的 年 × 月 × 日 × 类别 汇总 (钻取报告使用)
+	map<int, SettlementReport> settlementArchive;       // 结算档案，键为 年*100+月
+	unique_ptr<BackgroundSettlement> backgroundSettlement; // 正在进行的后台结算 (没有时为空)
+	set<int> settlementTouchedMonths;                   // 后台结算期间被改动过的月份 (年*100+月)，其结算结果不写入档案
+	unsigned long dataVersion;                          // 记录每次增删加 1，用于判断列式快照是否过期
+	ColumnSnapshot columns;                             // 过滤表达式使用的列式快照
+	TrackedHashMap<int, PartitionBitmaps, MEMORY_INDEXES> bitmapIndex; // 各分区按类别的位图索引，键为 年*100+月
+	bool bitmapIndexChanged;                            // 位图索引与磁盘上的索引文件不一致，保存时重写
+	bool loadingPartitions;                             // 正在从分区文件读入记录 (记录顺序与索引一致，索引不作废)
+	size_t filterCandidateRows;                         // 最近一次过滤时位图给出的候选行数
+	mutable shared_mutex coreLock;                      // 核心接口的读写锁: 查询/汇总共享，添加/删除独占
+	TrackedHashMap<string, CategoryTrend, MEMORY_INDEXES> categoryTrends; // 各类别新记录金额的滚动统计
+	map<uint64_t, AnomalyFlag> anomalyFlags;            // 被标记的异常开销 (按记录编号)
+	bool anomalyStateChanged;                           // 滚动统计或异常标记与磁盘上的文件不一致，保存时重写
+	int pageSize;                                       // 分页浏览时每页的记录数
+	CategoryTrie categoryTrie;                          // 所有已知类别名和别名的前缀树
+	vector<string> categoryNames;                       // 类别编号 -> 规范类别名
+	unordered_map<string, int> categoryIds;             // 类别名或别名 -> 规范类别编号
+	TrackedHashMap<uint64_t, int, MEMORY_INDEXES> duplicateIndex; // 已加载记录的重复检测键 -> 记录数
+	DuplicatePolicy duplicatePolicy;                    // 添加和导入时对重复记录的处理策略
+	mt19937_64 idGenerator;                             // 新记录编号的随机数发生器
+	AsyncFileIO fileIO;                                 // 数据文件的读写 (io_uring 或线程池)
+
+	// 私有辅助方法
+	void clearInputBuffer();
+	int loadRecordsFromFile(const string& path, set<uint64_t>* tombstones = nullptr);
+	int loadRecordData(string_view text, set<uint64_t>* tombstones);
+	int readRecordFile(const string& path, vector<Expense>& records, set<uint64_t>* tombstones);
+	static int parseRecordData(string_view text, vector<Expense>& records, set<uint64_t>* tombstones);
+	string partitionFileText(int idx, uint64_t* blockHash);
+	bool readManifestFile(const string& path, vector<PartitionInfo>& list);
+	bool writeManifestFile(const string& path, const vector<PartitionInfo>& list);
+	uint64_t newRecordId();
+	int insertRecord(Expense e);
+	void insertRecords(vector<Expense>& batch);
+	void addTombstone(const Expense& e);
+	bool syncLedger(const string& otherPath);
+	void syncMenu();
+	bool loadLegacyDataFile();
+	bool readManifest();
+	int findPartition(int year, int month);
+	int getOrCreatePartition(int year, int month);
+	string partitionFilePath(int year, int month);
+	bool ensurePartitionLoaded(int year, int month);
+	bool loadPartitions(const vector<int>& indices);
+	bool ensurePartitionsLoaded(int fromYear, int fromMonth, int toYear, int toMonth);
+	bool ensureAllPartitionsLoaded();
+	void adjustPartitionCount(int year, int month, int delta);
+	int totalRecordCount();
+	int storeIndexForPosition(int position);
+	int positionForDate(int year, int month, int day);
+	int browseExpenses(bool selecting);
+	void recordAdded(const Expense& e);
+	void recordRemoved(const Expense& e);
+	void markBitmapsStale(const Expense& e);
+	void loadBudgets();
+	void saveBudgets();
+	const BudgetEntry* findBudget(int year, int month, const string& category);
+	void checkBudgetAfterAdd(const Expense& e);
+	long long categoryMonthCents(int year, int month, const string& category);
+	void printCubeRollup(const CubeSlice& slice, CubeDimension by);
+	void drillDownMenu();
+	void printCategoryTree(int year, int month);
+	void loadSettlementArchive();
+	void saveSettlementArchive();
+	void invalidateSettlementCache(int year, int month);
+	void loadCategories();
+	void saveCategories();
+	string categoryFileText();
+	int registerCategory(const string& name);
+	string normalizeCategory(const string& raw);
+	void printCategorySuggestions(const string& prefix);
+	void addCategoryAlias(const string& alias, const string& target);
+	int findDuplicate(const Expense& e);
+	DuplicateAction resolveDuplicate(const Expense& incoming);
+	void showDuplicates();
+	void duplicatePolicyMenu();
+	void printArchivedReport(const SettlementReport& report);
+	template <typename Predicate, typename Sink>
+	void runQuery(const Predicate& predicate, Sink& sink);
+	void refreshColumns();
+	void estimateFilterCost(FilterTerm& term);
+	void narrowSelection(const FilterTerm& term, vector<uint32_t>& selection);
+	vector<uint32_t> evaluateFilter(const FilterExpression& filter);
+	void loadPartitionsForFilter(const FilterExpression& filter);
+	PartitionBitmaps* partitionBitmaps(int idx);
+	PartitionBitmaps* usableBitmaps(int idx);
+	void partitionRows(int idx, int& from, int& to);
+	bool filterCandidates(const vector<FilterTerm>& terms, int idx, RoaringBitmap& candidates, bool rebuild = true);
+	vector<uint32_t> matchFilterRows(const FilterExpression& filter);
+	bool allPartitionsLoaded();
+	void summarizeMonth(int year, int month, MonthSummary& out);
+	void readBitmapIndex();
+	string bitmapIndexFileText();
+	bool checkAnomaly(const Expense& e, AnomalyFlag* flag = nullptr);
+	void loadAnomalyState();
+	string anomalyFileText();
+	void anomalyReport();
+	void rebuildBitmapIndex();
+	bool printFilterResults(const string& text);
+	int removeRows(const vector<uint32_t>& rows);
+	bool bulkDeleteMatching(const FilterExpression& filter, bool interactive);
+	void readLastSettlement(int& lastYear, int& lastMonth);
+	void writeLastSettlement(int year, int month);
+	void generateMonthlyReportForSettlement(int year, int month);
+
+public:
+	explicit ExpenseTracker(bool interactive = true);  // 构造函数 (批处理模式下不打印加载信息、不做自动结算)
+	~ExpenseTracker(); // 析构函数 (可选, 此处为空)
+
+	void run(); // 运行主程序循环
+
+	// 【核心接口 (线程安全)】不读写 cin/cout，可由多个线程同时调用: 查询和汇总持共享锁并发执行，添加和删除持独占锁。
+	// 交互菜单只在主线程中运行，不与这些接口并发使用。只修改内存中的数据，保存仍由 `saveExpenses` 完成。
+	bool coreAdd(Expense& e, string& error, DuplicateAction* action = nullptr, AnomalyFlag* anomaly = nullptr);
+	bool coreDelete(const Expense& record);
+	bool coreQuery(const string& filterText, vector<Expense>& out, string& error);
+	bool coreSummarize(int year, int month, MonthSummary& out);
+	void runStressTest(const vector<int>& threadCounts, double seconds, int writePercent);
+
+	// 公共接口方法
+	void addExpense();
+	void displayAllExpenses();
+	void displayMonthlySummary();
+	// void generateSimpleChart(); // Removed
+	void listExpensesByPeriod(); // Added
+	void saveExpenses();
+	bool loadExpenses();
+	void deleteExpense();
+	void bulkDeleteMenu();
+	void performAutomaticSettlement();
+	void collectBackgroundSettlement();
+	void stopBackgroundSettlement();
+	void dataToolsMenu();
+	void memoryReport();
+	void exportColumnar();
+	void importColumnar();
+	bool importCsv(const string& path, bool negativeIsExpense);
+	void importCsvMenu();
+	bool mergeLedgers(const vector<string>& inputs, bool unionMode, const string& outputRoot);
+	void mergeMenu();
+	bool externalSortLedger(const string& input, const string& outputRoot, size_t memoryBudget);
+	bool streamingSummary(const string& input, int onlyYear, size_t memoryBudget);
+	void outOfCoreMenu();
+	bool writeJsonReport(const string& report, const vector<string>& args, bool ndjson);
+	void writeJsonCategories(JsonWriter& json, int year, int month, const CategorySum categories[], int count);
+	void budgetMenu();
+	void categoryMenu();
+	void reprintSettlement();
+	void filterQuery();
+	int runBatch(int argc, char* argv[]);
+};
+
+// 【`runQuery` 模板实现 - 查询管道的核心循环】
+// 先按条件的期间只加载相关分区，再对内存中的记录做一次遍历，满足条件的交给输出端。
+// 记录按日期有序，限定期间的条件只需遍历二分查找得到的那一段连续区间。
+template <typename Predicate, typename Sink>
+void ExpenseTracker::runQuery(const Predicate& predicate, Sink& sink) {
+	int fromYear, fromMonth, toYear, toMonth;
+	int from = 0, to; // 需要遍历的下标区间
+	bool complete;
+	if (predicate.range(fromYear, fromMonth, toYear, toMonth)) {
+		complete = ensurePartitionsLoaded(fromYear, fromMonth, toYear, toMonth); // 分区裁剪
+		from = allExpenses.lowerBound(fromYear * 10000 + fromMonth * 100);
+		to = allExpenses.lowerBound(toYear * 10000 + toMonth * 100 + 100); // 结束月份之后的第一条
+	} else {
+		complete = ensureAllPartitionsLoaded();
+		to = expenseCount; // 加载之后再取记录数
+	}
+	if (!complete) cerr << "警告：部分月份的数据未能加载，以下结果不完整。\n";
+	allExpenses.forEachInRange(from, to, [&](const Expense& e) {
+		if (predicate(e)) sink.consume(e);
+	});
+}
+
+// --- ExpenseTracker 类成员函数实现 ---
+/*
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!! CRITICAL REFACTORING POINT / 核心重构点: MVC 架构分离 !!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+TODO: UI逻辑、业务逻辑、控制逻辑必须分离！采用MVC (Model-View-Controller) 设计模式。
+
+      目标是将当前混合的逻辑拆分成三个明确职责的组件:
+
+      1. M - Model (模型层 - 例如: 新建类 `ExpenseService` 或 `ExpenseModel`):
+         职责:
+         -   管理应用程序的核心数据 (例如: `allExpenses` 数组, `expenseCount`) 和状态。
+         -   包含所有的业务规则和数据处理逻辑 (例如: 添加、删除、查询开销的实际操作，数据验证，计算统计，文件保存与加载，自动结算逻辑)。
+         -   完全独立于用户界面。Model 不知道数据将如何显示，也不知道用户如何输入数据。
+         -   提供清晰的接口供 Controller 调用 (例如: `bool createExpense(data)`, `vector<Expense> getAllExpenses()`, `bool saveExpensesToFile()`, `MonthlySummaryData generateMonthlySummary(year, month)`)。
+         -   示例: `DATA_FILE`, `SETTLEMENT_FILE`, `MAX_EXPENSES` 这些常量和相关文件操作逻辑应属于 Model。
+
+      2. V - View (视图层 - 例如: 新建类 `ExpenseTrackerConsoleUI`):
+         职责:
+         -   负责所有与用户的直接交互，即输入和输出。
+         -   显示数据给用户 (例如: 打印菜单、列表、报告、提示信息、错误信息)。
+         -   从用户获取输入 (例如: 读取菜单选项、开销详情)。
+         -   不包含任何业务逻辑。它只是一个"哑"的界面，根据 Controller 的指令显示信息或收集输入。
+         -   提供接口供 Controller 调用 (例如: `int displayMainMenu()`, `ExpenseData promptForNewExpenseData()`, `void displayExpenses(const vector<Expense>& expenses)`, `void showMessage(const string& message)`)。
+
+      3. C - Controller (控制器层 - 当前的 `ExpenseTracker` 类将演变为此角色):
+         职责:
+         -   作为 Model 和 View 之间的协调者和中介。
+         -   接收来自 View 的用户请求/输入 (例如，用户选择了"添加开销"菜单项)。
+         -   根据用户请求调用 Model 的相应方法来处理数据或执行业务逻辑。
+         -   获取 Model 处理后的结果。
+         -   选择合适的 View 来更新显示，将结果呈现给用户。
+         -   管理应用程序的流程和状态转换。
+         -   示例: `ExpenseTracker::run()` 方法将是主要的控制循环。当用户选择"添加开销"时：
+             a. `Controller::run()` 调用 `View::promptForNewExpenseData()` 获取用户输入的开销信息。
+             b. 如果数据有效, `Controller` 调用 `Model::createExpense(expenseData)`。
+             c. `Model` 执行添加逻辑，返回成功/失败状态。
+             d. `Controller` 根据 `Model` 的返回，调用 `View::showMessage()` 显示相应信息。
+
+      重构步骤建议:
+      A. 先定义 `ExpenseService` (Model) 和 `ExpenseTrackerConsoleUI` (View) 的接口和基本骨架。
+      B. 逐步将 `ExpenseTracker` 方法中的业务逻辑和数据存储迁移到 `ExpenseService`。
+      C. 逐步将 `ExpenseTracker` 方法中的 `cout` 和 `cin` 迁移到 `ExpenseTrackerConsoleUI`。
+      D. 修改 `ExpenseTracker` (Controller) 的方法，使其调用新的 Model 和 View 完成任务。
+
+      这样做的好处:
+      -   高内聚，低耦合：每个组件职责单一，修改一个组件不轻易影响其他组件。
+      -   可维护性：逻辑清晰，更容易理解和修改。
+      -   可测试性：Model 可以独立于 UI 进行单元测试。
+      -   灵活性：未来如果想更换 UI (例如图形界面)，理论上只需替换 View 层。
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+*/
+
+// 【开发者提示解读：关于代码的"整理房间"——MVC模式】
+// 上面这段非常长的、被 `/* ... */` 和很多感叹号包围的注释，是程序员写给其他程序员看的，关于如何把代码写得更整洁、更有条理的专业建议。
+// 它在说："我们这个开销追踪程序，现在把所有事情都放在一个大抽屉 (`ExpenseTracker` 类) 里了，以后东西多了可能会乱。我们应该学习一种叫做 MVC 的整理方法。"
+//
+// MVC 是什么？
+// 想象一下餐馆的运作：
+// -   Model (模型 M - 管理数据和规则)：就像是餐馆的【后厨】。负责管理食材 (数据)，处理订单 (业务逻辑)，比如计算总价、保存记录等。后厨不直接跟顾客打交道。
+// -   View (视图 V - 展示给用户看/用户操作的界面)：就像是餐馆的【菜单和餐桌上的食物】。负责把菜品 (数据) 好看地展示给顾客，以及记录顾客点的菜 (用户输入)。菜单本身不做菜。
+// -   Controller (控制器 C - 指挥官)：就像是餐馆的【服务员】。服务员在顾客和后厨之间跑腿。他把顾客的点单 (来自View的请求)告诉后厨 (调用Model)，然后把做好的菜 (来自Model的结果)端给顾客 (更新View)。
+//
+// 这段注释建议我们把 `ExpenseTracker` 程序也这样分开：
+// 1.  **Model (模型层)**：专门负责所有的数据处理。比如 `allExpenses` 数组、`expenseCount` 变量，还有保存文件、从文件加载、计算月度总结这些具体的数据操作，都应该放到 Model 里。它不关心这些数据怎么显示给用户。
+// 2.  **View (视图层)**：专门负责和用户打交道。所有 `cout` (在屏幕上显示东西) 和 `cin` (从键盘读取东西) 的代码，比如显示菜单、打印开销列表、提示用户输入等，都应该放到 View 里。它不处理具体的数据逻辑。
+// 3.  **Controller (控制器层)**：现在的 `ExpenseTracker` 类慢慢变成这个角色。它会接收用户的操作 (比如用户选了"添加开销")，然后告诉 Model 去做相应的数据处理，拿到结果后，再告诉 View 把结果显示出来。
+//
+// 为什么要这么做（好处）？
+// -   **代码更清晰**：每个部分只做自己的事，就像餐馆里厨师专心做菜，服务员专心服务一样。找问题、改东西都更容易。
+// -   **更容易维护和修改**：如果想改菜单样式 (View)，不用动后厨 (Model) 的代码。如果想改菜品价格计算方法 (Model)，顾客看到的菜单 (View) 可能不用变。
+// -   **更容易测试**：可以单独测试后厨 (Model) 的功能好不好用，不用真的找个顾客来点单。
+// -   **更灵活**：以后如果想把现在的命令行界面换成漂亮的图形窗口界面，理论上只需要换掉 View 部分，Model 和 Controller 可能不用大改。
+//
+// 对于初学者：
+// 这是一种让代码结构更棒的设计思想。目前程序的功能是正常的。等你对C++更熟悉了，学习这种设计模式会对编写大型程序非常有帮助。
+// 现在，我们可以继续看 `ExpenseTracker` 类里的函数是怎么具体工作的。
+
+// 【ExpenseTracker 构造函数实现】
+// `ExpenseTracker::` // 这个双冒号叫做作用域解析运算符，它表明我们现在定义的是属于 `ExpenseTracker` 类的那个名为 `ExpenseTracker` 的函数（也就是构造函数）。
+// `: expenseCount(0)` // 这是成员初始化列表。在构造函数体执行之前，它会把成员变量 `expenseCount` 初始化为0。
+//                   // 对于类来说，这是一种推荐的初始化成员变量的方式，比在函数体内部赋值更高效。
+ExpenseTracker::ExpenseTracker(bool interactive)
+	: expenseCount(0), dataVersion(0), bitmapIndexChanged(false), loadingPartitions(false), filterCandidateRows(0), anomalyStateChanged(false), pageSize(DEFAULT_PAGE_SIZE), duplicatePolicy(DUPLICATE_FLAG),
+	  idGenerator(random_device()() ^ (uint64_t)chrono::steady_clock::now().time_since_epoch().count()) {
+	// `if (loadExpenses())` // 调用本类 (ExpenseTracker对象自己) 的 `loadExpenses()` 方法，尝试从文件中加载已保存的开销数据。
+	                       // `loadExpenses()` 会返回一个布尔值 (`true` 或 `false`)。
+	loadCategories(); // 先读取类别与别名表，加载记录时再补充其中没有的类别。
+	loadAnomalyState(); // 各类别的滚动统计 (不需要加载任何分区)。
+	bool loaded = loadExpenses();
+	if (!interactive) { // 批处理模式: 只加载数据，输出留给具体命令
+		loadBudgets();
+		loadSettlementArchive();
+		return;
+	}
+	if (loaded) { // 如果 `loadExpenses()` 返回 `true` (表示数据成功加载)
+		// `cout` // 是 `iostream` 库中提供的标准输出流对象，通常用于向控制台（屏幕）输出信息。
+		// `<<`  // 是流插入运算符，它把右边的内容发送到左边的流中。
+		// `expenseCount` // 此处是成员变量 `expenseCount`，它在 `loadExpenses()` 成功后会被更新为加载的记录条数。
+		// `" 条历史记录。\n"` // 这是一个字符串字面量。`\n` 是一个转义字符，代表换行，使后续输出从新的一行开始。
+		cout << "成功加载 " << totalRecordCount() << " 条历史记录 (共 " << partitions.size() << " 个月度分区，按需读取)。\n"; // 打印清单中的记录总数与分区数。
+	} else { // `else` 分支：如果 `loadExpenses()` 返回 `false` (表示加载失败，比如文件不存在或文件内容损坏)
+		cout << "未找到历史数据文件或加载失败，开始新的记录。\n"; // 在屏幕上打印相应的提示信息。
+	}
+	// `performAutomaticSettlement()` // 调用本类的 `performAutomaticSettlement()` 方法。
+	                               // 这个方法用于检查并自动处理（例如生成报告）过去月份中尚未结算的开销数据。
+	                               // 这样程序每次启动时，都会确保历史数据的完整性。
+	loadBudgets(); // 读取类别预算 (结算报告中的预算对比列会用到)。
+	loadSettlementArchive(); // 读取已结算月份的报告缓存。
+	performAutomaticSettlement(); // 执行自动结算检查。
+} // 构造函数结束
+
+// 【ExpenseTracker 析构函数实现】
+// `~ExpenseTracker()` // 这是 `ExpenseTracker` 类的析构函数。析构函数在对象生命周期结束时（例如，`main`函数中的`tracker`对象在`main`函数结束时）自动被调用。
+                    // 它的主要用途是释放对象在生命周期内可能获取的资源（如动态分配的内存、打开的文件等）。
+                    // 析构函数的名称是类名前面加一个波浪号 `~`，并且没有参数，也没有返回类型。
+ExpenseTracker::~ExpenseTracker() {
+	stopBackgroundSettlement(); // 未经菜单退出时也要等后台结算线程结束
+	// 这个析构函数的函数体是空的。
+	// 在这个特定的程序中，数据保存是在用户选择退出时通过 `saveExpenses()` 方法显式完成的，
+	// 并且没有在 `ExpenseTracker` 对象内部直接使用 `new` 动态分配需要 `delete` 清理的内存。
+	// 因此，目前这个析构函数不需要执行特定的清理操作。
+	// 如果将来类变得更复杂，比如动态管理了某些资源，就需要在这里添加相应的释放代码。
+} // 析构函数结束
+
+// 【私有辅助方法 `clearInputBuffer` 实现】
+// `void` // 表示这个函数不返回任何值。
+// `ExpenseTracker::clearInputBuffer()` // 定义 `ExpenseTracker` 类的 `clearInputBuffer` 方法。
+                                     // 这是一个私有方法，意味着它主要被类内部的其他成员函数调用，用于辅助完成任务。
+void ExpenseTracker::clearInputBuffer() {
+	// `cin` // 标准输入流对象，通常代表键盘输入。
+	// `.ignore(...)` // 是输入流的一个成员函数，用于忽略（跳过并丢弃）输入流中的字符。
+	// `numeric_limits<streamsize>::max()` // `numeric_limits` 是定义在 `<limits>` 头文件中的模板类，用于获取各种数据类型的属性（如此处的最大值）。
+	                                     // `streamsize` 是一种用于表示流大小的整数类型。
+	                                     // `numeric_limits<streamsize>::max()` 返回 `streamsize` 类型能表示的最大值。
+	                                     // 这意味着 `.ignore()` 会尝试忽略非常非常多的字符，直到遇到下一个参数指定的停止条件。
+	// `'\n'` // 这是第二个参数，指定了忽略操作的终止字符。`'\n'` 代表换行符。
+	//         // 当用户在控制台输入并按下回车键时，这个换行符也会被放入输入缓冲区。
+	// 这整行代码的作用是：丢弃输入缓冲区中当前位置直到下一个换行符（包括该换行符）之间的所有字符，或者丢弃掉缓冲区内所有剩余字符（如果先达到了流的最大限制）。
+	// 这样做的目的是为了清除在一次输入操作（尤其是使用 `>>` 操作符读取数字后）后可能残留在缓冲区中的换行符或其他多余字符，
+	// 以防止它们影响到后续的输入操作（特别是 `getline` 函数，它会读取整行直到换行符）。
+	cin.ignore(numeric_limits<streamsize>::max(), '\n'); // 清除输入缓冲区中直到下一个换行符的所有内容。
+} // `clearInputBuffer` 函数结束
+
+// 【核心功能方法 `run` 实现】
+// `void ExpenseTracker::run()` // 定义 `ExpenseTracker` 类的 `run` 方法。这是程序的用户交互核心。
+void ExpenseTracker::run() {
+	int choice; // 声明一个整型变量 `choice`，用于存储用户从菜单中选择的选项的数字。
+	// `do...while` // 这是一个 `do-while` 循环结构。它的特点是循环体内的代码至少会执行一次，然后在每次循环结束时检查 `while` 后面的条件。
+	             // 只要条件为真，循环就会继续。
+	do { // `do-while` 循环开始
+		collectBackgroundSettlement(); // 取回后台结算的结果 (完成时在菜单上方提示)
+		// 下面是一系列的 `cout` 语句，用于在控制台（屏幕）上打印出程序的主菜单。
+		cout << "\n大学生开销追踪器\n"; // `\n` 是换行符，使标题在新的一行显示，并且前面有一个空行，让界面更清晰。
+		cout << "--------------------\n"; // 打印一行分隔线。
+		cout << "1. 添加开销记录\n";   // 菜单选项1。
+		cout << "2. 查看所有开销\n";   // 菜单选项2。
+		cout << "3. 查看月度统计\n";   // 菜单选项3。
+		cout << "4. 按期间列出开销\n"; // 菜单选项4。
+		cout << "5. 删除开销记录\n";   // 菜单选项5。
+		cout << "6. 保存并退出\n";     // 菜单选项6。
+		cout << "7. 数据工具 (导出/导入)\n"; // 菜单选项7。
+		cout << "8. 预算管理\n";         // 菜单选项8。
+		cout << "9. 重新打印结算报告\n"; // 菜单选项9。
+		cout << "10. 条件查询 (过滤表达式)\n"; // 菜单选项10。
+		cout << "11. 批量删除\n"; // 菜单选项11。
+		cout << "12. 类别管理 (补全/别名)\n"; // 菜单选项12。
+		cout << "13. 钻取报告 (年/月/日 × 类别)\n"; // 菜单选项13。
+		cout << "--------------------\n"; // 打印一行分隔线。
+		cout << "请输入选项: ";        // 提示用户输入他们的选择。
+
+		// `cin >> choice;` // 使用标准输入流 `cin` 和提取运算符 `>>` 来读取用户输入的整数，并将其存储到 `choice` 变量中。
+		                    // 注意：`>>` 操作符在读取数字时，会跳过前面的空白字符（空格、制表符、换行符），然后读取数字字符，
+		                    // 直到遇到第一个非数字字符。它会将这个非数字字符（通常是按下回车时产生的换行符 `\n`）留在输入缓冲区中。
+		cin >> choice; // 从用户那里获取菜单选项。
+
+		// 【输入验证和错误处理】
+		// `cin.fail()` // 这个成员函数检查输入流 `cin` 是否处于"失败"状态。
+		              // 如果上一次输入操作（如 `cin >> choice`）因为用户输入了无效的内容（例如输入了字母而不是数字）而失败，`cin.fail()` 会返回 `true`。
+		if (cin.fail()) { // 如果输入操作失败了 (例如，用户输入了文本而不是数字)
+			cin.clear();          // `cin.clear()`: 这个成员函数用于清除输入流的错误状态标志（例如 `failbit` 或 `badbit`）。
+			                      // 清除错误标志后，输入流对象才能恢复正常工作，进行下一次输入/输出操作。
+			clearInputBuffer();   // 调用我们自己定义的 `clearInputBuffer()` 辅助函数，
+			                      // 来清除输入缓冲区中导致先前输入失败的无效字符 (以及随后的换行符)。
+			choice = 0;           // 将 `choice` 变量的值设置为0。这是一个任意选择的无效菜单选项值，
+			                      // 目的是确保在接下来的 `switch` 语句中，程序会进入 `default` 分支，从而提示用户输入无效。
+		} else { // `else` 分支：如果 `cin >> choice` 操作没有失败 (即用户确实输入了看起来像数字的内容)
+			clearInputBuffer();   // 即使输入成功，输入缓冲区中通常还残留着用户按下回车键时产生的换行符 `\n`。
+			                      // 调用 `clearInputBuffer()` 来清除这个换行符，对于后续可能使用 `getline`（它对换行符敏感）的函数调用来说，这是个好习惯。
+		} // 输入验证结束。
+
+		// `switch (choice)` // `switch` 语句是一种多分支选择结构。它会根据 `choice` 变量的值，跳转到匹配的 `case`标签处执行代码。
 		switch (choice) { // 根据用户的选择执行相应的操作。
 		case 1: // 如果 `choice` 的值是 1
 			addExpense(); // 调用 `addExpense()` 成员方法来处理添加新开销的逻辑。
@@ -323,1073 +3644,4051 @@ void ExpenseTracker::run() {
 			deleteExpense(); // 调用 `deleteExpense()` 成员方法来删除指定的开销记录。
 			break; // 跳出 `switch`。
 		case 6: // 如果 `choice` 的值是 6 (用户选择保存并退出)
+			stopBackgroundSettlement(); // 后台结算做完当前月份后停下，剩余月份下次启动时继续。
 			saveExpenses(); // 调用 `saveExpenses()` 成员方法，将当前的开销数据保存到文件中。
 			cout << "数据已保存。正在退出...\n"; // 向用户显示一条消息，表明数据已保存并且程序即将退出。
 			break; // 跳出 `switch`。
+		case 7: // 如果 `choice` 的值是 7
+			dataToolsMenu(); // 进入数据工具子菜单 (列式导出/导入等)。
+			break; // 跳出 `switch`。
+		case 8: // 如果 `choice` 的值是 8
+			budgetMenu(); // 进入预算管理子菜单。
+			break; // 跳出 `switch`。
+		case 9: // 如果 `choice` 的值是 9
+			reprintSettlement(); // 从结算档案中重新打印某个已结算月份的报告。
+			break; // 跳出 `switch`。
+		case 10: // 如果 `choice` 的值是 10
+			filterQuery(); // 输入过滤表达式并列出满足条件的记录。
+			break; // 跳出 `switch`。
+		case 11: // 如果 `choice` 的值是 11
+			bulkDeleteMenu(); // 按日期范围、类别或过滤表达式一次删除多条记录。
+			break; // 跳出 `switch`。
+		case 12: // 如果 `choice` 的值是 12
+			categoryMenu(); // 查看类别、按前缀补全、维护别名表。
+			break; // 跳出 `switch`。
+		case 13: // 如果 `choice` 的值是 13
+			drillDownMenu(); // 从汇总立方体按年、月、日逐级钻取，可按类别过滤或透视。
+			break; // 跳出 `switch`。
 		default: // `default` 分支：如果 `choice` 的值不匹配前面任何一个 `case` (例如，用户输入了无效数字，或者输入错误被处理后 `choice` 被设为0)
 			cout << "无效选项，请重试。\n"; // 向用户显示错误提示，要求他们重新输入一个有效的选项。
 			// 此处没有 `break;` 因为 `default` 通常是 `switch` 语句的最后一个分支，执行完后自然会退出 `switch`。
 		} // `switch` 语句结束。
-	} while (choice != 6); // `do-while` 循环的条件判断：只要用户的选择 `choice` 不是 6 (退出选项)，循环就会继续，重新显示菜单并等待用户输入。
-	                       // 当 `choice` 等于 6 时，条件为 `false`，循环终止，`run()` 函数结束，程序流程返回到调用 `run()` 的地方 (即 `main` 函数)。
-} // `run` 函数结束。
+	} while (choice != 6); // `do-while` 循环的条件判断：只要用户的选择 `choice` 不是 6 (退出选项)，循环就会继续，重新显示菜单并等待用户输入。
+	                       // 当 `choice` 等于 6 时，条件为 `false`，循环终止，`run()` 函数结束，程序流程返回到调用 `run()` 的地方 (即 `main` 函数)。
+} // `run` 函数结束。
+
+// 【`addExpense` 方法实现 - 添加新的开销记录】
+// `void ExpenseTracker::addExpense()` // 定义 `ExpenseTracker` 类的 `addExpense` 成员方法。
+void ExpenseTracker::addExpense() {
+	// 【检查容量是否已满】
+	// `if (expenseCount >= MAX_EXPENSES)` // 检查当前已存储的开销数量 `expenseCount` 是否已经达到或超过了预设的最大容量 `MAX_EXPENSES`。
+	                                    // `MAX_EXPENSES` 是一个全局常量，定义了 `allExpenses` 数组的大小。
+	if (expenseCount >= MAX_EXPENSES) { // 如果记录已满
+		cout << "错误：开销记录已满！无法添加更多记录。\n"; // 打印错误消息。
+		return; // `return;` 语句立即从当前函数 (`addExpense`) 返回，不再执行后续的添加逻辑。
+	} // 容量检查结束。
+
+	// 【声明用于存储用户输入的局部变量】
+	int year, month, day;    // `int` 类型变量，分别用于存储用户输入的年份、月份和日期。
+	string description;      // `string` 类型变量 (来自 `<string>` 库)，用于存储开销的文字描述。
+	double amount;           // `double` 类型变量，用于存储开销的金额 (可以包含小数)。
+	string category;         // `string` 类型变量，用于存储开销的类别。
+	string line_input;       // `string` 类型变量，用于临时存储用户通过 `getline` 输入的一整行文本。
+	                         // 使用它是因为 `getline` 可以读取包含空格的输入，而 `cin >> ...` 遇到空格会停止。
+
+	cout << "\n--- 添加新开销 (输入 '-1' 作为数字或 '!cancel' 作为文本可取消) ---\n"; // 打印一个提示标题，告知用户如何取消操作。
+
+	// 【获取当前系统日期，用作后续输入的默认值】
+	// `time_t` // 是一种算术类型，用于表示时间，通常是自某个固定点（如1970年1月1日 UTC）以来的秒数。
+	// `now`    // 声明一个 `time_t` 类型的变量 `now`。
+	// `time(0)`// `time()` 函数 (来自 `<ctime>` 头文件) 返回当前日历时间。参数 `0` (或 `nullptr`) 是常见的用法。
+	time_t now = time(0); // 获取当前时间的秒数表示。
+	// `tm`       // 是一个结构体 (定义在 `<ctime>` 中)，用于存储日历时间的各个组成部分 (年、月、日、时、分、秒等)。
+	// `*ltm`     // 声明一个指向 `tm` 结构体的指针 `ltm`。
+	// `localtime(&now)` // `localtime()` 函数将 `time_t` 类型的时间（`now` 的地址 `&now` 所指向的值）转换为本地时间的 `tm` 结构体形式。
+	                    // 它返回一个指向内部静态分配的 `tm` 结构体的指针。
+	tm *ltm = localtime(&now); // 将秒数转换为本地时间的 `tm` 结构体。
+	// 从 `tm` 结构体中提取当前的年、月、日信息，用于默认值。
+	// `ltm->tm_year` // `tm` 结构体中的 `tm_year` 成员表示的是从1900年开始的年数。
+	int currentYear = 1900 + ltm->tm_year; // 所以需要加上1900得到实际的公元年份。
+	// `ltm->tm_mon`  // `tm_mon` 成员表示月份，范围是 0 (一月) 到 11 (十二月)。
+	int currentMonth = 1 + ltm->tm_mon;    // 所以需要加1得到实际的月份 (1-12)。
+	// `ltm->tm_mday` // `tm_mday` 成员表示月份中的日期，范围是 1 到 31。
+	int currentDay = ltm->tm_mday;       // 这个值可以直接使用。
+
+	// 【获取年份输入】
+	// `cout << ...`: 打印提示信息，包括当前的默认年份以及如何取消。
+	cout << "输入年份 (YYYY) [默认: " << currentYear << ", -1 取消]: ";
+	// `getline(cin, line_input);` // 使用 `getline` 函数从标准输入 `cin` 读取一整行用户输入 (直到用户按下回车)，
+	                               // 并将读取的内容存储到 `line_input` 字符串变量中。
+	                               // 这与 `cin >> year;` 不同，`getline` 可以读取包含空格的行，并且会读取并丢弃行尾的换行符。
+	getline(cin, line_input); // 读取用户输入的整行年份信息。
+	// `if (line_input == "-1")`: 检查用户是否输入了 "-1" 来取消操作。
+	if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 如果是，打印取消消息并从函数返回。
+	// `if (!line_input.empty())`: 检查用户是否输入了内容 (即 `line_input` 字符串不是空的)。
+	                             // 如果用户只是直接按了回车，`line_input` 会是空的。
+	if (!line_input.empty()) { // 如果用户输入了非空内容
+		// `stringstream` // (来自 `<sstream>` 头文件) 允许你像处理输入/输出流 (`cin`/`cout`) 一样处理内存中的字符串。
+		// `ss(line_input)` // 创建一个名为 `ss` 的 `stringstream` 对象，并将用户输入的 `line_input` 字符串的内容放入这个流中。
+		stringstream ss(line_input); // 用用户输入行创建一个字符串流。
+		// `!(ss >> year)` // 尝试从字符串流 `ss` 中提取一个整数到 `year` 变量。
+		                 // 如果提取失败 (例如，`line_input` 中包含非数字字符，或者为空)，这个表达式的结果为 `true`。
+		// `!ss.eof()`   // `eof()` (end-of-file) 成员函数检查流是否到达了末尾。
+		                 // `!ss.eof()` 为 `true` 意味着在成功提取整数 `year` 之后，字符串流 `ss` 中还有剩余的未被读取的非空白字符。
+		                 // 我们希望年份输入是纯数字，所以这种情况也视为无效。
+		if (!(ss >> year) || !ss.eof()) { // 如果提取年份失败，或者提取后仍有非数字残留
+			cout << "年份输入无效或包含非数字字符，将使用默认年份: " << currentYear << "。\n"; // 打印错误消息。
+			year = currentYear; // 将 `year` 设置为之前获取的当前系统年份作为默认值。
+		} // 年份解析和验证结束。
+	} else { // `else` 分支：如果 `line_input.empty()` 为 `true` (即用户直接按了回车，没有输入任何内容)
+		year = currentYear; // 使用当前系统年份作为默认值。
+	} // 年份输入处理完毕。
+
+	// 【获取月份输入】 - 这部分逻辑与获取年份输入的逻辑非常相似。
+	cout << "输入月份 (MM) [默认: " << currentMonth << ", -1 取消]: "; // 提示用户输入月份。
+	getline(cin, line_input); // 读取整行输入。
+	if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
+	if (!line_input.empty()) { // 如果输入非空
+		stringstream ss(line_input); // 创建字符串流。
+		if (!(ss >> month) || !ss.eof() || month < 1 || month > 12) { // 尝试提取月份，并增加月份范围 (1-12) 的校验。
+		                                                              // 如果提取失败，或有残留，或月份不在1-12范围内，则视为无效。
+			cout << "月份输入无效或范围不正确 (1-12)，将使用默认月份: " << currentMonth << "。\n"; // 打印错误消息。
+			month = currentMonth; // 使用当前系统月份作为默认值。
+		} // 月份解析和验证结束。
+	} else { // 如果用户直接回车
+		month = currentMonth; // 使用当前系统月份作为默认值。
+	} // 月份输入处理完毕。
+
+	// 【获取日期输入】 - 逻辑与获取年份/月份相似，但校验条件略有不同。
+	cout << "输入日期 (DD) [默认: " << currentDay << ", -1 取消]: "; // 提示用户输入日期。
+	getline(cin, line_input); // 读取整行输入。
+	if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
+	if (!line_input.empty()) { // 如果输入非空
+		stringstream ss(line_input); // 创建字符串流。
+		// 尝试提取日期，并按该年该月的实际天数校验 (`daysInMonth` 考虑了闰年)。
+		if (!(ss >> day) || !ss.eof() || day < 1 || day > daysInMonth(year, month)) { // 如果提取失败，或有残留，或日期超出该月天数
+			cout << "日期输入无效或范围不正确 (1-" << daysInMonth(year, month) << ")，将使用默认日期: " << currentDay << "。\n"; // 打印错误消息。
+			day = currentDay; // 使用当前系统日期作为默认值。
+		} // 日期解析和验证结束。
+	} else { // 如果用户直接回车
+		day = currentDay; // 使用当前系统日期作为默认值。
+	} // 日期输入处理完毕。
+
+	/* 【开发人员的注释 - 关于日期校验的重要提示】
+	   (这部分注释在之前的步骤中已经由我（AI助手）添加了初学者解读，这里是原始的开发者注释)
+	!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	!!! CRITICAL VALIDATION POINT / 必须实现的日期校验逻辑 !!!
+	!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	TODO: 此处必须实现严格的日期有效性检查！
+	      当前的验证 (month < 1 || month > 12 || day < 1 || day > 31) 非常基础。
+	      需要加入以下检查:
+	      1.  根据年份和月份，判断 'day' 是否在该月份的有效范围内 (例如，4月不能有31日)。
+	      2.  处理闰年情况 (2月份的天数)。
+	      3.  可以考虑不允许输入未来的日期，或者至少给出警告。
+	      4.  确保年份的合理性（例如，不是公元0年或公元9999年这种极端情况）。
+	      重要: 如果日期无效，应持续提示用户重新输入，直到用户提供有效日期为止。
+            绝对不能像当前这样直接回退到默认日期！当前的默认回退行为必须修改。
+	!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	*/
+	// 【基础日期有效性二次确认】
+	// 在分别处理完年、月、日的默认值逻辑后，这里再对组合后的日期进行一次非常基础的有效性检查。
+	// 这与上面在输入月份和日期时各自进行的范围检查是部分重叠的，但可以看作一个最终确认。
+	// 理想情况下，这里应该有一个更完善的日期验证函数，如TODO注释所建议。
+	if (!isValidDate(year, month, day)) { // 完整校验: 年份 1-9999，月份 1-12，日期不超过该月天数 (例如默认日期 31 日落在 4 月)。
+		cout << "日期输入无效（例如月份不在1-12，或该月没有这一天），请重新输入。\n"; // 打印错误消息。
+		// 注意：根据TODO注释的建议，这里不应该直接返回，而是应该提示用户重新输入整个日期，或者至少重新输入有问题的部分。
+		// 当前的实现是如果日期组合后仍不符合这个基础检查，则直接放弃本次添加操作。
+		return; // 从 `addExpense` 函数返回，添加失败。
+	} // 基础日期验证结束。
+
+	// 【获取描述输入】
+	// `Expense::MAX_DESCRIPTION_LENGTH` // 访问 `Expense` 类中定义的静态常量 `MAX_DESCRIPTION_LENGTH`，它规定了描述的最大字符数。
+	cout << "输入描述 (最多 " << Expense::MAX_DESCRIPTION_LENGTH << " 字符, 输入 '!cancel' 取消): "; // 提示用户输入描述。
+	getline(cin, description); // 使用 `getline` 读取用户输入的描述，允许包含空格。
+	if (description == "!cancel") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
+	// `description.length()` // `string` 对象的 `length()` 成员函数返回字符串中的字符数量。
+	if (description.length() > Expense::MAX_DESCRIPTION_LENGTH) { // 如果用户输入的描述长度超过了允许的最大长度
+		cout << "描述过长，已截断为 " << Expense::MAX_DESCRIPTION_LENGTH << " 字符。\n"; // 打印提示消息。
+		// `description.substr(0, Expense::MAX_DESCRIPTION_LENGTH)` // `string` 对象的 `substr()` 成员函数用于提取子字符串。
+		                                                          // 参数 `0` 是起始位置，`Expense::MAX_DESCRIPTION_LENGTH` 是要提取的长度。
+		                                                          // 这会将描述截断到允许的最大长度。
+		description = description.substr(0, Expense::MAX_DESCRIPTION_LENGTH); // 执行截断。
+	} // 描述长度处理完毕。
+
+	// 【获取金额输入】
+	cout << "输入金额 (-1 取消): "; // 提示用户输入金额。
+	// `while (true)` // 创建一个无限循环。这个循环会一直执行，直到遇到 `break` (输入有效) 或 `return` (用户取消)。
+	while (true) { // 开始金额输入循环
+		getline(cin, line_input); // 读取用户输入的整行金额信息。
+		if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
+
+		stringstream ss_amount(line_input); // 用用户输入行创建一个字符串流 `ss_amount`。
+		// `ss_amount >> amount` // 尝试从字符串流中提取一个 `double` 类型的值到 `amount` 变量。
+		// `amount >= 0`         // 检查提取出的金额是否大于或等于0 (即非负数)。
+		// `ss_amount.eof()`     // 检查在提取金额后，字符串流是否已经到达末尾 (确保输入的是纯数字，没有多余字符)。
+		if (ss_amount >> amount && amount >= 0 && ss_amount.eof()) { // 如果金额成功提取、非负，并且没有多余字符
+			break; // `break;` 跳出当前的 `while (true)` 循环，因为已获得有效金额。
+		} // 有效金额判断结束。
+		// 如果上面的 `if` 条件不满足 (即金额无效)
+		cout << "金额无效或为负，请重新输入 (-1 取消): "; // 打印错误消息，提示用户重新输入。
+	} // `while (true)` 循环结束，此时 `amount` 中已存储有效金额。
+
+	// 【获取类别输入】以 '?' 结尾的输入表示"列出以此开头的已有类别"，列出后重新提示。
+	while (true) {
+		cout << "输入类别 (如 餐饮, 交通, 娱乐; 最多 " << Expense::MAX_CATEGORY_LENGTH << " 字符, 前缀加 ? 查看已有类别, 输入 '!cancel' 取消): "; // 提示输入类别。
+		getline(cin, category); // 使用 `getline` 读取用户输入的类别，允许包含空格。
+		if (category.empty() || category.back() != '?') break;
+		printCategorySuggestions(trimCategory(category.substr(0, category.size() - 1))); // 列出补全候选
+	}
+	if (category == "!cancel") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
+	// `category.length()` // 获取类别字符串的长度。
+	if (category.length() > Expense::MAX_CATEGORY_LENGTH) { // 如果类别长度超过了 `Expense` 类中定义的 `MAX_CATEGORY_LENGTH`
+		cout << "类别名称过长，已截断为 " << Expense::MAX_CATEGORY_LENGTH << " 字符。\n"; // 打印提示消息。
+		category = category.substr(0, Expense::MAX_CATEGORY_LENGTH); // 将类别截断到允许的最大长度。
+	} // 类别长度处理完毕。
+	// `category.empty()` // `string` 对象的 `empty()` 成员函数检查字符串是否为空 (即长度为0)。
+	if (category.empty()) { // 如果用户没有输入任何类别内容 (例如直接按了回车)
+		category = "未分类"; // 将类别设置为默认值 "未分类"。
+	} // 空类别处理完毕。
+	// 【类别规范化】去掉首尾空白并按别名表换成规范名，避免同一类别分散成多个统计项。
+	string canonical = normalizeCategory(category);
+	if (canonical.empty()) canonical = "未分类";
+	if (canonical != category) {
+		cout << "类别已规范化为 \"" << canonical << "\"。\n";
+	} else if (categoryIds.find(canonical) == categoryIds.end()) { // 新类别: 提示同一首字的已有类别，方便发现输入差异
+		size_t firstChar = 1; // UTF-8 首字符的字节数
+		while (firstChar < canonical.size() && ((unsigned char)canonical[firstChar] & 0xC0) == 0x80) ++firstChar;
+		vector<string> similar = categoryTrie.complete(canonical.substr(0, firstChar), MAX_CATEGORY_SUGGESTIONS);
+		if (!similar.empty()) {
+			cout << "提示：\"" << canonical << "\" 是新类别。已有类别:";
+			for (size_t i = 0; i < similar.size(); ++i) cout << " " << similar[i];
+			cout << " (可在类别管理中设置别名)\n";
+		}
+	}
+	category = canonical;
+
+	// 【将收集到的数据存储到有序记录存储中】
+	// `Expense::create(...)` // 用用户输入的年、月、日、描述、金额、类别创建一条经过校验的开销记录。
+	// `coreAdd(...)` // 加载所在月份的分区、做重复检测，然后按日期插入到正确位置 (补记的旧日期也排在时间顺序中)。
+	optional<Expense> created = Expense::create(year, month, day, description, amount, category);
+	if (!created) { // 上面的输入循环已经保证日期和金额有效，这里只是最后的保险
+		cout << "错误：日期或金额无效，开销未添加。\n";
+		return;
+	}
+	Expense& newExpense = *created;
+	string error;
+	DuplicateAction action = DUPLICATE_NONE;
+	AnomalyFlag anomaly;
+	if (!coreAdd(newExpense, error, &action, &anomaly)) {
+		cout << "错误：" << error << "，开销未添加。\n";
+		return;
+	}
+	if (action == DUPLICATE_SKIPPED) { cout << "与已有记录重复 (同日期、金额、描述)，已跳过。\n"; return; }
+	if (action == DUPLICATE_MERGED) { cout << "与已有记录重复，已合并到已有记录 (类别: " << category << ")。\n"; return; }
+	if (action == DUPLICATE_FLAGGED) cout << "警告：已存在日期、金额、描述都相同的记录，可在 数据工具 -> 查看重复记录 中检查。\n";
+	cout << "开销已添加。\n"; // 打印成功添加的消息。
+	if (anomaly.id != 0) {
+		cout << fixed << setprecision(2) << "警告：金额 " << anomaly.cents / 100.0 << " 远高于类别 " << anomaly.category << " 的近期均值 "
+			 << anomaly.expectedCents / 100.0 << "，已记入 数据工具 -> 异常开销报告。\n" << defaultfloat << setprecision(6);
+	}
+	checkBudgetAfterAdd(newExpense); // 检查该类别本月预算，必要时提醒。
+} // `addExpense` 函数结束。
+
+// 【`displayAllExpenses` 方法实现 - 显示所有开销记录】
+void ExpenseTracker::displayAllExpenses() {
+	// 【检查是否有记录可显示】
+	if (totalRecordCount() == 0) { // 所有分区 (含未加载的) 都没有记录
+		cout << "没有开销记录。\n"; // 打印提示信息。
+		return; // 从函数返回，不再执行后续的显示逻辑。
+	} // 记录检查结束。
+	cout << "\n--- 所有开销记录 ---\n"; // 打印列表的标题。
+	browseExpenses(false); // 分页浏览: 只加载和打印当前页用到的分区与记录。
+} // `displayAllExpenses` 函数结束。
+
+// 【`displayMonthlySummary` 方法实现 - 显示月度开销统计】
+// `void ExpenseTracker::displayMonthlySummary()` // 定义 `ExpenseTracker` 类的 `displayMonthlySummary` 成员方法。
+void ExpenseTracker::displayMonthlySummary() {
+	int year, month; // 声明两个整型变量 `year` 和 `month`，用于存储用户希望统计的年份和月份。
+	cout << "\n--- 月度开销统计 ---\n"; // 打印该功能的标题。
+
+	// 【获取用户输入的年份】
+	cout << "输入要统计的年份 (YYYY) (-1 取消): "; // 提示用户输入年份，并告知输入-1可以取消操作。
+	// `while (true)` // 开始一个无限循环，用于持续获取和验证用户输入，直到获得有效年份或用户取消。
+	while (true) {
+		cin >> year; // 尝试从标准输入读取一个整数到 `year` 变量。
+		// `cin.fail()` // 检查上一次输入操作是否失败（例如，用户输入了文本而不是数字）。
+		if (cin.fail()) { // 如果输入失败
+			cout << "年份输入无效，请重新输入 (-1 取消): "; // 打印错误提示。
+			cin.clear();        // 清除输入流 `cin` 的错误状态标志，使其恢复正常。
+			clearInputBuffer(); // 调用自定义函数清除输入缓冲区中的无效内容（包括换行符）。
+		// `else if (year == -1)` // 如果用户输入的是 -1 (表示取消)
+		} else if (year == -1) {
+			clearInputBuffer(); // 清除输入缓冲区中的 "-1" 后的换行符。
+			cout << "已取消月度统计。\n"; // 打印取消消息。
+			return; // 从 `displayMonthlySummary` 函数返回，终止统计操作。
+		} else { // `else` 分支：如果输入操作成功且不是 -1 (即用户输入了一个数字)
+			clearInputBuffer(); // 清除输入缓冲区中数字后的换行符。
+			break; // `break;` 跳出当前的 `while (true)` 循环，因为已获得有效的年份输入。
+		} // 年份输入验证结束。
+	} // 年份获取循环结束。
+
+	// 【获取用户输入的月份】
+	cout << "输入要统计的月份 (MM) (-1 取消): "; // 提示用户输入月份。
+	// `while (true)` // 开始另一个无限循环，用于获取和验证月份输入。
+	while (true) {
+		cin >> month; // 尝试读取月份。
+		if (cin.fail()) { // 如果输入失败
+			cout << "月份输入无效 (1-12)，请重新输入 (-1 取消): "; // 打印错误提示。
+			cin.clear();        // 清除错误状态。
+			clearInputBuffer(); // 清除无效输入。
+		} else if (month == -1) { // 如果用户输入 -1 (取消)
+			clearInputBuffer(); // 清除换行符。
+			cout << "已取消月度统计。\n"; // 打印取消消息。
+			return; // 从函数返回。
+		// `else if (month < 1 || month > 12)` // 如果输入的月份不在有效范围 1 到 12 之内
+		} else if (month < 1 || month > 12) {
+			cout << "月份输入无效 (1-12)，请重新输入 (-1 取消): "; // 打印范围错误提示。
+			clearInputBuffer(); // 清除无效月份输入后的换行符，以便下一次循环可以正确读取。
+		} else { // `else` 分支：如果输入成功、不是 -1，并且月份在 1-12 范围内 (即月份有效)
+			clearInputBuffer(); // 清除有效月份后的换行符。
+			break; // `break;` 跳出当前的 `while (true)` 循环。
+		} // 月份输入验证结束。
+	} // 月份获取循环结束。
+
+	// 【打印月度统计报告的标题】
+	cout << "\n--- " << year << "年" << setfill('0') << setw(2) << month << setfill(' ') << "月 开销统计 ---\n";
+	printExpenseHeader(); // 明细表头。
+
+	// 【打印明细】只加载该月份的分区；各级类别合计在加载和增删记录时已经更新，不需要再分组。
+	PrintSink printer;                         // 输出端: 打印该月明细
+	runQuery(MatchMonth(year, month), printer);
+
+	// 【输出统计结果】
+	if (printer.count == 0) { // 没有找到任何属于该月份的记录
+		cout << "该月份没有开销记录。\n"; // 打印提示信息。
+		return;
+	}
+	printExpenseSeparator(); // 打印一条分隔线。
+	cout << left << setw(12 + 30 + 20) << "本月总计:" // "本月总计:" 文本左对齐，占据前面三列的宽度。
+		 << right << fixed << setprecision(2) << setw(10) << categoryMonthCents(year, month, "") / 100.0 << "\n\n"; // 总金额右对齐。
+	printCategoryTree(year, month); // 可展开/折叠的类别合计树 (含预算对比)。
+} // `displayMonthlySummary` 函数结束。
+
+// 【`printCategoryTree` 方法实现 - 按类别层级显示某月合计】
+// 直接读取 `monthRollups` 中各节点的子树合计。开始时只展开第一级；输入行号展开或折叠该类别，
+// 同一级按金额从大到小排列。类别本身也有记录 (例如既有 "餐饮" 又有 "餐饮/午餐") 时，展开后多一行 "(未细分)"。
+void ExpenseTracker::printCategoryTree(int year, int month) {
+	const MonthRollup& rollup = monthRollups[year * 100 + month];
+	const vector<CategoryNode>& nodes = categoryHierarchy.nodes;
+	vector<char> expanded(nodes.size(), 0);
+	expanded[0] = 1;
+	while (true) {
+		vector<int> shown; // 行号 -> 节点编号 (不可展开的行为 -1)
+		vector<int> stack(1, 0);
+		cout << "按类别汇总 (" << "[+] 可展开，[-] 可折叠):\n";
+		cout << "     " << left << setw(30) << "类别" << right << setw(12) << "实际" << setw(8) << "笔数" << setw(8) << "占比"
+			 << setw(10) << "预算" << setw(10) << "差额" << "\n";
+		cout << string(83, '-') << "\n";
+		double monthTotal = rollup.totalCents(0) / 100.0;
+		while (!stack.empty()) { // 深度优先，子节点按金额逆序压栈，弹出时即为从大到小
+			int node = stack.back();
+			stack.pop_back();
+			vector<int> children;
+			long long childCents = 0;
+			for (int child : nodes[node].children) {
+				if (rollup.recordCount(child) == 0) continue; // 该月没有记录的类别不显示
+				children.push_back(child);
+				childCents += rollup.totalCents(child);
+			}
+			if (node != 0) {
+				double total = rollup.totalCents(node) / 100.0;
+				string label = string((nodes[node].depth - 1) * 2, ' ') + (children.empty() ? "    " : (expanded[node] ? "[-] " : "[+] ")) + nodes[node].name;
+				shown.push_back(children.empty() ? -1 : node);
+				cout << left << setw(5) << shown.size() << setw(30) << label << right << fixed << setprecision(2) << setw(12) << total
+					 << setw(8) << rollup.recordCount(node) << setw(7) << setprecision(1) << (monthTotal > 0 ? total * 100 / monthTotal : 0) << "%"
+					 << setprecision(2);
+				const BudgetEntry* budget = findBudget(year, month, nodes[node].path);
+				if (budget != nullptr) { // 差额为正表示结余，为负表示超支
+					cout << setw(10) << budget->amount << setw(10) << budget->amount - total;
+					if (total > budget->amount) cout << "  超支";
+				} else {
+					cout << setw(10) << "-" << setw(10) << "-";
+				}
+				cout << "\n";
+			}
+			if (!expanded[node]) continue;
+			long long ownCents = rollup.totalCents(node) - childCents; // 直接记在该类别本身的金额
+			if (node != 0 && !children.empty() && ownCents != 0) {
+				shown.push_back(-1);
+				cout << left << setw(5) << shown.size() << setw(30) << string(nodes[node].depth * 2, ' ') + "    (未细分)"
+					 << right << setw(12) << ownCents / 100.0 << "\n";
+			}
+			sort(children.begin(), children.end(), [&rollup](int a, int b) { return rollup.totalCents(a) < rollup.totalCents(b); });
+			stack.insert(stack.end(), children.begin(), children.end());
+		}
+		cout << string(83, '-') << "\n";
+		cout << "输入行号展开/折叠，a 全部展开，c 全部折叠，直接回车返回: ";
+		string input;
+		getline(cin, input);
+		if (input.empty()) break;
+		if (input == "a" || input == "c") {
+			fill(expanded.begin() + 1, expanded.end(), input == "a" ? 1 : 0);
+			continue;
+		}
+		int row = atoi(input.c_str());
+		if (row < 1 || row > (int)shown.size() || shown[row - 1] < 0) {
+			cout << "该行不能展开。\n";
+			continue;
+		}
+		expanded[shown[row - 1]] ^= 1;
+	}
+} // `printCategoryTree` 函数结束。
+
+// 【`listExpensesByPeriod` 方法实现 - 按指定期间列出开销】
+// `void ExpenseTracker::listExpensesByPeriod()` // 定义 `ExpenseTracker` 类的 `listExpensesByPeriod` 成员方法。
+                                            // 此方法提供一个子菜单，允许用户按年、月或日来查看开销记录。
+void ExpenseTracker::listExpensesByPeriod() {
+	int choice; // 声明一个整型变量 `choice`，用于存储用户在子菜单中的选择。
+	// `do...while` // 开始一个 `do-while` 循环，用于显示子菜单并处理用户选择，直到用户选择返回主菜单。
+	do {
+		// 【显示子菜单选项】
+		cout << "\n--- 按期间列出开销 --- \n"; // 子菜单标题。
+		cout << "1. 按年份列出\n";        // 选项1：按年份。
+		cout << "2. 按月份列出\n";        // 选项2：按月份。
+		cout << "3. 按日期列出\n";        // 选项3：按日期。
+		cout << "0. 返回主菜单\n";      // 选项0：返回。
+		cout << "--------------------\n"; // 分隔线。
+		cout << "请输入选项: ";        // 提示输入。
+
+		cin >> choice; // 读取用户在子菜单中的选择。
+		// 【输入验证】 (与主菜单中的验证逻辑类似)
+		if (cin.fail()) { // 如果输入失败
+			cin.clear();        // 清除错误状态。
+			clearInputBuffer(); // 清除无效输入。
+			choice = -1;        // 将 `choice` 设为一个无效值 (例如-1)，确保 `switch` 进入 `default` 或不匹配任何 `case`，以便循环可以继续提示用户。
+		} else { // 如果输入成功 (是数字)
+			clearInputBuffer(); // 清除数字后的换行符。
+		} // 输入验证结束。
+
+		// `switch (choice)` // 根据用户的子菜单选择执行相应操作。
+		switch (choice) {
+			case 1: { // 【用户选择1：按年份列出】
+				cout << "\n--- 按年份列出开销 ---\n"; // 功能标题。
+				cout << "输入年份 (YYYY) (输入 0 返回): "; // 提示输入年份，0可返回子菜单。
+				int year; // 声明用于存储年份的变量。
+				// `while (!(cin >> year))` // 循环，直到用户输入一个有效的整数年份。
+				                         // `!(cin >> year)` 如果读取失败（例如输入文本），则为 `true`，循环继续。
+				while (!(cin >> year)) {
+					cout << "年份输入无效，请重新输入 (输入 0 返回): "; // 错误提示。
+					cin.clear();        // 清除错误。
+					clearInputBuffer(); // 清除缓冲区。
+				} // 年份输入循环结束。
+				clearInputBuffer(); // 清除有效年份后的换行符。
+				if (year == 0) break; // 如果用户输入0，则 `break` 跳出当前的 `case 1`，返回到子菜单的 `do-while` 循环开头。
+
+				// 【打印属于指定年份的记录】条件 MatchYear 只会加载该年份 12 个月的分区。
+				printExpenseHeader(); // 表头 (与 `displayAllExpenses` 中的格式相同)
+				PrintSink printer;
+				runQuery(MatchYear(year), printer);
+				if (printer.count == 0) { // 没有找到该年份的记录
+					cout << "在 " << year << " 年没有找到开销记录。\n"; // 打印未找到记录的消息。
+				} // 未找到记录判断结束。
+				printExpenseSeparator(); // 打印末尾分隔线。
+				break; // 结束 `case 1` 的处理。
+			} // `case 1` 结束。
+
+			case 2: { // 【用户选择2：按月份列出】
+				cout << "\n--- 按月份列出开销 ---\n"; // 功能标题。
+				cout << "输入年份 (YYYY) (输入 0 返回): "; // 提示输入年份。
+				int year; // 存储年份。
+				while (!(cin >> year)) { /* ... 此处省略了与 case 1 中完全相同的年份输入和验证逻辑的重复注释 ... */
+					cout << "年份输入无效，请重新输入 (输入 0 返回): ";
+					cin.clear(); clearInputBuffer();
+				}
+				clearInputBuffer();
+				if (year == 0) break; // 年份为0则返回子菜单。
+
+				cout << "输入月份 (MM) (输入 0 返回): "; // 提示输入月份。
+				int month; // 存储月份。
+				// `while (!(cin >> month) || (month != 0 && (month < 1 || month > 12)))` // 循环，直到输入有效的整数月份 (1-12) 或 0 (返回)。
+				                                                                        // `!(cin >> month)`: 读取失败。
+				                                                                        // `month != 0 && (month < 1 || month > 12)`: 读取成功但不是0，且月份不在1-12范围内。
+				while (!(cin >> month) || (month != 0 && (month < 1 || month > 12))) {
+					cout << "月份输入无效 (1-12)，请重新输入 (输入 0 返回): "; // 错误提示。
+					cin.clear(); clearInputBuffer(); // 清理。
+				} // 月份输入循环结束。
+				clearInputBuffer(); // 清除有效月份后的换行符。
+				if (month == 0) break; // 月份为0则返回子菜单。
+
+				// 【打印属于指定年和月的记录】只会加载该月份的分区。
+				printExpenseHeader();
+				PrintSink printer;
+				runQuery(MatchMonth(year, month), printer);
+				if (printer.count == 0) { // 如果未找到记录
+					cout << "在 " << year << " 年 " << month << " 月没有找到开销记录。\n"; // 打印提示。
+				} // 未找到判断结束。
+				printExpenseSeparator(); // 末尾分隔线。
+				break; // 结束 `case 2` 的处理。
+			} // `case 2` 结束。
+
+			case 3: { // 【用户选择3：按日期列出】
+				cout << "\n--- 按日期列出开销 ---\n"; // 功能标题。
+				cout << "输入年份 (YYYY) (输入 0 返回): "; // 提示输入年。
+				int year; // 存储年。
+				while (!(cin >> year)) { /* ... 年份输入与验证逻辑 (同上) ... */
+					cout << "年份输入无效，请重新输入 (输入 0 返回): ";
+					cin.clear(); clearInputBuffer();
+				}
+				clearInputBuffer();
+				if (year == 0) break;
+
+				cout << "输入月份 (MM) (输入 0 返回): "; // 提示输入月。
+				int month; // 存储月。
+				while (!(cin >> month) || (month != 0 && (month < 1 || month > 12))) { /* ... 月份输入与验证逻辑 (同上) ... */
+					cout << "月份输入无效 (1-12)，请重新输入 (输入 0 返回): ";
+					cin.clear(); clearInputBuffer();
+				}
+				clearInputBuffer();
+				if (month == 0) break;
+
+				cout << "输入日期 (DD) (输入 0 返回): "; // 提示输入日。
+				int day; // 存储日。
+				// `while (!(cin >> day) || (day != 0 && (day < 1 || day > 31)))` // 循环，直到输入有效的整数日期 (1-31) 或 0 (返回)。
+				                                                                 // 这是一个基础的日期范围检查，未考虑月份的实际天数。
+				while (!(cin >> day) || (day != 0 && !isValidDate(year, month, day))) {
+					cout << "日期输入无效 (1-" << daysInMonth(year, month) << ")，请重新输入 (输入 0 返回): "; // 错误提示。
+					cin.clear(); clearInputBuffer(); // 清理。
+				} // 日期输入循环结束。
+				clearInputBuffer(); // 清除有效日期后的换行符。
+				if (day == 0) break; // 日期为0则返回子菜单。
+
+				// 【打印属于指定年、月、日的记录】只会加载该日所在月份的分区。
+				printExpenseHeader();
+				PrintSink printer;
+				runQuery(MatchDay(year, month, day), printer);
+				if (printer.count == 0) { // 如果未找到
+					cout << "在 " << year << " 年 " << month << " 月 " << day << " 日没有找到开销记录。\n"; // 打印提示。
+				} // 未找到判断结束。
+				printExpenseSeparator(); // 末尾分隔线。
+				break; // 结束 `case 3` 的处理。
+			} // `case 3` 结束。
+
+			case 0: // 【用户选择0：返回主菜单】
+				cout << "返回主菜单...\n"; // 打印返回消息。
+				break; // 跳出 `switch` 语句。因为 `choice` 为 0，`do-while` 循环的条件 `choice != 0` 将为 `false`，从而结束子菜单循环。
+			default: // 【其他无效输入】
+				cout << "无效选项，请重试。\n"; // 打印错误提示。
+				// 无需 `break`，因为是 `switch` 的最后一个分支。
+		} // `switch` 语句结束。
+	} while (choice != 0); // 子菜单的 `do-while` 循环条件：当 `choice` 不为 0 时继续循环。用户选择0则退出。
+} // `listExpensesByPeriod` 函数结束。
+
+// 【`saveExpenses` 方法实现 - 保存开销数据到分区文件】
+// 数据按自然月分区存放在 `PARTITION_DIR` 目录下，每个分区文件的格式与旧版 `DATA_FILE` 相同
+// (第一行为记录数，之后每行一条逗号分隔的记录)。
+// 保存时只重写被标记为 dirty 的分区，未修改的历史月份文件保持不动。
+// 分两批写出 (每个文件都先写临时文件再改名，见 `AsyncFileIO::writeFiles`): 先同时写出各分区文件，
+// 再根据写入结果生成分区清单、类别表和各索引文件。写入失败的分区保留 dirty 标志，清单中的校验值记为未知 (0)，
+// 同步时不会把它当作与对方相同的月份。
+void ExpenseTracker::saveExpenses() {
+	error_code ec; // 文件系统操作的错误码 (使用 error_code 版本的接口，失败时不抛异常)
+	filesystem::create_directories(PARTITION_DIR, ec); // 确保分区目录存在 (已存在时什么也不做)。
+	if (ec) { // 如果目录创建失败
+		cerr << "错误：无法创建数据目录 " << PARTITION_DIR << "！\n"; // 打印错误消息。
+		return; // 不执行后续的保存操作。
+	} // 目录检查结束。
+
+	vector<FileRequest> writes;  // 本次要写出的分区文件
+	vector<size_t> writtenParts; // writes[k] 对应的分区下标
+	vector<uint64_t> blockHashes;
+	for (size_t p = 0; p < partitions.size(); ) { // 遍历所有分区 (循环体内可能删除元素，因此手动推进下标)。
+		PartitionInfo& part = partitions[p]; // 当前分区的引用。
+		if (!part.dirty) { ++p; continue; } // 未修改的分区直接跳过，这正是分区存储省下的写入量。
+		string path = partitionFilePath(part.year, part.month); // 分区文件路径。
+
+		if (part.recordCount == 0 && part.tombstones.empty()) { // 如果该分区没有记录也没有删除标记
+			filesystem::remove(path, ec); // 删除对应的分区文件。
+			partitions.erase(partitions.begin() + p); // 并从清单中移除该分区 (不推进下标)。
+			continue;
+		} // 空分区处理结束。
+
+		uint64_t blockHash;
+		writes.push_back(FileRequest(path, partitionFileText((int)p, &blockHash))); // 生成该分区文件的内容 (同时计算校验值)。
+		writtenParts.push_back(p);
+		blockHashes.push_back(blockHash);
+		++p; // 处理下一个分区。
+	} // 分区遍历结束。
+	fileIO.writeFiles(writes); // 第一批: 各分区文件同时写出。
+	for (size_t k = 0; k < writes.size(); ++k) {
+		PartitionInfo& part = partitions[writtenParts[k]];
+		if (writes[k].ok) {
+			part.blockHash = blockHashes[k]; // 清单中写入新的校验值
+			part.dirty = false; // 该分区已与磁盘一致。
+		} else {
+			cerr << "错误：无法写入文件 " << writes[k].path << "！\n"; // 分区保留 dirty 标志，下次保存时重试。
+			part.blockHash = 0; // 磁盘上的内容未知
+		}
+	}
+
+	// 第二批: 清单与索引文件反映上面的写入结果。
+	vector<FileRequest> metadata;
+	metadata.push_back(FileRequest(MANIFEST_FILE, formatManifest(partitions))); // 分区清单 (记录每个分区的年月、记录数和校验值)。
+	metadata.push_back(FileRequest(CATEGORY_FILE, categoryFileText()));      // 类别表包含未加载分区中的类别，随数据一起保存。
+	bool bitmapsWritten = bitmapIndexChanged || !writtenParts.empty();
+	if (bitmapsWritten) metadata.push_back(FileRequest(BITMAP_INDEX_FILE, bitmapIndexFileText())); // 位图索引记下分区的新校验值
+	bool anomaliesWritten = anomalyStateChanged;
+	if (anomaliesWritten) metadata.push_back(FileRequest(ANOMALY_FILE, anomalyFileText()));
+	fileIO.writeFiles(metadata);
+	for (size_t k = 0; k < metadata.size(); ++k) {
+		if (!metadata[k].ok) cerr << "错误：无法写入文件 " << metadata[k].path << "！\n";
+	}
+	size_t next = 2;
+	if (bitmapsWritten) bitmapIndexChanged = !metadata[next++].ok; // 写入失败时下次保存重试
+	if (anomaliesWritten) anomalyStateChanged = !metadata[next++].ok;
+} // `saveExpenses` 函数结束。
+
+// 【`partitionFileText` 方法实现 - 生成一个分区文件的内容】
+// 第一行为记录数，之后是该月的记录和删除标记；`blockHash` 返回分区校验值。
+string ExpenseTracker::partitionFileText(int idx, uint64_t* blockHash) {
+	const PartitionInfo& part = partitions[idx];
+	ostringstream out;
+	out << part.recordCount << "\n";
+	RecordWriterSink writer(out); // 输出端: 按数据文件格式写出记录
+	BlockHashSink hasher;         // 输出端: 同时计算分区校验值
+	TeeSink<RecordWriterSink, BlockHashSink> both(writer, hasher);
+	runQuery(MatchMonth(part.year, part.month), both); // 只写出属于该分区 (年月匹配) 的记录。
+	for (uint64_t id : part.tombstones) { // 记录之后写删除标记
+		out << "~" << formatRecordId(id) << "\n";
+		hasher.blockHash += tombstoneBlockHash(id);
+	}
+	if (blockHash) *blockHash = hasher.blockHash;
+	return out.str();
+} // `partitionFileText` 函数结束。
+
+// 【`loadRecordsFromFile` 方法实现 - 从一个数据文件追加加载开销记录】
+// 旧版 `DATA_FILE` 与每个分区文件使用相同的格式，由 `readRecordFile` 解析，这里按日期插入内存并更新索引。
+// `tombstones` 不为空时一并读出文件中的删除标记。
+// 返回值: 成功加载的记录数；文件无法打开或头部信息无效时返回 -1。
+int ExpenseTracker::loadRecordsFromFile(const string& path, set<uint64_t>* tombstones) {
+	string text;
+	if (!fileIO.readFile(path, text)) return -1;
+	return loadRecordData(text, tombstones);
+} // `loadRecordsFromFile` 函数结束。
+
+// 【`loadRecordData` 方法实现 - 解析一个数据文件的内容并加载到内存】返回值与 `loadRecordsFromFile` 相同。
+int ExpenseTracker::loadRecordData(string_view text, set<uint64_t>* tombstones) {
+	vector<Expense> records;
+	if (parseRecordData(text, records, tombstones) < 0) return -1;
+	if (expenseCount + (int)records.size() > MAX_EXPENSES) records.resize(MAX_EXPENSES - expenseCount); // 内存已满，只加载放得下的部分
+	for (size_t i = 0; i < records.size(); ++i) recordAdded(records[i]); // 更新月度累计等内存索引。
+	allExpenses.insertMany(records); // 一次排序归并插入有序存储。
+	expenseCount += (int)records.size(); // 内存中的记录总数。
+	return (int)records.size();
+} // `loadRecordData` 函数结束。
+
+// 【`readRecordFile` 方法实现 - 读取并解析一个数据文件】文件无法打开时返回 -1，否则由 `parseRecordData` 解析。
+int ExpenseTracker::readRecordFile(const string& path, vector<Expense>& records, set<uint64_t>* tombstones) {
+	string text;
+	if (!fileIO.readFile(path, text)) return -1;
+	return parseRecordData(text, records, tombstones);
+} // `readRecordFile` 函数结束。
+
+// 【`parseRecordData` 方法实现 - 解析一个数据文件的内容】
+// 格式: 第一行为记录数，之后每行一条记录 ("@编号," 前缀可选，旧文件没有)，记录之后可以有若干 "~编号" 删除标记行。
+// 没有编号的旧记录按内容推导出编号 (内容哈希 + 同内容记录的序号)，同一份旧文件在两台机器上推导出的编号相同。
+// 解析出的记录追加到 `records`；返回解析成功的记录数，头部信息无效时返回 -1。
+int ExpenseTracker::parseRecordData(string_view text, vector<Expense>& records, set<uint64_t>* tombstones) {
+	MemoryStreamBuffer source(text.data(), text.size());
+	istream inFile(&source); // 文件内容已整体读入内存，直接在缓冲区上按行解析。
+
+	// 【从文件读取数据内容】
+	int countFromFile; // 声明一个整型变量，用于存储从文件第一行读取到的记录总数。
+	inFile >> countFromFile; // 尝试从文件流 `inFile` 中读取一个整数，并存入 `countFromFile`。
+	                       // 这对应于 `saveExpenses` 中首先写入记录总数的做法。
+	// `inFile.fail()` // 检查上一次读取操作（即 `inFile >> countFromFile`）是否失败。
+	                 // 失败的可能原因包括：文件为空，文件第一行不是有效的数字，或者达到了文件末尾等。
+	// `countFromFile < 0 || countFromFile > MAX_EXPENSES` // 检查读取到的数量是否在一个合理的范围内。
+	                                                      // 小于0显然是无效的。大于 `MAX_EXPENSES` 表示文件中的记录数超出了程序内部数组的容量。
+	if (inFile.fail() || countFromFile < 0 || countFromFile > MAX_EXPENSES) { // 如果读取数量失败，或数量无效
+		return -1;        // 返回 -1，表示文件内容不符合预期。
+	} // 记录总数验证结束。
+	// `inFile.ignore(numeric_limits<streamsize>::max(), '\n');` // 在成功读取记录总数 `countFromFile` 之后，
+	                                                          // 文件流的当前读取位置可能在数字之后、换行符之前（如果数字后有空格或制表符），或者正好在换行符上。
+	                                                          // 调用 `ignore` 来跳过并丢弃第一行中剩余的所有字符，直到并包括第一个换行符 `\n`。
+	                                                          // 这是为了确保后续的 `getline` 函数能从文件的第二行（即第一条实际的开销记录）开始正确读取。
+	inFile.ignore(numeric_limits<streamsize>::max(), '\n'); // 忽略第一行（记录总数那一行）末尾的换行符。
+
+	string line;          // 声明一个 `string` 变量 `line`，用于存储从文件中读取的每一整行文本（即一条序列化后的开销记录）。
+	int loadedCount = 0;  // 声明一个整型变量 `loadedCount`，用于计数实际成功解析的开销记录数量，初始化为0。
+	unordered_map<uint64_t, int> derivedIdOccurrences; // 内容哈希 -> 已出现次数 (为没有编号的旧记录推导编号)
+	// `for (int i = 0; i < countFromFile; ++i)` // 根据从文件头部读取到的 `countFromFile`，尝试循环读取并解析相应数量的记录行。
+	for (int i = 0; i < countFromFile; ++i) {
+		// `if (!getline(inFile, line))` // 尝试从文件流 `inFile` 中读取一整行（直到换行符）到 `line` 变量中。
+		                              // `getline` 如果成功读取一行，返回 `true` (在布尔上下文中)；如果到达文件末尾或发生错误，返回 `false`。
+		                              // `!getline(...)` 表示如果读取失败。
+		if (!getline(inFile, line)) { // 如果无法再从文件中读取到一行 (例如文件比声明的记录数要短)
+			break; // `break;` 跳出当前的 `for` 循环，停止进一步的加载尝试。
+		} // 行读取检查结束。
+
+		Expense record;
+		if (!parseRecordLine(line, i + 1, record)) continue; // 字段不完整或无效: 跳过此记录 (原因已输出)
+		uint64_t recordId = record.getId();
+		if (recordId == 0) { // 旧记录: 由内容推导编号
+			uint64_t content = recordContentHash(record);
+			recordId = fnv1a64("#" + to_string(derivedIdOccurrences[content]++), content);
+			if (recordId == 0) recordId = 1;
+		}
+		record.setId(recordId);
+		records.push_back(record);
+		loadedCount++; // 本文件成功解析的记录数加1。
+	} // `for` 循环（遍历文件中的记录行）结束。
+
+	// 【删除标记】记录之后的 "~编号" 行。
+	while (tombstones && getline(inFile, line)) {
+		if (line.size() > 1 && line[0] == '~') tombstones->insert(strtoull(line.c_str() + 1, nullptr, 16));
+	}
+	return loadedCount; // 返回本文件实际解析的记录数（可能跳过了某些无效记录）。
+} // `parseRecordData` 函数结束。
+
+// 【`loadExpenses` 方法实现 - 加载开销数据】
+// 启动时只读取分区清单，不解析任何分区文件；分区在查询、结算或修改用到时才由 `ensurePartitionLoaded` 加载。
+// 如果清单不存在但旧版 `DATA_FILE` 存在，则整体读入旧文件，并在下次保存时迁移为分区存储。
+// 返回 `true` 表示找到了已有数据，`false` 表示没有历史数据。
+bool ExpenseTracker::loadExpenses() {
+	if (readManifest()) { // 优先读取分区清单
+		readBitmapIndex(); // 与清单一致的位图索引可以直接使用
+		return true;
+	}
+	return loadLegacyDataFile(); // 没有清单时尝试旧版单文件数据。
+} // `loadExpenses` 函数结束。
+
+// 【`loadLegacyDataFile` 方法实现 - 读取旧版单文件数据并准备迁移】
+bool ExpenseTracker::loadLegacyDataFile() {
+	if (loadRecordsFromFile(DATA_FILE) < 0) { // 旧文件不存在或头部无效
+		return false;
+	}
+	// 根据已加载的记录建立分区列表。所有分区都标记为 dirty，下次保存时会被写成分区文件。
+	for (int i = 0; i < expenseCount; ++i) {
+		adjustPartitionCount(allExpenses[i].getYear(), allExpenses[i].getMonth(), 1);
+	}
+	cerr << "提示：检测到旧版数据文件 " << DATA_FILE << "，保存时将迁移为按月分区存储 (" << PARTITION_DIR << "/)。\n";
+	return true;
+} // `loadLegacyDataFile` 函数结束。
+
+// 【`readManifest` 方法实现 - 读取分区清单】
+// 清单格式: 第一行为分区数，之后每行 "年 月 记录数"。
+bool ExpenseTracker::readManifest() {
+	vector<PartitionInfo> list;
+	if (!readManifestFile(MANIFEST_FILE, list)) { // 清单不存在 (首次运行或尚未迁移) 或头部无效
+		return false;
+	}
+	for (size_t i = 0; i < list.size(); ++i) {
+		int idx = getOrCreatePartition(list[i].year, list[i].month); // 登记分区 (此时尚未加载)。
+		partitions[idx].recordCount = list[i].recordCount;
+		partitions[idx].blockHash = list[i].blockHash;
+	}
+	return true;
+} // `readManifest` 函数结束。
+
+// 【`readManifestFile` 方法实现 - 读取一个分区清单文件】本账本和同步对方的清单共用。
+// 格式: 第一行为分区数，之后每行 "年 月 记录数 [校验值]"；旧清单没有校验值，按未知 (0) 处理。
+bool ExpenseTracker::readManifestFile(const string& path, vector<PartitionInfo>& list) {
+	string text;
+	if (!fileIO.readFile(path, text)) return false;
+	istringstream inFile(text);
+	int partitionCountFromFile; // 清单中声明的分区数。
+	inFile >> partitionCountFromFile;
+	if (inFile.fail() || partitionCountFromFile < 0) { // 头部无效
+		cerr << "警告：分区清单 " << path << " 格式无效。\n";
+		return false;
+	}
+	inFile.ignore(numeric_limits<streamsize>::max(), '\n');
+	string line;
+	for (int i = 0; i < partitionCountFromFile && getline(inFile, line); ++i) { // 逐行读取分区信息。
+		stringstream ss(line);
+		PartitionInfo part;
+		if (!(ss >> part.year >> part.month >> part.recordCount) || part.month < 1 || part.month > 12 || part.recordCount < 0) { // 行数据不完整或取值无效
+			cerr << "警告：分区清单第 " << i + 2 << " 行无效，忽略其后的分区。\n";
+			break;
+		}
+		string hash;
+		if (ss >> hash) part.blockHash = strtoull(hash.c_str(), nullptr, 16);
+		list.push_back(part);
+	}
+	sort(list.begin(), list.end(), [](const PartitionInfo& a, const PartitionInfo& b) {
+		return a.year * 100 + a.month < b.year * 100 + b.month;
+	});
+	return true;
+} // `readManifestFile` 函数结束。
+
+// 【`writeManifestFile` 方法实现 - 写出一个分区清单文件】每个分区一行: 年 月 记录数 校验值。
+bool ExpenseTracker::writeManifestFile(const string& path, const vector<PartitionInfo>& list) {
+	if (!fileIO.writeFile(path, formatManifest(list))) { // 覆盖写入清单。
+		cerr << "错误：无法写入分区清单 " << path << "\n";
+		return false;
+	}
+	return true;
+} // `writeManifestFile` 函数结束。
+
+// 【`findPartition` 方法实现 - 查找指定年月的分区】
+// 返回分区在 `partitions` 中的下标，不存在时返回 -1。
+int ExpenseTracker::findPartition(int year, int month) {
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		if (partitions[p].year == year && partitions[p].month == month) return (int)p;
+	}
+	return -1;
+} // `findPartition` 函数结束。
+
+// 【`getOrCreatePartition` 方法实现 - 查找或按年月顺序插入一个新分区】
+int ExpenseTracker::getOrCreatePartition(int year, int month) {
+	int idx = findPartition(year, month);
+	if (idx >= 0) return idx; // 已存在
+	size_t pos = 0; // 找到第一个比目标年月更晚的分区，保持列表按年月升序。
+	while (pos < partitions.size() &&
+		   (partitions[pos].year < year || (partitions[pos].year == year && partitions[pos].month < month))) {
+		++pos;
+	}
+	PartitionInfo part;
+	part.year = year;
+	part.month = month;
+	partitions.insert(partitions.begin() + pos, part);
+	return (int)pos;
+} // `getOrCreatePartition` 函数结束。
+
+// 【`partitionFilePath` 方法实现 - 生成分区文件路径，例如 expenses_data/2025-03.dat】
+string ExpenseTracker::partitionFilePath(int year, int month) {
+	ostringstream path;
+	path << PARTITION_DIR << "/" << setfill('0') << setw(4) << year << "-" << setw(2) << month << ".dat";
+	return path.str();
+} // `partitionFilePath` 函数结束。
+
+// 【`ensurePartitionLoaded` 方法实现 - 按需加载一个分区】
+// 分区不存在 (该月没有任何记录) 或已加载时直接返回 `true`。
+// 如果内存容量放不下整个分区则拒绝加载并返回 `false`，避免只加载一部分后保存时丢失数据。
+bool ExpenseTracker::ensurePartitionLoaded(int year, int month) {
+	int idx = findPartition(year, month);
+	if (idx < 0 || partitions[idx].loaded) return true;
+	return loadPartitions(vector<int>(1, idx));
+} // `ensurePartitionLoaded` 函数结束。
+
+// 【`loadPartitions` 方法实现 - 加载一批尚未加载的分区】
+// 所有分区文件由 `fileIO` 同时读取，每读完一个就在这里解析并插入内存，解析与其余文件的读取重叠进行。
+// 容量放不下或文件无法读取、解析的分区不加载 (返回 `false`)，调用方不会修改这些月份，保存时也就不会用部分数据覆盖原文件。
+bool ExpenseTracker::loadPartitions(const vector<int>& indices) {
+	bool allLoaded = true;
+	vector<int> chosen;
+	vector<FileRequest> reads;
+	int planned = expenseCount;
+	for (size_t k = 0; k < indices.size(); ++k) {
+		const PartitionInfo& part = partitions[indices[k]];
+		if (part.loaded) continue;
+		if (planned + part.recordCount > MAX_EXPENSES) { // 容量检查
+			cerr << "错误：内存记录已满，无法加载 " << part.year << "年" << part.month << "月的数据分区。\n";
+			allLoaded = false;
+			continue;
+		}
+		planned += part.recordCount;
+		chosen.push_back(indices[k]);
+		reads.push_back(FileRequest(partitionFilePath(part.year, part.month)));
+	}
+	fileIO.readFiles(reads, [&](size_t k) {
+		PartitionInfo& part = partitions[chosen[k]];
+		loadingPartitions = true; // 按文件顺序读入，该分区的位图索引仍然有效
+		int loaded = reads[k].ok ? loadRecordData(reads[k].data, &part.tombstones) : -1; // 追加读入该分区的记录和删除标记。
+		loadingPartitions = false;
+		IoBuffer().swap(reads[k].data); // 解析完即释放文件内容
+		if (loaded < 0) { // 分区文件丢失或损坏: 保持未加载，该月份不能修改 (否则保存时会覆盖原文件)
+			cerr << "错误：无法读取分区文件 " << reads[k].path << "，该月份的数据暂不可用。\n";
+			allLoaded = false;
+			return;
+		}
+		part.recordCount = loaded; // 以实际加载的记录数为准 (可能跳过了无效记录)。
+		part.loaded = true;
+	});
+	return allLoaded;
+} // `loadPartitions` 函数结束。
+
+// 【`ensurePartitionsLoaded` 方法实现 - 加载与 [起始年月, 结束年月] 重叠的所有分区】
+// 期间之外的分区文件不会被打开 (分区裁剪)。有分区因容量不足未能加载时返回 `false`。
+bool ExpenseTracker::ensurePartitionsLoaded(int fromYear, int fromMonth, int toYear, int toMonth) {
+	int fromKey = fromYear * 12 + fromMonth; // 把年月折算成单个整数便于比较。
+	int toKey = toYear * 12 + toMonth;
+	vector<int> indices;
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		int key = partitions[p].year * 12 + partitions[p].month;
+		if (key >= fromKey && key <= toKey && !partitions[p].loaded) indices.push_back((int)p);
+	}
+	return loadPartitions(indices); // 一次读入，各文件同时读取
+} // `ensurePartitionsLoaded` 函数结束。
+
+// 【`ensureAllPartitionsLoaded` 方法实现 - 加载全部分区 (查看全部记录、删除记录时使用)】
+bool ExpenseTracker::ensureAllPartitionsLoaded() {
+	vector<int> indices;
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		if (!partitions[p].loaded) indices.push_back((int)p);
+	}
+	return loadPartitions(indices);
+} // `ensureAllPartitionsLoaded` 函数结束。
+
+// 【`adjustPartitionCount` 方法实现 - 增删记录后更新所在分区的记录数并标记为 dirty】
+// 调用方需保证该分区已加载 (或是新分区)，因此这里直接把分区视为已加载。
+void ExpenseTracker::adjustPartitionCount(int year, int month, int delta) {
+	int idx = getOrCreatePartition(year, month);
+	partitions[idx].recordCount += delta;
+	partitions[idx].loaded = true;
+	partitions[idx].dirty = true;
+} // `adjustPartitionCount` 函数结束。
+
+// 【`totalRecordCount` 方法实现 - 所有分区 (含未加载分区) 的记录总数】
+int ExpenseTracker::totalRecordCount() {
+	int total = 0;
+	for (size_t p = 0; p < partitions.size(); ++p) total += partitions[p].recordCount;
+	return total;
+} // `totalRecordCount` 函数结束。
+
+// 【`storeIndexForPosition` 方法实现 - 全局序号 -> 内存下标】
+// 全局序号按日期顺序给所有记录 (含未加载分区) 编号，从 0 开始。由分区清单中的记录数就能算出序号落在哪个分区，
+// 只需加载这一个分区；分区内的记录在有序存储中是连续的一段。加载失败或序号越界时返回 -1。
+int ExpenseTracker::storeIndexForPosition(int position) {
+	int start = 0; // 当前分区第一条记录的全局序号
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		int count = partitions[p].recordCount;
+		if (position < start + count) {
+			if (!ensurePartitionLoaded(partitions[p].year, partitions[p].month)) return -1;
+			return allExpenses.lowerBound(partitions[p].year * 10000 + partitions[p].month * 100) + (position - start);
+		}
+		start += count;
+	}
+	return -1;
+} // `storeIndexForPosition` 函数结束。
+
+// 【`positionForDate` 方法实现 - 第一条日期不早于给定日期的记录的全局序号】
+// 只加载该日期所在月份的分区；之后没有记录时返回记录总数。
+int ExpenseTracker::positionForDate(int year, int month, int day) {
+	int start = 0;
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		const PartitionInfo& part = partitions[p];
+		if (part.year * 100 + part.month < year * 100 + month) { // 整个分区都在该日期之前
+			start += part.recordCount;
+			continue;
+		}
+		if (part.year == year && part.month == month && ensurePartitionLoaded(year, month)) {
+			int monthStart = allExpenses.lowerBound(year * 10000 + month * 100);
+			start += allExpenses.lowerBound(year * 10000 + month * 100 + day) - monthStart; // 该月内早于该日的记录
+		}
+		break;
+	}
+	return start;
+} // `positionForDate` 函数结束。
+
+// 【`browseExpenses` 方法实现 - 分页浏览 (游标)】
+// 游标是当前页第一条记录的全局序号，每次只格式化当前页的记录。命令:
+//   n (或直接回车) 下一页，p 上一页，g YYYY-MM-DD 跳到该日期，s 条数 设置每页条数，q 返回；
+//   `selecting` 为 true 时还可以输入序号选择一条记录。
+// 返回所选记录的全局序号 (从 0 开始)，未选择时返回 -1。
+int ExpenseTracker::browseExpenses(bool selecting) {
+	int first = 0; // 游标
+	while (true) {
+		int total = totalRecordCount();
+		if (total == 0) {
+			cout << "没有开销记录。\n";
+			return -1;
+		}
+		if (first >= total) first = (total - 1) / pageSize * pageSize; // 记录减少后游标可能越界
+		int last = min(first + pageSize, total);
+		printExpenseHeader(true);
+		for (int pos = first; pos < last; ++pos) {
+			int index = storeIndexForPosition(pos);
+			if (index < 0) {
+				cerr << "错误：无法加载第 " << pos + 1 << " 条记录所在的分区。\n";
+				break;
+			}
+			cout << left << setw(5) << pos + 1;
+			printExpenseRow(allExpenses[index]);
+		}
+		printExpenseSeparator(true);
+		cout << "第 " << first / pageSize + 1 << "/" << (total + pageSize - 1) / pageSize << " 页，共 " << total << " 条记录。\n";
+		cout << "n 下一页  p 上一页  g YYYY-MM-DD 跳转  s 条数 每页条数";
+		if (selecting) cout << "  序号 选择记录";
+		cout << "  q 返回: ";
+
+		string line;
+		if (!getline(cin, line)) return -1; // 输入结束
+		stringstream ss(line);
+		string command;
+		ss >> command;
+		if (command.empty() || command == "n" || command == "N") {
+			if (last < total) first = last;
+			else cout << "已是最后一页。\n";
+		} else if (command == "p" || command == "P") {
+			if (first > 0) first = max(0, first - pageSize);
+			else cout << "已是第一页。\n";
+		} else if (command == "g" || command == "G") {
+			int y, m, d;
+			char dash1, dash2;
+			if (ss >> y >> dash1 >> m >> dash2 >> d && dash1 == '-' && dash2 == '-' && isValidDate(y, m, d)) {
+				first = positionForDate(y, m, d);
+			} else {
+				cout << "日期无效，应为 YYYY-MM-DD 格式的有效日期。\n";
+			}
+		} else if (command == "s" || command == "S") {
+			int size;
+			if (ss >> size && size > 0) pageSize = size;
+			else cout << "每页条数必须是正整数。\n";
+		} else if (command == "q" || command == "Q" || command == "0") {
+			return -1;
+		} else if (selecting && command.find_first_not_of("0123456789") == string::npos) {
+			int number = atoi(command.c_str());
+			if (number >= 1 && number <= total) return number - 1;
+			cout << "输入无效。请输入 1 到 " << total << " 之间的序号。\n";
+		} else {
+			cout << "无法识别的命令。\n";
+		}
+	}
+} // `browseExpenses` 函数结束。
+
+// 【`readLastSettlement` 方法实现 - 读取上次自动结算的年月】
+// `void ExpenseTracker::readLastSettlement(int& lastYear, int& lastMonth)` // 定义 `ExpenseTracker` 类的 `readLastSettlement` 私有成员方法。
+                                                                        // 这个方法用于从结算状态文件 (`SETTLEMENT_FILE`) 中读取上一次自动结算完成的年份和月份。
+                                                                        // 参数 `lastYear` 和 `lastMonth` 是整型引用 (`int&`)，
+                                                                        // 这意味着函数内部对这两个变量的修改会直接影响到调用该函数时传入的原始变量的值。
+void ExpenseTracker::readLastSettlement(int& lastYear, int& lastMonth) {
+	lastYear = 0;  // 将传入的 `lastYear` 引用参数初始化（或重置）为0。这作为一种默认值，如果文件读取失败或文件不存在，年份将保持为0。
+	lastMonth = 0; // 同样，将 `lastMonth` 初始化（或重置）为0。
+	// `ifstream inFile(SETTLEMENT_FILE);` // 创建一个输入文件流 `inFile`，并尝试打开名为 `SETTLEMENT_FILE` (常量，通常是 "settlement_status.txt") 的文件进行读取。
+	string text;
+	if (fileIO.readFile(SETTLEMENT_FILE, text)) { // 如果结算状态记录文件读取成功
+		istringstream inFile(text);
+		// `inFile >> lastYear >> lastMonth;` // 从文件内容中尝试读取两个整数，并分别存入 `lastYear` 和 `lastMonth` 变量中。
+		                                   // 期望文件中的格式是：年份 数字，然后是一个空格或换行，然后是月份 数字。
+		inFile >> lastYear >> lastMonth; // 读取上一次结算的年份和月份。
+	} // 文件读取操作结束。
+	// 如果文件未能读取（例如文件不存在），则函数体内的读取操作不会执行，
+	// `lastYear` 和 `lastMonth` 将保持它们被初始化时的值0。
+} // `readLastSettlement` 函数结束。
+
+// 【`writeLastSettlement` 方法实现 - 写入新的自动结算年月】
+// `void ExpenseTracker::writeLastSettlement(int year, int month)` // 定义 `ExpenseTracker` 类的 `writeLastSettlement` 私有成员方法。
+                                                               // 这个方法用于将指定的 `year` 和 `month` 作为新的结算点写入到结算状态文件 (`SETTLEMENT_FILE`) 中。
+                                                               // 这通常在一次自动结算完成后被调用，以记录当前结算到的进度。
+void ExpenseTracker::writeLastSettlement(int year, int month) {
+	// `ofstream outFile(SETTLEMENT_FILE);` // 创建一个输出文件流 `outFile`，并尝试打开 `SETTLEMENT_FILE` 进行写入。
+	                                      // 打开文件进行写入时，如果文件已存在，其原有内容通常会被清空（覆盖模式）。
+	// 文件内容: 年份、一个空格、月份，以换行结束。
+	if (!fileIO.writeFile(SETTLEMENT_FILE, to_string(year) + " " + to_string(month) + "\n")) { // 如果文件未能写入
+		// `cerr` // 标准错误输出流。
+		cerr << "错误：无法写入结算状态文件 " << SETTLEMENT_FILE << "\n"; // 向标准错误输出打印一条错误消息。
+	} // 文件写入操作结束。
+} // `writeLastSettlement` 函数结束。
+
+// 【`generateMonthlyReportForSettlement` 方法实现 - 为自动结算生成月度报告】
+// `void ExpenseTracker::generateMonthlyReportForSettlement(int year, int month)` // 定义 `ExpenseTracker` 类的 `generateMonthlyReportForSettlement` 私有成员方法。
+                                                                             // 这个函数的功能与 `displayMonthlySummary` 非常相似，都是生成指定年月的开销报告。
+                                                                             // 主要区别在于：
+                                                                             // 1. 它是私有的，主要由 `performAutomaticSettlement` 内部调用。
+                                                                             // 2. 输出的报告标题会明确指出这是"自动结算"生成的报告。
+                                                                             // 3. 它不直接从用户获取年月，而是通过参数传入。
+void ExpenseTracker::generateMonthlyReportForSettlement(int year, int month) {
+	// 报告格式见 `writeSettlementReport` (与后台结算写入日志的报告相同)；结算只会加载被结算月份的分区。
+	SettlementReport report = writeSettlementReport(cout, budgets, year, month, [this, year, month](auto& sink) {
+		runQuery(MatchMonth(year, month), sink);
+	});
+	// 【写入结算档案】之后重新打印该月报告时直接读取档案。
+	settlementArchive[year * 100 + month] = report;
+	saveSettlementArchive();
+} // `generateMonthlyReportForSettlement` 函数结束。
+
+// 【`performAutomaticSettlement` 方法实现 - 执行自动结算】
+// `void ExpenseTracker::performAutomaticSettlement()` // 定义 `ExpenseTracker` 类的 `performAutomaticSettlement` 公有成员方法。
+                                                     // 此方法在程序启动时（在构造函数中）被调用，用于自动检查并处理（生成报告）
+                                                     // 从上一次结算点到当前月份之前的所有未结算月份的开销数据。
+void ExpenseTracker::performAutomaticSettlement() {
+	int lastSettledYear, lastSettledMonth; // 声明变量，用于存储从结算文件中读取到的上一次结算的年份和月份。
+	readLastSettlement(lastSettledYear, lastSettledMonth); // 调用 `readLastSettlement` 方法，尝试读取上次的结算信息，结果会存入 `lastSettledYear` 和 `lastSettledMonth`。
+
+	// 【获取当前系统的年份和月份】
+	time_t now = time(0);                 // 获取当前时间的 `time_t` 表示。
+	tm *ltm = localtime(&now);            // 将 `time_t` 转换为 `tm` 结构体以获取本地时间。
+	int currentYear = 1900 + ltm->tm_year; // 当前公元年份。
+	int currentMonth = 1 + ltm->tm_mon;    // 当前月份 (1-12)。
+
+	// 【处理首次运行或无结算记录的情况】
+	// 如果 `readLastSettlement` 后 `lastSettledYear` 仍然是0 (其初始值)，
+	// 这通常意味着程序是首次运行，或者结算状态文件 (`SETTLEMENT_FILE`) 不存在或内容无效。
+	if (lastSettledYear == 0) { // 如果是首次运行或无有效结算记录
+		// 在这种情况下，需要设定一个"基准"的上次结算点。
+		// 这里的逻辑是将"上次结算点"设定为"当前月份的前一个月"。
+		// 这样做的目的是，当程序下次（或在后续的迭代中）执行自动结算时，它会从这个"上个月"开始检查，
+		// 而不是试图从一个非常遥远的过去（比如公元0年）开始检查，这避免了不必要的循环和处理。
+		lastSettledYear = currentYear;  // 先将上次结算年月设为当前年月。
+		lastSettledMonth = currentMonth;
+		if (lastSettledMonth == 1) { // 如果当前是1月份
+			lastSettledMonth = 12;   // 那么"上个月"就是去年的12月。
+			lastSettledYear--;       // 年份减1。
+		} else { // 如果当前不是1月份
+			lastSettledMonth--;      // "上个月"就是当前月份减1。
+		} // 上个月计算完毕。
+		// 将这个计算出来的"基准上次结算点"写入到结算状态文件中。
+		writeLastSettlement(lastSettledYear, lastSettledMonth);
+		// 向用户显示一条消息，告知已设置的基准结算点。
+		cout << "首次运行或无结算记录，已设置基准结算点为: "
+				  << lastSettledYear << "年" << setfill('0') << setw(2) << lastSettledMonth << setfill(' ') << "月。\n";
+		return; // 设置完基准点后，本次 `performAutomaticSettlement` 调用即结束，不再执行后续的追溯结算逻辑。
+	} // 首次运行处理结束。
+
+	// 【从上次记录的结算点开始，逐月列出要结算的月份，直到当前月份之前】结算本身交给后台线程 (见 BackgroundSettlement)。
+	// 初始化要开始检查结算的年份和月份，使用从文件中读取到的 `lastSettledYear` 和 `lastSettledMonth`。
+	unique_ptr<BackgroundSettlement> task(new BackgroundSettlement());
+	int yearToSettle = lastSettledYear;
+	int monthToSettle = lastSettledMonth;
+
+	// `while (true)` // 开始一个循环，这个循环会不断地将 `yearToSettle` 和 `monthToSettle` 向前推进一个月，
+	               // 并为每个推进后的月份生成报告，直到达到不需要再结算的条件。
+	while (true) {
+		// 首先，将要结算的月份向前推进一个月。
+		monthToSettle++; // 月份加1。
+		if (monthToSettle > 12) { // 如果月份超过12 (例如从12月变成13月)
+			monthToSettle = 1;    // 月份重置为1月。
+			yearToSettle++;       // 年份加1。
+		} // 月份和年份推进完毕。
+
+		// 【判断是否已追溯到不需要再结算的月份】
+		// 自动结算的目标是处理"过去"未结算的月份。
+		// 因此，如果 `yearToSettle` 已经超过了 `currentYear` (当前年份)，
+		// 或者，如果 `yearToSettle` 等于 `currentYear` 但 `monthToSettle` 已经等于或超过了 `currentMonth` (当前月份)，
+		// 这都意味着我们已经追溯到了当前月份或更远的未来，此时应该停止自动结算。
+		if (yearToSettle > currentYear || (yearToSettle == currentYear && monthToSettle >= currentMonth)) {
+			break; // `break;` 跳出当前的 `while (true)` 循环，自动结算过程结束。
+		} // 停止条件判断结束。
+
+		// 【为当前需要结算的 `yearToSettle` 和 `monthToSettle` 准备记录快照】
+		// 分区还没加载时由后台线程读取分区文件；已在内存中的记录 (旧版单文件数据) 直接复制，不涉及文件读取。
+		task->months.push_back(SettlementMonth(yearToSettle, monthToSettle));
+		int idx = findPartition(yearToSettle, monthToSettle);
+		if (idx >= 0 && !partitions[idx].loaded) {
+			task->months.back().partitionFile = partitionFilePath(yearToSettle, monthToSettle);
+		} else {
+			CollectSink snapshot(task->months.back().records);
+			runQuery(MatchMonth(yearToSettle, monthToSettle), snapshot);
+		}
+	} // `while (true)` 循环结束（当所有需要自动结算的月份都列出时）。
+	if (task->months.empty()) return; // 没有要补结算的月份
+
+	// 【启动后台结算】报告写入日志，结算状态文件由后台线程逐月更新。
+	task->budgets = budgets;
+	task->parseRecords = [](string_view text, vector<Expense>& records) { return parseRecordData(text, records, nullptr); };
+	const SettlementMonth& first = task->months.front();
+	const SettlementMonth& last = task->months.back();
+	cout << "正在后台结算 " << task->months.size() << " 个月 (" << first.year << "年" << first.month << "月 - "
+		 << last.year << "年" << last.month << "月)，报告写入 " << SETTLEMENT_LOG_FILE << "，完成后会在菜单上方提示。\n";
+	backgroundSettlement = move(task);
+	backgroundSettlement->start();
+} // `performAutomaticSettlement` 函数结束。
+
+// 【`collectBackgroundSettlement` 方法实现 - 取回后台结算的结果】
+// 主菜单每次显示前调用: 把已完成月份的结果写入结算档案；后台线程结束时等待它退出并告诉用户。
+void ExpenseTracker::collectBackgroundSettlement() {
+	if (!backgroundSettlement) return;
+	BackgroundSettlement& task = *backgroundSettlement;
+	vector<SettlementReport> results;
+	{
+		lock_guard<mutex> guard(task.resultLock);
+		results.swap(task.completed);
+	}
+	bool archiveChanged = false;
+	for (size_t k = 0; k < results.size(); ++k) {
+		int key = results[k].year * 100 + results[k].month;
+		if (settlementTouchedMonths.count(key)) continue; // 快照已过时
+		settlementArchive[key] = results[k];
+		archiveChanged = true;
+	}
+	if (archiveChanged) saveSettlementArchive();
+	if (!task.finished) return;
+
+	if (task.worker.joinable()) task.worker.join();
+	if (task.failed) {
+		cerr << "错误：后台结算无法读取分区文件或写入 " << SETTLEMENT_LOG_FILE << " 或 " << SETTLEMENT_FILE << "，已结算 " << task.settledCount << " 个月，其余月份下次启动时重试。\n";
+	} else if (task.settledCount < (int)task.months.size()) {
+		const SettlementMonth& next = task.months[task.settledCount];
+		cout << "后台结算已暂停，" << next.year << "年" << next.month << "月起的 " << task.months.size() - task.settledCount << " 个月下次启动时继续。\n";
+	} else {
+		cout << "\n>>> 后台结算完成: 共结算 " << task.settledCount << " 个月，报告已写入 " << SETTLEMENT_LOG_FILE << "。\n";
+	}
+	backgroundSettlement.reset();
+	settlementTouchedMonths.clear();
+} // `collectBackgroundSettlement` 函数结束。
+
+// 【`stopBackgroundSettlement` 方法实现 - 退出前停止后台结算】
+// 后台线程做完正在结算的月份后停下；SETTLEMENT_FILE 与日志保持一致，剩下的月份下次启动时继续。
+void ExpenseTracker::stopBackgroundSettlement() {
+	if (!backgroundSettlement) return;
+	backgroundSettlement->stopRequested = true;
+	backgroundSettlement->worker.join(); // 等后台线程做完当前月份并退出
+	collectBackgroundSettlement();
+} // `stopBackgroundSettlement` 函数结束。
+
+// 【`deleteExpense` 方法实现 - 删除指定的开销记录】
+// `void ExpenseTracker::deleteExpense()` // 定义 `ExpenseTracker` 类的 `deleteExpense` 公有成员方法。
+                                      // 此方法允许用户查看所有开销记录，并选择一条进行删除。
+void ExpenseTracker::deleteExpense() {
+	if (totalRecordCount() == 0) { // 首先检查当前是否有任何开销记录 (含未加载的分区)。
+		cout << "没有开销记录可供删除。\n"; // 如果没有记录，打印提示消息。
+		return; // 并从函数返回，不执行后续的删除逻辑。
+	} // 记录存在性检查结束。
+
+	cout << "\n--- 删除开销记录 ---\n"; // 打印功能标题。
+	cout << "翻页找到要删除的记录，输入它的序号 (q 取消):\n"; // 提示信息。
+	// 【分页选择要删除的记录】只加载并打印当前页，第一次提示出现的快慢与记录总数无关。
+	int position = browseExpenses(true); // 所选记录的全局序号 (从 0 开始)，取消时为 -1。
+	if (position < 0) { // 用户取消
+		cout << "取消删除操作。\n"; // 打印取消消息。
+		return; // 从 `deleteExpense` 函数返回，不执行任何删除。
+	} // 取消判断结束。
+
+	int indexToDelete = storeIndexForPosition(position); // 所选记录在内存存储中的下标 (所在分区此时已加载)。
+	if (indexToDelete < 0) {
+		cout << "错误：无法加载所选记录所在的分区。\n";
+		return;
+	}
+
+	// 【显示即将被删除的记录的详细信息，让用户进行第一次确认】
+	cout << "\n即将删除以下记录:\n"; // 提示信息。
+	printExpenseHeader(); // 打印表头 (不带序号列)
+	printExpenseRow(allExpenses[indexToDelete]); // 打印指定索引 `indexToDelete` 的那条开销记录的详细信息。
+	printExpenseSeparator(); // 末尾分隔线。
+
+	// 【第一次确认删除】
+	char confirm; // 声明一个字符变量 `confirm`，用于存储用户的确认输入 (y/n)。
+	cout << "确认删除吗？ (y/n): "; // 提示用户输入确认。
+	cin >> confirm; // 读取用户输入的单个字符到 `confirm`。
+	clearInputBuffer(); // 清除输入字符后的换行符。
+
+	// `if (confirm == 'y' || confirm == 'Y')` // 检查用户是否输入了 'y' 或 'Y' (表示同意删除)。
+	if (confirm == 'y' || confirm == 'Y') { // 如果用户第一次确认删除
+		// 【进行第二次最终确认 - 为了防止用户误操作，这是一个重要的安全措施】
+		cout << "\n警告：此操作无法撤销！\n"; // 打印警告信息。
+		cout << "最后一次确认，真的要删除这条记录吗？ (y/n): "; // 再次提示用户确认。
+		char final_confirm; // 声明字符变量 `final_confirm` 用于存储用户的最终确认。
+		cin >> final_confirm; // 读取最终确认输入。
+		clearInputBuffer(); // 清除换行符。
+
+		// `if (final_confirm == 'y' || final_confirm == 'Y')` // 检查用户是否再次输入了 'y' 或 'Y'。
+		if (final_confirm == 'y' || final_confirm == 'Y') { // 如果用户最终确认删除
+			cout << "\n正在删除记录...\n"; // 打印正在删除的消息。
+
+			// 【执行删除操作】`allExpenses.erase(indexToDelete)` 只在该记录所在的块内前移后续记录，
+			// 其余记录的相对顺序 (按日期) 不变。
+			int deletedYear = allExpenses[indexToDelete].getYear();   // 记下被删除记录所在的分区 (年月)，
+			int deletedMonth = allExpenses[indexToDelete].getMonth(); // 前移覆盖之后就拿不到了。
+			recordRemoved(allExpenses[indexToDelete]); // 从月度累计等内存索引中扣除该记录。
+			addTombstone(allExpenses[indexToDelete]); // 留下删除标记，同步时另一份账本也会删除它。
+			allExpenses.erase(indexToDelete); // 从有序存储中移除该记录。
+			// `expenseCount--;` // 将总的开销记录数 `expenseCount` 减1，因为已经删除了一条记录。
+			expenseCount--; // 更新记录总数。
+			adjustPartitionCount(deletedYear, deletedMonth, -1); // 所在分区记录数减1并标记为待保存。
+			invalidateSettlementCache(deletedYear, deletedMonth); // 该月的结算档案 (如果有) 作废。
+			cout << "记录已删除。\n"; // 打印删除成功的消息。
+			saveExpenses(); // 调用 `saveExpenses()` 方法，将删除操作后的数据（即更新后的 `allExpenses` 数组和 `expenseCount`）立即保存到文件中。
+			cout << "数据已自动保存。\n"; // 提示数据已保存。
+		} else { // `else` 分支：如果用户在最终确认时没有输入 'y' 或 'Y' (即取消了删除)
+			cout << "已取消删除操作（二次确认未通过）。\n"; // 打印取消消息。
+		} // 最终确认结束。
+	} else { // `else` 分支：如果用户在第一次确认时没有输入 'y' 或 'Y' (即取消了删除)
+		cout << "取消删除操作。\n"; // 打印取消消息。
+	} // 第一次确认结束。
+} // `deleteExpense` 函数结束。
+
+// 【`memoryReport` 方法实现 - 内存使用报告】
+// 各子系统的当前占用、峰值和分配/释放次数，以及每条已加载记录平均占用的字节数 (记录本身 + 描述和类别字符串)。
+void ExpenseTracker::memoryReport() {
+	cout << "\n--- 内存使用报告 ---\n";
+	int64_t total = 0;
+	for (int s = 0; s < MEMORY_SUBSYSTEM_COUNT; ++s) {
+		const MemoryCounter& counter = memoryCounters[s];
+		total += counter.bytes.load();
+		cout << MEMORY_SUBSYSTEM_NAMES[s] << ": 当前 " << formatMemoryBytes(counter.bytes.load()) << "，峰值 " << formatMemoryBytes(counter.peak.load())
+			 << "，分配 " << counter.allocations.load() << " 次，释放 " << counter.deallocations.load() << " 次\n";
+	}
+	cout << "合计: 当前 " << formatMemoryBytes(total) << "\n";
+	if (expenseCount > 0) {
+		int64_t records = memoryCounters[MEMORY_RECORDS].bytes.load();
+		int64_t strings = memoryCounters[MEMORY_STRINGS].bytes.load();
+		int64_t indexes = memoryCounters[MEMORY_INDEXES].bytes.load();
+		cout << fixed << setprecision(1) << "已加载 " << expenseCount << " 条记录，平均每条: 记录 " << (double)records / expenseCount
+			 << " 字节 (sizeof(Expense) = " << sizeof(Expense) << ")，字符串 " << (double)strings / expenseCount
+			 << " 字节，索引 " << (double)indexes / expenseCount << " 字节。\n" << defaultfloat << setprecision(6);
+	}
+	cout << "(未加载的分区不占内存；查看全部数据前可先用批处理 --memory-report 加载全部分区后统计)\n";
+} // `memoryReport` 函数结束。
+
+// 【`checkAnomaly` 方法实现 - 用一条新记录更新其类别的滚动统计，并判断金额是否异常】
+// 先与更新前的统计比较，再把金额计入统计 (异常金额同样计入，类别的消费水平真的改变时会逐渐适应)。
+// 只对新添加和导入的记录调用；从磁盘加载的历史记录不经过这里。异常时记入 `anomalyFlags`，并复制到 `flag` (若非空)。
+bool ExpenseTracker::checkAnomaly(const Expense& e, AnomalyFlag* flag) {
+	double cents = (double)llround(e.getAmount() * 100);
+	CategoryTrend& trend = categoryTrends[e.getCategory()];
+	bool outlier = trend.isOutlier(cents);
+	if (outlier) {
+		AnomalyFlag& entry = anomalyFlags[e.getId()];
+		entry.id = e.getId();
+		entry.date = dateKey(e);
+		entry.cents = llround(cents);
+		entry.expectedCents = llround(trend.mean);
+		entry.category = e.getCategory();
+		if (flag) *flag = entry;
+	}
+	trend.update(cents);
+	anomalyStateChanged = true;
+	return outlier;
+} // `checkAnomaly` 函数结束。
+
+// 【`loadAnomalyState` 方法实现 - 读取各类别的滚动统计与异常标记】
+// 文件格式: 第一行为类别数，之后每行 "记录数<TAB>均值<TAB>方差<TAB>类别"；
+// 接着一行为标记数，之后每行 "编号(十六进制)<TAB>日期<TAB>金额(分)<TAB>当时均值(分)<TAB>类别"。
+void ExpenseTracker::loadAnomalyState() {
+	string text;
+	if (!fileIO.readFile(ANOMALY_FILE, text)) return; // 尚无文件，统计从之后添加的记录开始积累
+	istringstream inFile(text);
+	string line;
+	int count = -1;
+	bool valid = getline(inFile, line) && (count = atoi(line.c_str())) >= 0;
+	for (int i = 0; valid && i < count; ++i) {
+		CategoryTrend trend;
+		string category;
+		valid = getline(inFile, line) && sscanf(line.c_str(), "%ld\t%lf\t%lf\t", &trend.count, &trend.mean, &trend.variance) == 3;
+		size_t tab = line.rfind('\t');
+		if (valid && tab != string::npos && tab + 1 < line.size()) categoryTrends[line.substr(tab + 1)] = trend;
+	}
+	valid = valid && getline(inFile, line) && (count = atoi(line.c_str())) >= 0;
+	for (int i = 0; valid && i < count; ++i) {
+		AnomalyFlag flag;
+		unsigned long long id;
+		valid = getline(inFile, line) && sscanf(line.c_str(), "%llx\t%d\t%lld\t%lld\t", &id, &flag.date, &flag.cents, &flag.expectedCents) == 4;
+		size_t tab = line.rfind('\t');
+		if (!valid || tab == string::npos) break;
+		flag.id = id;
+		flag.category = line.substr(tab + 1);
+		anomalyFlags[flag.id] = flag;
+	}
+	if (!valid) cerr << "警告：异常统计文件 " << ANOMALY_FILE << " 不完整，已读取其中有效的部分。\n";
+} // `loadAnomalyState` 函数结束。
+
+// 【`anomalyFileText` 方法实现 - 生成异常统计文件的内容】格式见 `loadAnomalyState`。
+string ExpenseTracker::anomalyFileText() {
+	ostringstream out;
+	out << setprecision(17) << categoryTrends.size() << "\n";
+	for (const auto& entry : categoryTrends) {
+		out << entry.second.count << "\t" << entry.second.mean << "\t" << entry.second.variance << "\t" << entry.first << "\n";
+	}
+	out << anomalyFlags.size() << "\n";
+	for (const auto& entry : anomalyFlags) {
+		const AnomalyFlag& flag = entry.second;
+		out << hex << flag.id << dec << "\t" << flag.date << "\t" << flag.cents << "\t" << flag.expectedCents << "\t" << flag.category << "\n";
+	}
+	return out.str();
+} // `anomalyFileText` 函数结束。
+
+// 【`anomalyReport` 方法实现 - 按月列出被标记的异常开销】只读异常标记，不加载任何分区。
+void ExpenseTracker::anomalyReport() {
+	cout << "\n--- 异常开销报告 ---\n";
+	cout << "(金额同时高于该类别近期均值的 " << ANOMALY_MIN_RATIO << " 倍和 " << ANOMALY_SIGMAS << " 个标准差；类别至少有 "
+		 << ANOMALY_MIN_SAMPLES << " 条新记录后才开始判断)\n";
+	if (anomalyFlags.empty()) {
+		cout << "没有被标记的异常开销。\n";
+		return;
+	}
+	vector<const AnomalyFlag*> flags;
+	for (const auto& entry : anomalyFlags) flags.push_back(&entry.second);
+	stable_sort(flags.begin(), flags.end(), [](const AnomalyFlag* a, const AnomalyFlag* b) { return a->date < b->date; });
+	cout << fixed << setprecision(2);
+	for (size_t k = 0; k < flags.size(); ) {
+		int month = flags[k]->date / 100;
+		size_t end = k;
+		while (end < flags.size() && flags[end]->date / 100 == month) ++end;
+		cout << month / 100 << " 年 " << setw(2) << setfill('0') << month % 100 << setfill(' ') << " 月 (" << end - k << " 条)\n";
+		for (; k < end; ++k) {
+			const AnomalyFlag& flag = *flags[k];
+			double ratio = flag.expectedCents > 0 ? (double)flag.cents / flag.expectedCents : 0;
+			cout << "  " << flag.date / 10000 << "-" << setw(2) << setfill('0') << flag.date / 100 % 100 << "-" << setw(2) << flag.date % 100 << setfill(' ')
+				 << "  " << flag.category << "  " << flag.cents / 100.0 << " (近期均值 " << flag.expectedCents / 100.0;
+			if (ratio > 0) cout << "，" << setprecision(1) << ratio << " 倍" << setprecision(2);
+			cout << ")  编号 " << hex << flag.id << dec << "\n";
+		}
+	}
+	cout << "共 " << flags.size() << " 条。\n" << defaultfloat << setprecision(6);
+} // `anomalyReport` 函数结束。
+
+// 【`dataToolsMenu` 方法实现 - 数据工具子菜单】
+// 结构与 `listExpensesByPeriod` 的子菜单相同: 循环显示选项，直到用户输入 0 返回主菜单。
+void ExpenseTracker::dataToolsMenu() {
+	int choice; // 子菜单选项。
+	do {
+		cout << "\n--- 数据工具 ---\n";
+		cout << "1. 导出为列式文件 (Arrow IPC 风格)\n";
+		cout << "2. 从列式文件导入\n";
+		cout << "3. 查看重复记录\n";
+		cout << "4. 重复记录处理策略\n";
+		cout << "5. 与另一份账本同步\n";
+		cout << "6. 导入银行流水 (CSV)\n";
+		cout << "7. 合并多份账本 (家庭报告或合并账本)\n";
+		cout << "8. 大账本外部排序 / 年度汇总\n";
+		cout << "9. 建立位图索引\n";
+		cout << "10. 内存使用报告\n";
+		cout << "11. 异常开销报告\n";
+		cout << "0. 返回主菜单\n";
+		cout << "--------------------\n";
+		cout << "请输入选项: ";
+
+		cin >> choice; // 读取选项。
+		if (cin.fail()) { // 输入验证 (与主菜单相同)
+			cin.clear();
+			clearInputBuffer();
+			choice = -1;
+		} else {
+			clearInputBuffer();
+		}
+
+		switch (choice) {
+			case 1: exportColumnar(); break; // 列式导出
+			case 2: importColumnar(); break; // 列式导入
+			case 3: showDuplicates(); break; // 重复记录报告
+			case 4: duplicatePolicyMenu(); break; // 添加/导入时的重复处理策略
+			case 5: syncMenu(); break; // 双向同步
+			case 6: importCsvMenu(); break; // 银行流水 CSV 导入
+			case 7: mergeMenu(); break; // 多账本 k 路归并
+			case 8: outOfCoreMenu(); break; // 超出内存的账本: 外部排序与流式汇总
+			case 9: rebuildBitmapIndex(); break; // 为所有分区建立并保存位图索引
+			case 10: memoryReport(); break; // 各子系统的内存占用
+			case 11: anomalyReport(); break; // 按月列出被标记的异常开销
+			case 0: cout << "返回主菜单...\n"; break;
+			default: cout << "无效选项，请重试。\n";
+		}
+	} while (choice != 0);
+} // `dataToolsMenu` 函数结束。
+
+/*
+【列式文件格式 (Arrow IPC 风格)】
+与 Arrow 的列式内存布局一致: 每一列是一段连续的定宽缓冲区，变长字符串列由 int32 偏移数组 + utf8 数据缓冲区组成，
+类别列做字典编码 (int32 下标 + 字典字符串)。所有整数均为小端字节序，每个缓冲区按 8 字节对齐，
+分析工具可以把缓冲区直接映射成列，无需逐行解析。
+文件结构:
+  魔数 "EXPARW1\0" (8 字节)
+  uint32 版本号 (1), uint32 列数 (4)
+  int64  行数, int64 类别字典大小
+  列描述 x4: uint8 类型码, uint8 名称长度, 名称 (utf8)，整体补齐到 8 字节
+      date     date32 (自 1970-01-01 起的天数)
+      amount   int64  (金额，单位: 分)
+      category dictionary<int32, utf8>
+      description utf8
+  缓冲区 x7: int64 字节长度 + 数据 (补齐到 8 字节)
+      [0] date 值  [1] amount 值  [2] category 下标  [3] 字典偏移  [4] 字典数据  [5] description 偏移  [6] description 数据
+*/
+const char COLUMNAR_MAGIC[8] = { 'E', 'X', 'P', 'A', 'R', 'W', '1', '\0' };
+const uint8_t COLUMN_TYPE_DATE32 = 1;
+const uint8_t COLUMN_TYPE_INT64 = 2;
+const uint8_t COLUMN_TYPE_DICT_UTF8 = 3;
+const uint8_t COLUMN_TYPE_UTF8 = 4;
+
+// 【列式文件写入辅助函数】写入一个按 8 字节对齐的缓冲区: 先写长度，再一次性写出整块数据和补齐字节。
+void writeColumnBuffer(ofstream& outFile, const void* data, int64_t byteLength) {
+	static const char padding[8] = { 0 };
+	outFile.write((const char*)&byteLength, sizeof(byteLength));
+	if (byteLength > 0) outFile.write((const char*)data, byteLength);
+	outFile.write(padding, (8 - byteLength % 8) % 8);
+}
+
+// 【`exportColumnar` 方法实现 - 导出为列式文件】
+// 先用一次遍历把记录拆成各列的连续缓冲区，再把每一列整块写出 (每列一次 write 调用)，
+// 写文件阶段不再有逐行格式化，导出大账本时耗时主要取决于磁盘写入。
+void ExpenseTracker::exportColumnar() {
+	if (!ensureAllPartitionsLoaded()) { // 导出全部记录。
+		cout << "错误：部分月份的数据未能加载，已取消导出。\n";
+		return;
+	}
+	string path;
+	cout << "输入导出文件名 [默认: " << COLUMNAR_FILE << "]: ";
+	getline(cin, path);
+	if (path.empty()) path = COLUMNAR_FILE;
+
+	// 【按列构建缓冲区】
+	vector<int32_t> dates(expenseCount);            // date32 列
+	vector<int64_t> cents(expenseCount);            // int64 金额列 (分)
+	vector<int32_t> categoryIds(expenseCount);      // 类别字典下标
+	vector<int32_t> dictOffsets(1, 0);              // 字典字符串偏移 (首元素为 0)
+	string dictData;                                // 字典字符串数据
+	vector<string> dictionary;                      // 字典 (用于查找已有类别)
+	vector<int32_t> descOffsets(expenseCount + 1);  // 描述偏移
+	string descData;                                // 描述数据
+	descOffsets[0] = 0;
+	for (int i = 0; i < expenseCount; ++i) {
+		const Expense& e = allExpenses[i];
+		dates[i] = daysFromCivil(e.getYear(), e.getMonth(), e.getDay());
+		cents[i] = llround(e.getAmount() * 100);
+		int id = -1; // 在字典中查找类别 (类别数很少，线性查找即可)
+		for (size_t k = 0; k < dictionary.size(); ++k) {
+			if (dictionary[k] == e.getCategory()) { id = (int)k; break; }
+		}
+		if (id < 0) { // 新类别加入字典
+			id = (int)dictionary.size();
+			dictionary.push_back(e.getCategory());
+			dictData += e.getCategory();
+			dictOffsets.push_back((int32_t)dictData.size());
+		}
+		categoryIds[i] = id;
+		descData += e.getDescription();
+		descOffsets[i + 1] = (int32_t)descData.size();
+	}
+
+	ofstream outFile(path, ios::binary); // 以二进制方式写入。
+	if (!outFile) {
+		cerr << "错误：无法打开文件 " << path << " 进行写入！\n";
+		return;
+	}
+	// 【文件头与列描述】
+	uint32_t version = 1, columnCount = 4;
+	int64_t rowCount = expenseCount, dictSize = (int64_t)dictionary.size();
+	outFile.write(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+	outFile.write((const char*)&version, sizeof(version));
+	outFile.write((const char*)&columnCount, sizeof(columnCount));
+	outFile.write((const char*)&rowCount, sizeof(rowCount));
+	outFile.write((const char*)&dictSize, sizeof(dictSize));
+	const char* names[4] = { "date", "amount", "category", "description" };
+	const uint8_t types[4] = { COLUMN_TYPE_DATE32, COLUMN_TYPE_INT64, COLUMN_TYPE_DICT_UTF8, COLUMN_TYPE_UTF8 };
+	string schema; // 列描述先拼在内存里，整体补齐后一次写出。
+	for (int c = 0; c < 4; ++c) {
+		schema += (char)types[c];
+		schema += (char)strlen(names[c]);
+		schema += names[c];
+	}
+	schema.append((8 - schema.size() % 8) % 8, '\0');
+	outFile.write(schema.data(), schema.size());
+	// 【各列缓冲区】
+	writeColumnBuffer(outFile, dates.data(), (int64_t)dates.size() * sizeof(int32_t));
+	writeColumnBuffer(outFile, cents.data(), (int64_t)cents.size() * sizeof(int64_t));
+	writeColumnBuffer(outFile, categoryIds.data(), (int64_t)categoryIds.size() * sizeof(int32_t));
+	writeColumnBuffer(outFile, dictOffsets.data(), (int64_t)dictOffsets.size() * sizeof(int32_t));
+	writeColumnBuffer(outFile, dictData.data(), (int64_t)dictData.size());
+	writeColumnBuffer(outFile, descOffsets.data(), (int64_t)descOffsets.size() * sizeof(int32_t));
+	writeColumnBuffer(outFile, descData.data(), (int64_t)descData.size());
+	outFile.close();
+	if (!outFile) {
+		cerr << "错误：写入文件 " << path << " 失败！\n";
+		return;
+	}
+	cout << "已导出 " << expenseCount << " 条记录 (" << dictionary.size() << " 个类别) 到 " << path << "。\n";
+} // `exportColumnar` 函数结束。
+
+// 【列式文件读取辅助函数】从内存中的文件内容读取一个缓冲区，检查长度是否越界。
+// 成功时 `data` 指向缓冲区起点 (直接引用文件内容，不复制)，`pos` 前进到下一个缓冲区。
+bool readColumnBuffer(const TrackedVector<char, MEMORY_IO_BUFFERS>& file, size_t& pos, const char*& data, int64_t& byteLength) {
+	if (pos + sizeof(int64_t) > file.size()) return false;
+	memcpy(&byteLength, &file[pos], sizeof(byteLength));
+	pos += sizeof(byteLength);
+	if (byteLength < 0 || (uint64_t)byteLength > file.size() - pos) return false;
+	data = file.data() + pos;
+	pos += byteLength + (8 - byteLength % 8) % 8;
+	return true;
+}
+
+// 【`importColumnar` 方法实现 - 从列式文件导入】
+// 整个文件一次读入内存，各列直接在文件缓冲区上按下标访问。
+// date32 列换算回的年月日总是合法的日历日期 (年份超出 1-9999 的行会被拒绝)；每行另外检查下标/偏移是否越界、金额是否为负，描述和类别按 `loadExpenses()` 的规则截断。
+void ExpenseTracker::importColumnar() {
+	string path;
+	cout << "输入要导入的文件名 [默认: " << COLUMNAR_FILE << "]: ";
+	getline(cin, path);
+	if (path.empty()) path = COLUMNAR_FILE;
+
+	ifstream inFile(path, ios::binary | ios::ate); // 打开并定位到末尾以获取文件大小。
+	if (!inFile) {
+		cerr << "错误：无法打开文件 " << path << "！\n";
+		return;
+	}
+	TrackedVector<char, MEMORY_IO_BUFFERS> file((size_t)inFile.tellg());
+	inFile.seekg(0);
+	inFile.read(file.data(), file.size()); // 一次读入整个文件。
+	inFile.close();
+
+	// 【校验文件头】
+	const size_t headerSize = 8 + 4 + 4 + 8 + 8;
+	uint32_t version = 0, columnCount = 0;
+	int64_t rowCount = 0, dictSize = 0;
+	if (file.size() < headerSize || memcmp(file.data(), COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) != 0) {
+		cerr << "错误：" << path << " 不是有效的列式导出文件。\n";
+		return;
+	}
+	memcpy(&version, &file[8], 4);
+	memcpy(&columnCount, &file[12], 4);
+	memcpy(&rowCount, &file[16], 8);
+	memcpy(&dictSize, &file[24], 8);
+	if (version != 1 || columnCount != 4 || rowCount < 0 || dictSize < 0) {
+		cerr << "错误：不支持的列式文件版本或列结构。\n";
+		return;
+	}
+	size_t pos = headerSize;
+	size_t schemaSize = 0; // 跳过列描述 (列的顺序与类型在版本 1 中是固定的)
+	for (uint32_t c = 0; c < columnCount; ++c) {
+		if (pos + schemaSize + 2 > file.size()) { cerr << "错误：列描述不完整。\n"; return; }
+		schemaSize += 2 + (uint8_t)file[pos + schemaSize + 1];
+	}
+	pos += schemaSize + (8 - schemaSize % 8) % 8;
+
+	// 【定位各列缓冲区】
+	const char* buffers[7];
+	int64_t lengths[7];
+	for (int b = 0; b < 7; ++b) {
+		if (!readColumnBuffer(file, pos, buffers[b], lengths[b])) {
+			cerr << "错误：列缓冲区 " << b << " 不完整或越界。\n";
+			return;
+		}
+	}
+	if (lengths[0] != rowCount * 4 || lengths[1] != rowCount * 8 || lengths[2] != rowCount * 4 ||
+		lengths[3] != (dictSize + 1) * 4 || lengths[5] != (rowCount + 1) * 4) {
+		cerr << "错误：列长度与行数不一致。\n";
+		return;
+	}
+
+	if (!ensureAllPartitionsLoaded()) { // 导入的记录可能落在任何月份，先读入全部分区。
+		cerr << "错误：部分月份的数据未能加载，已取消导入。\n";
+		return;
+	}
+	if (expenseCount + rowCount > MAX_EXPENSES) {
+		cerr << "错误：导入 " << rowCount << " 条记录将超出容量 (" << MAX_EXPENSES << ")。\n";
+		return;
+	}
 
-// 【`addExpense` 方法实现 - 添加新的开销记录】
-// `void ExpenseTracker::addExpense()` // 定义 `ExpenseTracker` 类的 `addExpense` 成员方法。
-void ExpenseTracker::addExpense() {
-	// 【检查容量是否已满】
-	// `if (expenseCount >= MAX_EXPENSES)` // 检查当前已存储的开销数量 `expenseCount` 是否已经达到或超过了预设的最大容量 `MAX_EXPENSES`。
-	                                    // `MAX_EXPENSES` 是一个全局常量，定义了 `allExpenses` 数组的大小。
-	if (expenseCount >= MAX_EXPENSES) { // 如果记录已满
-		cout << "错误：开销记录已满！无法添加更多记录。\n"; // 打印错误消息。
-		return; // `return;` 语句立即从当前函数 (`addExpense`) 返回，不再执行后续的添加逻辑。
-	} // 容量检查结束。
+	int imported = 0, rejected = 0, anomalies = 0;
+	int skipped = 0, flagged = 0, merged = 0; // 重复记录按策略处理的条数
+	vector<Expense> pending;           // 已通过检查、等待批量插入的记录
+	unordered_set<uint64_t> pendingKeys; // 它们的重复检测键
+	auto flushPending = [&]() {
+		insertRecords(pending); // 分配新编号；所在分区标记为待保存，已结算月份的档案作废。
+		for (size_t k = 0; k < pending.size(); ++k) {
+			if (checkAnomaly(pending[k])) anomalies++;
+		}
+		pending.clear();
+		pendingKeys.clear();
+	};
+	for (int64_t i = 0; i < rowCount; ++i) {
+		int32_t days, categoryId, descBegin, descEnd;
+		int64_t amountCents;
+		memcpy(&days, buffers[0] + i * 4, 4);
+		memcpy(&amountCents, buffers[1] + i * 8, 8);
+		memcpy(&categoryId, buffers[2] + i * 4, 4);
+		memcpy(&descBegin, buffers[5] + i * 4, 4);
+		memcpy(&descEnd, buffers[5] + (i + 1) * 4, 4);
+		if (categoryId < 0 || categoryId >= dictSize || descBegin < 0 || descEnd < descBegin || descEnd > lengths[6]) {
+			rejected++; // 下标或偏移越界
+			continue;
+		}
+		int32_t catBegin, catEnd;
+		memcpy(&catBegin, buffers[3] + categoryId * 4, 4);
+		memcpy(&catEnd, buffers[3] + (categoryId + 1) * 4, 4);
+		if (catBegin < 0 || catEnd < catBegin || catEnd > lengths[4]) { rejected++; continue; }
 
-	// 【声明用于存储用户输入的局部变量】
-	int year, month, day;    // `int` 类型变量，分别用于存储用户输入的年份、月份和日期。
-	string description;      // `string` 类型变量 (来自 `<string>` 库)，用于存储开销的文字描述。
-	double amount;           // `double` 类型变量，用于存储开销的金额 (可以包含小数)。
-	string category;         // `string` 类型变量，用于存储开销的类别。
-	string line_input;       // `string` 类型变量，用于临时存储用户通过 `getline` 输入的一整行文本。
-	                         // 使用它是因为 `getline` 可以读取包含空格的输入，而 `cin >> ...` 遇到空格会停止。
+		int year, month, day;
+		civilFromDays(days, year, month, day);
+		string description = sanitizeRecordField(string(buffers[6] + descBegin, descEnd - descBegin)); // 与 CSV 导入相同的清理
+		string category = sanitizeRecordField(string(buffers[4] + catBegin, catEnd - catBegin));
+		if (amountCents < 0) { rejected++; continue; } // 与 addExpense 相同: 金额不能为负
+		if (description.length() > Expense::MAX_DESCRIPTION_LENGTH) description = description.substr(0, Expense::MAX_DESCRIPTION_LENGTH);
+		if (category.length() > Expense::MAX_CATEGORY_LENGTH) category = category.substr(0, Expense::MAX_CATEGORY_LENGTH);
+		category = normalizeCategory(category); // 按别名表合并同义类别，保持字典紧凑
 
-	cout << "\n--- 添加新开销 (输入 '-1' 作为数字或 '!cancel' 作为文本可取消) ---\n"; // 打印一个提示标题，告知用户如何取消操作。
+		optional<Expense> created = Expense::create(year, month, day, description, amountCents / 100.0, category);
+		if (!created) { rejected++; continue; } // 日期不存在或年份超出 1-9999
+		const Expense& record = *created;
+		if (pendingKeys.count(duplicateKey(record))) flushPending(); // 可能与本批尚未插入的记录重复: 先插入，再比较
+		DuplicateAction action = resolveDuplicate(record); // 与已有记录及本次已导入的记录比较
+		if (action == DUPLICATE_SKIPPED) { skipped++; continue; }
+		if (action == DUPLICATE_MERGED) { merged++; continue; }
+		if (action == DUPLICATE_FLAGGED) flagged++;
+		pendingKeys.insert(duplicateKey(record));
+		pending.push_back(record);
+		imported++;
+	}
+	flushPending();
+	cout << "已从 " << path << " 导入 " << imported << " 条记录";
+	if (rejected > 0) cout << "，跳过 " << rejected << " 条无效记录";
+	if (skipped > 0) cout << "，跳过 " << skipped << " 条重复记录";
+	if (merged > 0) cout << "，合并 " << merged << " 条重复记录";
+	if (flagged > 0) cout << "，其中 " << flagged << " 条疑似重复 (见 查看重复记录)";
+	if (anomalies > 0) cout << "，" << anomalies << " 条金额异常 (见 异常开销报告)";
+	cout << "。保存后生效。\n";
+} // `importColumnar` 函数结束。
 
-	// 【获取当前系统日期，用作后续输入的默认值】
-	// `time_t` // 是一种算术类型，用于表示时间，通常是自某个固定点（如1970年1月1日 UTC）以来的秒数。
-	// `now`    // 声明一个 `time_t` 类型的变量 `now`。
-	// `time(0)`// `time()` 函数 (来自 `<ctime>` 头文件) 返回当前日历时间。参数 `0` (或 `nullptr`) 是常见的用法。
-	time_t now = time(0); // 获取当前时间的秒数表示。
-	// `tm`       // 是一个结构体 (定义在 `<ctime>` 中)，用于存储日历时间的各个组成部分 (年、月、日、时、分、秒等)。
-	// `*ltm`     // 声明一个指向 `tm` 结构体的指针 `ltm`。
-	// `localtime(&now)` // `localtime()` 函数将 `time_t` 类型的时间（`now` 的地址 `&now` 所指向的值）转换为本地时间的 `tm` 结构体形式。
-	                    // 它返回一个指向内部静态分配的 `tm` 结构体的指针。
-	tm *ltm = localtime(&now); // 将秒数转换为本地时间的 `tm` 结构体。
-	// 从 `tm` 结构体中提取当前的年、月、日信息，用于默认值。
-	// `ltm->tm_year` // `tm` 结构体中的 `tm_year` 成员表示的是从1900年开始的年数。
-	int currentYear = 1900 + ltm->tm_year; // 所以需要加上1900得到实际的公元年份。
-	// `ltm->tm_mon`  // `tm_mon` 成员表示月份，范围是 0 (一月) 到 11 (十二月)。
-	int currentMonth = 1 + ltm->tm_mon;    // 所以需要加1得到实际的月份 (1-12)。
-	// `ltm->tm_mday` // `tm_mday` 成员表示月份中的日期，范围是 1 到 31。
-	int currentDay = ltm->tm_mday;       // 这个值可以直接使用。
+// 【`importCsv` 方法实现 - 导入银行流水 CSV】流水线结构见 SpscQueue 上方的说明。
+// 第一行必须是表头。导入的记录插入内存，由调用方决定何时保存。返回 false 表示文件无法打开或表头无法识别。
+bool ExpenseTracker::importCsv(const string& path, bool negativeIsExpense) {
+	ifstream inFile(path, ios::binary);
+	if (!inFile) {
+		cerr << "错误：无法打开文件 " << path << "！\n";
+		return false;
+	}
+	string headerLine;
+	if (!getline(inFile, headerLine)) {
+		cerr << "错误：" << path << " 是空文件。\n";
+		return false;
+	}
+	CsvLayout layout;
+	layout.negativeIsExpense = negativeIsExpense;
+	layout.delimiter = detectCsvDelimiter(headerLine);
+	vector<string> header;
+	splitCsvLine(headerLine, layout.delimiter, header);
+	string error;
+	if (!mapCsvColumns(header, layout, error)) {
+		cerr << "错误：" << error << "。\n";
+		return false;
+	}
+	for (const auto& entry : categoryIds) layout.categoryAliases[entry.first] = categoryNames[entry.second];
 
-	// 【获取年份输入】
-	// `cout << ...`: 打印提示信息，包括当前的默认年份以及如何取消。
-	cout << "输入年份 (YYYY) [默认: " << currentYear << ", -1 取消]: ";
-	// `getline(cin, line_input);` // 使用 `getline` 函数从标准输入 `cin` 读取一整行用户输入 (直到用户按下回车)，
-	                               // 并将读取的内容存储到 `line_input` 字符串变量中。
-	                               // 这与 `cin >> year;` 不同，`getline` 可以读取包含空格的行，并且会读取并丢弃行尾的换行符。
-	getline(cin, line_input); // 读取用户输入的整行年份信息。
-	// `if (line_input == "-1")`: 检查用户是否输入了 "-1" 来取消操作。
-	if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 如果是，打印取消消息并从函数返回。
-	// `if (!line_input.empty())`: 检查用户是否输入了内容 (即 `line_input` 字符串不是空的)。
-	                             // 如果用户只是直接按了回车，`line_input` 会是空的。
-	if (!line_input.empty()) { // 如果用户输入了非空内容
-		// `stringstream` // (来自 `<sstream>` 头文件) 允许你像处理输入/输出流 (`cin`/`cout`) 一样处理内存中的字符串。
-		// `ss(line_input)` // 创建一个名为 `ss` 的 `stringstream` 对象，并将用户输入的 `line_input` 字符串的内容放入这个流中。
-		stringstream ss(line_input); // 用用户输入行创建一个字符串流。
-		// `!(ss >> year)` // 尝试从字符串流 `ss` 中提取一个整数到 `year` 变量。
-		                 // 如果提取失败 (例如，`line_input` 中包含非数字字符，或者为空)，这个表达式的结果为 `true`。
-		// `!ss.eof()`   // `eof()` (end-of-file) 成员函数检查流是否到达了末尾。
-		                 // `!ss.eof()` 为 `true` 意味着在成功提取整数 `year` 之后，字符串流 `ss` 中还有剩余的未被读取的非空白字符。
-		                 // 我们希望年份输入是纯数字，所以这种情况也视为无效。
-		if (!(ss >> year) || !ss.eof()) { // 如果提取年份失败，或者提取后仍有非数字残留
-			cout << "年份输入无效或包含非数字字符，将使用默认年份: " << currentYear << "。\n"; // 打印错误消息。
-			year = currentYear; // 将 `year` 设置为之前获取的当前系统年份作为默认值。
-		} // 年份解析和验证结束。
-	} else { // `else` 分支：如果 `line_input.empty()` 为 `true` (即用户直接按了回车，没有输入任何内容)
-		year = currentYear; // 使用当前系统年份作为默认值。
-	} // 年份输入处理完毕。
+	auto started = chrono::steady_clock::now();
+	unsigned workerCount = min(max(thread::hardware_concurrency(), 3u) - 2, CSV_MAX_WORKERS); // 留出读取线程和主线程
+	vector<unique_ptr<SpscQueue<CsvChunk> > > toWorkers;  // 读取线程 -> 各解析线程
+	vector<unique_ptr<SpscQueue<CsvBatch> > > toWriter;   // 各解析线程 -> 主线程
+	for (unsigned w = 0; w < workerCount; ++w) {
+		toWorkers.emplace_back(new SpscQueue<CsvChunk>(CSV_QUEUE_CAPACITY));
+		toWriter.emplace_back(new SpscQueue<CsvBatch>(CSV_QUEUE_CAPACITY));
+	}
+	unsigned long long bytesRead = headerLine.size() + 1; // 只由读取线程修改，join 之后主线程读取
 
-	// 【获取月份输入】 - 这部分逻辑与获取年份输入的逻辑非常相似。
-	cout << "输入月份 (MM) [默认: " << currentMonth << ", -1 取消]: "; // 提示用户输入月份。
-	getline(cin, line_input); // 读取整行输入。
-	if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
-	if (!line_input.empty()) { // 如果输入非空
-		stringstream ss(line_input); // 创建字符串流。
-		if (!(ss >> month) || !ss.eof() || month < 1 || month > 12) { // 尝试提取月份，并增加月份范围 (1-12) 的校验。
-		                                                              // 如果提取失败，或有残留，或月份不在1-12范围内，则视为无效。
-			cout << "月份输入无效或范围不正确 (1-12)，将使用默认月份: " << currentMonth << "。\n"; // 打印错误消息。
-			month = currentMonth; // 使用当前系统月份作为默认值。
-		} // 月份解析和验证结束。
-	} else { // 如果用户直接回车
-		month = currentMonth; // 使用当前系统月份作为默认值。
-	} // 月份输入处理完毕。
+	// 【读取线程】大块读入，按换行符切分；最后给每个解析线程发一个结束块。
+	thread reader([&]() {
+		TrackedVector<char, MEMORY_IO_BUFFERS> buffer(CSV_READ_BLOCK);
+		IoBuffer pending; // 尚未凑成完整行的部分
+		size_t sequence = 0;
+		long nextLine = 2;
+		for (;;) {
+			inFile.read(buffer.data(), buffer.size());
+			streamsize got = inFile.gcount();
+			if (got > 0) {
+				bytesRead += got;
+				pending.append(buffer.data(), (size_t)got);
+			}
+			bool atEnd = got <= 0 || !inFile;
+			size_t cut = atEnd ? pending.size() : pending.rfind('\n');
+			if (cut == string::npos || cut == 0) { // 一行比一个块还长，继续读
+				if (atEnd) break;
+				continue;
+			}
+			if (!atEnd) ++cut; // 包含换行符
+			CsvChunk chunk;
+			chunk.sequence = sequence;
+			chunk.firstLine = nextLine;
+			chunk.text.assign(pending, 0, cut);
+			pending.erase(0, cut);
+			nextLine += count(chunk.text.begin(), chunk.text.end(), '\n');
+			toWorkers[sequence % workerCount]->push(chunk);
+			++sequence;
+			if (atEnd) break;
+		}
+		for (unsigned w = 0; w < workerCount; ++w) { // 结束块的序号紧接在最后一个数据块之后
+			CsvChunk end;
+			end.sequence = sequence + w;
+			end.last = true;
+			toWorkers[(sequence + w) % workerCount]->push(end);
+		}
+	});
 
-	// 【获取日期输入】 - 逻辑与获取年份/月份相似，但校验条件略有不同。
-	cout << "输入日期 (DD) [默认: " << currentDay << ", -1 取消]: "; // 提示用户输入日期。
-	getline(cin, line_input); // 读取整行输入。
-	if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
-	if (!line_input.empty()) { // 如果输入非空
-		stringstream ss(line_input); // 创建字符串流。
-		// 尝试提取日期，并进行基础的范围校验 (1-31)。注意，这里没有根据具体月份和年份来校验日期的最大值 (例如2月不能有30号)。
-		// 在下面的开发者注释（TODO块）中也指出了这一点需要改进。
-		if (!(ss >> day) || !ss.eof() || day < 1 || day > 31) { // 如果提取失败，或有残留，或日期不在1-31范围内
-			cout << "日期输入无效或范围不正确 (1-31)，将使用默认日期: " << currentDay << "。\n"; // 打印错误消息。
-			day = currentDay; // 使用当前系统日期作为默认值。
-		} // 日期解析和验证结束。
-	} else { // 如果用户直接回车
-		day = currentDay; // 使用当前系统日期作为默认值。
-	} // 日期输入处理完毕。
+	// 【解析线程】
+	vector<thread> workers;
+	for (unsigned w = 0; w < workerCount; ++w) {
+		workers.emplace_back([&, w]() {
+			CsvChunk chunk;
+			for (;;) {
+				toWorkers[w]->pop(chunk);
+				CsvBatch batch;
+				batch.sequence = chunk.sequence;
+				batch.last = chunk.last;
+				if (!chunk.last) parseCsvChunk(chunk, layout, batch);
+				toWriter[w]->push(batch);
+				if (chunk.last) break;
+			}
+		});
+	}
 
-	/* 【开发人员的注释 - 关于日期校验的重要提示】
-	   (这部分注释在之前的步骤中已经由我（AI助手）添加了初学者解读，这里是原始的开发者注释)
-	!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	!!! CRITICAL VALIDATION POINT / 必须实现的日期校验逻辑 !!!
-	!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	TODO: 此处必须实现严格的日期有效性检查！
-	      当前的验证 (month < 1 || month > 12 || day < 1 || day > 31) 非常基础。
-	      需要加入以下检查:
-	      1.  根据年份和月份，判断 'day' 是否在该月份的有效范围内 (例如，4月不能有31日)。
-	      2.  处理闰年情况 (2月份的天数)。
-	      3.  可以考虑不允许输入未来的日期，或者至少给出警告。
-	      4.  确保年份的合理性（例如，不是公元0年或公元9999年这种极端情况）。
-	      重要: 如果日期无效，应持续提示用户重新输入，直到用户提供有效日期为止。
-            绝对不能像当前这样直接回退到默认日期！当前的默认回退行为必须修改。
-	!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	*/
-	// 【基础日期有效性二次确认】
-	// 在分别处理完年、月、日的默认值逻辑后，这里再对组合后的日期进行一次非常基础的有效性检查。
-	// 这与上面在输入月份和日期时各自进行的范围检查是部分重叠的，但可以看作一个最终确认。
-	// 理想情况下，这里应该有一个更完善的日期验证函数，如TODO注释所建议。
-	if (month < 1 || month > 12 || day < 1 || day > 31) { // 再次检查月份是否在1-12之间，日期是否在1-31之间。
-		cout << "日期输入无效（例如月份不在1-12，或日期不在1-31），请重新输入。\n"; // 打印错误消息。
-		// 注意：根据TODO注释的建议，这里不应该直接返回，而是应该提示用户重新输入整个日期，或者至少重新输入有问题的部分。
-		// 当前的实现是如果日期组合后仍不符合这个基础检查，则直接放弃本次添加操作。
-		return; // 从 `addExpense` 函数返回，添加失败。
-	} // 基础日期验证结束。
+	// 【写入 (主线程)】按块序号取结果，遇到第一个结束块即全部完成。
+	long lines = 0;
+	int imported = 0, rejected = 0, credits = 0, full = 0, anomalies = 0;
+	int skipped = 0, flagged = 0, merged = 0; // 重复记录按策略处理的条数
+	vector<string> errors;
+	vector<Expense> pending;             // 已通过检查、等待批量插入的记录 (每个结果块插入一次)
+	unordered_set<uint64_t> pendingKeys; // 它们的重复检测键
+	auto flushPending = [&]() {
+		insertRecords(pending);
+		for (size_t k = 0; k < pending.size(); ++k) {
+			if (checkAnomaly(pending[k])) anomalies++;
+		}
+		pending.clear();
+		pendingKeys.clear();
+	};
+	for (size_t sequence = 0; ; ++sequence) {
+		CsvBatch batch;
+		toWriter[sequence % workerCount]->pop(batch);
+		if (batch.last) break;
+		lines += batch.lineCount;
+		rejected += batch.rejected;
+		credits += batch.credits;
+		for (size_t k = 0; k < batch.errors.size() && errors.size() < CSV_MAX_ERROR_LINES; ++k) errors.push_back(batch.errors[k]);
+		for (size_t k = 0; k < batch.rows.size(); ++k) {
+			const Expense& record = batch.rows[k];
+			if (!ensurePartitionLoaded(record.getYear(), record.getMonth()) || expenseCount + (int)pending.size() >= MAX_EXPENSES) { full++; continue; }
+			if (pendingKeys.count(duplicateKey(record))) flushPending(); // 可能与本块尚未插入的记录重复: 先插入，再比较
+			DuplicateAction action = resolveDuplicate(record); // 与已有记录及本次已导入的记录比较
+			if (action == DUPLICATE_SKIPPED) { skipped++; continue; }
+			if (action == DUPLICATE_MERGED) { merged++; continue; }
+			if (action == DUPLICATE_FLAGGED) flagged++;
+			pendingKeys.insert(duplicateKey(record));
+			pending.push_back(record);
+			imported++;
+		}
+		flushPending();
+	}
+	reader.join();
+	for (size_t w = 0; w < workers.size(); ++w) workers[w].join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
 
-	// 【获取描述输入】
-	// `Expense::MAX_DESCRIPTION_LENGTH` // 访问 `Expense` 类中定义的静态常量 `MAX_DESCRIPTION_LENGTH`，它规定了描述的最大字符数。
-	cout << "输入描述 (最多 " << Expense::MAX_DESCRIPTION_LENGTH << " 字符, 输入 '!cancel' 取消): "; // 提示用户输入描述。
-	getline(cin, description); // 使用 `getline` 读取用户输入的描述，允许包含空格。
-	if (description == "!cancel") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
-	// `description.length()` // `string` 对象的 `length()` 成员函数返回字符串中的字符数量。
-	if (description.length() > Expense::MAX_DESCRIPTION_LENGTH) { // 如果用户输入的描述长度超过了允许的最大长度
-		cout << "描述过长，已截断为 " << Expense::MAX_DESCRIPTION_LENGTH << " 字符。\n"; // 打印提示消息。
-		// `description.substr(0, Expense::MAX_DESCRIPTION_LENGTH)` // `string` 对象的 `substr()` 成员函数用于提取子字符串。
-		                                                          // 参数 `0` 是起始位置，`Expense::MAX_DESCRIPTION_LENGTH` 是要提取的长度。
-		                                                          // 这会将描述截断到允许的最大长度。
-		description = description.substr(0, Expense::MAX_DESCRIPTION_LENGTH); // 执行截断。
-	} // 描述长度处理完毕。
+	cout << "已从 " << path << " 导入 " << imported << " 条记录 (数据行 " << lines << " 行";
+	if (credits > 0) cout << "，收入/退款 " << credits << " 行未导入";
+	if (rejected > 0) cout << "，拒绝 " << rejected << " 行";
+	if (full > 0) cout << "，容量已满未导入 " << full << " 行";
+	if (skipped > 0) cout << "，跳过 " << skipped << " 条重复记录";
+	if (merged > 0) cout << "，合并 " << merged << " 条重复记录";
+	if (flagged > 0) cout << "，其中 " << flagged << " 条疑似重复 (见 查看重复记录)";
+	if (anomalies > 0) cout << "，" << anomalies << " 条金额异常 (见 异常开销报告)";
+	cout << ")。\n";
+	cout << fixed << setprecision(3) << "用时 " << seconds << " 秒，解析线程 " << workerCount << " 个";
+	if (seconds > 0) cout << setprecision(0) << "，" << lines / seconds << " 行/秒，" << setprecision(1) << bytesRead / seconds / (1024 * 1024) << " MB/秒";
+	cout << "。\n" << defaultfloat << setprecision(6);
+	cout << memoryUsageLine() << "。\n";
+	if (!errors.empty()) {
+		cout << "被拒绝的行" << (rejected > (int)errors.size() ? " (前 " + to_string(errors.size()) + " 条)" : "") << ":\n";
+		for (size_t k = 0; k < errors.size(); ++k) cout << "  " << errors[k] << "\n";
+	}
+	return true;
+} // `importCsv` 函数结束。
 
-	// 【获取金额输入】
-	cout << "输入金额 (-1 取消): "; // 提示用户输入金额。
-	// `while (true)` // 创建一个无限循环。这个循环会一直执行，直到遇到 `break` (输入有效) 或 `return` (用户取消)。
-	while (true) { // 开始金额输入循环
-		getline(cin, line_input); // 读取用户输入的整行金额信息。
-		if (line_input == "-1") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
+// 【`importCsvMenu` 方法实现 - 数据工具中的 CSV 导入入口】
+void ExpenseTracker::importCsvMenu() {
+	string path;
+	cout << "输入银行流水 CSV 文件名 (第一行为表头，直接回车取消): ";
+	getline(cin, path);
+	if (path.empty()) return;
+	cout << "金额的记法: 1. 支出为负数、收入为正数 (多数银行导出)  2. 支出为正数 [默认: 1]: ";
+	string sign;
+	getline(cin, sign);
+	if (importCsv(path, sign != "2")) cout << "保存后生效。\n";
+} // `importCsvMenu` 函数结束。
 
-		stringstream ss_amount(line_input); // 用用户输入行创建一个字符串流 `ss_amount`。
-		// `ss_amount >> amount` // 尝试从字符串流中提取一个 `double` 类型的值到 `amount` 变量。
-		// `amount >= 0`         // 检查提取出的金额是否大于或等于0 (即非负数)。
-		// `ss_amount.eof()`     // 检查在提取金额后，字符串流是否已经到达末尾 (确保输入的是纯数字，没有多余字符)。
-		if (ss_amount >> amount && amount >= 0 && ss_amount.eof()) { // 如果金额成功提取、非负，并且没有多余字符
-			break; // `break;` 跳出当前的 `while (true)` 循环，因为已获得有效金额。
-		} // 有效金额判断结束。
-		// 如果上面的 `if` 条件不满足 (即金额无效)
-		cout << "金额无效或为负，请重新输入 (-1 取消): "; // 打印错误消息，提示用户重新输入。
-	} // `while (true)` 循环结束，此时 `amount` 中已存储有效金额。
+// 【`mergeLedgers` 方法实现 - 多账本 k 路归并】算法见 LedgerStream 上方的说明。
+// `outputRoot` 为空时打印家庭合并报告，否则在 `outputRoot` 下写出一份新的分区账本 (可直接在该目录中运行本程序)。
+// 任一账本中有删除标记的记录不再输出，删除标记一并写入新账本。新账本先写到临时目录，全部写完后才改名为分区目录，
+// 中途失败 (例如某份账本没有按日期排序) 不会留下半份账本。本账本内存中的数据不受影响。
+bool ExpenseTracker::mergeLedgers(const vector<string>& inputs, bool unionMode, const string& outputRoot) {
+	vector<unique_ptr<LedgerStream> > streams;
+	vector<string> labels;
+	for (size_t s = 0; s < inputs.size(); ++s) {
+		streams.emplace_back(new LedgerStream());
+		string error;
+		if (!streams[s]->open(inputs[s], error)) {
+			cerr << "错误：" << error << "。\n";
+			return false;
+		}
+		labels.push_back(streams[s]->label);
+	}
 
-	// 【获取类别输入】
-	cout << "输入类别 (如 餐饮, 交通, 娱乐; 最多 " << Expense::MAX_CATEGORY_LENGTH << " 字符, 输入 '!cancel' 取消): "; // 提示输入类别。
-	getline(cin, category); // 使用 `getline` 读取用户输入的类别，允许包含空格。
-	if (category == "!cancel") { cout << "已取消添加开销。\n"; return; } // 处理取消操作。
-	// `category.length()` // 获取类别字符串的长度。
-	if (category.length() > Expense::MAX_CATEGORY_LENGTH) { // 如果类别长度超过了 `Expense` 类中定义的 `MAX_CATEGORY_LENGTH`
-		cout << "类别名称过长，已截断为 " << Expense::MAX_CATEGORY_LENGTH << " 字符。\n"; // 打印提示消息。
-		category = category.substr(0, Expense::MAX_CATEGORY_LENGTH); // 将类别截断到允许的最大长度。
-	} // 类别长度处理完毕。
-	// `category.empty()` // `string` 对象的 `empty()` 成员函数检查字符串是否为空 (即长度为0)。
-	if (category.empty()) { // 如果用户没有输入任何类别内容 (例如直接按了回车)
-		category = "未分类"; // 将类别设置为默认值 "未分类"。
-	} // 空类别处理完毕。
+	map<int, set<uint64_t> > tombstones; // 各账本的删除标记: yyyymm -> 编号 (0 表示月份未知)
+	for (size_t s = 0; s < streams.size(); ++s) streams[s]->readTombstones(tombstones);
+	unordered_map<uint64_t, int> deletedMonth; // 编号 -> 删除标记所在的月份
+	for (const auto& month : tombstones) {
+		for (uint64_t id : month.second) deletedMonth[id] = month.first; // 0 排在最前，已知月份会覆盖它
+	}
 
-	// 【将收集到的数据存储到开销对象数组中】
-	// `allExpenses` // 是 `ExpenseTracker` 类中定义的 `Expense` 对象数组。
-	// `expenseCount`// 是当前数组中已有的开销记录数量，也恰好是下一个新记录应存放的索引位置 (因为数组索引从0开始)。
-	// `allExpenses[expenseCount]` // 通过索引访问数组中的一个 `Expense` 对象。
-	// `.setData(...)` // 调用这个 `Expense` 对象的 `setData` 成员方法，
-	                // 将用户输入的年、月、日、描述、金额、类别等信息传递给它，用于设置该对象的内部状态。
-	allExpenses[expenseCount].setData(year, month, day, description, amount, category); // 设置新开销记录的数据。
-	// `expenseCount++` // 将 `expenseCount` 的值加1。这表示开销记录的总数增加了一个，
-	                  // 并且也为下一次添加新记录时 `expenseCount` 能指向正确的下一个空位做好了准备。
-	expenseCount++; // 增加已存储的开销数量。
-	cout << "开销已添加。\n"; // 打印成功添加的消息。
-} // `addExpense` 函数结束。
+	unique_ptr<PartitionStreamWriter> output;
+	unique_ptr<HouseholdReport> report;
+	error_code ec;
+	filesystem::path dir, staging;
+	if (!outputRoot.empty()) {
+		dir = filesystem::path(outputRoot) / PARTITION_DIR;
+		if (filesystem::exists(dir / "manifest.txt", ec)) {
+			cerr << "错误：" << outputRoot << " 中已经有账本，请指定一个新目录。\n";
+			return false;
+		}
+		staging = dir;
+		staging += ".tmp";
+		filesystem::remove_all(staging, ec); // 上次中断留下的临时目录
+		filesystem::create_directories(staging, ec);
+		if (ec) {
+			cerr << "错误：无法创建目录 " << staging.string() << "！\n";
+			return false;
+		}
+		output.reset(new PartitionStreamWriter(staging.string()));
+		output->tombstones = &tombstones;
+	} else {
+		report.reset(new HouseholdReport(labels));
+	}
 
-// 【`displayAllExpenses` 方法实现 - 显示所有开销记录】
-// `void ExpenseTracker::displayAllExpenses()` // 定义 `ExpenseTracker` 类的 `displayAllExpenses` 成员方法。
-void ExpenseTracker::displayAllExpenses() {
-	// 【检查是否有记录可显示】
-	if (expenseCount == 0) { // 如果当前没有任何开销记录 (`expenseCount` 为 0)
-		cout << "没有开销记录。\n"; // 打印提示信息。
-		return; // 从函数返回，不再执行后续的显示逻辑。
-	} // 记录检查结束。
-	cout << "\n--- 所有开销记录 ---\n"; // 打印列表的标题。
-	// 【打印表头】
-	// `left`        // 是一个流操纵符 (I/O manipulator)，来自 `<iomanip>` 头文件。它设置后续输出在字段宽度内左对齐。
-	// `setw(N)`     // 也是一个流操纵符，设置下一个输出项的字段宽度为 N 个字符。如果实际内容不足N个字符，会用填充字符补足；如果超出，通常会完整显示而破坏对齐。
-	// `right`       // 流操纵符，设置后续输出右对齐。
-	// `"日期"`, `"描述"`, `"类别"`, `"金额\n"` // 是要打印的表头文本。`\n` 用于在金额后换行。
-	cout << left                                  // 设置后续输出为左对齐。
-			  << setw(12) << "日期"                 // "日期"字段宽度为12。
-			  << setw(30) << "描述"                 // "描述"字段宽度为30。
-			  << setw(20) << "类别"                 // "类别"字段宽度为20。
-			  << right << setw(10) << "金额\n";     // "金额"字段宽度为10，且右对齐，然后换行。
-	// `string(total_width, '-')` // 创建一个包含 `total_width` 个连字符 `'-'` 的字符串。
-	                               // `12 + 30 + 20 + 10` 是表头各列宽度的总和。
-	cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 打印一行由连字符组成的分隔线。
-
-	// 【循环遍历并打印每一条开销记录】
-	// `for (int i = 0; i < expenseCount; ++i)` // 一个标准的 `for` 循环，用于遍历 `allExpenses` 数组中所有有效的记录。
-	                                          // `i` 从 0 开始，直到 `expenseCount - 1`。
-	for (int i = 0; i < expenseCount; ++i) { // 对每一条记录进行操作：
-		// `allExpenses[i]` // 访问数组中索引为 `i` 的 `Expense` 对象。
-		// `.getYear()`, `.getMonth()`, `.getDay()`, `.getDescription()`, `.getCategory()`, `.getAmount()` // 调用该对象的各个 getter 方法获取数据。
-		cout << left                                                    // 设置当前行输出左对齐。
-				  // 日期格式化: YYYY-MM-DD
-				  << setw(4) << allExpenses[i].getYear() << "-"          // 年份 (4位宽)，后跟连字符。
-				  // `setfill('0')` // 流操纵符，设置当字段宽度大于实际内容时，用字符 '0' 来填充，而不是默认的空格。
-				  // 这常用于月份和日期，确保它们总是两位数，例如 "05" 而不是 " 5"。
-				  << setfill('0') << setw(2) << allExpenses[i].getMonth() << "-" // 月份 (2位宽, 不足则前面补0)，后跟连字符。
-				  << setw(2) << allExpenses[i].getDay()                             // 日期 (2位宽, 不足则前面补0)。
-				  // `setfill(' ')` // 将填充字符恢复为默认的空格，以避免影响后续输出。
-				  << setfill(' ') << "  "                                        // 恢复填充为空格，并输出两个空格作为日期和描述之间的分隔。
-				  // 描述和类别
-				  << setw(30) << allExpenses[i].getDescription()             // 描述 (30位宽)。
-				  << setw(20) << allExpenses[i].getCategory()                // 类别 (20位宽)。
-				  // 金额格式化
-				  // `fixed` // 流操纵符，强制浮点数以定点表示法输出 (例如 123.45 而不是科学计数法 1.2345e+2)。
-				  // `setprecision(2)` // 流操纵符，设置浮点数输出时的小数精度为2位。
-				  << right << fixed << setprecision(2) << setw(10) << allExpenses[i].getAmount() << "\n"; // 金额 (10位宽, 右对齐, 固定2位小数)，然后换行。
-	} // `for` 循环结束。
-	cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 在列表末尾打印另一行分隔线。
-} // `displayAllExpenses` 函数结束。
+	unordered_map<uint64_t, bool> seenToday; // 当天已输出的记录编号 (同一条记录在各账本中日期相同)
+	uint32_t today = 0;
+	long merged = 0, duplicates = 0, deleted = 0;
+	bool sorted = mergeStreams(streams, [&](Expense& e, size_t s) {
+		auto tombstone = deletedMonth.find(e.getId());
+		if (tombstone != deletedMonth.end()) {
+			if (tombstone->second == 0) { // 删除标记的月份未知: 按记录的日期放入对应分区
+				tombstone->second = e.getYear() * 100 + e.getMonth();
+				tombstones[tombstone->second].insert(e.getId());
+			}
+			++deleted;
+			return;
+		}
+		if (e.getDate().value() != today) {
+			seenToday.clear();
+			today = e.getDate().value();
+		}
+		if (seenToday[e.getId()]) {
+			if (unionMode) { ++duplicates; return; }
+			// 合并模式保留重复的记录，但同一账本中编号必须唯一: 由原编号和来源账本推导一个新编号。
+			uint64_t id = fnv1a64("merge#" + to_string(s), e.getId());
+			e.setId(id == 0 ? 1 : id);
+		}
+		seenToday[e.getId()] = true;
+		if (output) output->consume(e);
+		else report->consume(e, s);
+		++merged;
+	});
+	if (!sorted) {
+		if (output) filesystem::remove_all(staging, ec);
+		return false;
+	}
 
-// 【`displayMonthlySummary` 方法实现 - 显示月度开销统计】
-// `void ExpenseTracker::displayMonthlySummary()` // 定义 `ExpenseTracker` 类的 `displayMonthlySummary` 成员方法。
-void ExpenseTracker::displayMonthlySummary() {
-	int year, month; // 声明两个整型变量 `year` 和 `month`，用于存储用户希望统计的年份和月份。
-	cout << "\n--- 月度开销统计 ---\n"; // 打印该功能的标题。
+	if (report) {
+		report->finish();
+	} else {
+		output->finishAll();
+		bool manifestOk = fileIO.writeFile(output->dir + "/manifest.txt", formatManifest(output->written));
+		if (output->failed || !manifestOk) {
+			cerr << "错误：合并账本写出不完整。\n";
+			filesystem::remove_all(staging, ec);
+			return false;
+		}
+		filesystem::remove(dir, ec); // 目标目录可能已经存在 (空目录)
+		filesystem::rename(staging, dir, ec);
+		if (ec) {
+			cerr << "错误：无法把 " << staging.string() << " 改名为 " << dir.string() << "！\n";
+			filesystem::remove_all(staging, ec);
+			return false;
+		}
+		cout << "已把 " << inputs.size() << " 份账本的 " << merged << " 条记录合并到 " << outputRoot << " (" << output->written.size() << " 个月份)。\n";
+	}
+	if (unionMode) cout << "并集模式: 去掉了 " << duplicates << " 条重复记录 (编号相同)。\n";
+	if (deleted > 0) cout << "跳过了 " << deleted << " 条已在某份账本中删除的记录。\n";
+	return true;
+} // `mergeLedgers` 函数结束。
 
-	// 【获取用户输入的年份】
-	cout << "输入要统计的年份 (YYYY) (-1 取消): "; // 提示用户输入年份，并告知输入-1可以取消操作。
-	// `while (true)` // 开始一个无限循环，用于持续获取和验证用户输入，直到获得有效年份或用户取消。
+// 【`mergeMenu` 方法实现 - 数据工具中的账本合并入口】
+void ExpenseTracker::mergeMenu() {
+	vector<string> inputs;
+	cout << "逐行输入要合并的账本 (账本目录或数据文件)，输入空行结束:\n";
 	while (true) {
-		cin >> year; // 尝试从标准输入读取一个整数到 `year` 变量。
-		// `cin.fail()` // 检查上一次输入操作是否失败（例如，用户输入了文本而不是数字）。
-		if (cin.fail()) { // 如果输入失败
-			cout << "年份输入无效，请重新输入 (-1 取消): "; // 打印错误提示。
-			cin.clear();        // 清除输入流 `cin` 的错误状态标志，使其恢复正常。
-			clearInputBuffer(); // 调用自定义函数清除输入缓冲区中的无效内容（包括换行符）。
-		// `else if (year == -1)` // 如果用户输入的是 -1 (表示取消)
-		} else if (year == -1) {
-			clearInputBuffer(); // 清除输入缓冲区中的 "-1" 后的换行符。
-			cout << "已取消月度统计。\n"; // 打印取消消息。
-			return; // 从 `displayMonthlySummary` 函数返回，终止统计操作。
-		} else { // `else` 分支：如果输入操作成功且不是 -1 (即用户输入了一个数字)
-			clearInputBuffer(); // 清除输入缓冲区中数字后的换行符。
-			break; // `break;` 跳出当前的 `while (true)` 循环，因为已获得有效的年份输入。
-		} // 年份输入验证结束。
-	} // 年份获取循环结束。
+		string path;
+		cout << "账本 " << inputs.size() + 1 << ": ";
+		if (!getline(cin, path) || path.empty()) break;
+		inputs.push_back(path);
+	}
+	if (inputs.empty()) return;
+	cout << "1. 合并 (保留全部记录)  2. 并集 (编号相同的记录只保留一条) [默认: 1]: ";
+	string mode;
+	getline(cin, mode);
+	cout << "输出目录 (直接回车则只打印家庭合并报告): ";
+	string outputRoot;
+	getline(cin, outputRoot);
+	mergeLedgers(inputs, mode == "2", outputRoot);
+} // `mergeMenu` 函数结束。
 
-	// 【获取用户输入的月份】
-	cout << "输入要统计的月份 (MM) (-1 取消): "; // 提示用户输入月份。
-	// `while (true)` // 开始另一个无限循环，用于获取和验证月份输入。
-	while (true) {
-		cin >> month; // 尝试读取月份。
-		if (cin.fail()) { // 如果输入失败
-			cout << "月份输入无效 (1-12)，请重新输入 (-1 取消): "; // 打印错误提示。
-			cin.clear();        // 清除错误状态。
-			clearInputBuffer(); // 清除无效输入。
-		} else if (month == -1) { // 如果用户输入 -1 (取消)
-			clearInputBuffer(); // 清除换行符。
-			cout << "已取消月度统计。\n"; // 打印取消消息。
-			return; // 从函数返回。
-		// `else if (month < 1 || month > 12)` // 如果输入的月份不在有效范围 1 到 12 之内
-		} else if (month < 1 || month > 12) {
-			cout << "月份输入无效 (1-12)，请重新输入 (-1 取消): "; // 打印范围错误提示。
-			clearInputBuffer(); // 清除无效月份输入后的换行符，以便下一次循环可以正确读取。
-		} else { // `else` 分支：如果输入成功、不是 -1，并且月份在 1-12 范围内 (即月份有效)
-			clearInputBuffer(); // 清除有效月份后的换行符。
-			break; // `break;` 跳出当前的 `while (true)` 循环。
-		} // 月份输入验证结束。
-	} // 月份获取循环结束。
+// 【`externalSortLedger` 方法实现 - 大账本外部排序】把 `input` (可以是未排序的旧版单文件) 按日期排序后
+// 写成 `outputRoot` 下的一份分区账本。内存占用约为 `memoryBudget` 加上同时打开的段文件的缓冲区。
+bool ExpenseTracker::externalSortLedger(const string& input, const string& outputRoot, size_t memoryBudget) {
+	LedgerStream source;
+	string error;
+	if (!source.open(input, error)) {
+		cerr << "错误：" << error << "。\n";
+		return false;
+	}
+	error_code ec;
+	filesystem::path dir = filesystem::path(outputRoot) / PARTITION_DIR;
+	if (filesystem::exists(dir / "manifest.txt", ec)) {
+		cerr << "错误：" << outputRoot << " 中已经有账本，请指定一个新目录。\n";
+		return false;
+	}
+	filesystem::create_directories(dir, ec);
+	if (ec) {
+		cerr << "错误：无法创建目录 " << dir.string() << "！\n";
+		return false;
+	}
+	ExternalSorter sorter(memoryBudget);
+	PartitionStreamWriter output(dir.string());
+	if (!sorter.sort(source, output)) return false;
+	output.finishFile();
+	bool manifestOk = fileIO.writeFile(output.dir + "/manifest.txt", formatManifest(output.written));
+	if (output.failed || !manifestOk) {
+		cerr << "错误：排序结果写出不完整。\n";
+		return false;
+	}
+	cout << "已把 " << sorter.records << " 条记录按日期排序写入 " << outputRoot << " (" << output.written.size() << " 个月份，排序时生成了 " << sorter.runSerial << " 个临时段)。\n";
+	cout << "记录缓冲峰值 " << formatMemoryBytes(memoryCounters[MEMORY_RECORDS].peak.load()) << "，字符串峰值 "
+		 << formatMemoryBytes(memoryCounters[MEMORY_STRINGS].peak.load()) << " (内存预算 " << formatMemoryBytes((int64_t)memoryBudget) << ")。\n";
+	return true;
+} // `externalSortLedger` 函数结束。
+
+// 【`streamingSummary` 方法实现 - 固定内存的年度/历年汇总】对 `input` 做外部排序，排序结果直接流入 YearlySummarySink，
+// 不写出中间账本。`onlyYear` 为 0 时打印每一年和历年汇总。
+bool ExpenseTracker::streamingSummary(const string& input, int onlyYear, size_t memoryBudget) {
+	LedgerStream source;
+	string error;
+	if (!source.open(input, error)) {
+		cerr << "错误：" << error << "。\n";
+		return false;
+	}
+	ExternalSorter sorter(memoryBudget);
+	YearlySummarySink summary(onlyYear);
+	if (!sorter.sort(source, summary)) return false;
+	summary.finish();
+	return true;
+} // `streamingSummary` 函数结束。
+
+// 【`outOfCoreMenu` 方法实现 - 数据工具中的大账本处理入口】
+void ExpenseTracker::outOfCoreMenu() {
+	string input;
+	cout << "账本目录或数据文件: ";
+	getline(cin, input);
+	if (input.empty()) return;
+	cout << "内存预算 (MB) [默认: " << (EXTERNAL_SORT_DEFAULT_MEMORY >> 20) << "]: ";
+	string line;
+	getline(cin, line);
+	size_t budget = EXTERNAL_SORT_DEFAULT_MEMORY;
+	if (!line.empty() && atoi(line.c_str()) > 0) budget = (size_t)atoi(line.c_str()) << 20;
+	cout << "1. 年度汇总  2. 全部年份汇总  3. 排序后写成新账本 [默认: 2]: ";
+	getline(cin, line);
+	if (line == "1") {
+		cout << "年份: ";
+		getline(cin, line);
+		int year = atoi(line.c_str());
+		if (year <= 0) {
+			cout << "无效的年份。\n";
+			return;
+		}
+		streamingSummary(input, year, budget);
+	} else if (line == "3") {
+		cout << "输出目录: ";
+		getline(cin, line);
+		if (!line.empty()) externalSortLedger(input, line, budget);
+	} else {
+		streamingSummary(input, 0, budget);
+	}
+} // `outOfCoreMenu` 函数结束。
+
+// 【`findDuplicate` 方法实现 - 查找与 `e` 重复的已加载记录】
+// 先查哈希索引 (O(1))，绝大多数没有重复的记录到此为止；只有索引命中时才在同一天的记录中找出具体是哪一条。
+// 返回记录下标，没有重复时返回 -1。调用方需保证 `e` 所在月份的分区已加载。
+int ExpenseTracker::findDuplicate(const Expense& e) {
+	uint64_t key = duplicateKey(e);
+	if (duplicateIndex.find(key) == duplicateIndex.end()) return -1;
+	int dayKey = dateKey(e);
+	for (int i = allExpenses.lowerBound(dayKey); i < expenseCount && dateKey(allExpenses[i]) == dayKey; ++i) {
+		if (duplicateKey(allExpenses[i]) == key) return i;
+	}
+	return -1;
+} // `findDuplicate` 函数结束。
+
+// 【`resolveDuplicate` 方法实现 - 对新记录执行重复处理策略】
+// 合并策略下直接修改已有记录 (类别取新记录的)，调用方不再插入新记录。
+DuplicateAction ExpenseTracker::resolveDuplicate(const Expense& incoming) {
+	int existing = findDuplicate(incoming);
+	if (existing < 0) return DUPLICATE_NONE;
+	if (duplicatePolicy == DUPLICATE_SKIP) return DUPLICATE_SKIPPED;
+	if (duplicatePolicy == DUPLICATE_FLAG) return DUPLICATE_FLAGGED;
+	Expense& e = allExpenses[existing];
+	if (e.getCategory() != incoming.getCategory()) {
+		recordRemoved(e); // 类别变化: 先按旧类别扣除月度累计
+		e.setData(e.getYear(), e.getMonth(), e.getDay(), e.getDescription(), e.getAmount(), incoming.getCategory());
+		recordAdded(e);
+		adjustPartitionCount(e.getYear(), e.getMonth(), 0); // 记录数不变，只标记分区待保存
+		invalidateSettlementCache(e.getYear(), e.getMonth());
+	}
+	return DUPLICATE_MERGED;
+} // `resolveDuplicate` 函数结束。
+
+// 【`showDuplicates` 方法实现 - 列出所有重复记录组】需要加载全部分区。
+void ExpenseTracker::showDuplicates() {
+	if (!ensureAllPartitionsLoaded()) cout << "警告：部分月份的数据未能加载，以下报告不完整。\n";
+	map<uint64_t, vector<int> > groups; // 重复检测键 -> 记录下标 (只收集索引计数大于 1 的键)
+	vector<uint64_t> order;             // 各组按第一条记录的日期排列
+	for (int i = 0; i < expenseCount; ++i) {
+		uint64_t key = duplicateKey(allExpenses[i]);
+		if (duplicateIndex[key] < 2) continue;
+		vector<int>& group = groups[key];
+		if (group.empty()) order.push_back(key);
+		group.push_back(i);
+	}
+	if (order.empty()) {
+		cout << "没有发现重复记录。\n";
+		return;
+	}
+	int extra = 0; // 每组第一条以外的记录数
+	printExpenseHeader();
+	for (size_t g = 0; g < order.size(); ++g) {
+		const vector<int>& group = groups[order[g]];
+		for (size_t k = 0; k < group.size(); ++k) printExpenseRow(allExpenses[group[k]]);
+		extra += (int)group.size() - 1;
+		if (g + 1 < order.size()) cout << "\n";
+	}
+	printExpenseSeparator();
+	cout << "共 " << order.size() << " 组重复记录，多出 " << extra << " 条。可用 批量删除 或 删除开销记录 清理。\n";
+} // `showDuplicates` 函数结束。
 
-	// 【打印月度统计报告的标题】
-	// `setfill('0')` // 设置填充字符为 '0'。
-	// `setw(2)`      // 设置字段宽度为2。
-	// `month`        // 要输出的月份。
-	// 这会确保月份总是以两位数显示，例如 "03" 而不是 "3"。
-	// `setfill(' ')` // 将填充字符恢复为默认的空格。
-	cout << "\n--- " << year << "年" << setfill('0') << setw(2) << month << setfill(' ') << "月 开销统计 ---\n";
+// 【`duplicatePolicyMenu` 方法实现 - 选择重复记录处理策略】
+void ExpenseTracker::duplicatePolicyMenu() {
+	const char* names[] = { "跳过", "提示并照常添加", "合并到已有记录" };
+	cout << "当前策略: " << names[duplicatePolicy] << "\n";
+	cout << "1. 跳过重复记录\n";
+	cout << "2. 提示并照常添加\n";
+	cout << "3. 合并到已有记录 (不新增，类别以新记录为准)\n";
+	cout << "请选择 (0 不修改): ";
+	int choice;
+	if (!(cin >> choice)) { cin.clear(); choice = 0; }
+	clearInputBuffer();
+	if (choice >= 1 && choice <= 3) {
+		duplicatePolicy = (DuplicatePolicy)(choice - 1);
+		cout << "重复记录策略已设为: " << names[duplicatePolicy] << "\n";
+	}
+} // `duplicatePolicyMenu` 函数结束。
 
-	// 【初始化用于统计的变量】
-	double totalMonthAmount = 0; // `double` 类型变量，用于累加指定月份的总开销金额，初始化为0。
-	bool foundRecords = false;   // `bool` 类型变量，用作标志。如果找到了任何属于该月份的记录，则设为 `true`。初始化为 `false`。
-
-	// `CategorySum categorySums[MAX_UNIQUE_CATEGORIES_PER_MONTH];` // 声明一个 `CategorySum` 类型的对象数组。
-	                                                              // `CategorySum` 是一个自定义类，用于存储特定类别的名称和该类别的总金额。
-	                                                              // `MAX_UNIQUE_CATEGORIES_PER_MONTH` 是一个常量，定义了最多能独立统计多少个不同类别。
-	CategorySum categorySums[MAX_UNIQUE_CATEGORIES_PER_MONTH]; // 用于存储每个类别的汇总金额。
-	int uniqueCategoriesCount = 0; // `int` 类型变量，记录当前已统计到的不同开销类别的数量，初始化为0。
-	// `double maxCategoryTotal = 0.0;` // 这个变量在原始代码中被声明并有赋值操作，但其值后续未被任何逻辑使用。
-	                                  // 对于初学者而言，可以理解为这是一个可能在开发过程中遗留的、当前无实际作用的变量。
-	double maxCategoryTotal = 0.0; // (此变量当前未被使用)
-
-	// 【打印该月开销明细的表头】 (与 `displayAllExpenses` 中的表头格式相同)
-	cout << left
-			  << setw(12) << "日期"
-			  << setw(30) << "描述"
-			  << setw(20) << "类别"
-			  << right << setw(10) << "金额\n";
-	cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 打印分隔线。
-
-	// 【遍历所有开销记录，筛选并处理属于指定年月的记录】
-	for (int i = 0; i < expenseCount; ++i) { // `for` 循环遍历所有已存储的开销记录。
-		// `if (allExpenses[i].getYear() == year && allExpenses[i].getMonth() == month)` // 检查当前遍历到的记录 `allExpenses[i]` 的年份和月份
-		                                                                            // 是否与用户指定的 `year` 和 `month` 相匹配。
-		if (allExpenses[i].getYear() == year && allExpenses[i].getMonth() == month) { // 如果记录属于目标月份
-			foundRecords = true; // 将 `foundRecords` 标志设置为 `true`，因为至少找到了一条匹配记录。
-			// 【打印该条匹配记录的详细信息】 (格式与 `displayAllExpenses` 中的记录打印一致)
-			cout << left
-					  << setw(4) << allExpenses[i].getYear() << "-"
-					  << setfill('0') << setw(2) << allExpenses[i].getMonth() << "-"
-					  << setw(2) << allExpenses[i].getDay() << setfill(' ') << "  "
-					  << setw(30) << allExpenses[i].getDescription()
-					  << setw(20) << allExpenses[i].getCategory()
-					  << right << fixed << setprecision(2) << setw(10) << allExpenses[i].getAmount() << "\n";
-			// `totalMonthAmount += allExpenses[i].getAmount();` // 将当前记录的金额累加到 `totalMonthAmount` 中。
-			totalMonthAmount += allExpenses[i].getAmount(); // 累加到本月总金额。
-
-			// 【按类别汇总金额逻辑】
-			bool categoryExists = false; // `bool` 标志，用于判断当前记录的类别是否已经在 `categorySums` 数组中存在了。
-			// `for (int j = 0; j < uniqueCategoriesCount; ++j)` // 遍历当前已经统计到的所有独立类别（存储在 `categorySums` 数组的前 `uniqueCategoriesCount` 个元素中）。
-			for (int j = 0; j < uniqueCategoriesCount; ++j) {
-				// `if (categorySums[j].name == allExpenses[i].getCategory())` // 比较 `categorySums` 数组中第 `j` 个类别的名称
-				                                                            // 与当前开销记录 `allExpenses[i]` 的类别名称是否相同。
-				if (categorySums[j].name == allExpenses[i].getCategory()) { // 如果找到了已存在的类别
-					categorySums[j].total += allExpenses[i].getAmount(); // 将当前记录的金额累加到该类别的总金额 `categorySums[j].total` 上。
-					categoryExists = true; // 设置标志，表示类别已存在。
-					if (categorySums[j].total > maxCategoryTotal) maxCategoryTotal = categorySums[j].total; // 更新 `maxCategoryTotal` (虽然它未被使用)
-					break; // 找到了对应的类别并处理完毕，跳出内层 `for` 循环 (遍历 `categorySums` 的循环)。
-				} // 类别匹配判断结束。
-			} // 内层 `for` 循环 (遍历已有类别汇总) 结束。
-
-			// `if (!categoryExists && uniqueCategoriesCount < MAX_UNIQUE_CATEGORIES_PER_MONTH)` // 如果 `categoryExists` 为 `false` (即当前记录的类别是一个新的类别)
-			                                                                                // 并且 `uniqueCategoriesCount` 小于 `MAX_UNIQUE_CATEGORIES_PER_MONTH` (即还有空间存储新的类别汇总)
-			if (!categoryExists && uniqueCategoriesCount < MAX_UNIQUE_CATEGORIES_PER_MONTH) { // 如果是新类别且有空间
-				categorySums[uniqueCategoriesCount].name = allExpenses[i].getCategory();  // 将新类别的名称存入 `categorySums` 数组的下一个可用位置。
-				categorySums[uniqueCategoriesCount].total = allExpenses[i].getAmount(); // 将当前记录的金额作为该新类别的初始总金额。
-				if (categorySums[uniqueCategoriesCount].total > maxCategoryTotal) maxCategoryTotal = categorySums[uniqueCategoriesCount].total; // 更新 `maxCategoryTotal`。
-				uniqueCategoriesCount++; // 已统计的独立类别数量加1。
-			} // 新类别处理结束。
-		} // 记录匹配判断结束。
-	} // 外层 `for` 循环 (遍历所有开销记录) 结束。
+// 【`recordAdded` / `recordRemoved` 方法实现 - 维护内存索引】
+// 每当一条记录进入内存 (加载、添加、导入) 或被删除时调用，使各种累计值随之增量更新，无需重新扫描记录。
+void ExpenseTracker::recordAdded(const Expense& e) {
+	duplicateIndex[duplicateKey(e)]++; // 重复检测索引
+	registerCategory(e.getCategory()); // 新出现的类别加入前缀树
+	++dataVersion; // 列式快照等派生数据随之过期
+	monthRollups[e.getYear() * 100 + e.getMonth()].add(categoryHierarchy, categoryHierarchy.nodeFor(e.getCategory()), llround(e.getAmount() * 100), 1);
+	cube.add(e, 1);
+	if (!loadingPartitions) markBitmapsStale(e);
+}
 
-	// 【输出统计结果】
-	if (!foundRecords) { // 如果 `foundRecords` 标志仍然是 `false` (即遍历完所有记录后，没有找到任何属于指定年月的记录)
-		cout << "该月份没有开销记录。\n"; // 打印提示信息。
-	} else { // `else` 分支：如果找到了记录 (`foundRecords` 为 `true`)
-		cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 打印一条分隔线。
-		// 打印本月总计金额
-		cout << left << setw(12 + 30 + 20) << "本月总计:" // "本月总计:" 文本左对齐，占据前面三列的宽度。
-				  << right << fixed << setprecision(2) << setw(10) << totalMonthAmount << "\n\n"; // 总金额右对齐，固定两位小数，占10位宽。然后输出两个换行符，增加间距。
-
-		// `if (uniqueCategoriesCount > 0)` // 如果统计到了任何类别的汇总数据
-		if (uniqueCategoriesCount > 0) {
-			cout << "按类别汇总:\n"; // 打印"按类别汇总"的标题。
-			cout << left << setw(20) << "类别" << right << setw(10) << "总金额\n"; // 打印类别汇总的表头。
-			cout << string(30, '-') << "\n"; // 打印分隔线 (30个字符宽)。
-			// `for (int i = 0; i < uniqueCategoriesCount; ++i)` // 循环遍历 `categorySums` 数组中所有已统计的类别。
-			for (int i = 0; i < uniqueCategoriesCount; ++i) {
-				// 打印每个类别的名称和对应的总金额。
-				cout << left << setw(20) << categorySums[i].name // 类别名称 (左对齐，20位宽)。
-						  << right << fixed << setprecision(2) << setw(10) << categorySums[i].total << "\n"; // 该类别总金额 (右对齐，固定两位小数，10位宽)，然后换行。
-			} // 类别汇总打印循环结束。
-			cout << string(30, '-') << "\n"; // 打印末尾分隔线。
-		} // 类别汇总打印结束。
-	} // 统计结果输出结束。
-} // `displayMonthlySummary` 函数结束。
+void ExpenseTracker::recordRemoved(const Expense& e) {
+	auto dup = duplicateIndex.find(duplicateKey(e));
+	if (dup != duplicateIndex.end() && --dup->second == 0) duplicateIndex.erase(dup);
+	++dataVersion;
+	monthRollups[e.getYear() * 100 + e.getMonth()].add(categoryHierarchy, categoryHierarchy.nodeFor(e.getCategory()), -llround(e.getAmount() * 100), -1);
+	cube.add(e, -1);
+	markBitmapsStale(e);
+}
 
-// 【`listExpensesByPeriod` 方法实现 - 按指定期间列出开销】
-// `void ExpenseTracker::listExpensesByPeriod()` // 定义 `ExpenseTracker` 类的 `listExpensesByPeriod` 成员方法。
-                                            // 此方法提供一个子菜单，允许用户按年、月或日来查看开销记录。
-void ExpenseTracker::listExpensesByPeriod() {
-	int choice; // 声明一个整型变量 `choice`，用于存储用户在子菜单中的选择。
-	// `do...while` // 开始一个 `do-while` 循环，用于显示子菜单并处理用户选择，直到用户选择返回主菜单。
-	do {
-		// 【显示子菜单选项】
-		cout << "\n--- 按期间列出开销 --- \n"; // 子菜单标题。
-		cout << "1. 按年份列出\n";        // 选项1：按年份。
-		cout << "2. 按月份列出\n";        // 选项2：按月份。
-		cout << "3. 按日期列出\n";        // 选项3：按日期。
-		cout << "0. 返回主菜单\n";      // 选项0：返回。
-		cout << "--------------------\n"; // 分隔线。
-		cout << "请输入选项: ";        // 提示输入。
+// 记录的增删会移动该月其后记录的分区内序号，因此整个月的位图作废，下次使用时按 O(该月记录数) 重建。
+void ExpenseTracker::markBitmapsStale(const Expense& e) {
+	auto it = bitmapIndex.find(e.getYear() * 100 + e.getMonth());
+	if (it != bitmapIndex.end() && !it->second.stale) {
+		it->second.stale = true;
+		bitmapIndexChanged = true;
+	}
+}
 
-		cin >> choice; // 读取用户在子菜单中的选择。
-		// 【输入验证】 (与主菜单中的验证逻辑类似)
-		if (cin.fail()) { // 如果输入失败
-			cin.clear();        // 清除错误状态。
-			clearInputBuffer(); // 清除无效输入。
-			choice = -1;        // 将 `choice` 设为一个无效值 (例如-1)，确保 `switch` 进入 `default` 或不匹配任何 `case`，以便循环可以继续提示用户。
-		} else { // 如果输入成功 (是数字)
-			clearInputBuffer(); // 清除数字后的换行符。
-		} // 输入验证结束。
+// 【`printCubeRollup` 方法实现 - 打印立方体沿某一维度的汇总】只打印有记录的行，并给出查询耗时。
+void ExpenseTracker::printCubeRollup(const CubeSlice& slice, CubeDimension by) {
+	auto start = chrono::steady_clock::now();
+	vector<CubeCell> rows = cube.rollup(slice, by);
+	double elapsedUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+	static const char* headers[] = { "年份", "月份", "日期", "类别" };
+	cout << left << setw(by == CUBE_BY_CATEGORY ? 24 : 12) << headers[by] << right << setw(14) << "金额" << setw(10) << "笔数" << "\n";
+	cout << string((by == CUBE_BY_CATEGORY ? 24 : 12) + 24, '-') << "\n";
+	CubeCell total;
+	for (size_t r = 0; r < rows.size(); ++r) {
+		if (rows[r].count == 0) continue;
+		if (by == CUBE_BY_YEAR) cout << left << setw(12) << to_string(cube.firstYear + (int)r) + "年";
+		else if (by == CUBE_BY_MONTH) cout << left << setw(12) << to_string(r + 1) + "月";
+		else if (by == CUBE_BY_DAY) cout << left << setw(12) << to_string(r + 1) + "日";
+		else cout << left << setw(24) << cube.categoryNames[r];
+		cout << right << fixed << setprecision(2) << setw(14) << rows[r].cents / 100.0 << setw(10) << rows[r].count << "\n";
+		total.cents += rows[r].cents;
+		total.count += rows[r].count;
+	}
+	cout << string((by == CUBE_BY_CATEGORY ? 24 : 12) + 24, '-') << "\n";
+	cout << left << setw(by == CUBE_BY_CATEGORY ? 24 : 12) << "合计" << right << setw(14) << total.cents / 100.0 << setw(10) << total.count << "\n";
+	cout << "(立方体查询耗时 " << setprecision(1) << elapsedUs << " 微秒)\n";
+} // `printCubeRollup` 函数结束。
 
-		// `switch (choice)` // 根据用户的子菜单选择执行相应操作。
-		switch (choice) {
-			case 1: { // 【用户选择1：按年份列出】
-				cout << "\n--- 按年份列出开销 ---\n"; // 功能标题。
-				cout << "输入年份 (YYYY) (输入 0 返回): "; // 提示输入年份，0可返回子菜单。
-				int year; // 声明用于存储年份的变量。
-				// `while (!(cin >> year))` // 循环，直到用户输入一个有效的整数年份。
-				                         // `!(cin >> year)` 如果读取失败（例如输入文本），则为 `true`，循环继续。
-				while (!(cin >> year)) {
-					cout << "年份输入无效，请重新输入 (输入 0 返回): "; // 错误提示。
-					cin.clear();        // 清除错误。
-					clearInputBuffer(); // 清除缓冲区。
-				} // 年份输入循环结束。
-				clearInputBuffer(); // 清除有效年份后的换行符。
-				if (year == 0) break; // 如果用户输入0，则 `break` 跳出当前的 `case 1`，返回到子菜单的 `do-while` 循环开头。
+// 【`drillDownMenu` 方法实现 - 年 → 月 → 日 钻取报告】
+// 当前层级按下一级维度列出合计: 全部年份 -> 某年的各月 -> 某月的各日 -> 某日 (按类别)。
+// 输入数字进入下一级，u 返回上一级，c 设置类别过滤 (含子类别)，p 切换为按类别透视当前切片，直接回车返回主菜单。
+void ExpenseTracker::drillDownMenu() {
+	if (!ensureAllPartitionsLoaded()) cout << "警告：部分月份的数据未能加载，钻取结果不完整。\n"; // 立方体只包含已加载的记录
+	CubeSlice slice;
+	string categoryFilter;
+	bool pivot = false;
+	while (true) {
+		CubeDimension by = slice.year == 0 ? CUBE_BY_YEAR : slice.month == 0 ? CUBE_BY_MONTH : slice.day == 0 ? CUBE_BY_DAY : CUBE_BY_CATEGORY;
+		cout << "\n--- 钻取报告: ";
+		if (slice.year == 0) cout << "全部年份";
+		else {
+			cout << slice.year << "年";
+			if (slice.month) cout << slice.month << "月";
+			if (slice.day) cout << slice.day << "日";
+		}
+		cout << (categoryFilter.empty() ? "" : "，类别 " + categoryFilter) << " ---\n";
+		printCubeRollup(slice, pivot ? CUBE_BY_CATEGORY : by);
+		cout << (by != CUBE_BY_CATEGORY ? "输入数字进入下一级，" : "") << "u 上一级，c 类别过滤，p 按类别透视，回车返回: ";
+		string input;
+		if (!getline(cin, input) || input.empty()) return;
+		if (input == "u" || input == "U") {
+			if (slice.day) slice.day = 0;
+			else if (slice.month) slice.month = 0;
+			else slice.year = 0;
+			pivot = false;
+		} else if (input == "c" || input == "C") {
+			cout << "类别 (直接回车表示全部类别): ";
+			getline(cin, categoryFilter);
+			categoryFilter = normalizeCategoryPath(categoryFilter);
+			slice.categories = cube.categoriesUnder(categoryFilter);
+			if (!categoryFilter.empty() && slice.categories.empty()) {
+				cout << "没有该类别的记录。\n";
+				categoryFilter.clear();
+			}
+		} else if (input == "p" || input == "P") {
+			pivot = !pivot;
+		} else if (by != CUBE_BY_CATEGORY) {
+			int value = atoi(input.c_str());
+			bool valid = by == CUBE_BY_YEAR ? value >= cube.firstYear && value < cube.firstYear + cube.yearCount
+					   : by == CUBE_BY_MONTH ? value >= 1 && value <= 12
+					   : value >= 1 && value <= daysInMonth(slice.year, slice.month);
+			if (!valid) {
+				cout << "无效的" << (by == CUBE_BY_YEAR ? "年份" : by == CUBE_BY_MONTH ? "月份" : "日期") << "。\n";
+				continue;
+			}
+			if (by == CUBE_BY_YEAR) slice.year = value;
+			else if (by == CUBE_BY_MONTH) slice.month = value;
+			else slice.day = value;
+			pivot = false;
+		} else {
+			cout << "无效输入。\n";
+		}
+	}
+} // `drillDownMenu` 函数结束。
 
-				// `cout << "正在为 " << year << " 年列出开销... (待实现)\n";` // 这行是原始代码中的注释掉的或者是一个占位符提示。
-				                                                            // 实际上，下面的代码实现了按年列出的功能。
-				bool found = false; // `bool` 标志，用于记录是否找到了该年份的任何开销记录。
-				// 【打印表头】 (与 `displayAllExpenses` 中的表头格式相同)
-				cout << left
-					  << setw(12) << "日期"
-					  << setw(30) << "描述"
-					  << setw(20) << "类别"
-					  << right << setw(10) << "金额\n";
-				cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 分隔线。
-				// 【遍历所有开销记录，筛选并打印属于指定年份的记录】
-				for (int i = 0; i < expenseCount; ++i) { // 遍历所有记录。
-					if (allExpenses[i].getYear() == year) { // 如果当前记录的年份与用户指定的年份匹配
-						// 【打印该条匹配记录的详细信息】 (格式与 `displayAllExpenses` 中的记录打印一致)
-						cout << left
-							  << setw(4) << allExpenses[i].getYear() << "-"
-							  << setfill('0') << setw(2) << allExpenses[i].getMonth() << "-"
-							  << setw(2) << allExpenses[i].getDay() << setfill(' ') << "  "
-							  << setw(30) << allExpenses[i].getDescription()
-							  << setw(20) << allExpenses[i].getCategory()
-							  << right << fixed << setprecision(2) << setw(10) << allExpenses[i].getAmount() << "\n";
-						found = true; // 设置 `found` 标志为 `true`，表示已找到记录。
-					} // 年份匹配判断结束。
-				} // 记录遍历循环结束。
-				if (!found) { // 如果遍历完所有记录后，`found` 标志仍为 `false`
-					cout << "在 " << year << " 年没有找到开销记录。\n"; // 打印未找到记录的消息。
-				} // 未找到记录判断结束。
-				cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 打印末尾分隔线。
-				break; // 结束 `case 1` 的处理。
-			} // `case 1` 结束。
+// 【`categoryMonthCents` 方法实现 - 某类别 (含全部子类别) 在某月的已加载支出合计，单位: 分】
+long long ExpenseTracker::categoryMonthCents(int year, int month, const string& category) {
+	auto it = monthRollups.find(year * 100 + month);
+	if (it == monthRollups.end()) return 0;
+	return it->second.totalCents(categoryHierarchy.find(category));
+} // `categoryMonthCents` 函数结束。
 
-			case 2: { // 【用户选择2：按月份列出】
-				cout << "\n--- 按月份列出开销 ---\n"; // 功能标题。
-				cout << "输入年份 (YYYY) (输入 0 返回): "; // 提示输入年份。
-				int year; // 存储年份。
-				while (!(cin >> year)) { /* ... 此处省略了与 case 1 中完全相同的年份输入和验证逻辑的重复注释 ... */
-					cout << "年份输入无效，请重新输入 (输入 0 返回): ";
-					cin.clear(); clearInputBuffer();
-				}
-				clearInputBuffer();
-				if (year == 0) break; // 年份为0则返回子菜单。
+// 【`loadBudgets` 方法实现 - 读取预算文件】
+// 格式与数据文件类似: 第一行为条目数，之后每行 "年,月,金额,类别" (类别放在最后，允许包含逗号)。
+// 金额以分为单位的整数保存 (第一行为 "条目数 cents")；第一行没有 "cents" 的旧文件金额单位为元。
+void ExpenseTracker::loadBudgets() {
+	string text;
+	if (!fileIO.readFile(BUDGET_FILE, text)) return; // 尚未设置任何预算
+	istringstream inFile(text);
+	int count;
+	inFile >> count;
+	if (inFile.fail() || count < 0) {
+		cerr << "警告：预算文件 " << BUDGET_FILE << " 格式无效，已忽略。\n";
+		return;
+	}
+	string line;
+	getline(inFile, line);
+	bool inCents = line.find("cents") != string::npos;
+	for (int i = 0; i < count && getline(inFile, line); ++i) {
+		stringstream ss(line);
+		BudgetEntry entry;
+		char comma1, comma2, comma3;
+		if (!(ss >> entry.year >> comma1 >> entry.month >> comma2 >> entry.amount >> comma3) ||
+			comma1 != ',' || comma2 != ',' || comma3 != ',' || !getline(ss, entry.category) || entry.amount < 0) {
+			cerr << "警告：预算文件第 " << i + 2 << " 行无效，已跳过。\n";
+			continue;
+		}
+		if (inCents) entry.amount = llround(entry.amount) / 100.0;
+		budgets[monthCategoryKey(entry.year, entry.month, entry.category)] = entry;
+	}
+} // `loadBudgets` 函数结束。
 
-				cout << "输入月份 (MM) (输入 0 返回): "; // 提示输入月份。
-				int month; // 存储月份。
-				// `while (!(cin >> month) || (month != 0 && (month < 1 || month > 12)))` // 循环，直到输入有效的整数月份 (1-12) 或 0 (返回)。
-				                                                                        // `!(cin >> month)`: 读取失败。
-				                                                                        // `month != 0 && (month < 1 || month > 12)`: 读取成功但不是0，且月份不在1-12范围内。
-				while (!(cin >> month) || (month != 0 && (month < 1 || month > 12))) {
-					cout << "月份输入无效 (1-12)，请重新输入 (输入 0 返回): "; // 错误提示。
-					cin.clear(); clearInputBuffer(); // 清理。
-				} // 月份输入循环结束。
-				clearInputBuffer(); // 清除有效月份后的换行符。
-				if (month == 0) break; // 月份为0则返回子菜单。
+// 【`saveBudgets` 方法实现 - 写入预算文件】预算修改后立即保存。
+void ExpenseTracker::saveBudgets() {
+	ostringstream outFile;
+	outFile << budgets.size() << " cents\n"; // 金额以分保存，默认的 6 位有效数字格式会丢失精度
+	for (const auto& item : budgets) {
+		const BudgetEntry& b = item.second;
+		outFile << b.year << "," << b.month << "," << llround(b.amount * 100) << "," << b.category << "\n";
+	}
+	if (!fileIO.writeFile(BUDGET_FILE, outFile.str())) {
+		cerr << "错误：无法写入预算文件 " << BUDGET_FILE << "\n";
+	}
+} // `saveBudgets` 函数结束。
 
-				// `cout << "正在为 " << year << " 年 " << month << " 月列出开销... (待实现)\n";` // 同样是可能的旧注释。
-				bool found = false; // 记录是否找到匹配项的标志。
-				// 【打印表头】
-				cout << left << setw(12) << "日期" /* ... 此处省略表头剩余部分的重复注释 ... */ << setw(10) << "金额\n";
-				cout << string(12 + 30 + 20 + 10, '-') << "\n";
-				// 【遍历所有开销记录，筛选并打印属于指定年和月的记录】
-				for (int i = 0; i < expenseCount; ++i) { // 遍历所有记录。
-					if (allExpenses[i].getYear() == year && allExpenses[i].getMonth() == month) { // 如果年份和月份都匹配
-						// 【打印该条匹配记录的详细信息】
-						cout << left /* ... 此处省略记录格式化与打印的重复注释 ... */ << "\n";
-						found = true; // 设置找到标志。
-					} // 年月匹配判断结束。
-				} // 记录遍历循环结束。
-				if (!found) { // 如果未找到记录
-					cout << "在 " << year << " 年 " << month << " 月没有找到开销记录。\n"; // 打印提示。
-				} // 未找到判断结束。
-				cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 末尾分隔线。
-				break; // 结束 `case 2` 的处理。
-			} // `case 2` 结束。
+// 【`findBudget` 方法实现 - 查找某月某类别适用的预算】
+// 先查该月的专门预算，再查每月默认预算；都没有时返回 nullptr。两次哈希查找，O(1)。
+const BudgetEntry* ExpenseTracker::findBudget(int year, int month, const string& category) {
+	return findBudgetIn(budgets, year, month, category);
+} // `findBudget` 函数结束。
 
-			case 3: { // 【用户选择3：按日期列出】
-				cout << "\n--- 按日期列出开销 ---\n"; // 功能标题。
-				cout << "输入年份 (YYYY) (输入 0 返回): "; // 提示输入年。
-				int year; // 存储年。
-				while (!(cin >> year)) { /* ... 年份输入与验证逻辑 (同上) ... */
-					cout << "年份输入无效，请重新输入 (输入 0 返回): ";
+// 【`checkBudgetAfterAdd` 方法实现 - 添加开销后检查预算】
+// 记录的类别及其每一级上级类别 (例如 "餐饮/午餐" 和 "餐饮") 都可能设有预算，上级的已用金额包含全部子类别。
+// 月度累计在 `recordAdded` 中已经增量更新，这里每一级只做常数次哈希查找，不会重新扫描该月的记录。
+void ExpenseTracker::checkBudgetAfterAdd(const Expense& e) {
+	string category = e.getCategory();
+	while (!category.empty()) {
+		const BudgetEntry* budget = findBudget(e.getYear(), e.getMonth(), category);
+		if (budget != nullptr) { // 该级类别设有预算
+			double spent = categoryMonthCents(e.getYear(), e.getMonth(), category) / 100.0;
+			cout << fixed << setprecision(2);
+			if (spent > budget->amount) { // 已超支
+				cout << "警告：类别 \"" << category << "\" 本月已支出 " << spent << "，超出预算 " << budget->amount
+					 << " 共 " << spent - budget->amount << "！\n";
+			} else if (spent >= budget->amount * BUDGET_WARNING_RATIO) { // 接近预算
+				cout << "提醒：类别 \"" << category << "\" 本月已用预算 " << spent << " / " << budget->amount
+					 << "，剩余 " << budget->amount - spent << "。\n";
+			}
+		}
+		size_t slash = category.rfind(CATEGORY_PATH_SEPARATOR);
+		category = slash == string::npos ? "" : category.substr(0, slash); // 上一级
+	}
+} // `checkBudgetAfterAdd` 函数结束。
+
+// 【`budgetMenu` 方法实现 - 预算管理子菜单】
+void ExpenseTracker::budgetMenu() {
+	int choice; // 子菜单选项。
+	do {
+		cout << "\n--- 预算管理 ---\n";
+		cout << "1. 设置类别预算\n";
+		cout << "2. 查看预算执行情况\n";
+		cout << "3. 删除类别预算\n";
+		cout << "0. 返回主菜单\n";
+		cout << "--------------------\n";
+		cout << "请输入选项: ";
+
+		cin >> choice;
+		if (cin.fail()) {
+			cin.clear();
+			clearInputBuffer();
+			choice = -1;
+		} else {
+			clearInputBuffer();
+		}
+
+		switch (choice) {
+			case 1:
+			case 3: { // 设置与删除都需要先确定 (类别, 年, 月)
+				BudgetEntry entry;
+				cout << "输入类别 (输入 '!cancel' 取消): ";
+				getline(cin, entry.category);
+				if (entry.category == "!cancel" || entry.category.empty()) { cout << "已取消。\n"; break; }
+				entry.category = normalizeCategory(entry.category); // 与记录使用同一个规范类别名
+				cout << "输入年份 (YYYY, 输入 0 表示每个月都适用): ";
+				while (!(cin >> entry.year) || entry.year < 0) {
+					cout << "年份输入无效，请重新输入: ";
 					cin.clear(); clearInputBuffer();
 				}
 				clearInputBuffer();
-				if (year == 0) break;
-
-				cout << "输入月份 (MM) (输入 0 返回): "; // 提示输入月。
-				int month; // 存储月。
-				while (!(cin >> month) || (month != 0 && (month < 1 || month > 12))) { /* ... 月份输入与验证逻辑 (同上) ... */
-					cout << "月份输入无效 (1-12)，请重新输入 (输入 0 返回): ";
+				if (entry.year != 0) {
+					cout << "输入月份 (MM): ";
+					while (!(cin >> entry.month) || entry.month < 1 || entry.month > 12) {
+						cout << "月份输入无效 (1-12)，请重新输入: ";
+						cin.clear(); clearInputBuffer();
+					}
+					clearInputBuffer();
+				}
+				string key = monthCategoryKey(entry.year, entry.month, entry.category);
+				if (choice == 3) { // 删除预算
+					if (budgets.erase(key) > 0) { saveBudgets(); cout << "预算已删除。\n"; }
+					else cout << "没有找到该预算。\n";
+					break;
+				}
+				cout << "输入预算金额: ";
+				while (!(cin >> entry.amount) || entry.amount < 0) {
+					cout << "金额无效或为负，请重新输入: ";
 					cin.clear(); clearInputBuffer();
 				}
 				clearInputBuffer();
-				if (month == 0) break;
+				budgets[key] = entry;
+				saveBudgets();
+				cout << "预算已保存。\n";
+				break;
+			}
+			case 2: { // 查看某个月所有预算的执行情况
+				int year, month;
+				cout << "输入年份 (YYYY): ";
+				while (!(cin >> year)) { cout << "年份输入无效，请重新输入: "; cin.clear(); clearInputBuffer(); }
+				clearInputBuffer();
+				cout << "输入月份 (MM): ";
+				while (!(cin >> month) || month < 1 || month > 12) { cout << "月份输入无效 (1-12)，请重新输入: "; cin.clear(); clearInputBuffer(); }
+				clearInputBuffer();
+				if (!ensurePartitionLoaded(year, month)) { // 月度累计只包含已加载的分区。
+					cout << "错误：无法加载 " << year << " 年 " << month << " 月的数据，无法统计预算执行情况。\n";
+					break;
+				}
+				vector<BudgetEntry> applicable; // 该月适用的预算 (专门预算覆盖默认预算)
+				for (const auto& item : budgets) {
+					const BudgetEntry& b = item.second;
+					if ((b.year == year && b.month == month) ||
+						(b.year == 0 && findBudget(year, month, b.category) == &b)) {
+						applicable.push_back(b);
+					}
+				}
+				if (applicable.empty()) { cout << "该月份没有适用的预算。\n"; break; }
+				sort(applicable.begin(), applicable.end(),
+					 [](const BudgetEntry& a, const BudgetEntry& b) { return a.category < b.category; });
+				cout << left << setw(20) << "类别" << right << setw(10) << "预算" << setw(10) << "已用" << setw(10) << "剩余" << "\n";
+				cout << string(50, '-') << "\n";
+				for (size_t i = 0; i < applicable.size(); ++i) {
+					double spent = categoryMonthCents(year, month, applicable[i].category) / 100.0; // 含子类别
+					cout << left << setw(20) << applicable[i].category
+						 << right << fixed << setprecision(2) << setw(10) << applicable[i].amount
+						 << setw(10) << spent << setw(10) << applicable[i].amount - spent
+						 << (spent > applicable[i].amount ? "  超支" : "") << "\n";
+				}
+				cout << string(50, '-') << "\n";
+				break;
+			}
+			case 0: cout << "返回主菜单...\n"; break;
+			default: cout << "无效选项，请重试。\n";
+		}
+	} while (choice != 0);
+} // `budgetMenu` 函数结束。
 
-				cout << "输入日期 (DD) (输入 0 返回): "; // 提示输入日。
-				int day; // 存储日。
-				// `while (!(cin >> day) || (day != 0 && (day < 1 || day > 31)))` // 循环，直到输入有效的整数日期 (1-31) 或 0 (返回)。
-				                                                                 // 这是一个基础的日期范围检查，未考虑月份的实际天数。
-				while (!(cin >> day) || (day != 0 && (day < 1 || day > 31))) {
-					cout << "日期输入无效 (1-31)，请重新输入 (输入 0 返回): "; // 错误提示。
-					cin.clear(); clearInputBuffer(); // 清理。
-				} // 日期输入循环结束。
-				clearInputBuffer(); // 清除有效日期后的换行符。
-				if (day == 0) break; // 日期为0则返回子菜单。
-				
-				// `cout << "正在为 " << year << " 年 " << month << " 月 " << day << " 日列出开销... (待实现)\n";` // 旧注释。
-				bool found = false; // 记录是否找到的标志。
-				// 【打印表头】
-				cout << left << setw(12) << "日期" /* ... 表头 ... */ << setw(10) << "金额\n";
-				cout << string(12 + 30 + 20 + 10, '-') << "\n";
-				// 【遍历所有开销记录，筛选并打印属于指定年、月、日的记录】
-				for (int i = 0; i < expenseCount; ++i) { // 遍历所有记录。
-					if (allExpenses[i].getYear() == year && allExpenses[i].getMonth() == month && allExpenses[i].getDay() == day) { // 如果年、月、日都匹配
-						// 【打印该条匹配记录的详细信息】
-						cout << left /* ... 记录格式化与打印 ... */ << "\n";
-						found = true; // 设置找到标志。
-					} // 年月日匹配判断结束。
-				} // 记录遍历循环结束。
-				if (!found) { // 如果未找到
-					cout << "在 " << year << " 年 " << month << " 月 " << day << " 日没有找到开销记录。\n"; // 打印提示。
-				} // 未找到判断结束。
-				cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 末尾分隔线。
-				break; // 结束 `case 3` 的处理。
-			} // `case 3` 结束。
+// 【`loadSettlementArchive` 方法实现 - 读取结算档案】
+// 格式: 第一行为条目数；每个条目先是一行 "年 月 记录数 总金额(分) 校验值(十六进制) 类别数"，
+// 之后每个类别一行 "金额(分),类别名称"。
+void ExpenseTracker::loadSettlementArchive() {
+	string text;
+	if (!fileIO.readFile(SETTLEMENT_ARCHIVE_FILE, text)) return; // 还没有任何结算档案
+	istringstream inFile(text);
+	int count;
+	inFile >> count;
+	if (inFile.fail() || count < 0) {
+		cerr << "警告：结算档案 " << SETTLEMENT_ARCHIVE_FILE << " 格式无效，已忽略。\n";
+		return;
+	}
+	for (int i = 0; i < count; ++i) {
+		SettlementReport report;
+		long long totalCents;
+		int categoryCount;
+		if (!(inFile >> report.year >> report.month >> report.recordCount >> totalCents >> hex >> report.contentHash >> dec >> categoryCount) ||
+			categoryCount < 0) {
+			cerr << "警告：结算档案第 " << i + 1 << " 个条目无效，忽略其后的条目。\n";
+			return;
+		}
+		inFile.ignore(numeric_limits<streamsize>::max(), '\n');
+		report.total = totalCents / 100.0;
+		for (int c = 0; c < categoryCount; ++c) {
+			string line;
+			getline(inFile, line);
+			size_t comma = line.find(',');
+			if (comma == string::npos) continue; // 损坏的类别行
+			CategorySum sum;
+			try { sum.total = stoll(line.substr(0, comma)) / 100.0; } catch (const exception&) { continue; }
+			sum.name = line.substr(comma + 1);
+			report.categories.push_back(sum);
+		}
+		settlementArchive[report.year * 100 + report.month] = report;
+	}
+} // `loadSettlementArchive` 函数结束。
 
-			case 0: // 【用户选择0：返回主菜单】
-				cout << "返回主菜单...\n"; // 打印返回消息。
-				break; // 跳出 `switch` 语句。因为 `choice` 为 0，`do-while` 循环的条件 `choice != 0` 将为 `false`，从而结束子菜单循环。
-			default: // 【其他无效输入】
-				cout << "无效选项，请重试。\n"; // 打印错误提示。
-				// 无需 `break`，因为是 `switch` 的最后一个分支。
-		} // `switch` 语句结束。
-	} while (choice != 0); // 子菜单的 `do-while` 循环条件：当 `choice` 不为 0 时继续循环。用户选择0则退出。
-} // `listExpensesByPeriod` 函数结束。
+// 【`saveSettlementArchive` 方法实现 - 写入结算档案】
+void ExpenseTracker::saveSettlementArchive() {
+	ostringstream outFile;
+	outFile << settlementArchive.size() << "\n";
+	for (const auto& item : settlementArchive) {
+		const SettlementReport& r = item.second;
+		outFile << r.year << " " << r.month << " " << r.recordCount << " " << llround(r.total * 100) << " "
+				<< hex << r.contentHash << dec << " " << r.categories.size() << "\n";
+		for (size_t c = 0; c < r.categories.size(); ++c) {
+			outFile << llround(r.categories[c].total * 100) << "," << r.categories[c].name << "\n";
+		}
+	}
+	if (!fileIO.writeFile(SETTLEMENT_ARCHIVE_FILE, outFile.str())) {
+		cerr << "错误：无法写入结算档案 " << SETTLEMENT_ARCHIVE_FILE << "\n";
+	}
+} // `saveSettlementArchive` 函数结束。
 
-// 【`saveExpenses` 方法实现 - 保存开销数据到文件】
-// `void ExpenseTracker::saveExpenses()` // 定义 `ExpenseTracker` 类的 `saveExpenses` 成员方法。
-void ExpenseTracker::saveExpenses() {
-	// `ofstream` // 是输出文件流 (output file stream) 类，来自 `<fstream>` 头文件，用于向文件写入数据。
-	// `outFile`  // 声明一个 `ofstream` 类型的对象 `outFile`。
-	// `(DATA_FILE)`// 在创建 `outFile` 对象时，尝试打开名为 `DATA_FILE` (在程序前面定义的常量，值为 "expenses.dat") 的文件用于写入。
-	               // 如果文件不存在，此操作会创建该文件。如果文件已存在，默认情况下，它会清空文件原有内容（覆盖写入）。
-	ofstream outFile(DATA_FILE); // 创建并打开用于写入数据的文件流。
-	// `if (!outFile)` // 检查文件流对象 `outFile` 是否处于有效状态。如果文件未能成功打开（例如由于权限问题或路径无效），则 `!outFile` 为 `true`。
-	if (!outFile) { // 如果文件打开失败
-		// `cerr` // 是标准错误输出流，通常也连接到控制台屏幕，专门用于输出错误信息。
-		cerr << "错误：无法打开文件 " << DATA_FILE << " 进行写入！\n"; // 向错误流打印错误消息。
-		return; // 从 `saveExpenses` 函数返回，不执行后续的保存操作。
-	} // 文件打开检查结束。
-
-	// 【将数据写入文件】
-	// `outFile << expenseCount << "\n";` // 首先，将当前总的开销记录数 `expenseCount` 写入文件，
-	                                   // 并在其后写入一个换行符 `\n`，以便在加载时可以先读取这个数量。
-	outFile << expenseCount << "\n"; // 写入记录总数。
-	// `for (int i = 0; i < expenseCount; ++i)` // 循环遍历所有有效的开销记录。
+// 【`invalidateSettlementCache` 方法实现 - 作废某月的结算档案】
+// 补记 (back-dated addExpense)、删除或导入改动了已结算月份的数据时调用；下次重新打印时会重新计算。
+void ExpenseTracker::invalidateSettlementCache(int year, int month) {
+	if (backgroundSettlement) settlementTouchedMonths.insert(year * 100 + month); // 后台结算中该月的快照已过时
+	if (settlementArchive.erase(year * 100 + month) > 0) {
+		saveSettlementArchive();
+		cout << "提示：" << year << "年" << month << "月已结算，该月的结算档案已作废，重新打印时将重新计算。\n";
+	}
+} // `invalidateSettlementCache` 函数结束。
+
+// 【`printArchivedReport` 方法实现 - 打印结算档案中的报告】
+void ExpenseTracker::printArchivedReport(const SettlementReport& report) {
+	cout << "\n--- " << report.year << "年" << setfill('0') << setw(2) << report.month << setfill(' ') << "月 开销报告 (结算档案) ---\n";
+	if (report.recordCount == 0) {
+		cout << "该月份没有开销记录。\n";
+		return;
+	}
+	cout << "记录数: " << report.recordCount << "\n";
+	cout << left << setw(12 + 30 + 20) << "本月总计:"
+		 << right << fixed << setprecision(2) << setw(10) << report.total << "\n\n";
+	if (!report.categories.empty()) {
+		writeCategoryBudgetTable(cout, budgets, report.year, report.month, report.categories.data(), (int)report.categories.size());
+	}
+	cout << "内容校验值: " << hex << report.contentHash << dec << "\n";
+	cout << "--- 报告结束 ---\n";
+} // `printArchivedReport` 函数结束。
+
+// 【`reprintSettlement` 方法实现 - 重新打印已结算月份的报告】
+// 档案命中时只做一次查找；档案缺失或已作废时重新计算 (并重新写入档案)。
+void ExpenseTracker::reprintSettlement() {
+	int lastYear, lastMonth;
+	readLastSettlement(lastYear, lastMonth);
+	if (!settlementArchive.empty()) { // 列出档案中已有的月份
+		cout << "\n结算档案中的月份:";
+		for (const auto& item : settlementArchive) {
+			cout << " " << item.second.year << "-" << setfill('0') << setw(2) << item.second.month << setfill(' ');
+		}
+		cout << "\n";
+	}
+	int year, month;
+	cout << "输入年份 (YYYY) (输入 0 返回): ";
+	while (!(cin >> year)) { cout << "年份输入无效，请重新输入 (输入 0 返回): "; cin.clear(); clearInputBuffer(); }
+	clearInputBuffer();
+	if (year == 0) return;
+	cout << "输入月份 (MM) (输入 0 返回): ";
+	while (!(cin >> month) || (month != 0 && (month < 1 || month > 12))) {
+		cout << "月份输入无效 (1-12)，请重新输入 (输入 0 返回): ";
+		cin.clear(); clearInputBuffer();
+	}
+	clearInputBuffer();
+	if (month == 0) return;
+
+	auto it = settlementArchive.find(year * 100 + month);
+	if (it != settlementArchive.end()) { // 档案命中
+		printArchivedReport(it->second);
+		return;
+	}
+	if (year > lastYear || (year == lastYear && month > lastMonth)) { // 尚未结算的月份没有结算报告
+		cout << "该月份尚未结算 (最近结算到 " << lastYear << "年" << lastMonth << "月)。\n";
+		return;
+	}
+	generateMonthlyReportForSettlement(year, month); // 重新计算，同时写回档案。
+} // `reprintSettlement` 函数结束。
+
+// 【`refreshColumns` 方法实现 - 按需重建列式快照】
+// 数据版本号没变时直接复用上一次的快照，连续多次查询不必重复拆列。
+void ExpenseTracker::refreshColumns() {
+	if (columns.valid && columns.version == dataVersion && columns.dates.size() == (size_t)expenseCount) return;
+	columns.dates.resize(expenseCount);
+	columns.cents.resize(expenseCount);
+	columns.categoryIds.resize(expenseCount);
+	columns.categoryNames.clear();
+	columns.categoryCounts.clear();
+	unordered_map<string, int> ids; // 类别名称 -> 编号
 	for (int i = 0; i < expenseCount; ++i) {
-		// 将每条开销记录的各个字段（通过getter方法获取）依次写入到文件流 `outFile` 中。
-		// 字段之间用逗号 `,` 作为分隔符，这是一种简单的CSV (Comma-Separated Values，逗号分隔值) 格式。
-		// 每条记录的所有字段写完后，写入一个换行符 `\n`，表示该条记录结束，下一条记录将从新的一行开始。
-		outFile << allExpenses[i].getYear() << ","          // 写入年份，后跟逗号。
-				<< allExpenses[i].getMonth() << ","         // 写入月份，后跟逗号。
-				<< allExpenses[i].getDay() << ","           // 写入日期，后跟逗号。
-				<< allExpenses[i].getDescription() << "," // 写入描述，后跟逗号。描述本身可能包含空格，但因为我们按行读取且用逗号分隔，通常能正确处理。
-				<< allExpenses[i].getAmount() << ","      // 写入金额，后跟逗号。
-				<< allExpenses[i].getCategory() << "\n";    // 写入类别，后跟换行符。
-	} // 记录写入循环结束。
-	// `outFile.close();` // 关闭文件流。这是一个良好的编程习惯，它确保所有缓冲在内存中的数据都被实际写入到物理文件中，
-	                   // 并且释放与该文件关联的系统资源。
-	                   // (虽然 `ofstream` 对象在销毁时其析构函数通常会自动关闭文件，但显式调用 `close()` 更明确和安全。)
-	outFile.close(); // 关闭文件。
-} // `saveExpenses` 函数结束。
+		const Expense& e = allExpenses[i];
+		columns.dates[i] = dateKey(e);
+		columns.cents[i] = llround(e.getAmount() * 100);
+		auto it = ids.find(e.getCategory());
+		int id;
+		if (it == ids.end()) { // 新类别
+			id = (int)columns.categoryNames.size();
+			ids[e.getCategory()] = id;
+			columns.categoryNames.push_back(e.getCategory());
+			columns.categoryCounts.push_back(0);
+		} else {
+			id = it->second;
+		}
+		columns.categoryIds[i] = id;
+		columns.categoryCounts[id]++;
+	}
+	columns.version = dataVersion;
+	columns.valid = true;
+} // `refreshColumns` 函数结束。
 
-// 【`loadExpenses` 方法实现 - 从文件加载开销数据】
-// `bool ExpenseTracker::loadExpenses()` // 定义 `ExpenseTracker` 类的 `loadExpenses` 成员方法。
-                                     // 此方法尝试从数据文件加载开销记录，并返回一个 `bool` 值：
-                                     // `true` 表示加载过程尝试进行（即使可能部分记录无效），`false` 表示文件无法打开或头部信息无效。
-bool ExpenseTracker::loadExpenses() {
-	// `ifstream` // 是输入文件流 (input file stream) 类，来自 `<fstream>` 头文件，用于从文件读取数据。
-	// `inFile`   // 声明一个 `ifstream` 类型的对象 `inFile`。
-	// `(DATA_FILE)`// 在创建 `inFile` 对象时，尝试打开名为 `DATA_FILE` 的文件用于读取。
-	ifstream inFile(DATA_FILE); // 创建并打开用于读取数据的文件流。
-	// `if (!inFile)` // 检查文件流对象 `inFile` 是否有效。如果文件未能成功打开（例如文件不存在或无读取权限），则 `!inFile` 为 `true`。
-	if (!inFile) { // 如果文件打开失败
-		return false; // 返回 `false`，表示加载失败，程序将开始新的记录。
-	} // 文件打开检查结束。
+// 【选择向量收窄】对选择向量中的每个行号检查一列的值，原地保留满足条件的行号。
+template <typename T, typename Test>
+void narrowColumn(vector<uint32_t>& selection, const T* column, Test test) {
+	size_t kept = 0;
+	for (size_t k = 0; k < selection.size(); ++k) {
+		uint32_t row = selection[k];
+		if (test(column[row])) selection[kept++] = row;
+	}
+	selection.resize(kept);
+}
 
-	// 【从文件读取数据内容】
-	int countFromFile; // 声明一个整型变量，用于存储从文件第一行读取到的记录总数。
-	inFile >> countFromFile; // 尝试从文件流 `inFile` 中读取一个整数，并存入 `countFromFile`。
-	                       // 这对应于 `saveExpenses` 中首先写入记录总数的做法。
-	// `inFile.fail()` // 检查上一次读取操作（即 `inFile >> countFromFile`）是否失败。
-	                 // 失败的可能原因包括：文件为空，文件第一行不是有效的数字，或者达到了文件末尾等。
-	// `countFromFile < 0 || countFromFile > MAX_EXPENSES` // 检查读取到的数量是否在一个合理的范围内。
-	                                                      // 小于0显然是无效的。大于 `MAX_EXPENSES` 表示文件中的记录数超出了程序内部数组的容量。
-	if (inFile.fail() || countFromFile < 0 || countFromFile > MAX_EXPENSES) { // 如果读取数量失败，或数量无效
-		expenseCount = 0; // 将程序内部的当前开销记录数 `expenseCount` 重置为0。
-		inFile.close();   // 关闭已打开的文件。
-		return false;     // 返回 `false`，表示加载失败或文件内容不符合预期。
-	} // 记录总数验证结束。
-	// `inFile.ignore(numeric_limits<streamsize>::max(), '\n');` // 在成功读取记录总数 `countFromFile` 之后，
-	                                                          // 文件流的当前读取位置可能在数字之后、换行符之前（如果数字后有空格或制表符），或者正好在换行符上。
-	                                                          // 调用 `ignore` 来跳过并丢弃第一行中剩余的所有字符，直到并包括第一个换行符 `\n`。
-	                                                          // 这是为了确保后续的 `getline` 函数能从文件的第二行（即第一条实际的开销记录）开始正确读取。
-	inFile.ignore(numeric_limits<streamsize>::max(), '\n'); // 忽略第一行（记录总数那一行）末尾的换行符。
+// 数值比较: 比较符在循环外分派，每种比较符各自是一个紧凑的循环。
+template <typename T, typename Extract>
+void narrowNumeric(vector<uint32_t>& selection, const T* column, FilterTerm::Op op, int64_t value, Extract extract) {
+	switch (op) {
+		case FilterTerm::EQ: narrowColumn(selection, column, [&](T x) { return extract(x) == value; }); break;
+		case FilterTerm::NE: narrowColumn(selection, column, [&](T x) { return extract(x) != value; }); break;
+		case FilterTerm::LT: narrowColumn(selection, column, [&](T x) { return extract(x) < value; }); break;
+		case FilterTerm::LE: narrowColumn(selection, column, [&](T x) { return extract(x) <= value; }); break;
+		case FilterTerm::GT: narrowColumn(selection, column, [&](T x) { return extract(x) > value; }); break;
+		case FilterTerm::GE: narrowColumn(selection, column, [&](T x) { return extract(x) >= value; }); break;
+		default: selection.clear();
+	}
+}
 
-	string line;          // 声明一个 `string` 变量 `line`，用于存储从文件中读取的每一整行文本（即一条序列化后的开销记录）。
-	int loadedCount = 0;  // 声明一个整型变量 `loadedCount`，用于计数实际成功加载并解析到内存中的开销记录数量，初始化为0。
-	// `for (int i = 0; i < countFromFile; ++i)` // 根据从文件头部读取到的 `countFromFile`，尝试循环读取并解析相应数量的记录行。
-	for (int i = 0; i < countFromFile; ++i) {
-		// `if (!getline(inFile, line))` // 尝试从文件流 `inFile` 中读取一整行（直到换行符）到 `line` 变量中。
-		                              // `getline` 如果成功读取一行，返回 `true` (在布尔上下文中)；如果到达文件末尾或发生错误，返回 `false`。
-		                              // `!getline(...)` 表示如果读取失败。
-		if (!getline(inFile, line)) { // 如果无法再从文件中读取到一行 (例如文件比声明的记录数要短)
-			break; // `break;` 跳出当前的 `for` 循环，停止进一步的加载尝试。
-		} // 行读取检查结束。
+// 【`narrowSelection` 方法实现 - 用一个条件收窄选择向量】
+void ExpenseTracker::narrowSelection(const FilterTerm& term, vector<uint32_t>& selection) {
+	const int32_t* dates = columns.dates.data();
+	switch (term.field) {
+		case FilterTerm::DATE:   narrowNumeric(selection, dates, term.op, term.number, [](int32_t d) { return (int64_t)d; }); break;
+		case FilterTerm::YEAR:   narrowNumeric(selection, dates, term.op, term.number, [](int32_t d) { return (int64_t)(d / 10000); }); break;
+		case FilterTerm::MONTH:  narrowNumeric(selection, dates, term.op, term.number, [](int32_t d) { return (int64_t)(d / 100 % 100); }); break;
+		case FilterTerm::DAY:    narrowNumeric(selection, dates, term.op, term.number, [](int32_t d) { return (int64_t)(d % 100); }); break;
+		case FilterTerm::AMOUNT: narrowNumeric(selection, columns.cents.data(), term.op, term.number, [](int64_t c) { return c; }); break;
+		case FilterTerm::CATEGORY: { // 先把候选值换成"类别编号 -> 是否命中"的表，每行只需一次下标访问
+			vector<char> hit(columns.categoryNames.size(), 0);
+			for (size_t id = 0; id < columns.categoryNames.size(); ++id) {
+				for (size_t v = 0; v < term.values.size(); ++v) {
+					if (columns.categoryNames[id] == term.values[v]) hit[id] = 1;
+				}
+			}
+			char expected = term.op == FilterTerm::NE ? 0 : 1;
+			const char* table = hit.data();
+			narrowColumn(selection, columns.categoryIds.data(), [=](int32_t id) { return table[id] == expected; });
+			break;
+		}
+		case FilterTerm::DESCRIPTION: { // 描述没有单独成列，直接访问记录
+			size_t kept = 0;
+			const string& text = term.values[0];
+			for (size_t k = 0; k < selection.size(); ++k) {
+				const string& desc = allExpenses[selection[k]].getDescription();
+				bool match = term.op == FilterTerm::CONTAINS ? desc.find(text) != string::npos
+							 : term.op == FilterTerm::EQ ? desc == text : desc != text;
+				if (match) selection[kept++] = selection[k];
+			}
+			selection.resize(kept);
+			break;
+		}
+	}
+} // `narrowSelection` 函数结束。
+
+// 【`estimateFilterCost` 方法实现 - 估算条件的选择率】
+// 类别条件可以用每个类别的记录数精确算出；其余条件在最多 256 行的等间距样本上试算。
+// 描述条件需要比较字符串，单行代价按 4 倍计，使它尽量排在后面只处理剩余的少量行。
+void ExpenseTracker::estimateFilterCost(FilterTerm& term) {
+	int rows = (int)columns.dates.size();
+	if (rows == 0) { term.estimatedCost = 0; return; }
+	double selectivity;
+	if (term.field == FilterTerm::CATEGORY) {
+		int matched = 0;
+		for (size_t id = 0; id < columns.categoryNames.size(); ++id) {
+			bool listed = find(term.values.begin(), term.values.end(), columns.categoryNames[id]) != term.values.end();
+			if (listed != (term.op == FilterTerm::NE)) matched += columns.categoryCounts[id];
+		}
+		selectivity = (double)matched / rows;
+	} else {
+		vector<uint32_t> sample;
+		int step = rows > 256 ? rows / 256 : 1;
+		for (int r = 0; r < rows; r += step) sample.push_back((uint32_t)r);
+		size_t sampled = sample.size();
+		narrowSelection(term, sample);
+		selectivity = (double)sample.size() / sampled;
+	}
+	term.estimatedCost = selectivity * (term.field == FilterTerm::DESCRIPTION ? 4.0 : 1.0);
+} // `estimateFilterCost` 函数结束。
+
+// 【分区级判断】year、month 条件对一个分区的所有记录结果相同；date 条件按该月的日期范围判断是否可能满足。
+// 返回 false 时该分区的任何记录都不满足条件。
+bool filterTermMayMatchMonth(const FilterTerm& term, int year, int month) {
+	int64_t low, high; // 该分区中该字段可能的取值范围
+	if (term.field == FilterTerm::DATE) { low = year * 10000 + month * 100 + 1; high = low + 30; }
+	else if (term.field == FilterTerm::YEAR) { low = high = year; }
+	else if (term.field == FilterTerm::MONTH) { low = high = month; }
+	else return true;
+	switch (term.op) {
+		case FilterTerm::EQ: return term.number >= low && term.number <= high;
+		case FilterTerm::NE: return low != high || term.number != low;
+		case FilterTerm::LT: return low < term.number;
+		case FilterTerm::LE: return low <= term.number;
+		case FilterTerm::GT: return high > term.number;
+		case FilterTerm::GE: return high >= term.number;
+		default: return true;
+	}
+}
+
+// 【逐行判断】一条记录是否满足一个条件，语义与 `narrowSelection` 相同。
+bool filterTermMatches(const FilterTerm& term, const Expense& e) {
+	int64_t value;
+	switch (term.field) {
+		case FilterTerm::DATE:   value = dateKey(e); break;
+		case FilterTerm::YEAR:   value = e.getYear(); break;
+		case FilterTerm::MONTH:  value = e.getMonth(); break;
+		case FilterTerm::DAY:    value = e.getDay(); break;
+		case FilterTerm::AMOUNT: value = llround(e.getAmount() * 100); break;
+		case FilterTerm::CATEGORY: {
+			bool listed = find(term.values.begin(), term.values.end(), e.getCategory()) != term.values.end();
+			return term.op == FilterTerm::NE ? !listed : listed;
+		}
+		case FilterTerm::DESCRIPTION: {
+			const string& desc = e.getDescription();
+			const string& text = term.values[0];
+			return term.op == FilterTerm::CONTAINS ? desc.find(text) != string::npos
+				   : term.op == FilterTerm::EQ ? desc == text : desc != text;
+		}
+		default: return false;
+	}
+	switch (term.op) {
+		case FilterTerm::EQ: return value == term.number;
+		case FilterTerm::NE: return value != term.number;
+		case FilterTerm::LT: return value < term.number;
+		case FilterTerm::LE: return value <= term.number;
+		case FilterTerm::GT: return value > term.number;
+		case FilterTerm::GE: return value >= term.number;
+		default: return false;
+	}
+}
+
+// 【`partitionBitmaps` 方法实现 - 取得一个分区的位图索引】
+// 已加载的分区在索引作废或缺失时从内存中的记录重建；未加载的分区只能使用从索引文件读入的有效索引，没有时返回空指针。
+PartitionBitmaps* ExpenseTracker::partitionBitmaps(int idx) {
+	const PartitionInfo& part = partitions[idx];
+	if (PartitionBitmaps* usable = usableBitmaps(idx)) return usable;
+	if (!part.loaded) return nullptr;
+
+	PartitionBitmaps& index = bitmapIndex[part.year * 100 + part.month];
+	index = PartitionBitmaps();
+	int from, to;
+	partitionRows(idx, from, to);
+	uint32_t ordinal = 0;
+	allExpenses.forEachInRange(from, to, [&](const Expense& e) { index.byCategory[e.getCategory()].add(ordinal++); });
+	index.recordCount = to - from;
+	index.blockHash = part.blockHash;
+	bitmapIndexChanged = true;
+	return &index;
+} // `partitionBitmaps` 函数结束。
+
+// 【`usableBitmaps` 方法实现 - 不重建，只返回仍然有效的位图索引】只读，可在共享锁下调用。
+PartitionBitmaps* ExpenseTracker::usableBitmaps(int idx) {
+	const PartitionInfo& part = partitions[idx];
+	auto it = bitmapIndex.find(part.year * 100 + part.month);
+	if (it == bitmapIndex.end() || it->second.stale || it->second.recordCount != part.recordCount) return nullptr;
+	return &it->second;
+} // `usableBitmaps` 函数结束。
+
+// 【`partitionRows` 方法实现 - 已加载分区的记录在内存中的行号范围 [from, to)】
+void ExpenseTracker::partitionRows(int idx, int& from, int& to) {
+	const PartitionInfo& part = partitions[idx];
+	int nextKey = part.month == 12 ? (part.year + 1) * 10000 + 100 : part.year * 10000 + (part.month + 1) * 100;
+	from = allExpenses.lowerBound(part.year * 10000 + part.month * 100);
+	to = allExpenses.lowerBound(nextKey);
+} // `partitionRows` 函数结束。
+
+// 【`filterCandidates` 方法实现 - 用位图求一个合取式在一个分区内的候选记录 (分区内序号)】
+// 类别条件 (=、in 取各类别位图的并集，!= 从全集中减去) 的结果是精确的；year、month 条件在分区级判断；
+// 其余条件留给调用方逐行检查。分区没有可用索引时返回 false；`rebuild` 为 false 时不重建已作废的索引 (共享锁下使用)。
+bool ExpenseTracker::filterCandidates(const vector<FilterTerm>& terms, int idx, RoaringBitmap& candidates, bool rebuild) {
+	const PartitionInfo& part = partitions[idx];
+	candidates = RoaringBitmap();
+	for (size_t t = 0; t < terms.size(); ++t) {
+		if (!filterTermMayMatchMonth(terms[t], part.year, part.month)) return true; // 整个分区都不满足
+	}
+	PartitionBitmaps* index = rebuild ? partitionBitmaps(idx) : usableBitmaps(idx);
+	if (!index) return false;
+	bool constrained = false; // 是否已有 = / in 类别条件
+	vector<const FilterTerm*> excluded;
+	for (size_t t = 0; t < terms.size(); ++t) {
+		const FilterTerm& term = terms[t];
+		if (term.field != FilterTerm::CATEGORY) continue;
+		if (term.op == FilterTerm::NE) { excluded.push_back(&term); continue; }
+		RoaringBitmap hit;
+		for (size_t v = 0; v < term.values.size(); ++v) {
+			auto found = index->byCategory.find(term.values[v]);
+			if (found != index->byCategory.end()) hit = hit.combine(found->second, RoaringBitmap::OR);
+		}
+		candidates = constrained ? candidates.combine(hit, RoaringBitmap::AND) : hit;
+		constrained = true;
+		if (candidates.empty()) return true;
+	}
+	if (!constrained) candidates = RoaringBitmap::range((uint32_t)index->recordCount);
+	for (size_t k = 0; k < excluded.size() && !candidates.empty(); ++k) {
+		for (size_t v = 0; v < excluded[k]->values.size(); ++v) {
+			auto found = index->byCategory.find(excluded[k]->values[v]);
+			if (found != index->byCategory.end()) candidates = candidates.combine(found->second, RoaringBitmap::ANDNOT);
+		}
+	}
+	return true;
+} // `filterCandidates` 函数结束。
+
+// 【`evaluateFilter` 方法实现 - 执行过滤表达式，返回满足条件的行号 (升序)】
+// 每个合取式先用位图算出各已加载分区中的候选记录，再只对这些行检查位图无法回答的条件 (date、day、amount、description)。
+vector<uint32_t> ExpenseTracker::evaluateFilter(const FilterExpression& filter) {
+	refreshColumns();
+	vector<uint32_t> result;
+	filterCandidateRows = 0;
+	for (size_t d = 0; d < filter.disjuncts.size(); ++d) {
+		const vector<FilterTerm>& conjunct = filter.disjuncts[d];
+		vector<uint32_t> selection; // 候选行号 (分区按年月升序，因此整体有序)
+		for (size_t p = 0; p < partitions.size(); ++p) {
+			if (!partitions[p].loaded) continue;
+			RoaringBitmap candidates;
+			filterCandidates(conjunct, (int)p, candidates); // 已加载的分区总有索引
+			if (candidates.empty()) continue;
+			uint32_t base = (uint32_t)allExpenses.lowerBound(partitions[p].year * 10000 + partitions[p].month * 100);
+			candidates.forEach([&](uint32_t ordinal) { selection.push_back(base + ordinal); });
+		}
+		filterCandidateRows += selection.size();
+
+		vector<FilterTerm> terms; // 位图已经精确处理了 category、year、month 条件
+		for (size_t t = 0; t < conjunct.size(); ++t) {
+			FilterTerm::Field field = conjunct[t].field;
+			if (field != FilterTerm::CATEGORY && field != FilterTerm::YEAR && field != FilterTerm::MONTH) terms.push_back(conjunct[t]);
+		}
+		for (size_t t = 0; t < terms.size(); ++t) estimateFilterCost(terms[t]);
+		sort(terms.begin(), terms.end(), [](const FilterTerm& a, const FilterTerm& b) { return a.estimatedCost < b.estimatedCost; });
+		for (size_t t = 0; t < terms.size() && !selection.empty(); ++t) {
+			narrowSelection(terms[t], selection); // 选择率低的条件先执行
+		}
+		if (d == 0) { result.swap(selection); continue; }
+		vector<uint32_t> merged; // or: 两个有序行号列表求并集
+		set_union(result.begin(), result.end(), selection.begin(), selection.end(), back_inserter(merged));
+		result.swap(merged);
+	}
+	return result;
+} // `evaluateFilter` 函数结束。
+
+// 【`loadPartitionsForFilter` 方法实现 - 只加载可能有满足条件记录的分区】
+// 未加载的分区如果有有效的位图索引，就先用索引求候选记录，所有合取式都没有候选时不读分区文件；
+// 没有索引的分区只按 date/year/month 条件裁剪。
+void ExpenseTracker::loadPartitionsForFilter(const FilterExpression& filter) {
+	vector<int> indices;
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		if (partitions[p].loaded) continue;
+		for (size_t d = 0; d < filter.disjuncts.size(); ++d) {
+			RoaringBitmap candidates;
+			if (!filterCandidates(filter.disjuncts[d], (int)p, candidates)) { // 没有索引: 看分区级条件
+				bool possible = true;
+				for (size_t t = 0; t < filter.disjuncts[d].size() && possible; ++t) {
+					possible = filterTermMayMatchMonth(filter.disjuncts[d][t], partitions[p].year, partitions[p].month);
+				}
+				if (!possible) continue;
+			} else if (candidates.empty()) {
+				continue;
+			}
+			indices.push_back((int)p);
+			break;
+		}
+	}
+	loadPartitions(indices); // 一次读入，各文件同时读取
+} // `loadPartitionsForFilter` 函数结束。
+
+// 【`readBitmapIndex` 方法实现 - 读取位图索引文件】
+// 只保留记录数和校验值都与清单一致的分区索引；文件缺失或损坏时丢弃全部索引，保存时重新写出。
+void ExpenseTracker::readBitmapIndex() {
+	string data;
+	bitmapIndex.clear();
+	bitmapIndexChanged = true;
+	if (!fileIO.readFile(BITMAP_INDEX_FILE, data)) return; // 还没有索引文件
+	size_t pos = sizeof(BITMAP_INDEX_MAGIC);
+	uint32_t partitionTotal;
+	bool ok = data.size() >= pos && memcmp(data.data(), BITMAP_INDEX_MAGIC, pos) == 0 && readBinary(data, pos, partitionTotal);
+	decltype(bitmapIndex) loaded;
+	bool allMatched = true;
+	for (uint32_t k = 0; ok && k < partitionTotal; ++k) {
+		int32_t year = 0, month = 0, recordCount = 0;
+		uint64_t blockHash = 0;
+		uint32_t categoryTotal = 0;
+		ok = readBinary(data, pos, year) && readBinary(data, pos, month) && readBinary(data, pos, recordCount)
+			 && readBinary(data, pos, blockHash) && readBinary(data, pos, categoryTotal);
+		PartitionBitmaps index;
+		index.recordCount = recordCount;
+		index.blockHash = blockHash;
+		for (uint32_t c = 0; ok && c < categoryTotal; ++c) {
+			uint32_t length;
+			ok = readBinary(data, pos, length) && data.size() - pos >= length;
+			if (!ok) break;
+			string name = data.substr(pos, length);
+			pos += length;
+			ok = index.byCategory[name].readFrom(data, pos);
+		}
+		if (!ok) break;
+		int idx = findPartition(year, month);
+		if (idx < 0 || blockHash == 0 || partitions[idx].blockHash != blockHash || partitions[idx].recordCount != recordCount) {
+			allMatched = false; // 分区在别处被改写过，这个月的索引作废
+			continue;
+		}
+		loaded[year * 100 + month] = move(index);
+	}
+	if (!ok) {
+		cerr << "警告：位图索引文件 " << BITMAP_INDEX_FILE << " 已损坏，将在保存时重新建立。\n";
+		return;
+	}
+	bitmapIndex.swap(loaded);
+	bitmapIndexChanged = !allMatched;
+} // `readBitmapIndex` 函数结束。
+
+// 【`rebuildBitmapIndex` 方法实现 - 为所有分区建立位图索引并保存】
+// 只读取过部分分区的账本，未加载的分区没有索引，过滤时仍需读取分区文件；这里一次性补齐并打印索引的大小。
+void ExpenseTracker::rebuildBitmapIndex() {
+	ensureAllPartitionsLoaded();
+	size_t bitmaps = 0, bytes = 0;
+	uint64_t values = 0;
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		PartitionBitmaps* index = partitionBitmaps((int)p);
+		if (!index) continue;
+		for (auto it = index->byCategory.begin(); it != index->byCategory.end(); ++it) {
+			string encoded;
+			it->second.appendTo(encoded);
+			++bitmaps;
+			bytes += encoded.size();
+			values += it->second.cardinality();
+		}
+	}
+	bitmapIndexChanged = true;
+	saveExpenses(); // 索引随清单一起写出
+	cout << "位图索引: " << partitions.size() << " 个分区，" << bitmaps << " 个类别位图，共 " << values
+		 << " 条记录，压缩后 " << bytes << " 字节 (保存在 " << BITMAP_INDEX_FILE << ")。\n";
+} // `rebuildBitmapIndex` 函数结束。
+
+// 【`bitmapIndexFileText` 方法实现 - 生成位图索引文件的内容】
+// 文件头之后是分区数，每个分区依次为 年、月、记录数、校验值、类别数，以及各类别的名称和位图。
+// 已加载的分区按当前记录重建 (若已作废)；未加载的分区只写出仍然有效的索引。需在分区的新校验值算出之后调用。
+string ExpenseTracker::bitmapIndexFileText() {
+	string out(BITMAP_INDEX_MAGIC, sizeof(BITMAP_INDEX_MAGIC));
+	vector<PartitionBitmaps*> entries;
+	vector<int> owners;
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		PartitionBitmaps* index = partitionBitmaps((int)p);
+		if (!index || partitions[p].blockHash == 0) continue;
+		index->blockHash = partitions[p].blockHash; // 已加载分区的索引对应刚写出的分区文件
+		entries.push_back(index);
+		owners.push_back((int)p);
+	}
+	appendBinary(out, (uint32_t)entries.size());
+	for (size_t k = 0; k < entries.size(); ++k) {
+		const PartitionInfo& part = partitions[owners[k]];
+		appendBinary(out, (int32_t)part.year);
+		appendBinary(out, (int32_t)part.month);
+		appendBinary(out, (int32_t)entries[k]->recordCount);
+		appendBinary(out, entries[k]->blockHash);
+		appendBinary(out, (uint32_t)entries[k]->byCategory.size());
+		for (auto it = entries[k]->byCategory.begin(); it != entries[k]->byCategory.end(); ++it) {
+			appendBinary(out, (uint32_t)it->first.size());
+			out += it->first;
+			it->second.appendTo(out);
+		}
+	}
+	return out;
+} // `bitmapIndexFileText` 函数结束。
+
+// 【`matchFilterRows` 方法实现 - 按行执行过滤表达式，返回满足条件的行号 (升序)】核心接口的查询使用。
+// 只读: 不建立列式快照，也不重建位图 (两者在每次写入后都会作废，重建需要独占锁)。
+// 位图有效的分区只检查候选行上其余的条件，位图已作废的分区逐行检查该月的全部记录。只考虑已加载的分区。
+vector<uint32_t> ExpenseTracker::matchFilterRows(const FilterExpression& filter) {
+	vector<uint32_t> result;
+	for (size_t d = 0; d < filter.disjuncts.size(); ++d) {
+		const vector<FilterTerm>& conjunct = filter.disjuncts[d];
+		vector<const FilterTerm*> rowTerms; // 位图回答不了的条件
+		for (size_t t = 0; t < conjunct.size(); ++t) {
+			FilterTerm::Field field = conjunct[t].field;
+			if (field != FilterTerm::CATEGORY && field != FilterTerm::YEAR && field != FilterTerm::MONTH) rowTerms.push_back(&conjunct[t]);
+		}
+		vector<uint32_t> selection;
+		for (size_t p = 0; p < partitions.size(); ++p) {
+			if (!partitions[p].loaded) continue;
+			int from, to;
+			partitionRows((int)p, from, to);
+			RoaringBitmap candidates;
+			if (filterCandidates(conjunct, (int)p, candidates, false)) {
+				candidates.forEach([&](uint32_t ordinal) {
+					uint32_t row = (uint32_t)from + ordinal;
+					const Expense& e = allExpenses[row];
+					bool match = true;
+					for (size_t t = 0; t < rowTerms.size() && match; ++t) match = filterTermMatches(*rowTerms[t], e);
+					if (match) selection.push_back(row);
+				});
+			} else { // 位图已作废: 逐行检查全部条件
+				uint32_t row = (uint32_t)from;
+				allExpenses.forEachInRange(from, to, [&](const Expense& e) {
+					bool match = true;
+					for (size_t t = 0; t < conjunct.size() && match; ++t) match = filterTermMatches(conjunct[t], e);
+					if (match) selection.push_back(row);
+					++row;
+				});
+			}
+		}
+		if (d == 0) { result.swap(selection); continue; }
+		vector<uint32_t> merged; // or: 两个有序行号列表求并集
+		set_union(result.begin(), result.end(), selection.begin(), selection.end(), back_inserter(merged));
+		result.swap(merged);
+	}
+	return result;
+} // `matchFilterRows` 函数结束。
+
+// 【`allPartitionsLoaded` 方法实现】所有分区是否都已读入内存。只读。
+bool ExpenseTracker::allPartitionsLoaded() {
+	for (size_t p = 0; p < partitions.size(); ++p) {
+		if (!partitions[p].loaded) return false;
+	}
+	return true;
+} // `allPartitionsLoaded` 函数结束。
+
+// 【`coreQuery` 方法实现 - 执行过滤表达式，把满足条件的记录复制到 `out`】
+// 表达式在锁外解析；全部分区已加载时只持共享锁，多个查询并发执行。第一次查询在独占锁下加载全部分区。
+bool ExpenseTracker::coreQuery(const string& filterText, vector<Expense>& out, string& error) {
+	FilterExpression filter;
+	if (!parseFilterExpression(filterText, filter, error)) return false;
+	out.clear();
+	{
+		shared_lock<shared_mutex> lock(coreLock);
+		if (allPartitionsLoaded()) {
+			vector<uint32_t> rows = matchFilterRows(filter);
+			out.reserve(rows.size());
+			for (size_t k = 0; k < rows.size(); ++k) out.push_back(allExpenses[rows[k]]);
+			return true;
+		}
+	}
+	unique_lock<shared_mutex> lock(coreLock);
+	ensureAllPartitionsLoaded();
+	vector<uint32_t> rows = matchFilterRows(filter);
+	out.reserve(rows.size());
+	for (size_t k = 0; k < rows.size(); ++k) out.push_back(allExpenses[rows[k]]);
+	return true;
+} // `coreQuery` 函数结束。
+
+// 【`summarizeMonth` 方法实现 - 从汇总立方体读出一个月的合计】只读，调用方需持锁并保证该月分区已加载。
+void ExpenseTracker::summarizeMonth(int year, int month, MonthSummary& out) {
+	CubeSlice slice;
+	slice.year = year;
+	slice.month = month;
+	vector<CubeCell> byCategory = cube.rollup(slice, CUBE_BY_CATEGORY);
+	out = MonthSummary();
+	out.year = year;
+	out.month = month;
+	for (size_t c = 0; c < byCategory.size(); ++c) {
+		if (byCategory[c].count == 0) continue;
+		out.categories.push_back(make_pair(cube.categoryNames[c], byCategory[c]));
+		out.totalCents += byCategory[c].cents;
+		out.recordCount += byCategory[c].count;
+	}
+} // `summarizeMonth` 函数结束。
 
-		// 【解析从文件中读取到的每一行数据】
-		// `stringstream ss(line);` // 用当前从文件中读取到的行 `line` 创建一个字符串流 `ss`。
-		                           // 字符串流使得我们可以方便地从这个行字符串中按分隔符提取各个字段的值。
-		stringstream ss(line); // 将行数据放入字符串流以方便解析。
-		string segment; // 声明一个 `string` 变量 `segment`，用于临时存储从行字符串流中按逗号分隔出来的每个数据片段。
-		// 声明并初始化用于存储解析出的开销数据的局部变量。
-		int year = 0, month = 0, day = 0; // 年、月、日，默认为0。
-		string description_str;           // 描述，默认为空字符串。
-		double amount = 0.0;              // 金额，默认为0.0。
-		string category_str;              // 类别，默认为空字符串。
-
-		// 【逐个字段解析】
-		// 使用 `getline(ss, segment, ',')` 从字符串流 `ss` 中读取内容到 `segment`，直到遇到逗号 `,` (逗号本身会被消耗掉但不会放入 `segment`)。
-		// 如果成功读取到一个片段，则进行后续的类型转换和错误处理。
-		// 如果 `getline` 失败（例如行中没有足够的逗号分隔的字段），则该记录解析失败。
-
-		// 解析年份
-		if (getline(ss, segment, ',')) { // 尝试读取年份片段。
-			// `try...catch` // 错误处理块。`stoi(segment)` 尝试将字符串 `segment` 转换为整数。
-			try { year = stoi(segment); } // 转换字符串到整数。
-			// `catch (const invalid_argument& ia)` // 如果 `segment` 不是有效的数字字符串 (例如 "abc")，`stoi` 会抛出 `std::invalid_argument` 异常。
-			catch (const invalid_argument& ia) { cerr << "警告：无效年份格式 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; /* `continue` 跳过当前 for 循环的剩余部分，直接开始下一次循环（处理下一行）。 */ }
-			// `catch (const out_of_range& oor)` // 如果 `segment` 是数字但超出了 `int` 类型能表示的范围，`stoi` 会抛出 `std::out_of_range` 异常。
-			catch (const out_of_range& oor) { cerr << "警告：年份超出范围 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; }
-		} else { cerr << "警告：记录 " << i+1 << " 数据不完整 (年份)。\n"; continue; } // 如果连年份片段都读不到，说明行数据不完整，跳过此记录。
-
-		// 解析月份 (逻辑与年份解析类似)
-		if (getline(ss, segment, ',')) {
-			try { month = stoi(segment); } catch (const invalid_argument& ia) { cerr << "警告：无效月份格式 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; } catch (const out_of_range& oor) { cerr << "警告：月份超出范围 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; }
-		} else { cerr << "警告：记录 " << i+1 << " 数据不完整 (月份)。\n"; continue; }
-		
-		// 解析日期 (逻辑与年份解析类似)
-		if (getline(ss, segment, ',')) {
-			try { day = stoi(segment); } catch (const invalid_argument& ia) { cerr << "警告：无效日期格式 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; } catch (const out_of_range& oor) { cerr << "警告：日期超出范围 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; }
-		} else { cerr << "警告：记录 " << i+1 << " 数据不完整 (日期)。\n"; continue; }
-
-		// 解析描述 (描述是字符串，不需要类型转换，但需要检查长度)
-		if (getline(ss, description_str, ',')) { // 尝试读取描述片段。
-			// `if (description_str.length() > Expense::MAX_DESCRIPTION_LENGTH)` // 如果读取到的描述长度超过了预设的最大长度
-			if (description_str.length() > Expense::MAX_DESCRIPTION_LENGTH) {
-				description_str = description_str.substr(0, Expense::MAX_DESCRIPTION_LENGTH); // 将描述截断到最大允许长度。
-			}
-		} else { cerr << "警告：记录 " << i+1 << " 数据不完整 (描述)。\n"; continue; } // 如果描述片段读不到，跳过此记录。
-		
-		// 解析金额 (使用 `stod` 将字符串转换为 `double` 类型)
-		if (getline(ss, segment, ',')) { // 尝试读取金额片段。
-			// `stod(segment)` // 尝试将字符串 `segment` 转换为 `double`。
-			try { amount = stod(segment); } // 转换。
-			// 类似 `stoi`，`stod` 也会在转换失败时抛出 `std::invalid_argument` 或 `std::out_of_range` 异常。
-			catch (const invalid_argument& ia) { cerr << "警告：无效金额格式 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; }
-			catch (const out_of_range& oor) { cerr << "警告：金额超出范围 '" << segment << "' 在记录 " << i+1 << "。跳过此记录。\n"; continue; }
-		} else { cerr << "警告：记录 " << i+1 << " 数据不完整 (金额)。\n"; continue; } // 如果金额片段读不到，跳过。
-
-		// 解析类别 (类别是行中的最后一个字段)
-		// `if (getline(ss, category_str))` // 注意这里调用 `getline` 时没有第三个参数（分隔符）。
-		                               // 这意味着它会从字符串流 `ss` 的当前位置读取所有剩余的字符，直到流结束（即行尾），并存入 `category_str`。
-		if (getline(ss, category_str)) { // 尝试读取类别片段（即行中剩余的部分）。
-			// `if (category_str.length() > Expense::MAX_CATEGORY_LENGTH)` // 如果类别长度超限
-			if (category_str.length() > Expense::MAX_CATEGORY_LENGTH) {
-				category_str = category_str.substr(0, Expense::MAX_CATEGORY_LENGTH); // 截断类别字符串。
-			}
-		} else { 
-			// 如果这里 `getline` 失败，可能意味着金额后面紧跟着就是行结束符，没有类别字段，或者类别字段为空。
-			// 在这种情况下，`category_str` 会保持其默认的空字符串状态。
-			// 程序允许这种情况，后续 `setData` 时空类别可能会被处理或使用默认值（例如 "未分类"，取决于 `Expense` 类的具体实现，不过当前 `Expense` 类并没有为 `category` 设置默认值）。
-		} // 类别解析结束。
-		
-		// 【将成功解析的数据存入开销对象数组】
-		// `if (loadedCount < MAX_EXPENSES)` // 检查当前已成功加载的记录数 `loadedCount` 是否仍小于程序内部数组 `allExpenses` 的最大容量 `MAX_EXPENSES`。
-		if (loadedCount < MAX_EXPENSES) { // 如果数组还有空间
-		   // `allExpenses[loadedCount]` // 访问数组中下一个可用的 `Expense` 对象。
-		   // `.setData(...)` // 调用该对象的 `setData` 方法，将从文件中解析出的各个字段值设置给它。
-		   allExpenses[loadedCount].setData(year, month, day, description_str, amount, category_str); // 将解析的数据设置到对象。
-		   loadedCount++; // 成功加载并存储的记录数加1。
-		} else { // 如果 `loadedCount` 已经等于 `MAX_EXPENSES` (数组已满)
-			// 即使文件中声明的 `countFromFile` 还有更多记录，但程序内部已无法存储，所以停止加载。
-			break; // 跳出 `for` 循环。
-		} // 容量检查结束。
-	} // `for` 循环（遍历文件中的记录行）结束。
-	// `expenseCount = loadedCount;` // 将 `ExpenseTracker` 对象的成员变量 `expenseCount` (表示当前程序中有效的开销记录总数)
-	                             // 更新为实际成功从文件中加载并解析到 `allExpenses` 数组中的记录数量 `loadedCount`。
-	expenseCount = loadedCount; // 更新当前程序中的总开销数量。
-	inFile.close(); // 关闭输入文件流。
-	return true;    // 返回 `true`，表示加载过程已尝试执行完毕（即使可能跳过了某些无效记录）。
-} // `loadExpenses` 函数结束。
+// 【`coreSummarize` 方法实现 - 一个月的合计与各类别合计】该月分区已加载时只持共享锁。
+bool ExpenseTracker::coreSummarize(int year, int month, MonthSummary& out) {
+	if (!isValidDate(year, month, 1)) return false;
+	{
+		shared_lock<shared_mutex> lock(coreLock);
+		int idx = findPartition(year, month);
+		if (idx < 0 || partitions[idx].loaded) {
+			summarizeMonth(year, month, out);
+			return true;
+		}
+	}
+	unique_lock<shared_mutex> lock(coreLock);
+	if (!ensurePartitionLoaded(year, month)) return false;
+	summarizeMonth(year, month, out);
+	return true;
+} // `coreSummarize` 函数结束。
 
-// 【`readLastSettlement` 方法实现 - 读取上次自动结算的年月】
-// `void ExpenseTracker::readLastSettlement(int& lastYear, int& lastMonth)` // 定义 `ExpenseTracker` 类的 `readLastSettlement` 私有成员方法。
-                                                                        // 这个方法用于从结算状态文件 (`SETTLEMENT_FILE`) 中读取上一次自动结算完成的年份和月份。
-                                                                        // 参数 `lastYear` 和 `lastMonth` 是整型引用 (`int&`)，
-                                                                        // 这意味着函数内部对这两个变量的修改会直接影响到调用该函数时传入的原始变量的值。
-void ExpenseTracker::readLastSettlement(int& lastYear, int& lastMonth) {
-	lastYear = 0;  // 将传入的 `lastYear` 引用参数初始化（或重置）为0。这作为一种默认值，如果文件读取失败或文件不存在，年份将保持为0。
-	lastMonth = 0; // 同样，将 `lastMonth` 初始化（或重置）为0。
-	// `ifstream inFile(SETTLEMENT_FILE);` // 创建一个输入文件流 `inFile`，并尝试打开名为 `SETTLEMENT_FILE` (常量，通常是 "settlement_status.txt") 的文件进行读取。
-	ifstream inFile(SETTLEMENT_FILE); // 打开结算状态记录文件。
-	// `if (inFile)` // 这是一个简洁的检查文件是否成功打开的方式。如果文件成功打开，`inFile` 对象在布尔上下文中会评估为 `true`。
-	if (inFile) { // 如果文件成功打开
-		// `inFile >> lastYear >> lastMonth;` // 从文件流 `inFile` 中尝试读取两个整数，并分别存入 `lastYear` 和 `lastMonth` 变量中。
-		                                   // 期望文件中的格式是：年份 数字，然后是一个空格或换行，然后是月份 数字。
-		inFile >> lastYear >> lastMonth; // 读取上一次结算的年份和月份。
-		inFile.close(); // 关闭文件流。即使不显式调用，当 `inFile` 对象离开作用域时其析构函数也会关闭文件，但显式关闭是好习惯。
-	} // 文件读取操作结束。
-	// 如果文件未能成功打开（例如文件不存在），则 `if (inFile)` 条件为 `false`，函数体内的读取操作不会执行，
-	// `lastYear` 和 `lastMonth` 将保持它们被初始化时的值0。
-} // `readLastSettlement` 函数结束。
+// 【`coreAdd` 方法实现 - 添加一条记录】
+// 新记录写入其所在月份的分区，保存时会重写整个分区文件，因此先把该分区已有的记录读入内存，否则保存时会丢失它们。
+// 类别按别名表规范化，重复记录按当前策略处理 (`action` 返回处理结果，跳过或合并时不新增记录)。
+// 成功新增时 `e` 带上分配的编号；金额远高于该类别近期水平时记入异常报告，并填写 `anomaly` (否则其编号保持为 0)。
+// 失败时返回 false，原因在 `error` 中。
+bool ExpenseTracker::coreAdd(Expense& e, string& error, DuplicateAction* action, AnomalyFlag* anomaly) {
+	if (!isValidDate(e.getYear(), e.getMonth(), e.getDay())) { error = "日期无效"; return false; }
+	if (e.getAmount() < 0) { error = "金额不能为负"; return false; }
+	unique_lock<shared_mutex> lock(coreLock);
+	if (!ensurePartitionLoaded(e.getYear(), e.getMonth()) || expenseCount >= MAX_EXPENSES) { // 分区加载失败或加载后容量已满
+		error = "无法加载该月份的数据或记录已满";
+		return false;
+	}
+	string canonical = normalizeCategory(e.getCategory());
+	if (canonical.empty()) canonical = "未分类";
+	if (canonical != e.getCategory()) e.setData(e.getYear(), e.getMonth(), e.getDay(), e.getDescription(), e.getAmount(), canonical);
+	// 【重复检测】该月分区已加载，索引中包含同一天的全部记录，查一次哈希表即可判断。
+	DuplicateAction result = resolveDuplicate(e);
+	if (action) *action = result;
+	if (result == DUPLICATE_SKIPPED || result == DUPLICATE_MERGED) return true;
+	int index = insertRecord(e); // 分配编号、按日期插入并更新各项索引与分区记录数。
+	e.setId(allExpenses[index].getId());
+	checkAnomaly(allExpenses[index], anomaly);
+	return true;
+} // `coreAdd` 函数结束。
 
-// 【`writeLastSettlement` 方法实现 - 写入新的自动结算年月】
-// `void ExpenseTracker::writeLastSettlement(int year, int month)` // 定义 `ExpenseTracker` 类的 `writeLastSettlement` 私有成员方法。
-                                                               // 这个方法用于将指定的 `year` 和 `month` 作为新的结算点写入到结算状态文件 (`SETTLEMENT_FILE`) 中。
-                                                               // 这通常在一次自动结算完成后被调用，以记录当前结算到的进度。
-void ExpenseTracker::writeLastSettlement(int year, int month) {
-	// `ofstream outFile(SETTLEMENT_FILE);` // 创建一个输出文件流 `outFile`，并尝试打开 `SETTLEMENT_FILE` 进行写入。
-	                                      // 打开文件进行写入时，如果文件已存在，其原有内容通常会被清空（覆盖模式）。
-	ofstream outFile(SETTLEMENT_FILE); // 打开结算状态记录文件以进行写入。
-	// `if (outFile)` // 检查文件是否成功打开以供写入。
-	if (outFile) { // 如果文件成功打开
-		// `outFile << year << " " << month << endl;` // 将传入的 `year`、一个空格字符、传入的 `month`，以及一个换行符 (`endl`) 依次写入文件流。
-		                                            // `endl` (end line) 不仅会写入换行符，通常还会刷新输出缓冲区，确保数据立即写入文件。
-		outFile << year << " " << month << endl; // 将年份和月份写入文件，用空格隔开，并以换行结束。
-		outFile.close(); // 关闭文件流。
-	} else { // `else` 分支：如果文件未能成功打开以供写入
-		// `cerr` // 标准错误输出流。
-		cerr << "错误：无法写入结算状态文件 " << SETTLEMENT_FILE << "\n"; // 向标准错误输出打印一条错误消息。
-	} // 文件写入操作结束。
-} // `writeLastSettlement` 函数结束。
+// 【`coreDelete` 方法实现 - 按编号删除一条记录】
+// `record` 是 `coreAdd` 添加的记录或 `coreQuery` 返回的副本: 按其日期定位到当天的记录，只需在当天的记录中找编号。
+// 记录已不存在 (例如已被其他线程删除) 时返回 false。
+bool ExpenseTracker::coreDelete(const Expense& record) {
+	unique_lock<shared_mutex> lock(coreLock);
+	if (!ensurePartitionLoaded(record.getYear(), record.getMonth())) return false;
+	int key = dateKey(record);
+	for (int row = allExpenses.lowerBound(key); row < expenseCount && dateKey(allExpenses[row]) == key; ++row) {
+		if (allExpenses[row].getId() != record.getId()) continue;
+		removeRows(vector<uint32_t>(1, (uint32_t)row)); // 与批量删除相同: 更新索引、留下删除标记
+		return true;
+	}
+	return false;
+} // `coreDelete` 函数结束。
 
-// 【`generateMonthlyReportForSettlement` 方法实现 - 为自动结算生成月度报告】
-// `void ExpenseTracker::generateMonthlyReportForSettlement(int year, int month)` // 定义 `ExpenseTracker` 类的 `generateMonthlyReportForSettlement` 私有成员方法。
-                                                                             // 这个函数的功能与 `displayMonthlySummary` 非常相似，都是生成指定年月的开销报告。
-                                                                             // 主要区别在于：
-                                                                             // 1. 它是私有的，主要由 `performAutomaticSettlement` 内部调用。
-                                                                             // 2. 输出的报告标题会明确指出这是"自动结算"生成的报告。
-                                                                             // 3. 它不直接从用户获取年月，而是通过参数传入。
-void ExpenseTracker::generateMonthlyReportForSettlement(int year, int month) {
-	// 打印报告标题，包含指定的年份和月份，并注明是"(自动结算)"
-	cout << "\n--- " << year << "年" << setfill('0') << setw(2) << month << setfill(' ') << "月 开销报告 (自动结算) ---\n";
-
-	// 【初始化统计变量】(与 `displayMonthlySummary` 中的逻辑相同)
-	double totalMonthAmount = 0; // 用于累加该月总开销。
-	bool foundRecords = false;   // 标志是否找到该月的记录。
-
-	CategorySum categorySums[MAX_UNIQUE_CATEGORIES_PER_MONTH]; // 存储按类别汇总的金额。
-	int uniqueCategoriesCount = 0; // 已统计的独立类别数量。
-	// `double maxCategoryTotal = 0.0;` // 此变量在 `displayMonthlySummary` 中也存在且未被使用，这里同样。
-	double maxCategoryTotal = 0.0; // (此变量当前未被使用)
-
-	cout << "明细:\n"; // 打印"明细:"子标题。
-	// 【打印表头】 (与 `displayMonthlySummary` 和 `displayAllExpenses` 中的表头格式一致)
-	cout << left
-			  << setw(12) << "日期"
-			  << setw(30) << "描述"
-			  << setw(20) << "类别"
-			  << right << setw(10) << "金额\n";
-	cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 分隔线。
-
-	// 【遍历所有开销记录，筛选、打印并汇总属于指定年月的记录】
-	// 这部分的逻辑与 `displayMonthlySummary` 方法中处理记录的部分完全相同。
-	// 因此，关于这部分循环、条件判断、打印格式化、金额累加、类别汇总的详细注释，请参考 `displayMonthlySummary` 方法中的对应注释。
-	for (int i = 0; i < expenseCount; ++i) {
-		if (allExpenses[i].getYear() == year && allExpenses[i].getMonth() == month) {
-			foundRecords = true;
-			cout << left
-					  << setw(4) << allExpenses[i].getYear() << "-"
-					  << setfill('0') << setw(2) << allExpenses[i].getMonth() << "-"
-					  << setw(2) << allExpenses[i].getDay() << setfill(' ') << "  "
-					  << setw(30) << allExpenses[i].getDescription()
-					  << setw(20) << allExpenses[i].getCategory()
-					  << right << fixed << setprecision(2) << setw(10) << allExpenses[i].getAmount() << "\n";
-			totalMonthAmount += allExpenses[i].getAmount();
-
-			bool categoryExists = false;
-			for (int j = 0; j < uniqueCategoriesCount; ++j) {
-				if (categorySums[j].name == allExpenses[i].getCategory()) {
-					categorySums[j].total += allExpenses[i].getAmount();
-					categoryExists = true;
-					// 更新 maxCategoryTotal (虽然未使用)
-					if (categorySums[j].total > maxCategoryTotal) maxCategoryTotal = categorySums[j].total;
-					break;
+// 【`runStressTest` 方法实现 - 核心接口的并发压力测试】
+// 对每个线程数运行 `seconds` 秒: 每个线程循环执行随机操作，`writePercent`% 为写 (添加或删除自己添加过的记录)，
+// 其余为读 (四分之三是按类别和月份的查询，四分之一是月度汇总)，记录每个操作的延迟，最后给出吞吐量和延迟分位数。
+// 写入都落在最后一年之后的一年 (不会使已结算月份的档案作废)；每轮结束时各线程删除自己剩下的记录，下一轮从相同的数据开始。
+// 测试只修改内存中的数据，不保存。
+void ExpenseTracker::runStressTest(const vector<int>& threadCounts, double seconds, int writePercent) {
+	{
+		unique_lock<shared_mutex> lock(coreLock);
+		ensureAllPartitionsLoaded();
+	}
+	int stressYear = partitions.empty() ? 2025 : partitions.back().year + 1; // 写入所在的年份
+	vector<string> categories = cube.categoryNames;
+	if (categories.empty()) categories = { "餐饮", "交通", "购物", "娱乐", "居住" };
+	if (expenseCount < STRESS_MIN_RECORDS) { // 记录太少时先生成测试数据
+		mt19937_64 rng(1);
+		string error;
+		for (int i = 0; i < STRESS_SEED_RECORDS; ++i) {
+			Expense e;
+			e.setData(stressYear, 1 + (int)(rng() % 12), 1 + (int)(rng() % 28), "测试数据", 1 + (rng() % 50000) / 100.0, categories[rng() % categories.size()]);
+			coreAdd(e, error);
+		}
+	}
+	vector<pair<int, int> > months; // 查询的年月: 现有分区和写入年份的各月
+	for (size_t p = 0; p < partitions.size(); ++p) months.push_back(make_pair(partitions[p].year, partitions[p].month));
+	for (int m = 1; m <= 12; ++m) months.push_back(make_pair(stressYear, m));
+
+	cout << "压力测试: " << expenseCount << " 条记录，每轮 " << seconds << " 秒，写操作占 " << writePercent
+		 << "%，写入 " << stressYear << " 年 (只修改内存中的数据，不保存)。\n";
+	cout << "线程数       次/秒     读p50     读p99    读最大     写p50     写p99    写最大   (延迟: 微秒)\n";
+	for (size_t round = 0; round < threadCounts.size(); ++round) {
+		int threads = threadCounts[round];
+		vector<StressWorkerStats> stats(threads);
+		atomic<bool> stop(false);
+		vector<thread> workers;
+		auto started = chrono::steady_clock::now();
+		for (int w = 0; w < threads; ++w) {
+			workers.emplace_back([&, w]() {
+				mt19937_64 rng(w * 7919 + threads);
+				StressWorkerStats& my = stats[w];
+				vector<Expense> added; // 本线程添加、尚未删除的记录
+				vector<Expense> rows;
+				string error;
+				while (!stop.load(memory_order_relaxed)) {
+					bool write = (int)(rng() % 100) < writePercent;
+					auto opStart = chrono::steady_clock::now();
+					if (write) {
+						if (!added.empty() && rng() % 2) {
+							coreDelete(added.back());
+							added.pop_back();
+						} else {
+							Expense e;
+							e.setData(stressYear, 1 + (int)(rng() % 12), 1 + (int)(rng() % 28), "压力测试", 1 + (rng() % 50000) / 100.0, categories[rng() % categories.size()]);
+							if (coreAdd(e, error) && e.getId() != 0) added.push_back(e);
+						}
+					} else {
+						const pair<int, int>& ym = months[rng() % months.size()];
+						if (rng() % 4 == 0) {
+							MonthSummary summary;
+							coreSummarize(ym.first, ym.second, summary);
+							my.queryRows += summary.recordCount;
+						} else {
+							string text = "category = \"" + categories[rng() % categories.size()] + "\" and year = " + to_string(ym.first) + " and month = " + to_string(ym.second);
+							coreQuery(text, rows, error);
+							my.queryRows += (long)rows.size();
+						}
+					}
+					double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - opStart).count();
+					(write ? my.writeMicros : my.readMicros).push_back(micros);
 				}
+				for (size_t k = 0; k < added.size(); ++k) coreDelete(added[k]); // 恢复本轮开始时的数据 (不计时)
+			});
+		}
+		this_thread::sleep_for(chrono::duration<double>(seconds));
+		stop = true;
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		for (size_t w = 0; w < workers.size(); ++w) workers[w].join();
+
+		vector<double> reads, writes;
+		for (int w = 0; w < threads; ++w) {
+			reads.insert(reads.end(), stats[w].readMicros.begin(), stats[w].readMicros.end());
+			writes.insert(writes.end(), stats[w].writeMicros.begin(), stats[w].writeMicros.end());
+		}
+		double throughput = (reads.size() + writes.size()) / elapsed;
+		cout << fixed << setprecision(0) << setw(6) << threads << setw(12) << throughput << setprecision(1)
+			 << setw(10) << percentile(reads, 0.5) << setw(10) << percentile(reads, 0.99) << setw(10) << percentile(reads, 1.0)
+			 << setw(10) << percentile(writes, 0.5) << setw(10) << percentile(writes, 0.99) << setw(10) << percentile(writes, 1.0) << "\n";
+	}
+	cout << defaultfloat << setprecision(6);
+} // `runStressTest` 函数结束。
+
+// 【`printFilterResults` 方法实现 - 解析、执行表达式并打印结果】菜单和批处理模式共用。
+bool ExpenseTracker::printFilterResults(const string& text) {
+	FilterExpression filter;
+	string error;
+	if (!parseFilterExpression(text, filter, error)) {
+		cout << "表达式错误：" << error << "\n";
+		return false;
+	}
+	loadPartitionsForFilter(filter);
+	auto start = chrono::steady_clock::now();
+	vector<uint32_t> rows = evaluateFilter(filter);
+	double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	printExpenseHeader();
+	double total = 0;
+	for (size_t k = 0; k < rows.size(); ++k) {
+		printExpenseRow(allExpenses[rows[k]]);
+		total += allExpenses[rows[k]].getAmount();
+	}
+	printExpenseSeparator();
+	cout << "共 " << rows.size() << " 条记录，合计 " << fixed << setprecision(2) << total
+		 << "，筛选耗时 " << setprecision(3) << elapsedMs << " ms (位图候选 " << filterCandidateRows << " 行，已加载 " << expenseCount << " 行)。\n";
+	cout << defaultfloat << setprecision(6) << memoryUsageLine() << "。\n";
+	return true;
+} // `printFilterResults` 函数结束。
+
+// 【`removeRows` 方法实现 - 一次删除多条记录】
+// `rows` 为升序行号。先更新各项索引，再由 `ExpenseStore::eraseRows` 对每块只做一遍压缩，
+// 而不是像单条删除那样每删一条就移动一次后面的记录。返回删除的条数。
+int ExpenseTracker::removeRows(const vector<uint32_t>& rows) {
+	if (rows.empty()) return 0;
+	for (size_t k = 0; k < rows.size(); ++k) {
+		const Expense& e = allExpenses[rows[k]];
+		recordRemoved(e); // 从月度累计等内存索引中扣除
+		addTombstone(e);
+		adjustPartitionCount(e.getYear(), e.getMonth(), -1);
+		invalidateSettlementCache(e.getYear(), e.getMonth());
+	}
+	allExpenses.eraseRows(rows);
+	int removed = expenseCount - allExpenses.size();
+	expenseCount = allExpenses.size();
+	return removed;
+} // `removeRows` 函数结束。
+
+// 【`bulkDeleteMatching` 方法实现 - 预览并删除满足条件的记录】
+// 先显示匹配的条数、合计金额和前几条明细；交互模式下需要两次确认 (与单条删除相同)，
+// 批处理模式下由调用方 (`--yes` 参数) 负责确认。删除后只保存一次。返回是否执行了删除。
+bool ExpenseTracker::bulkDeleteMatching(const FilterExpression& filter, bool interactive) {
+	const int PREVIEW_ROWS = 10; // 预览显示的最多条数
+	loadPartitionsForFilter(filter);
+	vector<uint32_t> rows = evaluateFilter(filter);
+	if (rows.empty()) {
+		cout << "没有满足条件的记录。\n";
+		return false;
+	}
+	double total = 0;
+	for (size_t k = 0; k < rows.size(); ++k) total += allExpenses[rows[k]].getAmount();
+	cout << "\n即将删除以下记录:\n";
+	printExpenseHeader();
+	for (size_t k = 0; k < rows.size() && k < (size_t)PREVIEW_ROWS; ++k) printExpenseRow(allExpenses[rows[k]]);
+	if (rows.size() > (size_t)PREVIEW_ROWS) cout << "... (其余 " << rows.size() - PREVIEW_ROWS << " 条未显示)\n";
+	printExpenseSeparator();
+	cout << "共 " << rows.size() << " 条记录，合计 " << fixed << setprecision(2) << total << "。\n";
+
+	if (interactive) {
+		char confirm;
+		cout << "确认删除这 " << rows.size() << " 条记录吗？ (y/n): ";
+		cin >> confirm;
+		clearInputBuffer();
+		if (confirm != 'y' && confirm != 'Y') {
+			cout << "取消删除操作。\n";
+			return false;
+		}
+		cout << "\n警告：此操作无法撤销！\n";
+		cout << "最后一次确认，真的要删除吗？ (y/n): ";
+		cin >> confirm;
+		clearInputBuffer();
+		if (confirm != 'y' && confirm != 'Y') {
+			cout << "已取消删除操作（二次确认未通过）。\n";
+			return false;
+		}
+	}
+	int removed = removeRows(rows);
+	saveExpenses(); // 所有删除完成后只写一次
+	cout << "已删除 " << removed << " 条记录，数据已自动保存。\n";
+	return true;
+} // `bulkDeleteMatching` 函数结束。
+
+// 【`bulkDeleteMenu` 方法实现 - 批量删除子菜单】
+// 三种方式最终都转换成过滤表达式，由 `bulkDeleteMatching` 统一预览和删除。
+void ExpenseTracker::bulkDeleteMenu() {
+	int choice; // 子菜单选项。
+	do {
+		cout << "\n--- 批量删除 ---\n";
+		cout << "1. 按日期范围删除\n";
+		cout << "2. 按类别删除\n";
+		cout << "3. 按过滤表达式删除\n";
+		cout << "0. 返回主菜单\n";
+		cout << "--------------------\n";
+		cout << "请输入选项: ";
+
+		cin >> choice; // 读取选项。
+		if (cin.fail()) { // 输入验证 (与主菜单相同)
+			cin.clear();
+			clearInputBuffer();
+			choice = -1;
+		} else {
+			clearInputBuffer();
+		}
+
+		FilterExpression filter;
+		string error;
+		switch (choice) {
+		case 1: {
+			string from, to;
+			cout << "起始日期 (YYYY-MM-DD): ";
+			getline(cin, from);
+			cout << "结束日期 (YYYY-MM-DD，含当天): ";
+			getline(cin, to);
+			if (!parseFilterExpression("date >= " + from + " and date <= " + to, filter, error)) {
+				cout << "日期格式无效。\n";
+				break;
 			}
-			if (!categoryExists && uniqueCategoriesCount < MAX_UNIQUE_CATEGORIES_PER_MONTH) {
-				categorySums[uniqueCategoriesCount].name = allExpenses[i].getCategory();
-				categorySums[uniqueCategoriesCount].total = allExpenses[i].getAmount();
-				// 更新 maxCategoryTotal (虽然未使用)
-				if (categorySums[uniqueCategoriesCount].total > maxCategoryTotal) maxCategoryTotal = categorySums[uniqueCategoriesCount].total;
-				uniqueCategoriesCount++;
+			bulkDeleteMatching(filter, true);
+			break;
+		}
+		case 2: {
+			string category;
+			cout << "要删除的类别: ";
+			getline(cin, category);
+			FilterTerm term; // 直接构造条件，类别名中的空格、引号不需要转义
+			term.field = FilterTerm::CATEGORY;
+			term.op = FilterTerm::EQ;
+			term.values.push_back(category);
+			filter.disjuncts.assign(1, vector<FilterTerm>(1, term));
+			bulkDeleteMatching(filter, true);
+			break;
+		}
+		case 3: {
+			string text;
+			cout << "示例: category = 餐饮 and date >= 2025-03-01 and date <= 2025-03-31\n";
+			cout << "输入过滤表达式: ";
+			getline(cin, text);
+			if (!parseFilterExpression(text, filter, error)) {
+				cout << "表达式错误：" << error << "\n";
+				break;
 			}
+			bulkDeleteMatching(filter, true);
+			break;
+		}
+		case 0:
+			break;
+		default:
+			cout << "无效选项，请重新输入。\n";
 		}
+	} while (choice != 0);
+} // `bulkDeleteMenu` 函数结束。
+
+// 【`loadCategories` 方法实现 - 读取类别与别名表】
+// 文件格式: 第一行为行数，之后每行一个规范类别名，或 "别名<TAB>规范名"。
+void ExpenseTracker::loadCategories() {
+	string text;
+	if (!fileIO.readFile(CATEGORY_FILE, text)) return; // 尚无类别表，加载记录时会逐步建立
+	istringstream inFile(text);
+	int count;
+	inFile >> count;
+	if (inFile.fail() || count < 0) {
+		cerr << "警告：类别文件 " << CATEGORY_FILE << " 格式无效，已忽略。\n";
+		return;
+	}
+	inFile.ignore(numeric_limits<streamsize>::max(), '\n');
+	string line;
+	for (int i = 0; i < count && getline(inFile, line); ++i) {
+		size_t tab = line.find('\t');
+		if (tab == string::npos) {
+			if (!line.empty()) registerCategory(line);
+			continue;
+		}
+		string alias = line.substr(0, tab), target = line.substr(tab + 1);
+		if (alias.empty() || target.empty()) {
+			cerr << "警告：类别文件第 " << i + 2 << " 行无效，已跳过。\n";
+			continue;
+		}
+		categoryIds[alias] = registerCategory(target);
+		categoryTrie.insert(alias);
 	}
+} // `loadCategories` 函数结束。
 
-	// 【输出统计结果】
-	if (!foundRecords) { // 如果该月份没有任何记录
-		cout << "该月份没有开销记录。\n"; // 打印提示。
-		return; // 直接从函数返回，不再输出后续的汇总信息。
-	} // 未找到记录判断结束。
+// 【`saveCategories` 方法实现 - 写回类别与别名表】
+void ExpenseTracker::saveCategories() {
+	if (!fileIO.writeFile(CATEGORY_FILE, categoryFileText())) {
+		cerr << "错误：无法写入类别文件 " << CATEGORY_FILE << "！\n";
+	}
+} // `saveCategories` 函数结束。
 
-	// 打印分隔线和本月总计 (逻辑与 `displayMonthlySummary` 相同)
-	cout << string(12 + 30 + 20 + 10, '-') << "\n";
-	cout << left << setw(12 + 30 + 20) << "本月总计:"
-			  << right << fixed << setprecision(2) << setw(10) << totalMonthAmount << "\n\n";
+// 【`categoryFileText` 方法实现 - 生成类别文件的内容】
+string ExpenseTracker::categoryFileText() {
+	ostringstream outFile;
+	vector<string> lines;
+	for (auto it = categoryIds.begin(); it != categoryIds.end(); ++it) {
+		const string& canonical = categoryNames[it->second];
+		lines.push_back(it->first == canonical ? canonical : it->first + "\t" + canonical);
+	}
+	sort(lines.begin(), lines.end()); // 固定顺序，便于比较前后两次的文件
+	outFile << lines.size() << "\n";
+	for (size_t i = 0; i < lines.size(); ++i) outFile << lines[i] << "\n";
+	return outFile.str();
+} // `categoryFileText` 函数结束。
 
-	// 打印按类别汇总 (逻辑与 `displayMonthlySummary` 相同)
-	if (uniqueCategoriesCount > 0) {
-		cout << "按类别汇总:\n";
-		cout << left << setw(20) << "类别" << right << setw(10) << "总金额\n";
-		cout << string(30, '-') << "\n";
-		for (int i = 0; i < uniqueCategoriesCount; ++i) {
-			cout << left << setw(20) << categorySums[i].name
-					  << right << fixed << setprecision(2) << setw(10) << categorySums[i].total << "\n";
+// 【`registerCategory` 方法实现 - 登记类别名，返回其规范类别编号】
+// 已知的名字 (包括别名) 直接返回对应编号；新名字作为新的规范类别加入字典和前缀树。
+int ExpenseTracker::registerCategory(const string& name) {
+	auto it = categoryIds.find(name);
+	if (it != categoryIds.end()) return it->second;
+	int id = (int)categoryNames.size();
+	categoryNames.push_back(name);
+	categoryIds[name] = id;
+	categoryTrie.insert(name);
+	return id;
+} // `registerCategory` 函数结束。
+
+// 【`normalizeCategory` 方法实现 - 求输入类别的规范名】
+// 每一级去掉首尾空白后，从第一级开始逐级加长前缀，在字典中查找: 前缀是别名时换成它的规范名，其余各级原样保留，
+// 例如别名 "吃饭" -> "餐饮" 时，"吃饭/午餐" 规范为 "餐饮/午餐"。未知类别原样 (去空白后) 返回，由调用方决定是否作为新类别。
+string ExpenseTracker::normalizeCategory(const string& raw) {
+	string name = normalizeCategoryPath(raw);
+	size_t end = 0; // 当前前缀的长度 (下一个分隔符的位置)
+	while (end < name.size()) {
+		end = name.find(CATEGORY_PATH_SEPARATOR, end + 1);
+		if (end == string::npos) end = name.size();
+		auto it = categoryIds.find(name.substr(0, end));
+		if (it == categoryIds.end() || categoryNames[it->second].compare(0, string::npos, name, 0, end) == 0) continue;
+		const string& canonical = categoryNames[it->second]; // 前缀是别名
+		name = canonical + name.substr(end);
+		end = canonical.size();
+	}
+	return name;
+} // `normalizeCategory` 函数结束。
+
+// 【`printCategorySuggestions` 方法实现 - 列出以 `prefix` 开头的已知类别】别名后注明对应的规范名。
+void ExpenseTracker::printCategorySuggestions(const string& prefix) {
+	vector<string> names = categoryTrie.complete(prefix, MAX_CATEGORY_SUGGESTIONS);
+	if (names.empty()) {
+		cout << "没有以 \"" << prefix << "\" 开头的已知类别。\n";
+		return;
+	}
+	cout << "已知类别:";
+	for (size_t i = 0; i < names.size(); ++i) {
+		const string& canonical = categoryNames[categoryIds[names[i]]];
+		cout << "  " << names[i];
+		if (canonical != names[i]) cout << " (-> " << canonical << ")";
+	}
+	if (names.size() == MAX_CATEGORY_SUGGESTIONS) cout << "  ...";
+	cout << "\n";
+} // `printCategorySuggestions` 函数结束。
+
+// 【`addCategoryAlias` 方法实现 - 把 `alias` 设为 `target` 的别名】
+// 如果 `alias` 或它的子类别已有记录，询问是否把这些记录的类别改为规范名 (子类别保留下级路径，例如 "吃饭/午餐" 改为 "餐饮/午餐")，
+// 会加载全部分区并标记修改过的分区待保存。
+void ExpenseTracker::addCategoryAlias(const string& alias, const string& target) {
+	string canonical = normalizeCategory(target); // 目标本身是别名时，指向它的规范名
+	if (alias == canonical) {
+		cout << "别名与规范名相同，未做修改。\n";
+		return;
+	}
+	auto underAlias = [&alias](const string& name) {
+		return name.compare(0, alias.size(), alias) == 0 && (name.size() == alias.size() || name[alias.size()] == CATEGORY_PATH_SEPARATOR);
+	};
+	bool wasCategory = false; // alias 或它的子类别是已有记录使用的规范类别
+	for (size_t c = 0; c < categoryNames.size() && !wasCategory; ++c) wasCategory = underAlias(categoryNames[c]);
+	int id = registerCategory(canonical);
+	categoryIds[alias] = id;
+	categoryTrie.insert(alias);
+	for (auto it = categoryIds.begin(); it != categoryIds.end(); ++it) { // 原先指向 alias 的别名改为指向新的规范类别
+		if (categoryNames[it->second] == alias) it->second = id;
+	}
+	saveCategories();
+	cout << "已添加别名: " << alias << " -> " << canonical << "\n";
+	if (!wasCategory) return;
+
+	cout << "\"" << alias << "\" 已有记录，是否把它们的类别改为 \"" << canonical << "\"？ (y/n): ";
+	char confirm;
+	cin >> confirm;
+	clearInputBuffer();
+	if (confirm != 'y' && confirm != 'Y') return;
+	if (!ensureAllPartitionsLoaded()) {
+		cout << "错误：部分月份的数据未能加载，已有记录的类别未修改。\n";
+		return;
+	}
+	int merged = 0;
+	for (int i = 0; i < expenseCount; ++i) {
+		Expense& e = allExpenses[i];
+		if (!underAlias(e.getCategory())) continue;
+		recordRemoved(e); // 先按旧类别扣除月度累计
+		e.setData(e.getYear(), e.getMonth(), e.getDay(), e.getDescription(), e.getAmount(), canonical + e.getCategory().substr(alias.size()));
+		recordAdded(e);
+		adjustPartitionCount(e.getYear(), e.getMonth(), 0); // 记录数不变，只标记分区待保存
+		invalidateSettlementCache(e.getYear(), e.getMonth());
+		++merged;
+	}
+	saveExpenses();
+	cout << "已合并 " << merged << " 条记录，数据已自动保存。\n";
+} // `addCategoryAlias` 函数结束。
+
+// 【`categoryMenu` 方法实现 - 类别管理子菜单】
+void ExpenseTracker::categoryMenu() {
+	int choice; // 子菜单选项。
+	do {
+		cout << "\n--- 类别管理 ---\n";
+		cout << "1. 列出所有类别与别名\n";
+		cout << "2. 按前缀查找类别\n";
+		cout << "3. 添加别名\n";
+		cout << "4. 删除别名\n";
+		cout << "0. 返回主菜单\n";
+		cout << "--------------------\n";
+		cout << "请输入选项: ";
+
+		cin >> choice; // 读取选项。
+		if (cin.fail()) { // 输入验证 (与主菜单相同)
+			cin.clear();
+			clearInputBuffer();
+			choice = -1;
+		} else {
+			clearInputBuffer();
 		}
-		cout << string(30, '-') << "\n";
-	} // 类别汇总打印结束。
 
-	cout << "--- 报告生成完毕 ---\n"; // 打印报告生成结束的标志。
-} // `generateMonthlyReportForSettlement` 函数结束。
+		switch (choice) {
+		case 1: {
+			vector<string> names = categoryTrie.complete("", categoryIds.size()); // 空前缀即全部
+			if (names.empty()) { cout << "还没有任何类别。\n"; break; }
+			for (size_t i = 0; i < names.size(); ++i) {
+				const string& canonical = categoryNames[categoryIds[names[i]]];
+				cout << "  " << names[i];
+				if (canonical != names[i]) cout << "  (别名 -> " << canonical << ")";
+				cout << "\n";
+			}
+			break;
+		}
+		case 2: {
+			string prefix;
+			cout << "输入类别前缀: ";
+			getline(cin, prefix);
+			printCategorySuggestions(trimCategory(prefix));
+			break;
+		}
+		case 3: {
+			string alias, target;
+			cout << "输入别名 (例如 吃饭): ";
+			getline(cin, alias);
+			cout << "输入它对应的规范类别 (例如 餐饮): ";
+			getline(cin, target);
+			alias = normalizeCategoryPath(alias);
+			if (alias.empty() || normalizeCategoryPath(target).empty()) { cout << "别名和类别都不能为空。\n"; break; }
+			addCategoryAlias(alias, target);
+			break;
+		}
+		case 4: {
+			string alias;
+			cout << "输入要删除的别名: ";
+			getline(cin, alias);
+			alias = normalizeCategoryPath(alias);
+			auto it = categoryIds.find(alias);
+			if (it == categoryIds.end() || categoryNames[it->second] == alias) { cout << "\"" << alias << "\" 不是别名。\n"; break; }
+			categoryIds.erase(it);
+			categoryTrie.erase(alias);
+			saveCategories();
+			cout << "已删除别名 " << alias << "。\n";
+			break;
+		}
+		case 0:
+			break;
+		default:
+			cout << "无效选项，请重新输入。\n";
+		}
+	} while (choice != 0);
+} // `categoryMenu` 函数结束。
 
-// 【`performAutomaticSettlement` 方法实现 - 执行自动结算】
-// `void ExpenseTracker::performAutomaticSettlement()` // 定义 `ExpenseTracker` 类的 `performAutomaticSettlement` 公有成员方法。
-                                                     // 此方法在程序启动时（在构造函数中）被调用，用于自动检查并处理（生成报告）
-                                                     // 从上一次结算点到当前月份之前的所有未结算月份的开销数据。
-void ExpenseTracker::performAutomaticSettlement() {
-	int lastSettledYear, lastSettledMonth; // 声明变量，用于存储从结算文件中读取到的上一次结算的年份和月份。
-	readLastSettlement(lastSettledYear, lastSettledMonth); // 调用 `readLastSettlement` 方法，尝试读取上次的结算信息，结果会存入 `lastSettledYear` 和 `lastSettledMonth`。
+// 【`newRecordId` 方法实现 - 生成新的记录编号】64 位随机数，两台机器各自新增的记录几乎不可能撞号。
+uint64_t ExpenseTracker::newRecordId() {
+	uint64_t id;
+	do { id = idGenerator(); } while (id == 0);
+	return id;
+} // `newRecordId` 函数结束。
 
-	// 【获取当前系统的年份和月份】
-	time_t now = time(0);                 // 获取当前时间的 `time_t` 表示。
-	tm *ltm = localtime(&now);            // 将 `time_t` 转换为 `tm` 结构体以获取本地时间。
-	int currentYear = 1900 + ltm->tm_year; // 当前公元年份。
-	int currentMonth = 1 + ltm->tm_mon;    // 当前月份 (1-12)。
+// 【`insertRecord` 方法实现 - 新增一条记录】
+// 没有编号时分配新编号，按日期插入，更新各项索引，所在分区记录数加 1 并标记待保存，已结算月份的档案作废。
+// 调用方负责先加载该月分区并检查容量。返回插入位置的下标。
+int ExpenseTracker::insertRecord(Expense e) {
+	if (e.getId() == 0) e.setId(newRecordId());
+	int index = allExpenses.insert(e);
+	recordAdded(allExpenses[index]);
+	expenseCount++;
+	adjustPartitionCount(e.getYear(), e.getMonth(), 1);
+	invalidateSettlementCache(e.getYear(), e.getMonth());
+	return index;
+} // `insertRecord` 函数结束。
 
-	// 【处理首次运行或无结算记录的情况】
-	// 如果 `readLastSettlement` 后 `lastSettledYear` 仍然是0 (其初始值)，
-	// 这通常意味着程序是首次运行，或者结算状态文件 (`SETTLEMENT_FILE`) 不存在或内容无效。
-	if (lastSettledYear == 0) { // 如果是首次运行或无有效结算记录
-		// 在这种情况下，需要设定一个"基准"的上次结算点。
-		// 这里的逻辑是将"上次结算点"设定为"当前月份的前一个月"。
-		// 这样做的目的是，当程序下次（或在后续的迭代中）执行自动结算时，它会从这个"上个月"开始检查，
-		// 而不是试图从一个非常遥远的过去（比如公元0年）开始检查，这避免了不必要的循环和处理。
-		lastSettledYear = currentYear;  // 先将上次结算年月设为当前年月。
-		lastSettledMonth = currentMonth;
-		if (lastSettledMonth == 1) { // 如果当前是1月份
-			lastSettledMonth = 12;   // 那么"上个月"就是去年的12月。
-			lastSettledYear--;       // 年份减1。
-		} else { // 如果当前不是1月份
-			lastSettledMonth--;      // "上个月"就是当前月份减1。
-		} // 上个月计算完毕。
-		// 将这个计算出来的"基准上次结算点"写入到结算状态文件中。
-		writeLastSettlement(lastSettledYear, lastSettledMonth);
-		// 向用户显示一条消息，告知已设置的基准结算点。
-		cout << "首次运行或无结算记录，已设置基准结算点为: "
-				  << lastSettledYear << "年" << setfill('0') << setw(2) << lastSettledMonth << setfill(' ') << "月。\n";
-		return; // 设置完基准点后，本次 `performAutomaticSettlement` 调用即结束，不再执行后续的追溯结算逻辑。
-	} // 首次运行处理结束。
+// 【`insertRecords` 方法实现 - 批量插入新记录】效果与对每条记录调用 `insertRecord` 相同，
+// 但有序存储只做一次排序归并，结算档案每个月份只作废一次。`batch` 中的记录随之带上分配的编号。
+void ExpenseTracker::insertRecords(vector<Expense>& batch) {
+	set<int> months;
+	for (size_t k = 0; k < batch.size(); ++k) {
+		Expense& e = batch[k];
+		if (e.getId() == 0) e.setId(newRecordId());
+		recordAdded(e);
+		adjustPartitionCount(e.getYear(), e.getMonth(), 1);
+		months.insert(e.getYear() * 100 + e.getMonth());
+	}
+	allExpenses.insertMany(batch);
+	expenseCount += (int)batch.size();
+	for (int key : months) invalidateSettlementCache(key / 100, key % 100);
+} // `insertRecords` 函数结束。
 
-	// 【从上次记录的结算点开始，逐月检查并处理，直到当前月份之前】
-	// 初始化要开始检查结算的年份和月份，使用从文件中读取到的 `lastSettledYear` 和 `lastSettledMonth`。
-	int yearToSettle = lastSettledYear;
-	int monthToSettle = lastSettledMonth;
+// 【`addTombstone` 方法实现 - 为被删除的记录留下删除标记】
+void ExpenseTracker::addTombstone(const Expense& e) {
+	partitions[getOrCreatePartition(e.getYear(), e.getMonth())].tombstones.insert(e.getId());
+	if (anomalyFlags.erase(e.getId())) anomalyStateChanged = true; // 被删除的记录不再出现在异常报告中
+} // `addTombstone` 函数结束。
 
-	// `while (true)` // 开始一个循环，这个循环会不断地将 `yearToSettle` 和 `monthToSettle` 向前推进一个月，
-	               // 并为每个推进后的月份生成报告，直到达到不需要再结算的条件。
-	while (true) {
-		// 首先，将要结算的月份向前推进一个月。
-		monthToSettle++; // 月份加1。
-		if (monthToSettle > 12) { // 如果月份超过12 (例如从12月变成13月)
-			monthToSettle = 1;    // 月份重置为1月。
-			yearToSettle++;       // 年份加1。
-		} // 月份和年份推进完毕。
+/*
+【账本同步】
+两份账本 (本目录的 expenses_data/ 与另一个目录) 按月分区比较:
+1. 清单里记着每个分区的校验值 (记录编号+内容的哈希和，加上删除标记)，先只比较两份清单；
+   校验值相同的月份直接跳过，两份大部分相同的账本只需读写有差异的那几个月。
+2. 有差异的月份读入双方的记录和删除标记，按记录编号合并:
+   - 任一方有删除标记的编号，双方都删除 (删除标记取并集，并继续保留)；
+   - 只在一方存在的编号，复制到另一方；
+   - 双方都有但内容不同 (例如一方修改了类别)，取内容哈希较大的一方，保证两边各自同步的结果一致。
+3. 合并结果写回本账本，并把这些月份的分区文件和整份清单写到对方目录，同步后两份清单完全相同。
+*/
+bool ExpenseTracker::syncLedger(const string& otherPath) {
+	error_code ec;
+	filesystem::path remoteDir(otherPath);
+	if (!filesystem::exists(remoteDir / "manifest.txt", ec) && filesystem::exists(remoteDir / PARTITION_DIR, ec)) {
+		remoteDir /= PARTITION_DIR; // 给的是账本根目录
+	}
+	if (filesystem::exists(remoteDir, ec) && filesystem::exists(PARTITION_DIR, ec) && filesystem::equivalent(remoteDir, PARTITION_DIR, ec)) {
+		cerr << "错误：不能与本账本自身同步。\n";
+		return false;
+	}
+	filesystem::create_directories(remoteDir, ec); // 对方目录不存在时视为空账本 (同步即完整复制)
+	if (ec) {
+		cerr << "错误：无法创建目录 " << remoteDir.string() << "！\n";
+		return false;
+	}
+	saveExpenses(); // 先保存本地修改，使本地清单中的校验值都是最新的
+	vector<PartitionInfo> remote;
+	readManifestFile((remoteDir / "manifest.txt").string(), remote); // 没有清单时为空
 
-		// 【判断是否已追溯到不需要再结算的月份】
-		// 自动结算的目标是处理"过去"未结算的月份。
-		// 因此，如果 `yearToSettle` 已经超过了 `currentYear` (当前年份)，
-		// 或者，如果 `yearToSettle` 等于 `currentYear` 但 `monthToSettle` 已经等于或超过了 `currentMonth` (当前月份)，
-		// 这都意味着我们已经追溯到了当前月份或更远的未来，此时应该停止自动结算。
-		if (yearToSettle > currentYear || (yearToSettle == currentYear && monthToSettle >= currentMonth)) {
-			break; // `break;` 跳出当前的 `while (true)` 循环，自动结算过程结束。
-		} // 停止条件判断结束。
+	// 【比较清单】两份按年月有序的列表做归并，找出校验值不同 (或未知) 的月份。
+	vector<pair<int, int> > differing;
+	size_t li = 0, ri = 0;
+	int comparedMonths = 0;
+	while (li < partitions.size() || ri < remote.size()) {
+		int lkey = li < partitions.size() ? partitions[li].year * 100 + partitions[li].month : INT32_MAX;
+		int rkey = ri < remote.size() ? remote[ri].year * 100 + remote[ri].month : INT32_MAX;
+		int key = min(lkey, rkey);
+		bool same = lkey == rkey && partitions[li].blockHash != 0 && partitions[li].blockHash == remote[ri].blockHash;
+		++comparedMonths;
+		if (!same) differing.push_back(make_pair(key / 100, key % 100));
+		if (lkey == key) ++li;
+		if (rkey == key) ++ri;
+	}
+	int sent = 0, received = 0, deleted = 0, conflicts = 0;
+	vector<int> localDiffering; // 先把本地有差异的月份一次读入
+	for (size_t d = 0; d < differing.size(); ++d) {
+		int idx = findPartition(differing[d].first, differing[d].second);
+		if (idx >= 0) localDiffering.push_back(idx);
+	}
+	loadPartitions(localDiffering);
+	for (size_t d = 0; d < differing.size(); ++d) {
+		int year = differing[d].first, month = differing[d].second;
+		if (!ensurePartitionLoaded(year, month)) {
+			cerr << "错误：无法加载 " << year << "年" << month << "月的分区，同步中止。\n";
+			return false;
+		}
+		char name[16];
+		snprintf(name, sizeof(name), "%04d-%02d.dat", year, month);
+		vector<Expense> remoteRecords;
+		set<uint64_t> remoteTombstones;
+		readRecordFile((remoteDir / name).string(), remoteRecords, &remoteTombstones); // 对方没有该月时为空
 
-		// 【为当前需要结算的 `yearToSettle` 和 `monthToSettle` 生成报告】
-		// 打印开始结算当前月份的提示信息。
-		cout << "\n>>> 开始自动结算: " << yearToSettle << "年" << setfill('0') << setw(2) << monthToSettle << setfill(' ') << "月 <<\n";
-		// 调用 `generateMonthlyReportForSettlement` 方法为这个指定的年月生成并显示月度开销报告。
-		generateMonthlyReportForSettlement(yearToSettle, monthToSettle);
-		// 调用 `writeLastSettlement` 方法，将当前已成功结算的 `yearToSettle` 和 `monthToSettle` 写入结算状态文件，
-		// 这样下次程序启动时，就会从这个新的结算点开始。
-		writeLastSettlement(yearToSettle, monthToSettle);
-		// 打印完成结算当前月份的提示信息。
-		cout << ">>> 自动结算完成: " << yearToSettle << "年" << setfill('0') << setw(2) << monthToSettle << setfill(' ') << "月 <<\n";
-	} // `while (true)` 循环结束（当所有需要自动结算的月份都处理完毕时）。
-} // `performAutomaticSettlement` 函数结束。
+		PartitionInfo& part = partitions[getOrCreatePartition(year, month)];
+		set<uint64_t> tombstones = part.tombstones; // 删除标记取并集
+		tombstones.insert(remoteTombstones.begin(), remoteTombstones.end());
+		unordered_map<uint64_t, const Expense*> remoteById;
+		for (size_t k = 0; k < remoteRecords.size(); ++k) remoteById[remoteRecords[k].getId()] = &remoteRecords[k];
 
-// 【`deleteExpense` 方法实现 - 删除指定的开销记录】
-// `void ExpenseTracker::deleteExpense()` // 定义 `ExpenseTracker` 类的 `deleteExpense` 公有成员方法。
-                                      // 此方法允许用户查看所有开销记录，并选择一条进行删除。
-void ExpenseTracker::deleteExpense() {
-	if (expenseCount == 0) { // 首先检查当前是否有任何开销记录。
-		cout << "没有开销记录可供删除。\n"; // 如果没有记录，打印提示消息。
-		return; // 并从函数返回，不执行后续的删除逻辑。
-	} // 记录存在性检查结束。
+		// 本地该月的记录: 被删除的收集起来一次删除，内容冲突且对方胜出的就地改写。
+		int from = allExpenses.lowerBound(year * 10000 + month * 100);
+		int to = allExpenses.lowerBound(year * 10000 + month * 100 + 100);
+		vector<uint32_t> removals;
+		unordered_map<uint64_t, bool> localIds;
+		for (int i = from; i < to; ++i) {
+			Expense& e = allExpenses[i];
+			localIds[e.getId()] = true;
+			if (tombstones.count(e.getId())) { removals.push_back((uint32_t)i); continue; }
+			auto it = remoteById.find(e.getId());
+			if (it == remoteById.end()) { ++sent; continue; } // 对方没有: 随分区文件写给对方
+			const Expense& other = *it->second;
+			if (recordContentHash(other) == recordContentHash(e)) continue;
+			++conflicts;
+			if (recordContentHash(other) > recordContentHash(e)) { // 对方版本胜出 (日期相同，位置不变)
+				recordRemoved(e);
+				e.setData(other.getYear(), other.getMonth(), other.getDay(), other.getDescription(), other.getAmount(), other.getCategory());
+				recordAdded(e);
+				adjustPartitionCount(year, month, 0);
+				invalidateSettlementCache(year, month);
+			}
+		}
+		deleted += removeRows(removals);
+		for (size_t k = 0; k < remoteRecords.size(); ++k) { // 只在对方存在的记录
+			const Expense& e = remoteRecords[k];
+			if (localIds.count(e.getId()) || tombstones.count(e.getId())) continue;
+			if (expenseCount >= MAX_EXPENSES) {
+				cerr << "错误：内存记录已满，同步中止 (已合并的部分会在保存时写入)。\n";
+				return false;
+			}
+			insertRecord(e); // 保留对方的编号
+			++received;
+		}
+		PartitionInfo& merged = partitions[getOrCreatePartition(year, month)]; // 插入可能新建分区，重新取引用
+		merged.tombstones = tombstones;
+		merged.dirty = true;
+		merged.loaded = true;
+	}
+	saveExpenses(); // 写回本地有变化的分区，同时算出新的校验值
 
-	cout << "\n--- 删除开销记录 ---\n"; // 打印功能标题。
-	cout << "以下是所有开销记录:\n"; // 提示信息。
-	// 【显示所有开销记录及其序号，方便用户选择要删除的记录】
-	// 表头增加了一列 "序号"。
-	cout << left                                           // 设置后续输出左对齐。
-			  << setw(5) << "序号"                           // "序号"列，宽度为5。
-			  << setw(12) << "日期"                          // "日期"列，宽度为12。
-			  << setw(30) << "描述"                          // "描述"列，宽度为30。
-			  << setw(20) << "类别"                          // "类别"列，宽度为20。
-			  << right << setw(10) << "金额\n";              // "金额"列，宽度为10，右对齐，然后换行。
-	cout << string(5 + 12 + 30 + 20 + 10, '-') << "\n"; // 打印分隔线，宽度为所有列宽之和。
-
-	// `for (int i = 0; i < expenseCount; ++i)` // 循环遍历所有有效的开销记录。
-	for (int i = 0; i < expenseCount; ++i) {
-		// 打印每条记录的详细信息，并在最前面加上序号。
-		// `i + 1` // 因为数组索引 `i` 从0开始，所以用户看到的序号应该是 `i + 1`，从1开始计数，更符合用户习惯。
-		cout << left
-				  << setw(5) << i + 1 // 打印记录的序号 (1-based)。
-				  // 后续的日期、描述、类别、金额的打印格式与 `displayAllExpenses` 方法中的相同。
-				  << setw(4) << allExpenses[i].getYear() << "-"
-				  << setfill('0') << setw(2) << allExpenses[i].getMonth() << "-"
-				  << setw(2) << allExpenses[i].getDay() << setfill(' ') << "  "
-				  << setw(30) << allExpenses[i].getDescription()
-				  << setw(20) << allExpenses[i].getCategory()
-				  << right << fixed << setprecision(2) << setw(10) << allExpenses[i].getAmount() << "\n";
-	} // 记录列表打印循环结束。
-	cout << string(5 + 12 + 30 + 20 + 10, '-') << "\n"; // 打印列表末尾的分隔线。
-
-	// 【获取用户要删除的记录序号】
-	int recordNumberToDelete; // 声明一个整型变量，用于存储用户输入的要删除的记录的序号。
-	cout << "请输入要删除的记录序号 (0 取消删除): "; // 提示用户输入序号，并告知输入0可以取消删除。
-	// `while (!(cin >> recordNumberToDelete) || recordNumberToDelete < 0 || recordNumberToDelete > expenseCount)` // 开始一个循环，用于获取和验证用户输入的序号。
-	                                                                                                           // 循环条件解释：
-	                                                                                                           // `!(cin >> recordNumberToDelete)`: 如果从 `cin` 读取整数到 `recordNumberToDelete` 失败 (例如用户输入了文本)，则为 `true`。
-	                                                                                                           // `recordNumberToDelete < 0`: 如果用户输入的序号小于0 (无效)。
-	                                                                                                           // `recordNumberToDelete > expenseCount`: 如果用户输入的序号大于当前总记录数 (无效，因为序号是从1到`expenseCount`)。
-	                                                                                                           // 只要以上任何一个条件为 `true` (通过 `||` 或运算符连接)，整个循环条件就为 `true`，循环继续，提示用户重新输入。
-	while (!(cin >> recordNumberToDelete) || recordNumberToDelete < 0 || recordNumberToDelete > expenseCount) {
-		cout << "输入无效。请输入 1 到 " << expenseCount << " 之间的数字，或 0 取消: "; // 打印错误提示，明确告知有效的输入范围。
-		cin.clear();        // 清除 `cin` 的错误状态。
-		clearInputBuffer(); // 清除输入缓冲区中的无效内容。
-	} // 序号输入和验证循环结束。
-	clearInputBuffer(); // 清除用户输入有效序号后，残留在缓冲区中的换行符。
-
-	if (recordNumberToDelete == 0) { // 如果用户输入的是0 (表示取消删除操作)
-		cout << "取消删除操作。\n"; // 打印取消消息。
-		return; // 从 `deleteExpense` 函数返回，不执行任何删除。
-	} // 取消判断结束。
+	// 【写给对方】有差异的月份按本地合并结果重写；清单与本地完全相同。所有文件作为一批同时写出。
+	vector<FileRequest> writes;
+	for (size_t d = 0; d < differing.size(); ++d) {
+		int year = differing[d].first, month = differing[d].second;
+		char name[16];
+		snprintf(name, sizeof(name), "%04d-%02d.dat", year, month);
+		string path = (remoteDir / name).string();
+		int idx = findPartition(year, month);
+		if (idx < 0) { // 本地已没有该月 (无记录也无删除标记)
+			filesystem::remove(path, ec);
+			continue;
+		}
+		writes.push_back(FileRequest(path, partitionFileText(idx, nullptr)));
+	}
+	writes.push_back(FileRequest((remoteDir / "manifest.txt").string(), formatManifest(partitions)));
+	if (!fileIO.writeFiles(writes)) {
+		for (size_t k = 0; k < writes.size(); ++k) {
+			if (!writes[k].ok) cerr << "错误：无法写入 " << writes[k].path << "！\n";
+		}
+		return false;
+	}
 
-	// `int indexToDelete = recordNumberToDelete - 1;` // 将用户输入的基于1的记录序号 `recordNumberToDelete` 转换为基于0的数组索引 `indexToDelete`。
-	                                                // 例如，如果用户想删除第1条记录，其数组索引是0。
-	int indexToDelete = recordNumberToDelete - 1; // 计算要删除的记录在数组中的实际索引。
+	cout << "同步完成: 比较 " << comparedMonths << " 个月份，其中 " << differing.size() << " 个有差异；"
+		 << "发送 " << sent << " 条，接收 " << received << " 条，删除 " << deleted << " 条，内容冲突 " << conflicts << " 条。\n";
+	return true;
+} // `syncLedger` 函数结束。
 
-	// 【显示即将被删除的记录的详细信息，让用户进行第一次确认】
-	cout << "\n即将删除以下记录:\n"; // 提示信息。
-	// 打印表头 (不带序号列)
-	cout << left
-			  << setw(12) << "日期"
-			  << setw(30) << "描述"
-			  << setw(20) << "类别"
-			  << right << setw(10) << "金额\n";
-	cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 分隔线。
-	// 打印指定索引 `indexToDelete` 的那条开销记录的详细信息。
-	cout << left
-			  << setw(4) << allExpenses[indexToDelete].getYear() << "-"
-			  << setfill('0') << setw(2) << allExpenses[indexToDelete].getMonth() << "-"
-			  << setw(2) << allExpenses[indexToDelete].getDay() << setfill(' ') << "  "
-			  << setw(30) << allExpenses[indexToDelete].getDescription()
-			  << setw(20) << allExpenses[indexToDelete].getCategory()
-			  << right << fixed << setprecision(2) << setw(10) << allExpenses[indexToDelete].getAmount() << "\n";
-	cout << string(12 + 30 + 20 + 10, '-') << "\n"; // 末尾分隔线。
+// 【`syncMenu` 方法实现 - 数据工具中的同步入口】
+void ExpenseTracker::syncMenu() {
+	string path;
+	cout << "输入另一份账本的目录 (账本根目录或其中的 " << PARTITION_DIR << " 目录，直接回车取消): ";
+	getline(cin, path);
+	if (path.empty()) return;
+	syncLedger(path);
+} // `syncMenu` 函数结束。
 
-	// 【第一次确认删除】
-	char confirm; // 声明一个字符变量 `confirm`，用于存储用户的确认输入 (y/n)。
-	cout << "确认删除吗？ (y/n): "; // 提示用户输入确认。
-	cin >> confirm; // 读取用户输入的单个字符到 `confirm`。
-	clearInputBuffer(); // 清除输入字符后的换行符。
+// 【`filterQuery` 方法实现 - 条件查询菜单项】
+void ExpenseTracker::filterQuery() {
+	cout << "\n--- 条件查询 ---\n";
+	cout << "字段: date year month day amount category description\n";
+	cout << "示例: category in (餐饮, 交通) and amount > 50 and date >= 2025-03-01\n";
+	cout << "输入过滤表达式 (直接回车返回): ";
+	string text;
+	getline(cin, text);
+	if (text.empty()) return;
+	printFilterResults(text);
+} // `filterQuery` 函数结束。
 
-	// `if (confirm == 'y' || confirm == 'Y')` // 检查用户是否输入了 'y' 或 'Y' (表示同意删除)。
-	if (confirm == 'y' || confirm == 'Y') { // 如果用户第一次确认删除
-		// 【进行第二次最终确认 - 为了防止用户误操作，这是一个重要的安全措施】
-		cout << "\n警告：此操作无法撤销！\n"; // 打印警告信息。
-		cout << "最后一次确认，真的要删除这条记录吗？ (y/n): "; // 再次提示用户确认。
-		char final_confirm; // 声明字符变量 `final_confirm` 用于存储用户的最终确认。
-		cin >> final_confirm; // 读取最终确认输入。
-		clearInputBuffer(); // 清除换行符。
+// 【`writeJsonCategories` 方法实现 - 类别汇总数组】每个类别一个对象；设置了预算的类别带 "budget" 字段。
+void ExpenseTracker::writeJsonCategories(JsonWriter& json, int year, int month, const CategorySum categories[], int count) {
+	json.key("categories");
+	json.beginArray();
+	for (int c = 0; c < count; ++c) {
+		json.beginObject();
+		json.field("name", categories[c].name);
+		json.fieldCents("total", llround(categories[c].total * 100));
+		const BudgetEntry* budget = findBudget(year, month, categories[c].name);
+		if (budget) json.fieldCents("budget", llround(budget->amount * 100));
+		json.endObject();
+	}
+	json.endArray();
+} // `writeJsonCategories` 函数结束。
 
-		// `if (final_confirm == 'y' || final_confirm == 'Y')` // 检查用户是否再次输入了 'y' 或 'Y'。
-		if (final_confirm == 'y' || final_confirm == 'Y') { // 如果用户最终确认删除
-			cout << "\n正在删除记录...\n"; // 打印正在删除的消息。
+// 【`writeJsonReport` 方法实现 - 机器可读的报告】格式见 JsonWriter 上方的说明，错误信息写到 cerr。
+//   list [起始年月 [结束年月]]  全部记录或某段期间的记录 (年月写作 YYYY-MM)
+//   filter "<过滤表达式>"      满足条件的记录
+//   month <YYYY-MM>            该月的记录，最后是一个 "summary" 对象 (与月度统计相同的汇总)
+//   settlement <YYYY-MM>       已结算月份的 "settlement" 对象 (优先读取结算档案)
+bool ExpenseTracker::writeJsonReport(const string& report, const vector<string>& args, bool ndjson) {
+	int years[2] = {0, 0}, months[2] = {0, 0};
+	for (size_t a = 0; a < args.size() && a < 2 && report != "filter"; ++a) {
+		char dash = 0;
+		istringstream in(args[a]);
+		if (!(in >> years[a] >> dash >> months[a]) || dash != '-' || !isValidDate(years[a], months[a], 1)) {
+			cerr << "错误：无效的年月 " << args[a] << " (应为 YYYY-MM)。\n";
+			return false;
+		}
+	}
+	if (report == "list" && args.size() <= 2) {
+		JsonWriter json(cout, ndjson);
+		JsonRecordSink records(json);
+		if (args.empty()) {
+			runQuery(MatchAll(), records);
+		} else {
+			int ty = args.size() == 2 ? years[1] : years[0], tm = args.size() == 2 ? months[1] : months[0];
+			runQuery(MatchDateRange(Date(years[0], months[0], 1), Date(ty, tm, daysInMonth(ty, tm))), records);
+		}
+		json.finish();
+		return true;
+	}
+	if (report == "filter" && args.size() == 1) {
+		FilterExpression filter;
+		string error;
+		if (!parseFilterExpression(args[0], filter, error)) {
+			cerr << "表达式错误：" << error << "\n";
+			return false;
+		}
+		loadPartitionsForFilter(filter);
+		vector<uint32_t> rows = evaluateFilter(filter);
+		JsonWriter json(cout, ndjson);
+		JsonRecordSink records(json);
+		for (size_t k = 0; k < rows.size(); ++k) records.consume(allExpenses[rows[k]]);
+		json.finish();
+		return true;
+	}
+	if (report == "month" && args.size() == 1) {
+		JsonWriter json(cout, ndjson);
+		JsonRecordSink records(json);
+		AggregateSink<ByCategory> summary;
+		TeeSink<JsonRecordSink, AggregateSink<ByCategory> > both(records, summary);
+		runQuery(MatchMonth(years[0], months[0]), both);
+		json.beginRow();
+		json.field("type", "summary");
+		json.field("year", (long long)years[0]);
+		json.field("month", (long long)months[0]);
+		json.field("count", (long long)summary.count);
+		json.fieldCents("total", llround(summary.total * 100));
+		writeJsonCategories(json, years[0], months[0], summary.groups, summary.groupCount);
+		json.endRow();
+		json.finish();
+		return true;
+	}
+	if (report == "settlement" && args.size() == 1) {
+		SettlementReport settled;
+		bool archived = false;
+		auto it = settlementArchive.find(years[0] * 100 + months[0]);
+		if (it != settlementArchive.end()) {
+			settled = it->second;
+			archived = true;
+		} else {
+			int lastYear, lastMonth;
+			readLastSettlement(lastYear, lastMonth);
+			if (years[0] > lastYear || (years[0] == lastYear && months[0] > lastMonth)) {
+				cerr << "错误：该月份尚未结算 (最近结算到 " << lastYear << "年" << lastMonth << "月)。\n";
+				return false;
+			}
+			AggregateSink<ByCategory> summary; // 档案缺失: 重新计算 (不写回档案，批处理输出保持只读)
+			HashSink hasher;
+			TeeSink<AggregateSink<ByCategory>, HashSink> both(summary, hasher);
+			runQuery(MatchMonth(years[0], months[0]), both);
+			settled.year = years[0];
+			settled.month = months[0];
+			settled.recordCount = summary.count;
+			settled.total = summary.total;
+			settled.contentHash = hasher.contentHash;
+			settled.categories.assign(summary.groups, summary.groups + summary.groupCount);
+		}
+		JsonWriter json(cout, ndjson);
+		json.beginRow();
+		json.field("type", "settlement");
+		json.field("year", (long long)settled.year);
+		json.field("month", (long long)settled.month);
+		json.field("count", (long long)settled.recordCount);
+		json.fieldCents("total", llround(settled.total * 100));
+		json.fieldHex("contentHash", settled.contentHash);
+		json.fieldBool("archived", archived);
+		writeJsonCategories(json, settled.year, settled.month, settled.categories.data(), (int)settled.categories.size());
+		json.endRow();
+		json.finish();
+		return true;
+	}
+	cerr << "错误：未知的报告或参数 (可用: list [YYYY-MM [YYYY-MM]] | filter \"<表达式>\" | month YYYY-MM | settlement YYYY-MM)。\n";
+	return false;
+} // `writeJsonReport` 函数结束。
 
-			// 【执行删除操作：通过将后续元素前移来覆盖被删除的元素】
-			// 这个 `for` 循环从要被删除的元素的索引 `indexToDelete` 开始，
-			// 一直遍历到数组中倒数第二个有效元素的索引 (`expenseCount - 1` 是最后一个有效元素的索引，所以 `expenseCount - 2` 是倒数第二个，循环条件 `i < expenseCount - 1` 意味着 `i` 的最大值是 `expenseCount - 2`)。
-			// 在循环体中，`allExpenses[i] = allExpenses[i + 1];` 将第 `i+1` 个元素的值赋给第 `i` 个元素。
-			// 这样做的效果是，从被删除位置开始，后面的所有元素都向前移动了一个位置，从而覆盖掉了原来在 `indexToDelete` 位置的元素。
-			for (int i = indexToDelete; i < expenseCount - 1; ++i) {
-				allExpenses[i] = allExpenses[i + 1]; // 将后一个元素的数据复制到前一个元素的位置。
-			} // 元素前移循环结束。
-			// `expenseCount--;` // 将总的开销记录数 `expenseCount` 减1，因为已经删除了一条记录。
-			expenseCount--; // 更新记录总数。
-			cout << "记录已删除。\n"; // 打印删除成功的消息。
-			saveExpenses(); // 调用 `saveExpenses()` 方法，将删除操作后的数据（即更新后的 `allExpenses` 数组和 `expenseCount`）立即保存到文件中。
-			cout << "数据已自动保存。\n"; // 提示数据已保存。
-		} else { // `else` 分支：如果用户在最终确认时没有输入 'y' 或 'Y' (即取消了删除)
-			cout << "已取消删除操作（二次确认未通过）。\n"; // 打印取消消息。
-		} // 最终确认结束。
-	} else { // `else` 分支：如果用户在第一次确认时没有输入 'y' 或 'Y' (即取消了删除)
-		cout << "取消删除操作。\n"; // 打印取消消息。
-	} // 第一次确认结束。
-} // `deleteExpense` 函数结束。
+// 【`runBatch` 方法实现 - 批处理模式】
+// 用法: 程序名 --filter "<过滤表达式>"
+//       程序名 --delete "<过滤表达式>" [--yes]
+//       程序名 --duplicates
+//       程序名 --sync <另一份账本的目录>
+//       程序名 --import-csv <银行流水 CSV 文件> [--positive-expenses]
+//       程序名 --merge [--union] [--out <输出目录>] <账本1> <账本2> ...
+//       程序名 --external-sort <账本> --out <输出目录> [--memory <MB>]
+//       程序名 --summary <账本> [--year <年份>] [--memory <MB>]
+//       程序名 --cube [YYYY[-MM[-DD]]] [--category <类别>] [--by year|month|day|category]
+//       程序名 --bitmap-index                    (为所有分区建立并保存位图索引)
+//       程序名 --memory-report                   (加载全部分区后打印内存使用报告)
+//       程序名 --anomalies                       (按月列出添加或导入时被标记的异常开销)
+//       程序名 --stress [--threads 1,2,4,...] [--seconds S] [--writes 百分比]   (核心接口的并发压力测试)
+//       程序名 --json|--ndjson <报告> [参数...]   (报告: list / filter / month / settlement，见 writeJsonReport)
+// 不显示菜单，执行一条命令后返回退出码 (0 成功，1 参数或表达式错误)。
+int ExpenseTracker::runBatch(int argc, char* argv[]) {
+	string command = argv[1];
+	if (command == "--filter" && argc == 3) {
+		return printFilterResults(argv[2]) ? 0 : 1;
+	}
+	if (command == "--sync" && argc == 3) {
+		return syncLedger(argv[2]) ? 0 : 1;
+	}
+	if (command == "--import-csv" && (argc == 3 || (argc == 4 && string(argv[3]) == "--positive-expenses"))) {
+		if (!importCsv(argv[2], argc == 3)) return 1;
+		saveExpenses();
+		return 0;
+	}
+	if (command == "--merge") {
+		vector<string> inputs;
+		bool unionMode = false;
+		string outputRoot;
+		for (int a = 2; a < argc; ++a) {
+			string arg = argv[a];
+			if (arg == "--union") unionMode = true;
+			else if (arg == "--out" && a + 1 < argc) outputRoot = argv[++a];
+			else inputs.push_back(arg);
+		}
+		if (!inputs.empty()) return mergeLedgers(inputs, unionMode, outputRoot) ? 0 : 1;
+	}
+	if ((command == "--external-sort" || command == "--summary") && argc >= 3) {
+		string input, outputRoot;
+		int onlyYear = 0;
+		size_t budget = EXTERNAL_SORT_DEFAULT_MEMORY;
+		for (int a = 2; a < argc; ++a) {
+			string arg = argv[a];
+			if (arg == "--out" && a + 1 < argc) outputRoot = argv[++a];
+			else if (arg == "--year" && a + 1 < argc) onlyYear = atoi(argv[++a]);
+			else if (arg == "--memory" && a + 1 < argc) budget = (size_t)max(atoi(argv[++a]), 1) << 20;
+			else input = arg;
+		}
+		if (command == "--summary" && !input.empty()) return streamingSummary(input, onlyYear, budget) ? 0 : 1;
+		if (!input.empty() && !outputRoot.empty()) return externalSortLedger(input, outputRoot, budget) ? 0 : 1;
+	}
+	if (command == "--cube") {
+		CubeSlice slice;
+		string by;
+		bool valid = true;
+		if (!ensureAllPartitionsLoaded()) cerr << "警告：部分月份的数据未能加载，汇总结果不完整。\n";
+		for (int a = 2; a < argc && valid; ++a) {
+			string arg = argv[a];
+			if (arg == "--category" && a + 1 < argc) {
+				string category = normalizeCategoryPath(argv[++a]);
+				slice.categories = cube.categoriesUnder(category);
+				if (slice.categories.empty()) {
+					cout << "没有类别 " << category << " 的记录。\n";
+					return 0;
+				}
+			} else if (arg == "--by" && a + 1 < argc) {
+				by = argv[++a];
+			} else {
+				char dash;
+				istringstream in(arg);
+				valid = (bool)(in >> slice.year) && slice.year > 0;
+				if (valid && in >> dash >> slice.month) valid = dash == '-' && slice.month >= 1 && slice.month <= 12;
+				if (valid && in >> dash >> slice.day) valid = dash == '-' && isValidDate(slice.year, slice.month, slice.day);
+			}
+		}
+		CubeDimension dimension = slice.year == 0 ? CUBE_BY_YEAR : slice.month == 0 ? CUBE_BY_MONTH : slice.day == 0 ? CUBE_BY_DAY : CUBE_BY_CATEGORY;
+		if (by == "year") dimension = CUBE_BY_YEAR;
+		else if (by == "month") dimension = CUBE_BY_MONTH;
+		else if (by == "day") dimension = CUBE_BY_DAY;
+		else if (by == "category") dimension = CUBE_BY_CATEGORY;
+		else if (!by.empty()) valid = false;
+		if (valid) {
+			printCubeRollup(slice, dimension);
+			return 0;
+		}
+	}
+	if (command == "--stress") {
+		vector<int> threadCounts = { 1, 2, 4, 8, 16, 32, 64 };
+		double seconds = 1;
+		int writePercent = 10;
+		bool valid = true;
+		for (int a = 2; a < argc && valid; ++a) {
+			string arg = argv[a];
+			if (arg == "--threads" && a + 1 < argc) {
+				threadCounts.clear();
+				stringstream list(argv[++a]);
+				string item;
+				while (getline(list, item, ',')) {
+					int n = atoi(item.c_str());
+					if (n < 1 || n > 256) valid = false;
+					threadCounts.push_back(n);
+				}
+				if (threadCounts.empty()) valid = false;
+			} else if (arg == "--seconds" && a + 1 < argc) {
+				seconds = atof(argv[++a]);
+				valid = seconds > 0;
+			} else if (arg == "--writes" && a + 1 < argc) {
+				writePercent = atoi(argv[++a]);
+				valid = writePercent >= 0 && writePercent <= 100;
+			} else {
+				valid = false;
+			}
+		}
+		if (valid) {
+			runStressTest(threadCounts, seconds, writePercent);
+			return 0;
+		}
+	}
+	if (command == "--anomalies" && argc == 2) {
+		anomalyReport();
+		return 0;
+	}
+	if (command == "--memory-report" && argc == 2) {
+		ensureAllPartitionsLoaded();
+		refreshColumns(); // 过滤时才建立的列式快照也计入索引
+		memoryReport();
+		return 0;
+	}
+	if (command == "--bitmap-index" && argc == 2) {
+		rebuildBitmapIndex();
+		return 0;
+	}
+	if ((command == "--json" || command == "--ndjson") && argc >= 3) {
+		return writeJsonReport(argv[2], vector<string>(argv + 3, argv + argc), command == "--ndjson") ? 0 : 1;
+	}
+	if (command == "--duplicates" && argc == 2) {
+		showDuplicates();
+		return 0;
+	}
+	if (command == "--delete" && (argc == 3 || (argc == 4 && string(argv[3]) == "--yes"))) {
+		FilterExpression filter;
+		string error;
+		if (!parseFilterExpression(argv[2], filter, error)) {
+			cout << "表达式错误：" << error << "\n";
+			return 1;
+		}
+		if (argc == 3) { // 没有 --yes 时只预览，不删除
+			loadPartitionsForFilter(filter);
+			cout << "满足条件的记录共 " << evaluateFilter(filter).size() << " 条。加上 --yes 参数执行删除。\n";
+			return 0;
+		}
+		bulkDeleteMatching(filter, false);
+		return 0;
+	}
+	cerr << "用法:\n";
+	cerr << "  " << argv[0] << "                         进入交互菜单\n";
+	cerr << "  " << argv[0] << " --filter \"<表达式>\"     按过滤表达式列出记录\n";
+	cerr << "  " << argv[0] << " --delete \"<表达式>\" [--yes]  预览 (加 --yes 时删除) 满足条件的记录\n";
+	cerr << "  " << argv[0] << " --duplicates              列出重复记录\n";
+	cerr << "  " << argv[0] << " --sync <目录>             与另一份账本双向同步\n";
+	cerr << "  " << argv[0] << " --import-csv <文件> [--positive-expenses]  导入银行流水 (默认支出为负数)\n";
+	cerr << "  " << argv[0] << " --merge [--union] [--out <目录>] <账本>...  合并多份账本 (不加 --out 时打印家庭报告)\n";
+	cerr << "  " << argv[0] << " --external-sort <账本> --out <目录> [--memory <MB>]  按日期外部排序，写成新账本 (预算包括记录和字符串)\n";
+	cerr << "  " << argv[0] << " --summary <账本> [--year <年份>] [--memory <MB>]  固定内存的年度/历年汇总\n";
+	cerr << "  " << argv[0] << " --cube [YYYY[-MM[-DD]]] [--category <类别>] [--by year|month|day|category]  多维汇总\n";
+	cerr << "  " << argv[0] << " --json|--ndjson list [YYYY-MM [YYYY-MM]] | filter \"<表达式>\" | month YYYY-MM | settlement YYYY-MM\n";
+	cerr << "                            机器可读的记录列表、月度汇总与结算报告\n";
+	return 1;
+} // `runBatch` 函数结束。
 
 // --- Main Function ---
 // 【`main` 函数 - C++程序的入口点】
 // `int main()` // `main` 是每个C++程序执行开始的地方。操作系统会调用这个函数来启动程序。
               // `int` 表示 `main` 函数在执行完毕后会向操作系统返回一个整数状态码。
               // 通常，返回0表示程序成功执行并正常结束，非0值表示程序遇到了某种错误或异常结束。
-int main() {
+int main(int argc, char* argv[]) {
+	if (argc > 1) { // 带命令行参数时进入批处理模式，执行完命令即退出
+		ExpenseTracker batchTracker(false);
+		return batchTracker.runBatch(argc, argv);
+	}
 	// `ExpenseTracker tracker;` // 创建一个 `ExpenseTracker` 类的对象（实例），并将其命名为 `tracker`。
 	                          // 当这行代码执行时，`ExpenseTracker` 类的构造函数 (`ExpenseTracker::ExpenseTracker()`) 会被自动调用。
 	                          // 构造函数会进行一些初始化工作，比如将 `expenseCount` 初始化为0，尝试从文件加载已有的开销数据 (`loadExpenses()`)，